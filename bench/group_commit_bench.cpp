@@ -0,0 +1,160 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/metrics/metrics.h"
+#include "../src/postgres/group_commit.h"
+#include "../src/postgres/postgres.h"
+#include "../src/postgres/unit_of_work_impl.h"
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+namespace {
+
+constexpr const char DB_URL_ENV_NAME[]{"BOOKYPEDIA_DB_URL"};
+constexpr std::string_view NAME_PREFIX = "group-commit-bench-"sv;
+
+struct Args {
+    std::vector<size_t> sessions{1, 2, 4, 8, 16, 32};
+    std::chrono::seconds duration{5};
+    postgres::GroupCommitConfig group_commit;
+};
+
+struct RunResult {
+    uint64_t commits = 0;
+    uint64_t failures = 0;
+    metrics::Histogram latency_us;
+};
+
+std::vector<size_t> ParseList(std::string_view value) {
+    std::vector<size_t> result;
+    while (!value.empty()) {
+        const auto pos = value.find(',');
+        result.push_back(std::stoull(std::string(value.substr(0, pos))));
+        value.remove_prefix(pos == value.npos ? value.size() : pos + 1);
+    }
+    return result;
+}
+
+Args ParseArgs(int argc, const char* argv[]) {
+    Args args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for "s + std::string(arg));
+        }
+        const std::string value{argv[++i]};
+        if (arg == "--sessions"sv) {
+            args.sessions = ParseList(value);
+        } else if (arg == "--seconds"sv) {
+            args.duration = std::chrono::seconds(std::stoll(value));
+        } else if (arg == "--window-us"sv) {
+            args.group_commit.window = std::chrono::microseconds(std::stoll(value));
+        } else if (arg == "--max-batch"sv) {
+            args.group_commit.max_batch = std::stoull(value);
+        } else {
+            throw std::invalid_argument("Unknown argument "s + std::string(arg)
+                                        + ". Usage: group_commit_bench [--sessions 1,2,4] [--seconds N]"
+                                          " [--window-us N] [--max-batch N]"s);
+        }
+    }
+    return args;
+}
+
+// Каждый сеанс - своё соединение и поток, каждая транзакция - одна вставка автора, как AddAuthor
+RunResult Run(const std::string& url, size_t sessions, std::chrono::seconds duration,
+              postgres::TagIdCache& tag_cache, postgres::GroupCommitter* group_commit) {
+    std::vector<std::unique_ptr<pqxx::connection>> connections;
+    for (size_t i = 0; i < sessions; ++i) {
+        connections.push_back(std::make_unique<pqxx::connection>(url));
+    }
+
+    std::vector<RunResult> results(sessions);
+    std::atomic_bool stop{false};
+    std::vector<std::thread> threads;
+    for (size_t session = 0; session < sessions; ++session) {
+        threads.emplace_back([&, session] {
+            auto& result = results[session];
+            auto& connection = *connections[session];
+            while (!stop.load(std::memory_order_relaxed)) {
+                const auto start = std::chrono::steady_clock::now();
+                try {
+                    postgres::UnitOfWorkImpl unit{connection, tag_cache, group_commit};
+                    const auto id = domain::AuthorId::New();
+                    unit.Authors().Save({id, std::string(NAME_PREFIX) + id.ToString()});
+                    unit.Commit();
+                    ++result.commits;
+                } catch (const postgres::DurabilityUnknown&) {
+                    // Коммит прошёл, не подтвердился только сброс WAL
+                    ++result.commits;
+                } catch (const std::exception&) {
+                    ++result.failures;
+                }
+                const auto elapsed = std::chrono::steady_clock::now() - start;
+                result.latency_us.Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+            }
+        });
+    }
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    RunResult total;
+    for (const auto& result : results) {
+        total.commits += result.commits;
+        total.failures += result.failures;
+        total.latency_us.Merge(result.latency_us);
+    }
+    return total;
+}
+
+void PrintRow(std::string_view mode, size_t sessions, const RunResult& result, std::chrono::seconds duration) {
+    std::cout << std::left << std::setw(8) << mode << std::right << std::setw(10) << sessions
+              << std::setw(14) << std::fixed << std::setprecision(1)
+              << static_cast<double>(result.commits) / static_cast<double>(duration.count())
+              << std::setw(12) << result.latency_us.Quantile(0.5) << std::setw(12) << result.latency_us.Quantile(0.99)
+              << std::setw(10) << result.failures << std::endl;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        const auto args = ParseArgs(argc, argv);
+        const auto* url = std::getenv(DB_URL_ENV_NAME);
+        if (!url) {
+            throw std::runtime_error(DB_URL_ENV_NAME + " environment variable not found"s);
+        }
+        // Метрики сеансов не нужны: латентность меряется здесь же
+        metrics::SetEnabled(false);
+
+        postgres::Database db{pqxx::connection{url}};
+        postgres::GroupCommitter group_commit{url, args.group_commit};
+
+        std::cout << std::left << std::setw(8) << "mode" << std::right << std::setw(10) << "sessions"
+                  << std::setw(14) << "commits/s" << std::setw(12) << "p50, us" << std::setw(12) << "p99, us"
+                  << std::setw(10) << "failed" << std::endl;
+        for (auto sessions : args.sessions) {
+            PrintRow("single"sv, sessions, Run(url, sessions, args.duration, db.GetTagCache(), nullptr), args.duration);
+            PrintRow("group"sv, sessions, Run(url, sessions, args.duration, db.GetTagCache(), &group_commit),
+                     args.duration);
+        }
+
+        pqxx::work cleanup{db.GetConnection()};
+        cleanup.exec_params("DELETE FROM authors WHERE name LIKE $1;"_zv, std::string(NAME_PREFIX) + "%");
+        cleanup.commit();
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,389 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../src/app/executor.h"
+#include "../src/app/use_cases_impl.h"
+#include "../src/metrics/metrics.h"
+#include "../src/unit/unit_of_work_factory.h"
+
+using namespace std::literals;
+
+namespace {
+
+constexpr const char DB_URL_ENV_NAME[]{"BOOKYPEDIA_DB_URL"};
+constexpr std::string_view NAME_PREFIX = "load-test-"sv;
+
+// Операции повторяют команды View, в том же порядке вызовов сценариев
+enum class Op { ADD_AUTHOR, ADD_BOOK, EDIT_BOOK, SHOW_BOOK, SHOW_BOOKS, SHOW_AUTHORS, SHOW_AUTHOR_BOOKS, DELETE_BOOK };
+constexpr size_t OP_COUNT = 8;
+constexpr std::array<std::string_view, OP_COUNT> OP_NAMES{
+    "add_author"sv, "add_book"sv, "edit_book"sv, "show_book"sv,
+    "show_books"sv, "show_authors"sv, "show_author_books"sv, "delete_book"sv,
+};
+
+enum class ThinkModel { NONE, FIXED, EXPONENTIAL };
+
+struct Args {
+    size_t users = 8;
+    std::chrono::seconds duration{10};
+    // Веса операций; по умолчанию чтения преобладают, как у интерактивного пользователя
+    std::array<double, OP_COUNT> weights{1, 4, 2, 10, 4, 4, 4, 1};
+    ThinkModel think = ThinkModel::NONE;
+    std::chrono::microseconds think_time{0};
+    uint64_t seed = std::random_device{}();
+    std::string output;
+};
+
+struct OpStats {
+    uint64_t count = 0;
+    uint64_t errors = 0;
+    metrics::Histogram latency_us;
+};
+
+using UserStats = std::array<OpStats, OP_COUNT>;
+
+std::vector<std::string_view> Split(std::string_view value, char separator) {
+    std::vector<std::string_view> result;
+    while (!value.empty()) {
+        const auto pos = value.find(separator);
+        result.push_back(value.substr(0, pos));
+        value.remove_prefix(pos == value.npos ? value.size() : pos + 1);
+    }
+    return result;
+}
+
+// "show_book=10,add_book=2": не названные операции получают вес 0
+std::array<double, OP_COUNT> ParseMix(std::string_view value) {
+    std::array<double, OP_COUNT> weights{};
+    for (const auto item : Split(value, ',')) {
+        const auto eq = item.find('=');
+        const auto name = item.substr(0, eq);
+        size_t op = 0;
+        while (op < OP_COUNT && OP_NAMES[op] != name) {
+            ++op;
+        }
+        if (op == OP_COUNT || eq == item.npos) {
+            throw std::invalid_argument("Bad mix entry "s + std::string(item));
+        }
+        weights[op] = std::stod(std::string(item.substr(eq + 1)));
+    }
+    return weights;
+}
+
+Args ParseArgs(int argc, const char* argv[]) {
+    Args args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for "s + std::string(arg));
+        }
+        const std::string value{argv[++i]};
+        if (arg == "--users"sv) {
+            args.users = std::stoull(value);
+        } else if (arg == "--seconds"sv) {
+            args.duration = std::chrono::seconds(std::stoll(value));
+        } else if (arg == "--mix"sv) {
+            args.weights = ParseMix(value);
+        } else if (arg == "--think"sv) {
+            if (value == "none"sv) {
+                args.think = ThinkModel::NONE;
+            } else if (value == "fixed"sv) {
+                args.think = ThinkModel::FIXED;
+            } else if (value == "exp"sv) {
+                args.think = ThinkModel::EXPONENTIAL;
+            } else {
+                throw std::invalid_argument("Think model must be none, fixed or exp"s);
+            }
+        } else if (arg == "--think-ms"sv) {
+            args.think_time = std::chrono::microseconds(static_cast<int64_t>(std::stod(value) * 1000));
+            if (args.think == ThinkModel::NONE) {
+                args.think = ThinkModel::EXPONENTIAL;
+            }
+        } else if (arg == "--seed"sv) {
+            args.seed = std::stoull(value);
+        } else if (arg == "--output"sv) {
+            args.output = value;
+        } else {
+            throw std::invalid_argument("Unknown argument "s + std::string(arg)
+                                        + ". Usage: load_test [--users N] [--seconds N] [--mix op=weight,...]"
+                                          " [--think none|fixed|exp] [--think-ms N] [--seed N] [--output FILE]"s);
+        }
+    }
+    if (args.users == 0) {
+        throw std::invalid_argument("At least one user is required"s);
+    }
+    return args;
+}
+
+/**
+ * Пользователь со своим соединением и UseCasesImpl. Пишет только в своих авторов и книги,
+ * поэтому ошибки - это отказы хранилища, а не ожидаемые конфликты версий между пользователями.
+ * Читает весь каталог, как это делают подсказки выбора книги и автора.
+ */
+class User {
+public:
+    User(app::UnitOfWorkFactory& factory, size_t index, uint64_t seed)
+        : use_cases_{factory}
+        , prefix_{std::string(NAME_PREFIX) + std::to_string(index) + "-"s}
+        , random_{seed} {
+    }
+
+    void Run(const Args& args, const std::atomic_bool& stop, UserStats& stats) {
+        std::discrete_distribution<size_t> pick_op{args.weights.begin(), args.weights.end()};
+        while (!stop.load(std::memory_order_relaxed)) {
+            const auto op = static_cast<Op>(pick_op(random_));
+            auto& op_stats = stats[static_cast<size_t>(op)];
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                Execute(op);
+            } catch (const std::exception&) {
+                ++op_stats.errors;
+                Rollback();
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            ++op_stats.count;
+            op_stats.latency_us.Record(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+            Think(args);
+        }
+    }
+
+    // Созданные пользователем авторы; их книги и теги удаляются вместе с ними
+    const std::vector<std::string>& GetAuthors() const noexcept {
+        return authors_;
+    }
+
+private:
+    void Execute(Op op) {
+        switch (op) {
+            case Op::ADD_AUTHOR:
+                authors_.push_back(use_cases_.AddAuthor(prefix_ + std::to_string(next_name_++)));
+                use_cases_.Commit();
+                return;
+            case Op::ADD_BOOK: {
+                if (authors_.empty()) {
+                    return Execute(Op::ADD_AUTHOR);
+                }
+                const auto title = prefix_ + "book-"s + std::to_string(next_name_++);
+                const auto id = use_cases_.AddBook(RandomYear(), Pick(authors_), title);
+                use_cases_.AddTags(id, {"tag-"s + std::to_string(next_name_ % 50), "load-test"s});
+                use_cases_.Commit();
+                books_.push_back(title);
+                return;
+            }
+            case Op::EDIT_BOOK: {
+                if (books_.empty()) {
+                    return Execute(Op::ADD_BOOK);
+                }
+                auto books = use_cases_.FindBooksByTitle(Pick(books_));
+                if (books.empty()) {
+                    throw std::runtime_error("Own book is missing");
+                }
+                const auto& book = books.front();
+                use_cases_.EditBook(book.id, book.version, book.title, RandomYear(),
+                                    {"tag-"s + std::to_string(next_name_++ % 50)});
+                use_cases_.Commit();
+                return;
+            }
+            case Op::SHOW_BOOK: {
+                const auto books = use_cases_.GetBooks();
+                if (!books.empty()) {
+                    use_cases_.GetTagsByBookId(books[Index(books.size())].id);
+                }
+                use_cases_.FinishRead();
+                return;
+            }
+            case Op::SHOW_BOOKS:
+                use_cases_.GetBooks();
+                use_cases_.FinishRead();
+                return;
+            case Op::SHOW_AUTHORS:
+                use_cases_.GetAuthors();
+                use_cases_.FinishRead();
+                return;
+            case Op::SHOW_AUTHOR_BOOKS: {
+                const auto authors = use_cases_.GetAuthors();
+                if (!authors.empty()) {
+                    use_cases_.GetBooksAuthors(authors[Index(authors.size())].id);
+                }
+                use_cases_.FinishRead();
+                return;
+            }
+            case Op::DELETE_BOOK: {
+                if (books_.empty()) {
+                    return Execute(Op::ADD_BOOK);
+                }
+                const auto index = Index(books_.size());
+                auto books = use_cases_.FindBooksByTitle(books_[index]);
+                books_.erase(books_.begin() + static_cast<std::ptrdiff_t>(index));
+                if (!books.empty()) {
+                    use_cases_.DeleteBookAndDependencies(books.front().id);
+                }
+                use_cases_.Commit();
+                return;
+            }
+        }
+    }
+
+    void Rollback() {
+        try {
+            use_cases_.Rollback();
+        } catch (const std::exception&) {
+            // Следующая операция получит новую единицу работы
+        }
+    }
+
+    void Think(const Args& args) {
+        if (args.think == ThinkModel::NONE || args.think_time.count() == 0) {
+            return;
+        }
+        auto pause = args.think_time;
+        if (args.think == ThinkModel::EXPONENTIAL) {
+            std::exponential_distribution<double> distribution{1.0 / static_cast<double>(args.think_time.count())};
+            pause = std::chrono::microseconds(static_cast<int64_t>(distribution(random_)));
+        }
+        std::this_thread::sleep_for(pause);
+    }
+
+    size_t Index(size_t size) {
+        return std::uniform_int_distribution<size_t>{0, size - 1}(random_);
+    }
+    const std::string& Pick(const std::vector<std::string>& values) {
+        return values[Index(values.size())];
+    }
+    int RandomYear() {
+        return std::uniform_int_distribution<int>{1800, 2024}(random_);
+    }
+
+    app::UseCasesImpl use_cases_;
+    std::string prefix_;
+    std::mt19937_64 random_;
+    uint64_t next_name_ = 0;
+    std::vector<std::string> authors_;
+    std::vector<std::string> books_;
+};
+
+void WriteOpJson(std::ostream& out, const OpStats& stats, std::chrono::seconds duration) {
+    const auto& h = stats.latency_us;
+    out << "{\"count\": " << stats.count << ", \"errors\": " << stats.errors << ", \"error_rate\": "
+        << (stats.count == 0 ? 0.0 : static_cast<double>(stats.errors) / static_cast<double>(stats.count))
+        << ", \"throughput\": " << static_cast<double>(stats.count) / static_cast<double>(duration.count())
+        << ", \"p50_us\": " << h.Quantile(0.5) << ", \"p99_us\": " << h.Quantile(0.99)
+        << ", \"p999_us\": " << h.Quantile(0.999) << ", \"max_us\": " << h.Max() << "}";
+}
+
+// Машиночитаемая сводка; квантили - верхние границы корзин гистограммы, погрешность до 1/16
+void WriteSummary(std::ostream& out, const Args& args, const UserStats& stats) {
+    OpStats total;
+    for (const auto& op : stats) {
+        total.count += op.count;
+        total.errors += op.errors;
+        total.latency_us.Merge(op.latency_us);
+    }
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"users\": " << args.users << ",\n  \"seconds\": " << args.duration.count()
+        << ",\n  \"seed\": " << args.seed << ",\n  \"operations\": {";
+    bool first = true;
+    for (size_t op = 0; op < OP_COUNT; ++op) {
+        if (stats[op].count == 0) {
+            continue;
+        }
+        out << (first ? "\n" : ",\n") << "    \"" << OP_NAMES[op] << "\": ";
+        WriteOpJson(out, stats[op], args.duration);
+        first = false;
+    }
+    out << "\n  },\n  \"total\": ";
+    WriteOpJson(out, total, args.duration);
+    out << "\n}\n";
+}
+
+// Удаляет всё, что создали пользователи: авторы независимы, удаления идут параллельно на args.users соединениях
+void Cleanup(const app::StorageConfig& storage, const Args& args, const std::vector<std::unique_ptr<User>>& users) {
+    std::vector<std::string> authors;
+    for (const auto& user : users) {
+        authors.insert(authors.end(), user->GetAuthors().begin(), user->GetAuthors().end());
+    }
+    app::ExecutorConfig config;
+    config.threads = args.users;
+    config.max_connections = args.users;
+    app::UseCaseExecutor executor{[&storage] {
+        return app::MakeUnitOfWorkFactory(storage);
+    }, config};
+    auto deleted = executor.SubmitBatch(authors.begin(), authors.end(),
+                                        [](app::UseCases& use_cases, const std::string& author_id) {
+                                            use_cases.DeleteAuthorAndDependencies(author_id);
+                                        });
+    for (auto& future : deleted) {
+        future.get();
+    }
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    try {
+        const auto args = ParseArgs(argc, argv);
+        const auto* url = std::getenv(DB_URL_ENV_NAME);
+        if (!url) {
+            throw std::runtime_error(DB_URL_ENV_NAME + " environment variable not found"s);
+        }
+        // Латентность меряется здесь же, по операциям пользователя
+        metrics::SetEnabled(false);
+
+        app::StorageConfig storage;
+        storage.urls.emplace_back(url);
+        std::vector<std::unique_ptr<app::UnitOfWorkFactory>> factories;
+        std::vector<std::unique_ptr<User>> users;
+        std::mt19937_64 seeds{args.seed};
+        for (size_t i = 0; i < args.users; ++i) {
+            factories.push_back(app::MakeUnitOfWorkFactory(storage));
+            users.push_back(std::make_unique<User>(*factories.back(), i, seeds()));
+        }
+
+        std::vector<UserStats> stats(args.users);
+        std::atomic_bool stop{false};
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < args.users; ++i) {
+            threads.emplace_back([&, i] {
+                users[i]->Run(args, stop, stats[i]);
+            });
+        }
+        std::this_thread::sleep_for(args.duration);
+        stop = true;
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        Cleanup(storage, args, users);
+
+        UserStats merged;
+        for (const auto& user_stats : stats) {
+            for (size_t op = 0; op < OP_COUNT; ++op) {
+                merged[op].count += user_stats[op].count;
+                merged[op].errors += user_stats[op].errors;
+                merged[op].latency_us.Merge(user_stats[op].latency_us);
+            }
+        }
+        if (args.output.empty()) {
+            WriteSummary(std::cout, args, merged);
+        } else {
+            std::ofstream out{args.output};
+            WriteSummary(out, args, merged);
+            if (!out) {
+                throw std::runtime_error("Can't write "s + args.output);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
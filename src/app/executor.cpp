@@ -0,0 +1,123 @@
+#include "executor.h"
+
+#include <algorithm>
+
+#include "../metrics/metrics.h"
+
+namespace app {
+
+namespace {
+
+// Индекс очереди потока исполнителя, из которого идёт вызов; задачи, поставленные
+// из задачи, попадают в очередь того же потока
+thread_local const UseCaseExecutor* current_executor = nullptr;
+thread_local size_t current_queue = 0;
+
+}  // namespace
+
+UseCaseExecutor::UseCaseExecutor(const factory_maker_t& make_factory, ExecutorConfig config) {
+    auto threads = config.threads != 0 ? config.threads : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    threads = std::max<size_t>(std::min(threads, config.max_connections), 1);
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->factory = make_factory();
+        worker->use_cases = std::make_unique<UseCasesImpl>(*worker->factory);
+        worker->use_cases->SetCallTimeout(config.call_timeout);
+        workers_.push_back(std::move(worker));
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        workers_[i]->thread = std::thread([this, i] {
+            Run(i);
+        });
+    }
+}
+
+UseCaseExecutor::~UseCaseExecutor() {
+    {
+        std::lock_guard lock{wake_mutex_};
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+size_t UseCaseExecutor::NextQueue() noexcept {
+    if (current_executor == this) {
+        return current_queue;
+    }
+    return next_queue_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+}
+
+void UseCaseExecutor::Push(task_t task, size_t queue) {
+    auto& worker = *workers_[queue % workers_.size()];
+    {
+        std::lock_guard lock{worker.mutex};
+        worker.tasks.push_back(std::move(task));
+    }
+    {
+        // Счётчик растёт, когда задача уже в очереди: проснувшийся поток её найдёт
+        std::lock_guard lock{wake_mutex_};
+        ++pushed_;
+    }
+    wake_.notify_one();
+}
+
+bool UseCaseExecutor::Pop(size_t index, task_t& task) {
+    static auto& steals = metrics::GetCounter("executor_steals");
+    {
+        auto& own = *workers_[index];
+        std::lock_guard lock{own.mutex};
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < workers_.size(); ++offset) {
+        auto& victim = *workers_[(index + offset) % workers_.size()];
+        std::lock_guard lock{victim.mutex};
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals.Increment();
+            return true;
+        }
+    }
+    return false;
+}
+
+void UseCaseExecutor::Run(size_t index) {
+    static auto& completed = metrics::GetCounter("executor_tasks");
+    current_executor = this;
+    current_queue = index;
+    auto& use_cases = *workers_[index]->use_cases;
+    task_t task;
+    while (true) {
+        // Запоминается до поиска: задача, поставленная после, изменит pushed_ и не даст уснуть
+        uint64_t seen = 0;
+        {
+            std::lock_guard lock{wake_mutex_};
+            seen = pushed_;
+        }
+        if (Pop(index, task)) {
+            // Исключение задачи уже лежит в её future
+            task(use_cases);
+            task = nullptr;
+            completed.Increment();
+            continue;
+        }
+        std::unique_lock lock{wake_mutex_};
+        wake_.wait(lock, [this, seen] {
+            return stopping_ || pushed_ != seen;
+        });
+        // Очереди пусты, и с момента поиска ничего не поставили
+        if (stopping_ && pushed_ == seen) {
+            return;
+        }
+    }
+}
+
+}  // namespace app
@@ -0,0 +1,144 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "../metrics/trace.h"
+#include "../unit/unit_of_work_factory.h"
+#include "use_cases_impl.h"
+
+namespace app {
+
+struct ExecutorConfig {
+    // 0 - по числу ядер
+    size_t threads = 0;
+    // У каждого потока своё хранилище и своё соединение, потоков не больше стольких
+    size_t max_connections = 8;
+    // Срок каждого вызова сценария в задаче, как UseCasesImpl::SetCallTimeout. 0 - без срока
+    std::chrono::milliseconds call_timeout{0};
+};
+
+/**
+ * Потокобезопасный исполнитель сценариев. У каждого потока своя фабрика единиц работы
+ * (своё соединение) и свой UseCasesImpl; задача выполняется в отдельной единице работы,
+ * которая коммитится, если задача завершилась без исключения, и откатывается иначе.
+ *
+ * Очереди у потоков свои: поток берёт задачи с конца своей очереди, а опустев,
+ * забирает с начала чужих. Задачи не должны ждать futures других задач этого же исполнителя -
+ * поток, занятый ожиданием, не выполняет задачи из очереди.
+ */
+class UseCaseExecutor {
+public:
+    using factory_maker_t = std::function<std::unique_ptr<UnitOfWorkFactory>()>;
+
+    // make_factory вызывается по разу на поток, в конструкторе
+    explicit UseCaseExecutor(const factory_maker_t& make_factory, ExecutorConfig config = {});
+    // Дожидается выполнения уже поставленных задач
+    ~UseCaseExecutor();
+
+    UseCaseExecutor(const UseCaseExecutor&) = delete;
+    UseCaseExecutor& operator=(const UseCaseExecutor&) = delete;
+
+    size_t ThreadCount() const noexcept {
+        return workers_.size();
+    }
+
+    // fn(UseCases&) выполняется в своей единице работы
+    template <typename Fn>
+    auto Submit(Fn fn) -> std::future<std::invoke_result_t<Fn&, UseCases&>> {
+        auto [task, future] = MakeTask(std::move(fn));
+        Push(std::move(task), NextQueue());
+        return std::move(future);
+    }
+
+    // fn(UseCases&, item) для каждого элемента; каждый вызов - своя задача и своя единица работы.
+    // Элементы раскладываются по очередям потоков подряд идущими кусками
+    template <typename It, typename Fn>
+    auto SubmitBatch(It first, It last, Fn fn)
+        -> std::vector<std::future<std::invoke_result_t<Fn&, UseCases&, decltype(*first)>>> {
+        using result_t = std::invoke_result_t<Fn&, UseCases&, decltype(*first)>;
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        std::vector<std::future<result_t>> futures;
+        futures.reserve(count);
+        for (size_t i = 0; first != last; ++first, ++i) {
+            auto [task, future] = MakeTask([fn, item = *first](UseCases& use_cases) mutable {
+                return fn(use_cases, item);
+            });
+            Push(std::move(task), BatchQueue(i, count, workers_.size()));
+            futures.push_back(std::move(future));
+        }
+        return futures;
+    }
+
+    // Очередь index-го из count элементов пакета: queues кусков по ceil(count / queues) подряд идущих элементов
+    static size_t BatchQueue(size_t index, size_t count, size_t queues) noexcept {
+        return index / ((count + queues - 1) / queues);
+    }
+
+private:
+    using task_t = std::function<void(UseCasesImpl&)>;
+
+    struct Worker {
+        std::unique_ptr<UnitOfWorkFactory> factory;
+        std::unique_ptr<UseCasesImpl> use_cases;
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+        std::thread thread;
+    };
+
+    template <typename Fn>
+    static auto MakeTask(Fn fn) {
+        using result_t = std::invoke_result_t<Fn&, UseCases&>;
+        // packaged_task только перемещается, а std::function требует копирования
+        auto packaged = std::make_shared<std::packaged_task<result_t(UseCasesImpl&)>>(
+            [fn = std::move(fn)](UseCasesImpl& use_cases) mutable -> result_t {
+                try {
+                    if constexpr (std::is_void_v<result_t>) {
+                        fn(use_cases);
+                        use_cases.Commit();
+                    } else {
+                        auto result = fn(use_cases);
+                        use_cases.Commit();
+                        return result;
+                    }
+                } catch (...) {
+                    use_cases.Rollback();
+                    throw;
+                }
+            });
+        auto future = packaged->get_future();
+        // Интервалы задачи в трассе вложены в интервал, из которого её поставили
+        return std::make_pair(task_t{[packaged, trace = metrics::TraceContext::Current()](UseCasesImpl& use_cases) {
+                                  metrics::ScopedTraceContext scope{trace};
+                                  (*packaged)(use_cases);
+                              }},
+                              std::move(future));
+    }
+
+    size_t NextQueue() noexcept;
+    void Push(task_t task, size_t queue);
+    bool Pop(size_t index, task_t& task);
+    void Run(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> next_queue_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    // Число задач, поставленных в очереди. Поток, не нашедший задачи, спит, пока оно не изменится
+    uint64_t pushed_ = 0;
+    bool stopping_ = false;
+};
+
+}  // namespace app
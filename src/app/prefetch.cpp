@@ -0,0 +1,119 @@
+#include "prefetch.h"
+
+#include "../domain/tag.h"
+#include "../metrics/metrics.h"
+
+namespace app {
+
+BookDetailPrefetcher::BookDetailPrefetcher(factory_maker_t make_factory, PrefetchConfig config)
+    : make_factory_{std::move(make_factory)}
+    , config_{config}
+    , thread_{[this] {
+        Run();
+    }} {
+}
+
+BookDetailPrefetcher::~BookDetailPrefetcher() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+        ++generation_;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+void BookDetailPrefetcher::Prefetch(std::vector<std::string> book_ids) {
+    if (book_ids.size() > config_.max_books) {
+        book_ids.resize(config_.max_books);
+    }
+    {
+        std::lock_guard lock{mutex_};
+        ++generation_;
+        entries_.clear();
+        pending_ = std::move(book_ids);
+    }
+    wake_.notify_all();
+}
+
+void BookDetailPrefetcher::Clear() {
+    std::lock_guard lock{mutex_};
+    ++generation_;
+    entries_.clear();
+    pending_.clear();
+}
+
+std::optional<std::vector<std::string>> BookDetailPrefetcher::FindTags(const std::string& book_id) {
+    std::lock_guard lock{mutex_};
+    const auto it = entries_.find(book_id);
+    if (it == entries_.end()) {
+        return std::nullopt;
+    }
+    if (std::chrono::steady_clock::now() - it->second.fetched_at > config_.max_age) {
+        entries_.erase(it);
+        return std::nullopt;
+    }
+    return it->second.tags;
+}
+
+void BookDetailPrefetcher::WaitIdle() {
+    std::unique_lock lock{mutex_};
+    idle_.wait(lock, [this] {
+        return !busy_ && pending_.empty();
+    });
+}
+
+void BookDetailPrefetcher::Run() {
+    std::unique_lock lock{mutex_};
+    while (true) {
+        wake_.wait(lock, [this] {
+            return stopping_ || !pending_.empty();
+        });
+        if (stopping_) {
+            return;
+        }
+        auto book_ids = std::move(pending_);
+        pending_.clear();
+        const auto generation = generation_.load();
+        busy_ = true;
+        lock.unlock();
+        Fetch(book_ids, generation);
+        lock.lock();
+        busy_ = false;
+        idle_.notify_all();
+    }
+}
+
+void BookDetailPrefetcher::Fetch(const std::vector<std::string>& book_ids, uint64_t generation) {
+    static auto& fetched = metrics::GetCounter("prefetch_books");
+    static auto& failures = metrics::GetCounter("prefetch_failures");
+    try {
+        if (!factory_) {
+            factory_ = make_factory_();
+        }
+        // Только чтение: единица работы откатывается при разрушении
+        auto unit = factory_->CreateUnitOfWork();
+        for (const auto& book_id : book_ids) {
+            if (generation_.load() != generation) {
+                return;
+            }
+            Entry entry;
+            for (const auto& tag : unit->Tags().GetTagsByBookId(domain::BookId::FromString(book_id))) {
+                entry.tags.push_back(tag.GetTag());
+            }
+            entry.fetched_at = std::chrono::steady_clock::now();
+            std::lock_guard lock{mutex_};
+            // Пока шёл запрос, выборку могли отменить - её результат уже не нужен
+            if (generation_.load() != generation) {
+                return;
+            }
+            entries_.insert_or_assign(book_id, std::move(entry));
+            fetched.Increment();
+        }
+    } catch (const std::exception&) {
+        // Загрузка - только ускорение: книга без деталей прочитается обычным запросом
+        failures.Increment();
+    }
+}
+
+}  // namespace app
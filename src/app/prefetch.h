@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../unit/unit_of_work_factory.h"
+
+namespace app {
+
+struct PrefetchConfig {
+    // Из показанного списка загружаются только первые столько книг
+    size_t max_books = 64;
+    // Загруженные детали действительны столько времени: другие сеансы могли их изменить
+    std::chrono::milliseconds max_age{10000};
+};
+
+/**
+ * Загружает теги книг из списка, пока пользователь выбирает книгу. Работает в своём потоке
+ * через свою фабрику единиц работы, то есть на отдельном соединении; фабрика создаётся при
+ * первой выборке, чтобы не удлинять запуск. Новая выборка отменяет незаконченную предыдущую
+ * и заменяет её результаты.
+ *
+ * Транзакция сеанса и соединение загрузчика не видят незакоммиченных изменений друг друга,
+ * поэтому после записи сеанса результаты нужно сбросить (Clear).
+ */
+class BookDetailPrefetcher {
+public:
+    using factory_maker_t = std::function<std::unique_ptr<UnitOfWorkFactory>()>;
+
+    explicit BookDetailPrefetcher(factory_maker_t make_factory, PrefetchConfig config = {});
+    ~BookDetailPrefetcher();
+
+    BookDetailPrefetcher(const BookDetailPrefetcher&) = delete;
+    BookDetailPrefetcher& operator=(const BookDetailPrefetcher&) = delete;
+
+    void Prefetch(std::vector<std::string> book_ids);
+    // Отменяет загрузку и забывает загруженное
+    void Clear();
+    // Теги книги, если они уже загружены и не устарели
+    std::optional<std::vector<std::string>> FindTags(const std::string& book_id);
+    // Ждёт, пока текущая выборка загрузится или будет отменена
+    void WaitIdle();
+
+private:
+    struct Entry {
+        std::vector<std::string> tags;
+        std::chrono::steady_clock::time_point fetched_at;
+    };
+
+    void Run();
+    void Fetch(const std::vector<std::string>& book_ids, uint64_t generation);
+
+    const factory_maker_t make_factory_;
+    const PrefetchConfig config_;
+    // Создаётся и используется только потоком загрузчика
+    std::unique_ptr<UnitOfWorkFactory> factory_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<std::string> pending_;
+    bool busy_ = false;
+    bool stopping_ = false;
+    // Меняется при каждой выборке и отмене; загрузка старой выборки останавливается
+    std::atomic<uint64_t> generation_{0};
+    std::unordered_map<std::string, Entry> entries_;
+    std::thread thread_;
+};
+
+}  // namespace app
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <functional>
 #include <vector>
 #include <string>
+#include <utility>
 #include <optional>
 #include "../unit/unit_of_work.h"
 
@@ -18,6 +20,7 @@ struct AddBookParams {
 struct AuthorInfo {
     std::string id;
     std::string name;
+    int version = 0;
 };
 
 struct BookInfo {
@@ -25,6 +28,26 @@ struct BookInfo {
     int publication_year;
     std::string author_name;
     std::string id;
+    int version = 0;
+};
+
+struct BooksPage {
+    std::vector<BookInfo> books;
+    // Передаётся в следующий запрос той же выборки; пусто - страниц больше нет
+    std::string next_page;
+};
+
+struct CountInfo {
+    std::string name;
+    int books = 0;
+};
+
+struct CatalogStats {
+    int books = 0;
+    std::vector<CountInfo> top_authors;
+    std::vector<CountInfo> top_tags;
+    // Год и число книг, по возрастанию года
+    std::vector<std::pair<int, int>> books_per_year;
 };
 
 }  // namespace detail
@@ -38,9 +61,23 @@ public:
 
     virtual void Commit() {}
     virtual void Rollback() {}
+    // Завершает транзакцию, в которой только читали, чтобы не держать её, пока пользователь думает
+    virtual void FinishRead() {}
+    // Пользователь выбирает книгу из books: детали можно загрузить заранее, пока он думает.
+    // CancelPrefetch - выбор отменён, загрузка больше не нужна
+    virtual void PrefetchBookDetails(const books_list_t & /*books*/) {}
+    virtual void CancelPrefetch() {}
+    // Описания уже закоммиченных изменений, которые хранилище потом отвергло (отложенная запись).
+    // Каждое отдаётся один раз
+    virtual std::vector<std::string> TakeRejectedWrites() {
+        return {};
+    }
 
-    virtual void EditBook(const std::string & book_id, const std::string & title, int publication_year, const std::vector<std::string> & tags) = 0;
-    virtual void EditAuthorName(const std::string & author_id, const std::string & author_new_name) = 0;
+    // version - версия, прочитанная перед редактированием (0 - без проверки).
+    // Если запись успели изменить, бросается domain::VersionConflict.
+    // Возвращает false, если книга и её теги уже были такими
+    virtual bool EditBook(const std::string & book_id, int version, const std::string & title, int publication_year, const std::vector<std::string> & tags) = 0;
+    virtual void EditAuthorName(const std::string & author_id, int version, const std::string & author_new_name) = 0;
     virtual void DeleteAuthorAndDependenciesByName(const std::string & author_name) = 0;
     virtual void DeleteAuthorAndDependencies(const std::string & author_id) = 0;
     virtual void DeleteBookAndDependencies (std::string & book_id) = 0;
@@ -54,6 +91,20 @@ public:
     virtual std::optional<detail::AuthorInfo> FindAuthorByName(const std::string & name) = 0;
     virtual books_list_t FindBooksByTitle(const std::string & title) = 0;
     virtual tag_list_t GetTagsByBookId(const std::string &) = 0;
+    // Книги, изданные с from_year по to_year включительно, по году, названию и id.
+    // author_id пуст - книги всех авторов; page - next_page предыдущей страницы или пусто для первой
+    virtual detail::BooksPage GetBooksByYearRange(int from_year, int to_year, const std::string & author_id,
+                                                  const std::string & page, size_t limit) = 0;
+
+    // Счётчики хранилища, без обхода каталога. top - сколько авторов и тегов показать
+    virtual detail::CatalogStats GetCatalogStats(size_t top) = 0;
+    virtual int CountAuthorBooks(const std::string & author_id) = 0;
+    // Сверяет счётчики с полным пересчётом. Пусто, если всё сходится
+    virtual std::vector<std::string> CheckStats() = 0;
+
+    // Потоковые варианты GetAuthors/GetBooks для больших выгрузок
+    virtual void ForEachAuthor(const std::function<void(const detail::AuthorInfo &)> & visitor) = 0;
+    virtual void ForEachBook(const std::function<void(const detail::BookInfo &)> & visitor) = 0;
 protected:
     ~UseCases() = default;
 };
@@ -1,52 +1,196 @@
 #include "use_cases_impl.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 #include "../domain/author.h"
 #include "../domain/book.h"
+#include "../metrics/metrics.h"
 
 namespace app {
 using namespace domain;
+using namespace std::literals;
+
+namespace {
+
+metrics::LatencyMetric& UseCaseLatency(std::string_view name) {
+    return metrics::Latency(metrics::Scope::USE_CASE, name);
+}
+
+// Ключ последней книги страницы: "<год>:<id>:<название>", название последним - в нём может быть ':'
+std::string EncodePage(const Book & book) {
+    return std::to_string(book.GetYear()) + ":"s + book.GetId().ToString() + ":"s + book.GetTitle();
+}
+
+BookKey DecodePage(const std::string & page) {
+    const auto year_end = page.find(':');
+    const auto id_end = year_end == std::string::npos ? std::string::npos : year_end + 1 + util::detail::UUID_TEXT_SIZE;
+    if(year_end == std::string::npos || id_end >= page.size() || page[id_end] != ':')
+        throw std::invalid_argument("Malformed page token");
+    return BookKey{std::stoi(page.substr(0, year_end)), page.substr(id_end + 1),
+                   BookId::FromString(std::string_view{page}.substr(year_end + 1, util::detail::UUID_TEXT_SIZE))};
+}
+
+}  // namespace
+
+UseCasesImpl::CallDeadline::CallDeadline(UseCasesImpl & use_cases) {
+    if(use_cases.call_timeout_.count() <= 0)
+        return;
+    unit_ = use_cases.last_unit_of_work_;
+    unit_->SetDeadline(std::chrono::steady_clock::now() + use_cases.call_timeout_);
+}
+
+UseCasesImpl::CallDeadline::~CallDeadline() {
+    if(unit_)
+        unit_->ClearDeadline();
+}
 
-void UseCasesImpl::EditBook(const std::string& book_id,
+void UseCasesImpl::Commit() {
+    if(batch_size_ <= 1) {
+        CommitUnit();
+        return;
+    }
+    last_unit_of_work_->ReleaseSavepoint();
+    ++batch_stats_.committed_commands;
+    if(++pending_commands_ >= batch_size_) {
+        CommitUnit();
+    }
+    last_unit_of_work_->BeginSavepoint();
+}
+
+void UseCasesImpl::Rollback() {
+    if(batch_size_ <= 1) {
+        last_unit_of_work_.reset();
+        last_unit_of_work_ = unit_factory_.CreateUnitOfWork();
+        return;
+    }
+    ++batch_stats_.failed_commands;
+    try {
+        last_unit_of_work_->RollbackToSavepoint();
+    } catch (const std::exception& ex) {
+        auto lost = pending_commands_;
+        pending_commands_ = 0;
+        last_unit_of_work_.reset();
+        last_unit_of_work_ = unit_factory_.CreateUnitOfWork();
+        last_unit_of_work_->BeginSavepoint();
+        throw std::runtime_error("Batch transaction aborted, "s + std::to_string(lost) + " commands lost: "s + ex.what());
+    }
+}
+
+void UseCasesImpl::FinishRead() {
+    // В пакетном режиме транзакция общая для нескольких команд, и ждать ввода в ней некому
+    if(batch_size_ > 1)
+        return;
+    last_unit_of_work_.reset();
+    last_unit_of_work_ = unit_factory_.CreateUnitOfWork();
+}
+
+void UseCasesImpl::SetBatchSize(size_t batch_size) {
+    Flush();
+    batch_size_ = batch_size;
+    if(batch_size_ > 1)
+        last_unit_of_work_->BeginSavepoint();
+}
+
+void UseCasesImpl::Flush() {
+    if(batch_size_ <= 1 || pending_commands_ == 0)
+        return;
+    CommitUnit();
+    last_unit_of_work_->BeginSavepoint();
+}
+
+void UseCasesImpl::PrefetchBookDetails(const books_list_t & books) {
+    if(!prefetcher_)
+        return;
+    std::vector<std::string> book_ids;
+    book_ids.reserve(books.size());
+    for(const auto & book : books)
+        book_ids.push_back(book.id);
+    prefetcher_->Prefetch(std::move(book_ids));
+}
+
+void UseCasesImpl::CancelPrefetch() {
+    if(prefetcher_)
+        prefetcher_->Clear();
+}
+
+std::vector<std::string> UseCasesImpl::TakeRejectedWrites() {
+    return unit_factory_.TakeRejectedWrites();
+}
+
+void UseCasesImpl::CommitUnit() {
+    // Загруженные заранее детали могли устареть после записи сеанса
+    if(prefetcher_)
+        prefetcher_->Clear();
+    last_unit_of_work_->Commit();
+    last_unit_of_work_.reset();
+    last_unit_of_work_ = unit_factory_.CreateUnitOfWork();
+    pending_commands_ = 0;
+    ++batch_stats_.transactions;
+}
+
+bool UseCasesImpl::EditBook(const std::string& book_id, int version,
                             const std::string& title, int publication_year, const std::vector<std::string> & tags) {
-    auto book_id_tag = BookId::FromString(book_id);
-    last_unit_of_work_->Books().Edit(Book{book_id_tag, {{},""}, title, publication_year});
-    last_unit_of_work_->Tags().ClearTagsByBookId(book_id_tag);
-    AddTags(book_id, tags);
+    static auto& latency = UseCaseLatency("EditBook"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    return last_unit_of_work_->Tags().SyncBookTags(Book{BookId::FromString(book_id), {{},""}, title, publication_year, version}, tags);
 }
 
-void UseCasesImpl::EditAuthorName(const std::string& author_id,
+void UseCasesImpl::EditAuthorName(const std::string& author_id, int version,
                                   const std::string& author_new_name) {
-    last_unit_of_work_->Authors().Save({domain::AuthorId::FromString(author_id), author_new_name});
+    static auto& latency = UseCaseLatency("EditAuthorName"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    last_unit_of_work_->Authors().Save({domain::AuthorId::FromString(author_id), author_new_name, version});
 }
 
 void UseCasesImpl::DeleteAuthorAndDependenciesByName(const std::string& author_name) {
+    static auto& latency = UseCaseLatency("DeleteAuthorAndDependenciesByName"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     CascadeRemoveBooksAndTags(last_unit_of_work_->Authors().FindAuthorByName(author_name)->GetId());
     last_unit_of_work_->Authors().DeleteAuthorAndDependencies({{}, author_name});
 }
 
 void UseCasesImpl::DeleteAuthorAndDependencies(const std::string& author_id) {
+    static auto& latency = UseCaseLatency("DeleteAuthorAndDependencies"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     CascadeRemoveBooksAndTags(AuthorId::FromString(author_id));
     last_unit_of_work_->Authors().DeleteAuthorAndDependencies({domain::AuthorId::FromString(author_id), ""});
 }
 
 void UseCasesImpl::DeleteBookAndDependencies(std::string& book_id) {
+    static auto& latency = UseCaseLatency("DeleteBookAndDependencies"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     CascadeRemoveTags(BookId::FromString(book_id));
     last_unit_of_work_->Books().Delete(domain::BookId::FromString(book_id));
 }
 
 std::string UseCasesImpl::AddAuthor(const std::string& name) {
+    static auto& latency = UseCaseLatency("AddAuthor"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     auto id = AuthorId::New();
     last_unit_of_work_->Authors().Save({id, name});
     return id.ToString();
 }
 
 std::string UseCasesImpl::AddBook(int year, const std::string & author_id, const std::string& title) {
+    static auto& latency = UseCaseLatency("AddBook"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     auto id = BookId::New();
     last_unit_of_work_->Books().Save({id, {AuthorId::FromString(author_id),""}, title, year });
     return id.ToString();
 }
 
 void UseCasesImpl::AddTags(const std::string& book_id, const std::vector<std::string>& tags) {
+    static auto& latency = UseCaseLatency("AddTags"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     for(const auto & tag : tags)
         last_unit_of_work_->Tags().Save({domain::BookId::FromString(book_id), tag});
 }
@@ -54,53 +198,99 @@ void UseCasesImpl::AddTags(const std::string& book_id, const std::vector<std::st
 void UseCasesImpl::ClearTags(const std::string& book_id) {}
 
 UseCases::authors_list_t UseCasesImpl::GetAuthors() { 
+    static auto& latency = UseCaseLatency("GetAuthors"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     auto authors_list = last_unit_of_work_->Authors().GetList();
     authors_list_t authors_list_case;
     std::transform(authors_list.begin(), authors_list.end(),std::back_inserter(authors_list_case),
     [](const Author & author) -> detail::AuthorInfo {
-        return detail::AuthorInfo{author.GetId().ToString(), author.GetName()};
+        return detail::AuthorInfo{author.GetId().ToString(), author.GetName(), author.GetVersion()};
     });
     return authors_list_case;
 }
 
 UseCases::books_list_t UseCasesImpl::GetBooks() {
+    static auto& latency = UseCaseLatency("GetBooks"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     auto books_list = last_unit_of_work_->Books().GetList();
     books_list_t books_list_case;
     std::transform(books_list.begin(), books_list.end(),std::back_inserter(books_list_case),
     [](const Book & book) -> detail::BookInfo {
-        return detail::BookInfo{book.GetTitle(),book.GetYear(), book.GetAuthorName(), book.GetId().ToString()};
+        return detail::BookInfo{book.GetTitle(),book.GetYear(), book.GetAuthorName(), book.GetId().ToString(), book.GetVersion()};
     });
     return books_list_case;
 }
 
 UseCases::books_list_t UseCasesImpl::GetBooksAuthors(const std::string & author_id) {
+    static auto& latency = UseCaseLatency("GetBooksAuthors"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     auto books_list = last_unit_of_work_->Books().GetBookByAuthorId(AuthorId::FromString(author_id));
     books_list_t books_list_case;
     std::transform(books_list.begin(), books_list.end(),std::back_inserter(books_list_case),
     [](const Book & book) -> detail::BookInfo {
-        return detail::BookInfo{book.GetTitle(),book.GetYear()};
+        return detail::BookInfo{book.GetTitle(),book.GetYear(), {}, book.GetId().ToString(), book.GetVersion()};
     });
     return books_list_case;
 }
 
 std::optional<detail::AuthorInfo> UseCasesImpl::FindAuthorByName(const std::string& name) {
+    static auto& latency = UseCaseLatency("FindAuthorByName"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     auto author = last_unit_of_work_->Authors().FindAuthorByName(name);
     if(!author)
         return std::nullopt;
-    return detail::AuthorInfo{author->GetId().ToString(), author->GetName()};
+    return detail::AuthorInfo{author->GetId().ToString(), author->GetName(), author->GetVersion()};
 }
 
 UseCases::books_list_t UseCasesImpl::FindBooksByTitle(const std::string& title) {
+    static auto& latency = UseCaseLatency("FindBooksByTitle"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
     auto books_list = last_unit_of_work_->Books().GetBooksByTitle(title);
     books_list_t books_list_case;
     std::transform(books_list.begin(), books_list.end(),std::back_inserter(books_list_case),
     [](const Book & book) -> detail::BookInfo {
-        return detail::BookInfo{book.GetTitle(),book.GetYear(),book.GetAuthorName(),book.GetId().ToString()};
+        return detail::BookInfo{book.GetTitle(),book.GetYear(),book.GetAuthorName(),book.GetId().ToString(), book.GetVersion()};
     });
     return books_list_case;
 }
 
+detail::BooksPage UseCasesImpl::GetBooksByYearRange(int from_year, int to_year, const std::string & author_id,
+                                                    const std::string & page, size_t limit) {
+    static auto& latency = UseCaseLatency("GetBooksByYearRange"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    YearRangeQuery query{from_year, to_year, std::nullopt, std::nullopt, std::max<size_t>(limit, 1)};
+    if(!author_id.empty())
+        query.author_id = AuthorId::FromString(author_id);
+    if(!page.empty())
+        query.after = DecodePage(page);
+    auto books = last_unit_of_work_->Books().GetBooksByYearRange(query);
+    detail::BooksPage result;
+    // Полная страница - возможно, есть и следующая; лишний пустой запрос дешевле, чем limit + 1 строк на каждой
+    if(books.size() == query.limit)
+        result.next_page = EncodePage(books.back());
+    result.books.reserve(books.size());
+    for(const auto & book : books)
+        result.books.push_back({book.GetTitle(), book.GetYear(), book.GetAuthorName(), book.GetId().ToString(), book.GetVersion()});
+    return result;
+}
+
 UseCases::tag_list_t UseCasesImpl::GetTagsByBookId(const std::string& author_id) {
+    static auto& latency = UseCaseLatency("GetTagsByBookId"sv);
+    static auto& prefetched = metrics::GetCounter("prefetch_hits");
+    metrics::ScopedTimer timer{latency};
+    if(prefetcher_) {
+        if(auto tags = prefetcher_->FindTags(author_id)) {
+            prefetched.Increment();
+            return std::move(*tags);
+        }
+    }
+    CallDeadline deadline{*this};
     auto tags_list = last_unit_of_work_->Tags().GetTagsByBookId(BookId::FromString(author_id));
     tag_list_t tags_list_case;
     std::transform(tags_list.begin(), tags_list.end(),std::back_inserter(tags_list_case),
@@ -110,6 +300,59 @@ UseCases::tag_list_t UseCasesImpl::GetTagsByBookId(const std::string& author_id)
     return tags_list_case;
 }
 
+detail::CatalogStats UseCasesImpl::GetCatalogStats(size_t top) {
+    static auto& latency = UseCaseLatency("GetCatalogStats"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    auto & stats = last_unit_of_work_->Stats();
+    detail::CatalogStats result;
+    result.books = stats.CountBooks();
+    for(auto & author : stats.TopAuthors(top))
+        result.top_authors.push_back({std::move(author.name), author.books});
+    for(auto & tag : stats.TopTags(top))
+        result.top_tags.push_back({std::move(tag.tag), tag.books});
+    for(const auto & year : stats.BooksPerYear())
+        result.books_per_year.emplace_back(year.year, year.books);
+    return result;
+}
+
+int UseCasesImpl::CountAuthorBooks(const std::string & author_id) {
+    static auto& latency = UseCaseLatency("CountAuthorBooks"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    return last_unit_of_work_->Stats().CountAuthorBooks(AuthorId::FromString(author_id));
+}
+
+std::vector<std::string> UseCasesImpl::CheckStats() {
+    static auto& latency = UseCaseLatency("CheckStats"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    std::vector<std::string> problems;
+    for(const auto & mismatch : last_unit_of_work_->Stats().Verify()) {
+        problems.push_back(mismatch.counter + " "s + mismatch.key + ": stored "s + std::to_string(mismatch.stored)
+                           + ", actual "s + std::to_string(mismatch.actual));
+    }
+    return problems;
+}
+
+void UseCasesImpl::ForEachAuthor(const std::function<void(const detail::AuthorInfo &)> & visitor) {
+    static auto& latency = UseCaseLatency("ForEachAuthor"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    last_unit_of_work_->Authors().ForEach([&visitor](const Author & author) {
+        visitor(detail::AuthorInfo{author.GetId().ToString(), author.GetName(), author.GetVersion()});
+    });
+}
+
+void UseCasesImpl::ForEachBook(const std::function<void(const detail::BookInfo &)> & visitor) {
+    static auto& latency = UseCaseLatency("ForEachBook"sv);
+    metrics::ScopedTimer timer{latency};
+    CallDeadline deadline{*this};
+    last_unit_of_work_->Books().ForEach([&visitor](const Book & book) {
+        visitor(detail::BookInfo{book.GetTitle(), book.GetYear(), book.GetAuthorName(), book.GetId().ToString(), book.GetVersion()});
+    });
+}
+
 void UseCasesImpl::CascadeRemoveBooksAndTags(const AuthorId & author_id) {
     auto books = last_unit_of_work_->Books().GetBookByAuthorId(author_id);
     for(const auto & book : books) {
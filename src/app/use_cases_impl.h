@@ -1,6 +1,10 @@
 #pragma once
+#include <chrono>
+#include <memory>
+
 #include "../domain/author_fwd.h"
 #include "../domain/book_fwd.h"
+#include "prefetch.h"
 #include "use_cases.h"
 #include "../unit/unit_of_work_factory.h"
 
@@ -8,25 +12,45 @@ namespace app {
 
 class UseCasesImpl : public UseCases {
 public:
+    struct BatchStats {
+        size_t committed_commands = 0;
+        size_t failed_commands = 0;
+        size_t transactions = 0;
+    };
 
     explicit UseCasesImpl(UnitOfWorkFactory & unit_factory)
         : unit_factory_(unit_factory) {
         last_unit_of_work_ = unit_factory_.CreateUnitOfWork();
     }
 
-    void Commit() override {
-        last_unit_of_work_->Commit();
-        last_unit_of_work_.reset();
-        last_unit_of_work_ = unit_factory_.CreateUnitOfWork();
-    }
+    void Commit() override;
+    void Rollback() override;
+    void FinishRead() override;
+    void PrefetchBookDetails(const books_list_t & books) override;
+    void CancelPrefetch() override;
+    std::vector<std::string> TakeRejectedWrites() override;
 
-    void Rollback() override {
-        last_unit_of_work_.reset();
-        last_unit_of_work_ = unit_factory_.CreateUnitOfWork();
+    // При batch_size > 1 Commit() фиксирует только точку сохранения команды,
+    // а транзакция коммитится после каждых batch_size команд и в Flush()
+    void SetBatchSize(size_t batch_size);
+    void Flush();
+    const BatchStats & GetBatchStats() const noexcept {
+        return batch_stats_;
+    }
+    // Каждый вызов сценария должен уложиться в timeout, иначе он бросает DeadlineExceeded,
+    // и транзакцию нужно откатить. 0 - без срока
+    void SetCallTimeout(std::chrono::milliseconds timeout) noexcept {
+        call_timeout_ = timeout;
+    }
+    // GetTagsByBookId берёт теги из prefetcher, если он успел их загрузить. Без prefetcher
+    // PrefetchBookDetails ничего не делает. Не годится для пакетного режима: загрузчик
+    // не видит изменений, ещё не закоммиченных сеансом
+    void SetPrefetcher(BookDetailPrefetcher * prefetcher) noexcept {
+        prefetcher_ = prefetcher;
     }
 
-    void EditBook(const std::string & book_id, const std::string & title, int publication_year, const std::vector<std::string> & tags) override;
-    void EditAuthorName(const std::string & author_id, const std::string & author_new_name) override;
+    bool EditBook(const std::string & book_id, int version, const std::string & title, int publication_year, const std::vector<std::string> & tags) override;
+    void EditAuthorName(const std::string & author_id, int version, const std::string & author_new_name) override;
     void DeleteAuthorAndDependenciesByName(const std::string & author_name) override;
     void DeleteAuthorAndDependencies(const std::string & author_id) override;
     void DeleteBookAndDependencies (std::string & book_id) override;
@@ -40,14 +64,40 @@ public:
     books_list_t GetBooksAuthors(const std::string & author_id) override;
     std::optional<detail::AuthorInfo> FindAuthorByName(const std::string & name) override;
     books_list_t FindBooksByTitle(const std::string & title) override;
+    detail::BooksPage GetBooksByYearRange(int from_year, int to_year, const std::string & author_id,
+                                          const std::string & page, size_t limit) override;
     tag_list_t GetTagsByBookId(const std::string &) override;
+    detail::CatalogStats GetCatalogStats(size_t top) override;
+    int CountAuthorBooks(const std::string & author_id) override;
+    std::vector<std::string> CheckStats() override;
+    void ForEachAuthor(const std::function<void(const detail::AuthorInfo &)> & visitor) override;
+    void ForEachBook(const std::function<void(const detail::BookInfo &)> & visitor) override;
 
 private:
+    // Срок вызова: ставится на единицу работы в начале вызова и снимается по выходу из него
+    class CallDeadline {
+    public:
+        explicit CallDeadline(UseCasesImpl & use_cases);
+        ~CallDeadline();
+
+        CallDeadline(const CallDeadline &) = delete;
+        CallDeadline & operator=(const CallDeadline &) = delete;
+
+    private:
+        std::shared_ptr<UnitOfWork> unit_;
+    };
+
     void CascadeRemoveBooksAndTags(const domain::AuthorId & author_id);
     void CascadeRemoveTags(const domain::BookId & book_id);
+    void CommitUnit();
 
     std::shared_ptr<UnitOfWork> last_unit_of_work_;
     UnitOfWorkFactory & unit_factory_;
+    std::chrono::milliseconds call_timeout_{0};
+    BookDetailPrefetcher * prefetcher_ = nullptr;
+    size_t batch_size_ = 1;
+    size_t pending_commands_ = 0;
+    BatchStats batch_stats_;
 };
 
 }  // namespace app
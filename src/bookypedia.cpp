@@ -1,21 +1,98 @@
 #include "bookypedia.h"
 
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 
 #include "menu/menu.h"
-#include "postgres/postgres.h"
+#include "metrics/metrics.h"
+#include "metrics/startup.h"
+#include "metrics/trace.h"
+#include "snapshot/snapshot.h"
+#include "unit/catalog_cache.h"
 #include "ui/view.h"
 
 namespace bookypedia {
 
 using namespace std::literals;
 
+namespace {
+
+const AppConfig& CheckConfig(const AppConfig& config) {
+    // Шарды коммитятся по очереди, без двухфазного коммита: если пакет из нескольких команд
+    // затронул несколько шардов и коммит одного из них не удался, остальные уже закоммичены
+    const bool batch = config.batch || !config.script_path.empty();
+    if (batch && config.batch_size > 1 && (config.storage.urls.size() > 1 || config.storage.previous_shard_count > 1)) {
+        throw std::invalid_argument("Batch size above 1 is not supported for a sharded catalog");
+    }
+    return config;
+}
+
+}  // namespace
+
 Application::Application(const AppConfig& config)
-    : db_{pqxx::connection{config.db_url}} {
+    : config_{CheckConfig(config)}
+    , unit_work_factory_{app::MakeUnitOfWorkFactory(config.storage)} {
+    if (config.slow_query_log) {
+        postgres::SlowQueryLog::Configure(*config.slow_query_log);
+    }
+    // Соединения, схема и подготовленные запросы готовы. Копию каталога читаем в фоне,
+    // пока пользователь набирает первую команду, - иначе её ждал бы первый запрос
+    if (auto* cached = dynamic_cast<app::CachedUnitOfWorkFactory*>(unit_work_factory_.get())) {
+        ready_ = std::async(std::launch::async, [this, cached] {
+                     {
+                         metrics::StartupTimer timer{"cache.preload"sv};
+                         cached->Rebuild();
+                     }
+                     ready_at_ = std::chrono::steady_clock::now();
+                 }).share();
+    } else {
+        ready_at_ = std::chrono::steady_clock::now();
+        std::promise<void> ready;
+        ready.set_value();
+        ready_ = ready.get_future().share();
+    }
+}
+
+bool Application::IsReady() const {
+    return ready_.wait_for(std::chrono::seconds::zero()) == std::future_status::ready;
+}
+
+void Application::WaitReady() const {
+    ready_.wait();
 }
 
 void Application::Run() {
-    menu::Menu menu{std::cin, std::cout};
+    std::ifstream script;
+    std::istream* input = &std::cin;
+    if (!config_.script_path.empty()) {
+        script.open(config_.script_path);
+        if (!script) {
+            throw std::runtime_error("Can't open script "s + config_.script_path);
+        }
+        input = &script;
+    }
+    const bool batch = config_.batch || !config_.script_path.empty();
+
+    menu::Menu menu{*input, std::cout};
+    // Прогрев и команды пользуются одним соединением хранилища
+    menu.SetBeforeFirstCommand([this] {
+        WaitReady();
+        if (config_.startup_report) {
+            ReportStartup();
+        }
+    });
+    if (batch) {
+        menu.SetBatchMode(true);
+        use_cases_.SetBatchSize(config_.batch_size);
+    }
+    use_cases_.SetCallTimeout(config_.call_timeout);
+    if (UsePrefetch(batch)) {
+        prefetcher_ = std::make_unique<app::BookDetailPrefetcher>([storage = config_.storage] {
+            return app::MakeUnitOfWorkFactory(storage);
+        });
+        use_cases_.SetPrefetcher(prefetcher_.get());
+    }
     menu.AddAction("Help"s, {}, "Show instructions"s, [&menu](std::istream&) {
         menu.ShowInstructions();
         return true;
@@ -23,8 +100,43 @@ void Application::Run() {
     menu.AddAction("Exit"s, {}, "Exit program"s, [&menu](std::istream&) {
         return false;
     });
-    ui::View view{menu, use_cases_, std::cin, std::cout};
+    menu.AddAction("Stats"s, {}, "Show latency statistics"s, [this](std::istream&) {
+        metrics::WriteSummary(std::cout);
+        DumpMetrics();
+        return true;
+    });
+    ui::View view{menu, use_cases_, *input, std::cout};
     menu.Run();
+    WaitReady();
+    if (batch) {
+        use_cases_.Flush();
+        const auto& stats = use_cases_.GetBatchStats();
+        std::cerr << "Batch finished: "sv << stats.committed_commands << " commands committed, "sv
+                  << stats.failed_commands << " failed, "sv << stats.transactions << " transactions"sv << std::endl;
+    }
+    DumpMetrics();
+}
+
+bool Application::UsePrefetch(bool batch) const {
+    // В пакетном режиме пользователь не думает над выбором, а кэш, реплика и снимок
+    // и так отдают теги без обращения к базе
+    const auto& storage = config_.storage;
+    // С журналом загрузчик не увидел бы ещё не применённые записи
+    return config_.prefetch && !batch && !storage.cache && !storage.replica && !storage.journal
+           && !snapshot::IsSnapshotUrl(storage.urls.front());
+}
+
+void Application::ReportStartup() const {
+    metrics::StartupTimeline::Instance().Write(std::cerr, started_, ready_at_);
+}
+
+void Application::DumpMetrics() const {
+    if (!config_.metrics_file.empty()) {
+        metrics::WritePrometheusFile(config_.metrics_file);
+    }
+    if (metrics::IsTracing()) {
+        metrics::WriteTraceFile();
+    }
 }
 
 }  // namespace bookypedia
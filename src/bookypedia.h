@@ -1,13 +1,33 @@
 #pragma once
-#include <pqxx/pqxx>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
 
 #include "app/use_cases_impl.h"
-#include "postgres/postgres.h"
+#include "postgres/slow_query_log.h"
+#include "unit/unit_of_work_factory.h"
 
 namespace bookypedia {
 
 struct AppConfig {
-    std::string db_url;
+    app::StorageConfig storage;
+    // Если задан, метрики в формате Prometheus пишутся в этот файл по команде Stats и при выходе.
+    // Тогда же трасса, если включена metrics::ConfigureTracing, пишется в свой файл
+    std::string metrics_file;
+    std::optional<postgres::SlowQueryConfig> slow_query_log;
+    // Пакетный режим: команды и ответы на их запросы читаются из script_path (или stdin),
+    // транзакция коммитится раз в batch_size команд
+    bool batch = false;
+    std::string script_path;
+    size_t batch_size = 1;
+    // Перед первой командой печатать в stderr длительность фаз запуска
+    bool startup_report = false;
+    // Срок каждого вызова сценария; запрос, не уложившийся в него, прерывается. 0 - без срока
+    std::chrono::milliseconds call_timeout{0};
+    // Пока пользователь выбирает книгу из списка, загружать её теги через отдельное соединение.
+    // Только для интерактивного сеанса с хранилищем без локальной копии каталога
+    bool prefetch = true;
 };
 
 class Application {
@@ -16,10 +36,24 @@ public:
 
     void Run();
 
+    // Прогрев закончен: команды больше не ждут загрузки данных.
+    // Первая команда меню сама дожидается готовности
+    bool IsReady() const;
+    void WaitReady() const;
+
 private:
-    postgres::Database db_;
-    app::UnitOfWorkFactory unit_work_factory{db_.GetConnection()};
-    app::UseCasesImpl use_cases_{unit_work_factory};
+    void DumpMetrics() const;
+    bool UsePrefetch(bool batch) const;
+    void ReportStartup() const;
+
+    const std::chrono::steady_clock::time_point started_ = std::chrono::steady_clock::now();
+    AppConfig config_;
+    std::unique_ptr<app::UnitOfWorkFactory> unit_work_factory_;
+    app::UseCasesImpl use_cases_{*unit_work_factory_};
+    std::unique_ptr<app::BookDetailPrefetcher> prefetcher_;
+    // Пишется фоновым прогревом до того, как ready_ станет готов
+    std::chrono::steady_clock::time_point ready_at_;
+    std::shared_future<void> ready_;
 };
 
 }  // namespace bookypedia
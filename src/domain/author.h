@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <string>
 #include <vector>
 #include "../util/tagged_uuid.h"
@@ -14,9 +15,11 @@ using AuthorId = util::TaggedUUID<detail::AuthorTag>;
 
 class Author {
 public:
-    Author(AuthorId id, std::string name)
+    // version == 0 - версия неизвестна, запись сохраняется без проверки
+    Author(AuthorId id, std::string name, int version = 0)
         : id_(std::move(id))
-        , name_(std::move(name)) {
+        , name_(std::move(name))
+        , version_(version) {
     }
 
     const AuthorId& GetId() const noexcept {
@@ -27,9 +30,14 @@ public:
         return name_;
     }
 
+    int GetVersion() const noexcept {
+        return version_;
+    }
+
 private:
     AuthorId id_;
     std::string name_;
+    int version_;
 };
 
 class AuthorRepository {
@@ -41,6 +49,13 @@ public:
     virtual list_authors_t GetList() = 0;
     virtual std::optional <domain::Author> FindAuthorByName(const std::string &) = 0;
 
+    // Обходит авторов в порядке GetList() без материализации всего списка,
+    // если хранилище умеет отдавать строки потоком
+    virtual void ForEach(const std::function<void(const Author&)>& visitor) {
+        for(const auto & author : GetList())
+            visitor(author);
+    }
+
 protected:
     ~AuthorRepository() = default;
 };
@@ -1,7 +1,65 @@
 #include "book.h"
+
+#include <algorithm>
+#include <tuple>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/random_generator.hpp>
 
 namespace domain {
 
+namespace {
+
+using key_tuple_t = std::tuple<int, const std::string&, const util::detail::UUIDType&>;
+
+// Так же упорядочивает Postgres: title COLLATE "C", uuid побайтово
+key_tuple_t KeyTuple(const BookKey& key) noexcept {
+    return {key.year, key.title, *key.id};
+}
+
+key_tuple_t KeyTuple(const Book& book) noexcept {
+    return {book.GetYear(), book.GetTitle(), *book.GetId()};
+}
+
+}  // namespace
+
+BookKey KeyOf(const Book& book) {
+    return BookKey{book.GetYear(), book.GetTitle(), book.GetId()};
+}
+
+bool BookKeyLess(const BookKey& lhs, const BookKey& rhs) noexcept {
+    return KeyTuple(lhs) < KeyTuple(rhs);
+}
+
+bool BookKeyLess(const Book& lhs, const Book& rhs) noexcept {
+    return KeyTuple(lhs) < KeyTuple(rhs);
+}
+
+bool BookKeyLess(const BookKey& lhs, const Book& rhs) noexcept {
+    return KeyTuple(lhs) < KeyTuple(rhs);
+}
+
+bool YearRangeQuery::Matches(const Book& book) const {
+    if(book.GetYear() < from_year || book.GetYear() > to_year)
+        return false;
+    if(author_id && book.GetAuthorId() != *author_id)
+        return false;
+    return !after || BookKeyLess(*after, book);
+}
+
+BookRepository::list_books_t BookRepository::SelectYearRange(list_books_t books, const YearRangeQuery& query) {
+    std::erase_if(books, [&query](const Book& book) {
+        return !query.Matches(book);
+    });
+    const auto less = [](const Book& lhs, const Book& rhs) {
+        return BookKeyLess(lhs, rhs);
+    };
+    if(books.size() > query.limit) {
+        std::partial_sort(books.begin(), books.begin() + static_cast<std::ptrdiff_t>(query.limit), books.end(), less);
+        books.erase(books.begin() + static_cast<std::ptrdiff_t>(query.limit), books.end());
+    } else {
+        std::sort(books.begin(), books.end(), less);
+    }
+    return books;
+}
+
 }  // namespace domain
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <optional>
 #include <string>
 
 #include "../util/tagged_uuid.h"
@@ -14,11 +16,12 @@ using BookId = util::TaggedUUID<detail::BookTag>;
 
 class Book {
 public:
-    Book(BookId id, Author author, std::string title, int year)
+    Book(BookId id, Author author, std::string title, int year, int version = 0)
         : id_(std::move(id))
         , title_(std::move(title))
         , author_(std::move(author))
-        , year_(year) {
+        , year_(year)
+        , version_(version) {
     }
 
     const BookId& GetId() const noexcept {
@@ -41,23 +44,62 @@ public:
         return year_;
     }
 
+    int GetVersion() const noexcept {
+        return version_;
+    }
+
 private:
     BookId id_;
     domain::Author author_; //TODO std::variant <id, author>
     std::string title_;
     int year_;
+    int version_;
+};
+
+// Место книги в выборке по годам: год, название (побайтово) и id
+struct BookKey {
+    int year = 0;
+    std::string title;
+    BookId id;
+};
+
+BookKey KeyOf(const Book& book);
+// Без копирования ключа: для сортировок и поиска по спискам книг
+bool BookKeyLess(const BookKey& lhs, const BookKey& rhs) noexcept;
+bool BookKeyLess(const Book& lhs, const Book& rhs) noexcept;
+bool BookKeyLess(const BookKey& lhs, const Book& rhs) noexcept;
+
+// Книги, изданные в [from_year, to_year], по возрастанию BookKey, не больше limit.
+// Следующая страница - тот же запрос с after, равным ключу последней книги предыдущей
+struct YearRangeQuery {
+    int from_year = 0;
+    int to_year = 0;
+    std::optional<AuthorId> author_id;
+    std::optional<BookKey> after;
+    size_t limit = 100;
+
+    bool Matches(const Book& book) const;
 };
 
 class BookRepository {
 public:
     using list_books_t = std::vector<Book>;
 
+    // Для хранилищ в памяти: отбирает, сортирует и обрезает страницу из books
+    static list_books_t SelectYearRange(list_books_t books, const YearRangeQuery& query);
+
     virtual void Save(const Book& Book) = 0;
     virtual void Edit(const Book& Book) = 0;
     virtual void Delete(const BookId& Book) = 0;
     virtual list_books_t GetList() = 0;
     virtual list_books_t GetBookByAuthorId(const AuthorId &) = 0;
     virtual list_books_t GetBooksByTitle(const std::string &) = 0;
+    virtual list_books_t GetBooksByYearRange(const YearRangeQuery & query) = 0;
+
+    virtual void ForEach(const std::function<void(const Book&)>& visitor) {
+        for(const auto & book : GetList())
+            visitor(book);
+    }
 
 protected:
     ~BookRepository() = default;
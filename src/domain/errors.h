@@ -0,0 +1,12 @@
+#pragma once
+#include <stdexcept>
+
+namespace domain {
+
+// Запись изменили в другом сеансе после того, как её прочитали для редактирования
+class VersionConflict : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+}  // namespace domain
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "author.h"
+
+namespace domain {
+
+struct AuthorBooks {
+    AuthorId author_id;
+    std::string name;
+    int books = 0;
+};
+
+struct TagBooks {
+    std::string tag;
+    int books = 0;
+};
+
+struct YearBooks {
+    int year = 0;
+    int books = 0;
+};
+
+// Счётчик, который разошёлся с полным пересчётом
+struct StatsMismatch {
+    std::string counter;  // author, tag или year
+    std::string key;
+    int stored = 0;
+    int actual = 0;
+};
+
+/**
+ * Агрегаты каталога. Хранилище поддерживает счётчики в той же транзакции, что и записи,
+ * поэтому чтение счётчика не зависит от размера каталога.
+ */
+class StatsRepository {
+public:
+    using top_authors_t = std::vector<AuthorBooks>;
+    using top_tags_t = std::vector<TagBooks>;
+    using years_t = std::vector<YearBooks>;
+    using mismatches_t = std::vector<StatsMismatch>;
+
+    virtual int CountBooks() = 0;
+    virtual int CountAuthorBooks(const AuthorId& author_id) = 0;
+    // По убыванию числа книг, при равенстве - по имени
+    virtual top_authors_t TopAuthors(size_t limit) = 0;
+    virtual top_tags_t TopTags(size_t limit) = 0;
+    // Только годы, в которых есть книги, по возрастанию
+    virtual years_t BooksPerYear() = 0;
+    // Сверяет счётчики с пересчётом по таблицам каталога
+    virtual mismatches_t Verify() = 0;
+
+protected:
+    ~StatsRepository() = default;
+};
+
+}  // namespace domain
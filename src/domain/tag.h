@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <string>
 #include "book.h"
 
@@ -31,6 +32,11 @@ public:
     virtual void ClearTagsByBookId(const BookId & book) = 0;
     virtual void Save(const Tag& tag) = 0;
     virtual list_tags_t GetTagsByBookId(const BookId & book) = 0;
+    // Сохраняет название и год книги и приводит её теги к набору tags,
+    // трогая только отличающиеся строки. Возвращает true, если что-то изменилось
+    virtual bool SyncBookTags(const Book & book, const std::vector<std::string> & tags) = 0;
+    // Обходит теги всех книг (для выгрузки каталога целиком), порядок не определён
+    virtual void ForEach(const std::function<void(const Tag&)>& visitor) = 0;
 
 protected:
     ~TagRepository() = default;
@@ -0,0 +1,180 @@
+#include "generator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+namespace gen {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t MAX_TITLE_LENGTH = 100;
+constexpr size_t MAX_NAME_LENGTH = 100;
+constexpr size_t MAX_TAG_LENGTH = 30;
+
+constexpr std::string_view SYLLABLES[] = {
+    "an"sv, "bel"sv, "cor"sv, "da"sv, "el"sv, "fin"sv, "gar"sv, "ho"sv, "is"sv, "jo"sv,
+    "ka"sv, "lin"sv, "mar"sv, "ne"sv, "or"sv, "pet"sv, "qui"sv, "ra"sv, "son"sv, "ta"sv,
+    "ul"sv, "ver"sv, "wen"sv, "xa"sv, "yo"sv, "zor"sv, "ber"sv, "ston"sv, "mi"sv, "la"sv,
+};
+
+uint64_t SplitMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+std::string MakeWord(std::mt19937_64& engine, size_t min_syllables, size_t max_syllables) {
+    std::uniform_int_distribution<size_t> count{min_syllables, max_syllables};
+    std::uniform_int_distribution<size_t> pick{0, std::size(SYLLABLES) - 1};
+    std::string word;
+    for (size_t i = count(engine); i > 0; --i) {
+        word += SYLLABLES[pick(engine)];
+    }
+    return word;
+}
+
+std::string Capitalize(std::string word) {
+    if (!word.empty()) {
+        word.front() = static_cast<char>(std::toupper(static_cast<unsigned char>(word.front())));
+    }
+    return word;
+}
+
+std::string MakeTitle(std::mt19937_64& engine) {
+    // Большинство названий состоит из 2-4 слов, изредка встречаются длинные
+    std::lognormal_distribution<double> words_count{1.0, 0.45};
+    const auto words = std::clamp<size_t>(static_cast<size_t>(std::lround(words_count(engine))), 1, 12);
+    std::string title;
+    for (size_t i = 0; i < words; ++i) {
+        auto word = MakeWord(engine, 1, 4);
+        if (title.size() + word.size() + 1 > MAX_TITLE_LENGTH) {
+            break;
+        }
+        if (!title.empty()) {
+            title += ' ';
+        }
+        title += i == 0 ? Capitalize(std::move(word)) : std::move(word);
+    }
+    return title;
+}
+
+}  // namespace
+
+ZipfDistribution::ZipfDistribution(size_t n, double s) {
+    if (n == 0) {
+        throw std::invalid_argument("Zipf distribution needs at least one rank");
+    }
+    cdf_.reserve(n);
+    double sum = 0;
+    for (size_t k = 1; k <= n; ++k) {
+        sum += 1.0 / std::pow(static_cast<double>(k), s);
+        cdf_.push_back(sum);
+    }
+    for (auto& value : cdf_) {
+        value /= sum;
+    }
+}
+
+size_t ZipfDistribution::Rank(double u) const {
+    auto it = std::lower_bound(cdf_.begin(), cdf_.end(), u);
+    if (it == cdf_.end()) {
+        --it;
+    }
+    return static_cast<size_t>(it - cdf_.begin()) + 1;
+}
+
+CatalogGenerator::CatalogGenerator(GeneratorConfig config)
+    : config_(std::move(config))
+    , books_per_author_(std::max<size_t>(config_.max_books_per_author, 1), config_.books_skew)
+    , tag_rank_(std::max<size_t>(config_.tag_vocabulary, 1), config_.tags_skew) {
+    if (config_.min_year > config_.max_year) {
+        throw std::invalid_argument("min_year is greater than max_year");
+    }
+
+    std::mt19937_64 engine{SplitMix64(config_.seed)};
+    std::unordered_set<std::string> unique;
+    while (tags_.size() < config_.tag_vocabulary) {
+        auto tag = MakeWord(engine, 1, 3);
+        if (unique.size() >= 0.5 * std::pow(std::size(SYLLABLES), 3)) {
+            tag += std::to_string(tags_.size());
+        }
+        tag.resize(std::min(tag.size(), MAX_TAG_LENGTH));
+        if (unique.insert(tag).second) {
+            tags_.push_back(std::move(tag));
+        }
+    }
+}
+
+CatalogGenerator::AuthorPlan CatalogGenerator::Plan(size_t author_idx) const {
+    // Каждый автор генерируется собственным генератором, поэтому его можно
+    // воспроизвести независимо от остальных на любом проходе
+    std::mt19937_64 engine{SplitMix64(config_.seed ^ SplitMix64(author_idx + 1))};
+    boost::uuids::basic_random_generator<std::mt19937_64> uuid_gen{engine};
+
+    AuthorPlan author;
+    author.id = to_string(uuid_gen());
+    author.name = Capitalize(MakeWord(engine, 2, 3)) + " "s + Capitalize(MakeWord(engine, 2, 4));
+
+    std::uniform_int_distribution<int> year{config_.min_year, config_.max_year};
+    std::uniform_int_distribution<size_t> tags_count{0, config_.tag_vocabulary == 0 ? 0 : config_.max_tags_per_book};
+    const auto books = books_per_author_(engine);
+    author.books.reserve(books);
+    for (size_t i = 0; i < books; ++i) {
+        BookPlan book;
+        book.id = to_string(uuid_gen());
+        book.title = MakeTitle(engine);
+        book.year = year(engine);
+        for (size_t j = tags_count(engine); j > 0; --j) {
+            book.tags.push_back(tag_rank_(engine) - 1);
+        }
+        std::sort(book.tags.begin(), book.tags.end());
+        book.tags.erase(std::unique(book.tags.begin(), book.tags.end()), book.tags.end());
+        author.books.push_back(std::move(book));
+    }
+    return author;
+}
+
+void CatalogGenerator::Generate(CatalogSink& sink) const {
+    sink.AddTagVocabulary(tags_);
+
+    std::unordered_set<std::string> names;
+    names.reserve(config_.authors);
+    for (size_t i = 0; i < config_.authors; ++i) {
+        auto author = Plan(i);
+        if (!names.insert(author.name).second) {
+            author.name += " "s + std::to_string(i);
+            author.name.resize(std::min(author.name.size(), MAX_NAME_LENGTH));
+            names.insert(author.name);
+        }
+        sink.AddAuthor(author.id, author.name);
+    }
+
+    for (size_t i = 0; i < config_.authors; ++i) {
+        const auto author = Plan(i);
+        for (const auto& book : author.books) {
+            sink.AddBook(book.id, author.id, book.title, book.year);
+        }
+    }
+
+    for (size_t i = 0; i < config_.authors; ++i) {
+        const auto author = Plan(i);
+        for (const auto& book : author.books) {
+            for (auto tag_idx : book.tags) {
+                sink.AddTag(book.id, tag_idx);
+            }
+        }
+    }
+
+    sink.Finish();
+}
+
+}  // namespace gen
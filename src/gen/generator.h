@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gen {
+
+struct GeneratorConfig {
+    size_t authors = 1000;
+    size_t max_books_per_author = 200;
+    double books_skew = 1.1;
+    size_t tag_vocabulary = 500;
+    double tags_skew = 1.0;
+    size_t max_tags_per_book = 5;
+    int min_year = 1800;
+    int max_year = 2023;
+    uint64_t seed = 42;
+};
+
+/**
+ * Принимает сгенерированные строки.
+ * Гарантируется порядок: словарь тегов, все авторы, все книги, затем все теги книг,
+ * поэтому строки можно сразу отправлять в COPY без буферизации.
+ */
+class CatalogSink {
+public:
+    virtual void AddTagVocabulary(const std::vector<std::string>& tags) = 0;
+    virtual void AddAuthor(std::string_view id, std::string_view name) = 0;
+    virtual void AddBook(std::string_view id, std::string_view author_id, std::string_view title, int year) = 0;
+    // tag_index - позиция тега в словаре, переданном в AddTagVocabulary
+    virtual void AddTag(std::string_view book_id, size_t tag_index) = 0;
+    virtual void Finish() {}
+
+protected:
+    ~CatalogSink() = default;
+};
+
+// Распределение Ципфа на рангах [1, n]: P(k) ~ 1 / k^s
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t n, double s);
+
+    template <typename Engine>
+    size_t operator()(Engine& engine) const {
+        const double u = std::uniform_real_distribution<double>{0.0, 1.0}(engine);
+        return Rank(u);
+    }
+
+    size_t Size() const noexcept {
+        return cdf_.size();
+    }
+
+private:
+    size_t Rank(double u) const;
+
+    std::vector<double> cdf_;
+};
+
+class CatalogGenerator {
+public:
+    explicit CatalogGenerator(GeneratorConfig config);
+
+    void Generate(CatalogSink& sink) const;
+
+    const std::vector<std::string>& GetTagVocabulary() const noexcept {
+        return tags_;
+    }
+
+private:
+    struct BookPlan {
+        std::string id;
+        std::string title;
+        int year;
+        std::vector<size_t> tags;
+    };
+
+    struct AuthorPlan {
+        std::string id;
+        std::string name;
+        std::vector<BookPlan> books;
+    };
+
+    AuthorPlan Plan(size_t author_idx) const;
+
+    GeneratorConfig config_;
+    ZipfDistribution books_per_author_;
+    ZipfDistribution tag_rank_;
+    std::vector<std::string> tags_;
+};
+
+}  // namespace gen
@@ -0,0 +1,94 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "../postgres/postgres.h"
+#include "generator.h"
+#include "sinks.h"
+
+using namespace std::literals;
+
+namespace {
+
+constexpr const char DB_URL_ENV_NAME[]{"BOOKYPEDIA_DB_URL"};
+
+struct Args {
+    gen::GeneratorConfig config;
+    std::string out_dir;
+};
+
+void PrintUsage(std::ostream& out) {
+    out << "Usage: bookypedia-gen [--authors N] [--max-books N] [--tags N] [--max-tags N]\n"
+           "                      [--seed N] [--out DIR]\n"
+           "Without --out the catalog is loaded into "sv
+        << DB_URL_ENV_NAME << " using COPY."sv << std::endl;
+}
+
+Args ParseArgs(int argc, const char* argv[]) {
+    Args args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for "s + std::string(arg));
+        }
+        const std::string value{argv[++i]};
+        if (arg == "--authors"sv) {
+            args.config.authors = std::stoull(value);
+        } else if (arg == "--max-books"sv) {
+            args.config.max_books_per_author = std::stoull(value);
+        } else if (arg == "--tags"sv) {
+            args.config.tag_vocabulary = std::stoull(value);
+        } else if (arg == "--max-tags"sv) {
+            args.config.max_tags_per_book = std::stoull(value);
+        } else if (arg == "--seed"sv) {
+            args.config.seed = std::stoull(value);
+        } else if (arg == "--out"sv) {
+            args.out_dir = value;
+        } else {
+            throw std::invalid_argument("Unknown argument "s + std::string(arg));
+        }
+    }
+    return args;
+}
+
+}  // namespace
+
+int main(int argc, const char* argv[]) {
+    Args args;
+    try {
+        args = ParseArgs(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        PrintUsage(std::cerr);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        gen::CatalogGenerator generator{args.config};
+        if (!args.out_dir.empty()) {
+            gen::FileSink sink{args.out_dir};
+            generator.Generate(sink);
+            std::cout << "Load the files in order tags, authors, books, book_tags, then run\n"
+                         "SELECT setval(pg_get_serial_sequence('tags', 'id'), max(id)) FROM tags;"sv << std::endl;
+        } else {
+            const auto* url = std::getenv(DB_URL_ENV_NAME);
+            if (!url) {
+                throw std::runtime_error(DB_URL_ENV_NAME + " environment variable not found"s);
+            }
+            postgres::Database db{pqxx::connection{url}};
+            pqxx::work work{db.GetConnection()};
+            gen::PostgresCopySink sink{work};
+            generator.Generate(sink);
+            work.commit();
+        }
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+        std::cout << "Generated catalog in "sv << elapsed.count() << " ms"sv << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,140 @@
+#include "sinks.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace gen {
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+namespace {
+
+void WriteCopyField(std::ostream& out, std::string_view value) {
+    for (char c : value) {
+        switch (c) {
+            case '\\': out << "\\\\"sv; break;
+            case '\t': out << "\\t"sv; break;
+            case '\n': out << "\\n"sv; break;
+            case '\r': out << "\\r"sv; break;
+            default: out << c;
+        }
+    }
+}
+
+std::ofstream OpenTable(const std::filesystem::path& path) {
+    std::ofstream out{path, std::ios::binary | std::ios::trunc};
+    if (!out) {
+        throw std::runtime_error("Can't open "s + path.string());
+    }
+    return out;
+}
+
+}  // namespace
+
+FileSink::FileSink(const std::filesystem::path& dir)
+    : dir_(dir) {
+    std::filesystem::create_directories(dir);
+    authors_ = OpenTable(dir / "authors.tsv");
+    books_ = OpenTable(dir / "books.tsv");
+    tags_ = OpenTable(dir / "book_tags.tsv");
+}
+
+void FileSink::AddTagVocabulary(const std::vector<std::string>& tags) {
+    auto out = OpenTable(dir_ / "tags.tsv");
+    for (size_t i = 0; i < tags.size(); ++i) {
+        out << i + 1 << '\t';
+        WriteCopyField(out, tags[i]);
+        out << '\n';
+    }
+    if (!out.flush()) {
+        throw std::runtime_error("Failed to write tag vocabulary");
+    }
+}
+
+void FileSink::AddAuthor(std::string_view id, std::string_view name) {
+    authors_ << id << '\t';
+    WriteCopyField(authors_, name);
+    authors_ << '\n';
+}
+
+void FileSink::AddBook(std::string_view id, std::string_view author_id, std::string_view title, int year) {
+    books_ << id << '\t' << author_id << '\t';
+    WriteCopyField(books_, title);
+    books_ << '\t' << year << '\n';
+}
+
+void FileSink::AddTag(std::string_view book_id, size_t tag_index) {
+    tags_ << book_id << '\t' << tag_index + 1 << '\n';
+}
+
+void FileSink::Finish() {
+    for (auto* out : {&authors_, &books_, &tags_}) {
+        out->flush();
+        if (!*out) {
+            throw std::runtime_error("Failed to write generated catalog");
+        }
+    }
+}
+
+pqxx::stream_to& PostgresCopySink::Stream(Table table) {
+    if (current_ == table) {
+        return *stream_;
+    }
+    if (stream_) {
+        stream_->complete();
+        stream_.reset();
+    }
+    switch (table) {
+        case Table::AUTHORS:
+            stream_.emplace(pqxx::stream_to::table(worker_, {"authors"sv}, {"id"sv, "name"sv}));
+            break;
+        case Table::BOOKS:
+            stream_.emplace(pqxx::stream_to::table(worker_, {"books"sv},
+                                                   {"id"sv, "author_id"sv, "title"sv, "publication_year"sv}));
+            break;
+        case Table::TAGS:
+            stream_.emplace(pqxx::stream_to::table(worker_, {"book_tags"sv}, {"book_id"sv, "tag_id"sv}));
+            break;
+        case Table::NONE:
+            break;
+    }
+    current_ = table;
+    return *stream_;
+}
+
+void PostgresCopySink::AddTagVocabulary(const std::vector<std::string>& tags) {
+    // Словарь небольшой, его можно вставить одним запросом и сразу узнать идентификаторы
+    worker_.exec_params("INSERT INTO tags (name) SELECT unnest($1::varchar[]) ON CONFLICT (name) DO NOTHING"_zv, tags);
+    std::unordered_map<std::string, int> ids;
+    for (const auto& row : worker_.exec_params("SELECT id, name FROM tags WHERE name = ANY($1::varchar[])"_zv, tags)) {
+        ids.emplace(row[1].as<std::string>(), row[0].as<int>());
+    }
+    tag_ids_.clear();
+    tag_ids_.reserve(tags.size());
+    for (const auto& tag : tags) {
+        tag_ids_.push_back(ids.at(tag));
+    }
+}
+
+void PostgresCopySink::AddAuthor(std::string_view id, std::string_view name) {
+    Stream(Table::AUTHORS).write_values(id, name);
+}
+
+void PostgresCopySink::AddBook(std::string_view id, std::string_view author_id, std::string_view title, int year) {
+    Stream(Table::BOOKS).write_values(id, author_id, title, year);
+}
+
+void PostgresCopySink::AddTag(std::string_view book_id, size_t tag_index) {
+    Stream(Table::TAGS).write_values(book_id, tag_ids_.at(tag_index));
+}
+
+void PostgresCopySink::Finish() {
+    if (stream_) {
+        stream_->complete();
+        stream_.reset();
+    }
+    current_ = Table::NONE;
+}
+
+}  // namespace gen
@@ -0,0 +1,55 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <vector>
+#include <pqxx/pqxx>
+
+#include "generator.h"
+
+namespace gen {
+
+// Пишет tags.tsv, authors.tsv, books.tsv и book_tags.tsv в текстовом формате COPY.
+// Идентификаторы тегов начинаются с 1, файлы рассчитаны на загрузку в пустую базу
+class FileSink : public CatalogSink {
+public:
+    explicit FileSink(const std::filesystem::path& dir);
+
+    void AddTagVocabulary(const std::vector<std::string>& tags) override;
+    void AddAuthor(std::string_view id, std::string_view name) override;
+    void AddBook(std::string_view id, std::string_view author_id, std::string_view title, int year) override;
+    void AddTag(std::string_view book_id, size_t tag_index) override;
+    void Finish() override;
+
+private:
+    std::filesystem::path dir_;
+    std::ofstream authors_;
+    std::ofstream books_;
+    std::ofstream tags_;
+};
+
+// Загружает строки в схему postgres::Database через COPY FROM STDIN
+class PostgresCopySink : public CatalogSink {
+public:
+    explicit PostgresCopySink(pqxx::work& worker)
+        : worker_{worker} {
+    }
+
+    void AddTagVocabulary(const std::vector<std::string>& tags) override;
+    void AddAuthor(std::string_view id, std::string_view name) override;
+    void AddBook(std::string_view id, std::string_view author_id, std::string_view title, int year) override;
+    void AddTag(std::string_view book_id, size_t tag_index) override;
+    void Finish() override;
+
+private:
+    enum class Table { NONE, AUTHORS, BOOKS, TAGS };
+
+    pqxx::stream_to& Stream(Table table);
+
+    pqxx::work& worker_;
+    Table current_ = Table::NONE;
+    std::optional<pqxx::stream_to> stream_;
+    std::vector<int> tag_ids_;
+};
+
+}  // namespace gen
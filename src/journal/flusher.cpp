@@ -0,0 +1,268 @@
+#include "flusher.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#include "../domain/errors.h"
+#include "../metrics/metrics.h"
+#include "../unit/constraint_violation.h"
+#include "../unit/deadline.h"
+
+namespace journal {
+
+using namespace std::literals;
+
+namespace {
+
+std::string Describe(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::exception& ex) {
+        return ex.what();
+    } catch (...) {
+        return "unknown error"s;
+    }
+}
+
+}  // namespace
+
+Flusher::Flusher(factory_maker_t make_storage, JournalConfig config)
+    : make_storage_{std::move(make_storage)}
+    , config_{std::move(config)}
+    , file_{config_.path} {
+    static auto& replayed = metrics::GetCounter("journal_replayed_records");
+    storage_ = make_storage_();
+    {
+        // Только чтение: единица работы откатывается при разрушении
+        auto unit = storage_->CreateUnitOfWork();
+        applied_position_ = unit->GetJournalPosition(file_.GetId().ToString());
+    }
+    const auto now = std::chrono::steady_clock::now();
+    for (auto& record : file_.Read(applied_position_)) {
+        pending_.push_back({record.position, DecodeOperations(record.payload), now});
+    }
+    replayed.Increment(pending_.size());
+    appended_position_ = std::max(applied_position_, file_.LastPosition());
+    thread_ = std::thread{[this] {
+        Run();
+    }};
+}
+
+Flusher::~Flusher() {
+    {
+        std::unique_lock lock{mutex_};
+        applied_.wait_for(lock, config_.drain_timeout, [this] {
+            return pending_.empty() || failure_;
+        });
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+uint64_t Flusher::Append(operations_t operations, std::optional<time_point> deadline) {
+    static auto& latency = metrics::Latency(metrics::Scope::STATEMENT, "journal.append"sv);
+    static auto& throttled = metrics::GetCounter("journal_throttled_commits");
+    metrics::ScopedTimer timer{latency};
+    {
+        std::unique_lock lock{mutex_};
+        if (!HasRoom()) {
+            // Граница отставания: дальше сеанс идёт со скоростью хранилища
+            throttled.Increment();
+            const auto ready = [this] {
+                return HasRoom();
+            };
+            if (!deadline) {
+                applied_.wait(lock, ready);
+            } else if (!applied_.wait_until(lock, *deadline, ready)) {
+                throw app::DeadlineExceeded("Journal is too far ahead of the storage");
+            }
+        }
+    }
+    const auto payload = EncodeOperations(operations);
+    std::lock_guard append_lock{append_mutex_};
+    const auto position = file_.Append(payload);
+    {
+        std::lock_guard lock{mutex_};
+        pending_.push_back({position, std::move(operations), std::chrono::steady_clock::now()});
+        appended_position_ = position;
+    }
+    wake_.notify_one();
+    return position;
+}
+
+void Flusher::WaitApplied(std::optional<time_point> deadline) {
+    std::unique_lock lock{mutex_};
+    const auto target = appended_position_;
+    const auto done = [this, target] {
+        return applied_position_ >= target || failure_;
+    };
+    if (!deadline) {
+        applied_.wait(lock, done);
+    } else if (!applied_.wait_until(lock, *deadline, done)) {
+        throw app::DeadlineExceeded("Journal is not applied before the deadline");
+    }
+    if (applied_position_ < target) {
+        throw std::runtime_error("Journal can't be applied to the storage: "s + Describe(failure_));
+    }
+}
+
+uint64_t Flusher::AppliedPosition() const {
+    std::lock_guard lock{mutex_};
+    return applied_position_;
+}
+
+size_t Flusher::PendingCount() const {
+    std::lock_guard lock{mutex_};
+    return pending_.size();
+}
+
+std::vector<std::string> Flusher::TakeRejected() {
+    std::lock_guard lock{mutex_};
+    std::vector<std::string> result{std::make_move_iterator(unreported_.begin()),
+                                    std::make_move_iterator(unreported_.end())};
+    unreported_.clear();
+    return result;
+}
+
+bool Flusher::HasRoom() const {
+    if (pending_.empty()) {
+        return true;
+    }
+    return pending_.size() < config_.max_pending
+           && std::chrono::steady_clock::now() - pending_.front().appended_at < config_.max_lag;
+}
+
+void Flusher::Run() {
+    static auto& applied = metrics::GetCounter("journal_applied_records");
+    static auto& failures = metrics::GetCounter("journal_apply_failures");
+
+    std::unique_lock lock{mutex_};
+    while (true) {
+        wake_.wait(lock, [this] {
+            return stopping_ || !pending_.empty();
+        });
+        if (stopping_) {
+            return;
+        }
+        // Записи в начале очереди не двигаются: голову снимает только этот поток
+        std::vector<const Pending*> batch;
+        for (auto it = pending_.begin(); it != pending_.end() && batch.size() < config_.max_batch; ++it) {
+            batch.push_back(&*it);
+        }
+        lock.unlock();
+        std::exception_ptr error;
+        std::vector<Rejected> rejected;
+        try {
+            rejected = ApplyBatch(batch);
+        } catch (...) {
+            error = std::current_exception();
+            // Соединение могло оборваться: следующая попытка откроет новое
+            storage_.reset();
+        }
+        if (!error) {
+            ReportRejected(rejected);
+        }
+        lock.lock();
+        if (error) {
+            failures.Increment();
+            failure_ = error;
+            applied_.notify_all();
+            wake_.wait_for(lock, config_.retry_delay, [this] {
+                return stopping_;
+            });
+            continue;
+        }
+        failure_ = nullptr;
+        applied_position_ = batch.back()->position;
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(batch.size()));
+        applied.Increment(batch.size());
+        applied_.notify_all();
+        if (pending_.empty()) {
+            lock.unlock();
+            CompactIfIdle();
+            lock.lock();
+        }
+    }
+}
+
+std::vector<Flusher::Rejected> Flusher::ApplyBatch(const std::vector<const Pending*>& batch) {
+    static auto& latency = metrics::Latency(metrics::Scope::STATEMENT, "journal.apply"sv);
+    metrics::ScopedTimer timer{latency};
+    if (!storage_) {
+        storage_ = make_storage_();
+    }
+    std::vector<Rejected> rejected;
+    auto unit = storage_->CreateUnitOfWork();
+    for (const auto* record : batch) {
+        unit->BeginSavepoint();
+        try {
+            for (const auto& operation : record->operations) {
+                Apply(*unit, operation);
+            }
+        } catch (const domain::VersionConflict& ex) {
+            unit->RollbackToSavepoint();
+            rejected.push_back({record->position, ex.what()});
+        } catch (const app::ConstraintViolation& ex) {
+            unit->RollbackToSavepoint();
+            rejected.push_back({record->position, ex.what()});
+        } catch (const std::invalid_argument& ex) {
+            // Так хранилища отказывают в записи, противоречащей данным: повторяющееся имя автора,
+            // тег несуществующей книги
+            unit->RollbackToSavepoint();
+            rejected.push_back({record->position, ex.what()});
+        }
+        // Остальное (сбой сериализации, взаимоблокировка, таймауты, DeadlineExceeded, обрыв связи)
+        // может пройти при повторе: исключение откатывает пачку, и она применяется заново
+        unit->ReleaseSavepoint();
+    }
+    unit->SetJournalPosition(file_.GetId().ToString(), batch.back()->position);
+    unit->Commit();
+    return rejected;
+}
+
+void Flusher::ReportRejected(const std::vector<Rejected>& rejected) {
+    static auto& counter = metrics::GetCounter("journal_rejected");
+    if (rejected.empty()) {
+        return;
+    }
+    counter.Increment(rejected.size());
+    auto path = config_.path;
+    path += ".rejected";
+    std::ofstream out{path, std::ios::app};
+    std::lock_guard lock{mutex_};
+    for (const auto& record : rejected) {
+        // Одна строка на запись: переводы строк в тексте ошибки (например, SQL) заменяются пробелами
+        auto error = record.error;
+        std::replace(error.begin(), error.end(), '\n', ' ');
+        out << record.position << '\t' << error << '\n';
+        unreported_.push_back("change #"s + std::to_string(record.position) + ": "s + error);
+        if (unreported_.size() > MAX_UNREPORTED) {
+            unreported_.pop_front();
+        }
+    }
+}
+
+void Flusher::CompactIfIdle() {
+    std::lock_guard append_lock{append_mutex_};
+    if (file_.Size() <= config_.compact_bytes) {
+        return;
+    }
+    {
+        std::lock_guard lock{mutex_};
+        // Пока ждали файл, сеанс мог дописать запись
+        if (!pending_.empty()) {
+            return;
+        }
+    }
+    try {
+        file_.Compact();
+    } catch (const std::exception&) {
+        // Файл остаётся длинным; применённые записи при открытии всё равно пропускаются
+    }
+}
+
+}  // namespace journal
@@ -0,0 +1,105 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "journal.h"
+#include "../unit/unit_of_work_factory.h"
+
+namespace journal {
+
+/**
+ * Отложенная запись. Append дописывает операции закоммиченной единицы работы в файл журнала
+ * и возвращается, как только запись на диске. Поток сброса применяет записи к хранилищу
+ * по порядку, пачками до max_batch записей в одной транзакции, и в той же транзакции сохраняет
+ * позицию последней из них под id журнала (UnitOfWork::SetJournalPosition). Поэтому после
+ * сбоя в любой момент повтор с сохранённой позиции не применит запись дважды.
+ *
+ * Каждая запись применяется в своей точке сохранения. Если хранилище отказало в ней
+ * детерминированно (domain::VersionConflict, app::ConstraintViolation, std::invalid_argument),
+ * запись пропускается: повтор дал бы тот же отказ. Такие записи считаются в journal_rejected,
+ * дописываются в текстовый файл <журнал>.rejected и отдаются сеансу через TakeRejected.
+ * Любая другая ошибка, в том числе сбой сериализации, взаимоблокировка и таймаут,
+ * откатывает пачку целиком, и через retry_delay её применение повторяется на новом соединении.
+ */
+class Flusher {
+public:
+    using factory_maker_t = std::function<std::unique_ptr<app::UnitOfWorkFactory>()>;
+    using time_point = std::chrono::steady_clock::time_point;
+
+    // Открывает журнал и ставит в очередь записи, которых хранилище ещё не применило
+    Flusher(factory_maker_t make_storage, JournalConfig config);
+    // Ждёт применения принятого не дольше drain_timeout; остальное применится при следующем запуске
+    ~Flusher();
+
+    Flusher(const Flusher&) = delete;
+    Flusher& operator=(const Flusher&) = delete;
+
+    const JournalId& GetId() const noexcept {
+        return file_.GetId();
+    }
+
+    // Дописывает операции в журнал и возвращает позицию записи. Если хранилище отстало
+    // на max_pending записей или на max_lag, сначала ждёт его, но не дольше deadline
+    uint64_t Append(operations_t operations, std::optional<time_point> deadline = std::nullopt);
+    // Ждёт применения всех записей, принятых до вызова. Бросает ошибку хранилища,
+    // если последняя попытка применения не удалась, и DeadlineExceeded по сроку
+    void WaitApplied(std::optional<time_point> deadline = std::nullopt);
+
+    uint64_t AppliedPosition() const;
+    size_t PendingCount() const;
+    // Отвергнутые записи, о которых ещё не сообщили сеансу, не больше MAX_UNREPORTED последних
+    std::vector<std::string> TakeRejected();
+
+private:
+    static constexpr size_t MAX_UNREPORTED = 100;
+
+    struct Pending {
+        uint64_t position;
+        operations_t operations;
+        time_point appended_at;
+    };
+    struct Rejected {
+        uint64_t position;
+        std::string error;
+    };
+
+    void Run();
+    std::vector<Rejected> ApplyBatch(const std::vector<const Pending*>& batch);
+    void ReportRejected(const std::vector<Rejected>& rejected);
+    void CompactIfIdle();
+    bool HasRoom() const;
+
+    const factory_maker_t make_storage_;
+    const JournalConfig config_;
+    // Используется только потоком сброса; после ошибки пересоздаётся
+    std::unique_ptr<app::UnitOfWorkFactory> storage_;
+
+    // Порядок блокировок: append_mutex_, затем mutex_
+    std::mutex append_mutex_;
+    JournalFile file_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable applied_;
+    std::deque<Pending> pending_;
+    uint64_t appended_position_ = 0;
+    uint64_t applied_position_ = 0;
+    // Ошибка последней попытки применения, пока следующая не удалась
+    std::exception_ptr failure_;
+    std::deque<std::string> unreported_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}  // namespace journal
@@ -0,0 +1,57 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+namespace journal {
+
+/**
+ * Формат файла журнала отложенной записи. Все числа little-endian.
+ *
+ *   Header
+ *   записи подряд: RecordHeader и size байт операций одной закоммиченной единицы работы
+ *
+ * Позиции записей идут подряд, начиная с base_position + 1. Запись дописывается целиком
+ * и сбрасывается fsync до ответа сеансу; хвост, недописанный при сбое, не сходится
+ * по длине или CRC и отрезается при открытии.
+ *
+ * Операция: uint8 OpType, затем поля по порядку. UUID - 16 байт, int - int32,
+ * строка - uint32 длина и байты, список строк - uint32 число строк и строки.
+ */
+
+constexpr char MAGIC[8] = {'B', 'K', 'P', 'J', 'R', 'N', 'L', '\0'};
+constexpr uint32_t FORMAT_VERSION = 1;
+
+static_assert(std::endian::native == std::endian::little, "Journal format assumes a little-endian host");
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    // Журнал клиента в хранилище: под этим id хранится применённая позиция
+    uint8_t journal_id[16];
+    // Позиция последней записи, отрезанной при сжатии файла
+    uint64_t base_position;
+};
+
+struct RecordHeader {
+    uint32_t size;
+    // CRC-32 позиции и байт операций
+    uint32_t checksum;
+    uint64_t position;
+};
+
+enum class OpType : uint8_t {
+    SAVE_AUTHOR = 1,    // id, имя, версия
+    DELETE_AUTHOR = 2,  // id, имя
+    SAVE_BOOK = 3,      // id, id автора, название, год, версия
+    EDIT_BOOK = 4,      // id, название, год, версия
+    DELETE_BOOK = 5,    // id
+    CLEAR_TAGS = 6,     // id книги
+    SAVE_TAG = 7,       // id книги, тег
+    SYNC_TAGS = 8,      // id книги, название, год, версия, теги
+};
+
+static_assert(sizeof(Header) == 40);
+static_assert(sizeof(RecordHeader) == 16);
+
+}  // namespace journal
@@ -0,0 +1,460 @@
+#include "journal.h"
+
+#include <boost/crc.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <type_traits>
+#include <unistd.h>
+
+#include "format.h"
+#include "../unit/unit_of_work.h"
+
+namespace journal {
+
+using namespace std::literals;
+
+namespace {
+
+using Uuid = util::detail::UUIDType;
+
+template <typename... Ts>
+struct Overloaded : Ts... {
+    using Ts::operator()...;
+};
+template <typename... Ts>
+Overloaded(Ts...) -> Overloaded<Ts...>;
+
+class Encoder {
+public:
+    void PutType(OpType type) {
+        data_.push_back(static_cast<char>(type));
+    }
+    void PutId(const Uuid& id) {
+        data_.append(reinterpret_cast<const char*>(id.data), sizeof(id.data));
+    }
+    void PutInt(int value) {
+        PutRaw(static_cast<int32_t>(value));
+    }
+    void PutString(std::string_view value) {
+        PutRaw(static_cast<uint32_t>(value.size()));
+        data_.append(value);
+    }
+    void PutStrings(const std::vector<std::string>& values) {
+        PutRaw(static_cast<uint32_t>(values.size()));
+        for (const auto& value : values) {
+            PutString(value);
+        }
+    }
+
+    std::string Release() {
+        return std::move(data_);
+    }
+
+private:
+    template <typename T>
+    void PutRaw(T value) {
+        data_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    std::string data_;
+};
+
+class Decoder {
+public:
+    explicit Decoder(std::string_view data)
+        : data_{data} {
+    }
+
+    bool AtEnd() const noexcept {
+        return data_.empty();
+    }
+    OpType GetType() {
+        return static_cast<OpType>(GetRaw<uint8_t>());
+    }
+    Uuid GetId() {
+        Uuid id;
+        std::memcpy(id.data, Take(sizeof(id.data)).data(), sizeof(id.data));
+        return id;
+    }
+    int GetInt() {
+        return GetRaw<int32_t>();
+    }
+    std::string GetString() {
+        const auto size = GetRaw<uint32_t>();
+        return std::string(Take(size));
+    }
+    std::vector<std::string> GetStrings() {
+        const auto count = GetRaw<uint32_t>();
+        std::vector<std::string> values;
+        // Число строк не больше числа оставшихся байт: битая длина не раздует вектор
+        values.reserve(std::min<size_t>(count, data_.size()));
+        for (uint32_t i = 0; i < count; ++i) {
+            values.push_back(GetString());
+        }
+        return values;
+    }
+
+private:
+    std::string_view Take(size_t size) {
+        if (size > data_.size()) {
+            throw FormatError("Journal record is truncated"s);
+        }
+        auto result = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return result;
+    }
+    template <typename T>
+    T GetRaw() {
+        T value;
+        std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    std::string_view data_;
+};
+
+uint32_t Checksum(uint64_t position, std::string_view payload) {
+    boost::crc_32_type crc;
+    crc.process_bytes(&position, sizeof(position));
+    crc.process_bytes(payload.data(), payload.size());
+    return crc.checksum();
+}
+
+[[noreturn]] void ThrowSystemError(const std::string& what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+void ReadExactly(int fd, void* data, size_t size, uint64_t offset, const std::filesystem::path& path) {
+    auto* out = static_cast<char*>(data);
+    while (size > 0) {
+        const auto read = ::pread(fd, out, size, static_cast<off_t>(offset));
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read < 0) {
+            ThrowSystemError("Can't read journal "s + path.string());
+        }
+        if (read == 0) {
+            throw FormatError("Journal "s + path.string() + " is truncated"s);
+        }
+        out += read;
+        size -= static_cast<size_t>(read);
+        offset += static_cast<uint64_t>(read);
+    }
+}
+
+void WriteExactly(int fd, const void* data, size_t size, uint64_t offset, const std::filesystem::path& path) {
+    const auto* in = static_cast<const char*>(data);
+    while (size > 0) {
+        const auto written = ::pwrite(fd, in, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written < 0) {
+            ThrowSystemError("Can't write journal "s + path.string());
+        }
+        in += written;
+        size -= static_cast<size_t>(written);
+        offset += static_cast<uint64_t>(written);
+    }
+}
+
+// Обходит целые записи после заголовка. Возвращает смещение конца последней целой записи
+template <typename Visitor>
+uint64_t ScanRecords(int fd, uint64_t file_size, uint64_t base_position, const std::filesystem::path& path,
+                     const Visitor& visitor) {
+    uint64_t offset = sizeof(Header);
+    auto expected = base_position + 1;
+    std::string payload;
+    while (file_size - offset >= sizeof(RecordHeader)) {
+        RecordHeader record;
+        ReadExactly(fd, &record, sizeof(record), offset, path);
+        if (record.position != expected || record.size > file_size - offset - sizeof(record)) {
+            break;
+        }
+        payload.resize(record.size);
+        ReadExactly(fd, payload.data(), payload.size(), offset + sizeof(record), path);
+        if (Checksum(record.position, payload) != record.checksum) {
+            break;
+        }
+        visitor(record.position, payload);
+        offset += sizeof(record) + record.size;
+        ++expected;
+    }
+    return offset;
+}
+
+}  // namespace
+
+std::string EncodeOperations(const operations_t& operations) {
+    Encoder out;
+    for (const auto& operation : operations) {
+        std::visit(Overloaded{
+            [&out](const SaveAuthor& op) {
+                out.PutType(OpType::SAVE_AUTHOR);
+                out.PutId(*op.author.GetId());
+                out.PutString(op.author.GetName());
+                out.PutInt(op.author.GetVersion());
+            },
+            [&out](const DeleteAuthor& op) {
+                out.PutType(OpType::DELETE_AUTHOR);
+                out.PutId(*op.author.GetId());
+                out.PutString(op.author.GetName());
+            },
+            [&out](const SaveBook& op) {
+                out.PutType(OpType::SAVE_BOOK);
+                out.PutId(*op.book.GetId());
+                out.PutId(*op.book.GetAuthorId());
+                out.PutString(op.book.GetTitle());
+                out.PutInt(op.book.GetYear());
+                out.PutInt(op.book.GetVersion());
+            },
+            [&out](const EditBook& op) {
+                out.PutType(OpType::EDIT_BOOK);
+                out.PutId(*op.book.GetId());
+                out.PutString(op.book.GetTitle());
+                out.PutInt(op.book.GetYear());
+                out.PutInt(op.book.GetVersion());
+            },
+            [&out](const DeleteBook& op) {
+                out.PutType(OpType::DELETE_BOOK);
+                out.PutId(*op.book_id);
+            },
+            [&out](const ClearTags& op) {
+                out.PutType(OpType::CLEAR_TAGS);
+                out.PutId(*op.book_id);
+            },
+            [&out](const SaveTag& op) {
+                out.PutType(OpType::SAVE_TAG);
+                out.PutId(*op.tag.GetBookId());
+                out.PutString(op.tag.GetTag());
+            },
+            [&out](const SyncTags& op) {
+                out.PutType(OpType::SYNC_TAGS);
+                out.PutId(*op.book.GetId());
+                out.PutString(op.book.GetTitle());
+                out.PutInt(op.book.GetYear());
+                out.PutInt(op.book.GetVersion());
+                out.PutStrings(op.tags);
+            },
+        }, operation);
+    }
+    return out.Release();
+}
+
+operations_t DecodeOperations(std::string_view data) {
+    Decoder in{data};
+    operations_t operations;
+    while (!in.AtEnd()) {
+        switch (in.GetType()) {
+            case OpType::SAVE_AUTHOR: {
+                domain::AuthorId id{in.GetId()};
+                auto name = in.GetString();
+                operations.push_back(SaveAuthor{{id, std::move(name), in.GetInt()}});
+                break;
+            }
+            case OpType::DELETE_AUTHOR: {
+                domain::AuthorId id{in.GetId()};
+                operations.push_back(DeleteAuthor{{id, in.GetString()}});
+                break;
+            }
+            case OpType::SAVE_BOOK: {
+                domain::BookId id{in.GetId()};
+                domain::AuthorId author_id{in.GetId()};
+                auto title = in.GetString();
+                const auto year = in.GetInt();
+                operations.push_back(SaveBook{{id, {author_id, ""s}, std::move(title), year, in.GetInt()}});
+                break;
+            }
+            case OpType::EDIT_BOOK: {
+                domain::BookId id{in.GetId()};
+                auto title = in.GetString();
+                const auto year = in.GetInt();
+                operations.push_back(EditBook{{id, {{}, ""s}, std::move(title), year, in.GetInt()}});
+                break;
+            }
+            case OpType::DELETE_BOOK:
+                operations.push_back(DeleteBook{domain::BookId{in.GetId()}});
+                break;
+            case OpType::CLEAR_TAGS:
+                operations.push_back(ClearTags{domain::BookId{in.GetId()}});
+                break;
+            case OpType::SAVE_TAG: {
+                domain::BookId id{in.GetId()};
+                operations.push_back(SaveTag{{id, in.GetString()}});
+                break;
+            }
+            case OpType::SYNC_TAGS: {
+                domain::BookId id{in.GetId()};
+                auto title = in.GetString();
+                const auto year = in.GetInt();
+                const auto version = in.GetInt();
+                operations.push_back(SyncTags{{id, {{}, ""s}, std::move(title), year, version}, in.GetStrings()});
+                break;
+            }
+            default:
+                throw FormatError("Unknown journal operation"s);
+        }
+    }
+    return operations;
+}
+
+void Apply(app::UnitOfWork& unit, const Operation& operation) {
+    std::visit(Overloaded{
+        [&unit](const SaveAuthor& op) {
+            unit.Authors().Save(op.author);
+        },
+        [&unit](const DeleteAuthor& op) {
+            unit.Authors().DeleteAuthorAndDependencies(op.author);
+        },
+        [&unit](const SaveBook& op) {
+            unit.Books().Save(op.book);
+        },
+        [&unit](const EditBook& op) {
+            unit.Books().Edit(op.book);
+        },
+        [&unit](const DeleteBook& op) {
+            unit.Books().Delete(op.book_id);
+        },
+        [&unit](const ClearTags& op) {
+            unit.Tags().ClearTagsByBookId(op.book_id);
+        },
+        [&unit](const SaveTag& op) {
+            unit.Tags().Save(op.tag);
+        },
+        [&unit](const SyncTags& op) {
+            unit.Tags().SyncBookTags(op.book, op.tags);
+        },
+    }, operation);
+}
+
+JournalFile::JournalFile(std::filesystem::path path)
+    : path_{std::move(path)} {
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        ThrowSystemError("Can't open journal "s + path_.string());
+    }
+    try {
+        struct stat info;
+        if (::fstat(fd_, &info) != 0) {
+            ThrowSystemError("Can't open journal "s + path_.string());
+        }
+        const auto file_size = static_cast<uint64_t>(info.st_size);
+        // Заголовок пишется до первой записи: недописанный - значит, записей не было
+        if (file_size < sizeof(Header)) {
+            Create();
+            return;
+        }
+        Header header;
+        ReadExactly(fd_, &header, sizeof(header), 0, path_);
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+            throw FormatError(path_.string() + " is not a bookypedia journal"s);
+        }
+        if (header.version != FORMAT_VERSION || header.header_size != sizeof(Header)) {
+            throw FormatError("Unsupported journal version "s + std::to_string(header.version));
+        }
+        std::memcpy((*id_).data, header.journal_id, sizeof(header.journal_id));
+        last_position_ = header.base_position;
+        size_ = ScanRecords(fd_, file_size, header.base_position, path_, [this](uint64_t position, std::string_view) {
+            last_position_ = position;
+        });
+        if (size_ < file_size) {
+            // Запись, недописанная при сбое: о ней сеансу не ответили, её нет
+            if (::ftruncate(fd_, static_cast<off_t>(size_)) != 0) {
+                ThrowSystemError("Can't truncate journal "s + path_.string());
+            }
+            Sync();
+        }
+    } catch (...) {
+        ::close(fd_);
+        throw;
+    }
+}
+
+JournalFile::~JournalFile() {
+    ::close(fd_);
+}
+
+std::vector<JournalFile::Record> JournalFile::Read(uint64_t after) const {
+    Header header;
+    ReadExactly(fd_, &header, sizeof(header), 0, path_);
+    std::vector<Record> records;
+    ScanRecords(fd_, size_, header.base_position, path_, [after, &records](uint64_t position, std::string_view payload) {
+        if (position > after) {
+            records.push_back({position, std::string(payload)});
+        }
+    });
+    return records;
+}
+
+uint64_t JournalFile::Append(std::string_view payload) {
+    const auto position = last_position_ + 1;
+    RecordHeader header{static_cast<uint32_t>(payload.size()), Checksum(position, payload), position};
+    std::string record;
+    record.reserve(sizeof(header) + payload.size());
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    record.append(payload);
+    try {
+        WriteExactly(fd_, record.data(), record.size(), size_, path_);
+        if (::fdatasync(fd_) != 0) {
+            ThrowSystemError("Can't sync journal "s + path_.string());
+        }
+    } catch (...) {
+        // Частично записанную запись убираем; если не вышло, её отрежет проверка при открытии
+        (void)::ftruncate(fd_, static_cast<off_t>(size_));
+        throw;
+    }
+    size_ += record.size();
+    last_position_ = position;
+    return position;
+}
+
+void JournalFile::Compact() {
+    // Сначала заголовок с новой базой: если усечь не успеем, старые записи пропустит нумерация
+    WriteHeader(last_position_);
+    Sync();
+    if (::ftruncate(fd_, static_cast<off_t>(sizeof(Header))) != 0) {
+        ThrowSystemError("Can't truncate journal "s + path_.string());
+    }
+    Sync();
+    size_ = sizeof(Header);
+}
+
+void JournalFile::Create() {
+    id_ = JournalId::New();
+    if (::ftruncate(fd_, 0) != 0) {
+        ThrowSystemError("Can't create journal "s + path_.string());
+    }
+    WriteHeader(0);
+    Sync();
+    // Новый файл должен пережить сбой вместе с записью о нём в каталоге
+    const auto dir = path_.has_parent_path() ? path_.parent_path() : std::filesystem::path{"."};
+    const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+    last_position_ = 0;
+    size_ = sizeof(Header);
+}
+
+void JournalFile::WriteHeader(uint64_t base_position) {
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = FORMAT_VERSION;
+    header.header_size = sizeof(Header);
+    std::memcpy(header.journal_id, (*id_).data, sizeof(header.journal_id));
+    header.base_position = base_position;
+    WriteExactly(fd_, &header, sizeof(header), 0, path_);
+}
+
+void JournalFile::Sync() {
+    if (::fsync(fd_) != 0) {
+        ThrowSystemError("Can't sync journal "s + path_.string());
+    }
+}
+
+}  // namespace journal
@@ -0,0 +1,134 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+#include "../domain/tag.h"
+#include "../util/tagged_uuid.h"
+
+namespace app {
+class UnitOfWork;
+}
+
+namespace journal {
+
+namespace detail {
+struct JournalTag {};
+}  // namespace detail
+
+// Создаётся клиентом вместе с файлом журнала; под ним хранилище помнит применённую позицию
+using JournalId = util::TaggedUUID<detail::JournalTag>;
+
+class FormatError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct JournalConfig {
+    std::filesystem::path path;
+    // Записей в одной транзакции применения
+    size_t max_batch = 256;
+    // Отставание хранилища: коммит ждёт, пока неприменённых записей не станет меньше max_pending
+    // и самая старая из них не окажется моложе max_lag
+    size_t max_pending = 10000;
+    std::chrono::milliseconds max_lag{30000};
+    // Пауза перед повтором, если хранилище недоступно
+    std::chrono::milliseconds retry_delay{1000};
+    // Когда всё применено, а файл больше этого, он усекается до заголовка
+    size_t compact_bytes = 1024 * 1024;
+    // Сколько при остановке ждать применения журнала; остаток применится при следующем запуске
+    std::chrono::milliseconds drain_timeout{10000};
+};
+
+// Записи репозиториев, которые единица работы откладывает до применения журнала
+struct SaveAuthor {
+    domain::Author author;
+};
+struct DeleteAuthor {
+    domain::Author author;
+};
+struct SaveBook {
+    domain::Book book;
+};
+struct EditBook {
+    domain::Book book;
+};
+struct DeleteBook {
+    domain::BookId book_id;
+};
+struct ClearTags {
+    domain::BookId book_id;
+};
+struct SaveTag {
+    domain::Tag tag;
+};
+struct SyncTags {
+    domain::Book book;
+    std::vector<std::string> tags;
+};
+
+using Operation = std::variant<SaveAuthor, DeleteAuthor, SaveBook, EditBook, DeleteBook, ClearTags, SaveTag, SyncTags>;
+using operations_t = std::vector<Operation>;
+
+std::string EncodeOperations(const operations_t& operations);
+// Бросает FormatError, если байты не разбираются
+operations_t DecodeOperations(std::string_view data);
+// Повторяет операцию на единице работы хранилища
+void Apply(app::UnitOfWork& unit, const Operation& operation);
+
+/**
+ * Файл журнала (формат - в format.h). Append возвращается, только когда запись на диске.
+ * Не потокобезопасен: вызовы сериализует владелец.
+ */
+class JournalFile {
+public:
+    struct Record {
+        uint64_t position;
+        std::string payload;
+    };
+
+    // Открывает журнал или создаёт пустой с новым id. Недописанный хвост отрезается
+    explicit JournalFile(std::filesystem::path path);
+    ~JournalFile();
+
+    JournalFile(const JournalFile&) = delete;
+    JournalFile& operator=(const JournalFile&) = delete;
+
+    const JournalId& GetId() const noexcept {
+        return id_;
+    }
+    uint64_t LastPosition() const noexcept {
+        return last_position_;
+    }
+    uint64_t Size() const noexcept {
+        return size_;
+    }
+
+    // Записи с позицией больше after, по порядку
+    std::vector<Record> Read(uint64_t after) const;
+    // Дописывает запись и сбрасывает её на диск. Возвращает позицию записи
+    uint64_t Append(std::string_view payload);
+    // Все записи применены: файл усекается до заголовка, нумерация продолжается
+    void Compact();
+
+private:
+    void Create();
+    void WriteHeader(uint64_t base_position);
+    void Sync();
+
+    const std::filesystem::path path_;
+    int fd_ = -1;
+    JournalId id_;
+    uint64_t last_position_ = 0;
+    uint64_t size_ = 0;
+};
+
+}  // namespace journal
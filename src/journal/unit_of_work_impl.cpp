@@ -0,0 +1,135 @@
+#include "unit_of_work_impl.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace journal {
+
+void AuthorRepositoryImpl::DeleteAuthorAndDependencies(const domain::Author& author) {
+    unit_.Record(DeleteAuthor{author});
+}
+
+void AuthorRepositoryImpl::Save(const domain::Author& author) {
+    unit_.Record(SaveAuthor{author});
+}
+
+domain::AuthorRepository::list_authors_t AuthorRepositoryImpl::GetList() {
+    return unit_.Read().Authors().GetList();
+}
+
+std::optional<domain::Author> AuthorRepositoryImpl::FindAuthorByName(const std::string& name) {
+    return unit_.Read().Authors().FindAuthorByName(name);
+}
+
+void AuthorRepositoryImpl::ForEach(const std::function<void(const domain::Author&)>& visitor) {
+    unit_.Read().Authors().ForEach(visitor);
+}
+
+void BookRepositoryImpl::Save(const domain::Book& book) {
+    unit_.Record(SaveBook{book});
+}
+
+void BookRepositoryImpl::Edit(const domain::Book& book) {
+    unit_.Record(EditBook{book});
+}
+
+void BookRepositoryImpl::Delete(const domain::BookId& book_id) {
+    unit_.Record(DeleteBook{book_id});
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetList() {
+    return unit_.Read().Books().GetList();
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBookByAuthorId(const domain::AuthorId& author_id) {
+    return unit_.Read().Books().GetBookByAuthorId(author_id);
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByTitle(const std::string& title) {
+    return unit_.Read().Books().GetBooksByTitle(title);
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByYearRange(const domain::YearRangeQuery& query) {
+    return unit_.Read().Books().GetBooksByYearRange(query);
+}
+
+void BookRepositoryImpl::ForEach(const std::function<void(const domain::Book&)>& visitor) {
+    unit_.Read().Books().ForEach(visitor);
+}
+
+void TagRepositoryImpl::ClearTagsByBookId(const domain::BookId& book_id) {
+    unit_.Record(ClearTags{book_id});
+}
+
+void TagRepositoryImpl::Save(const domain::Tag& tag) {
+    unit_.Record(SaveTag{tag});
+}
+
+domain::TagRepository::list_tags_t TagRepositoryImpl::GetTagsByBookId(const domain::BookId& book_id) {
+    return unit_.Read().Tags().GetTagsByBookId(book_id);
+}
+
+bool TagRepositoryImpl::SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) {
+    unit_.Record(SyncTags{book, tags});
+    return true;
+}
+
+void TagRepositoryImpl::ForEach(const std::function<void(const domain::Tag&)>& visitor) {
+    unit_.Read().Tags().ForEach(visitor);
+}
+
+void UnitOfWorkImpl::Commit() {
+    if (!operations_.empty()) {
+        flusher_.Append(std::exchange(operations_, {}), deadline_);
+    }
+    savepoints_.clear();
+    if (inner_) {
+        // Транзакция хранилища только читала
+        std::exchange(inner_, nullptr)->Commit();
+    }
+}
+
+void UnitOfWorkImpl::BeginSavepoint() {
+    savepoints_.push_back(operations_.size());
+}
+
+void UnitOfWorkImpl::RollbackToSavepoint() {
+    if (savepoints_.empty()) {
+        throw std::logic_error("No savepoint to roll back to");
+    }
+    operations_.erase(operations_.begin() + static_cast<std::ptrdiff_t>(savepoints_.back()), operations_.end());
+}
+
+void UnitOfWorkImpl::ReleaseSavepoint() {
+    if (savepoints_.empty()) {
+        throw std::logic_error("No savepoint to release");
+    }
+    savepoints_.pop_back();
+}
+
+void UnitOfWorkImpl::SetDeadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+    if (inner_) {
+        inner_->SetDeadline(deadline);
+    }
+}
+
+void UnitOfWorkImpl::ClearDeadline() noexcept {
+    deadline_.reset();
+    if (inner_) {
+        inner_->ClearDeadline();
+    }
+}
+
+app::UnitOfWork& UnitOfWorkImpl::Read() {
+    if (!inner_) {
+        flusher_.WaitApplied(deadline_);
+        inner_ = storage_.CreateUnitOfWork();
+        if (deadline_) {
+            inner_->SetDeadline(*deadline_);
+        }
+    }
+    return *inner_;
+}
+
+}  // namespace journal
@@ -0,0 +1,151 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "flusher.h"
+#include "journal.h"
+#include "../unit/unit_of_work.h"
+#include "../unit/unit_of_work_factory.h"
+
+namespace journal {
+
+class UnitOfWorkImpl;
+
+class AuthorRepositoryImpl : public domain::AuthorRepository {
+public:
+    explicit AuthorRepositoryImpl(UnitOfWorkImpl& unit)
+        : unit_{unit} {
+    }
+
+    void DeleteAuthorAndDependencies(const domain::Author& author) override;
+    void Save(const domain::Author& author) override;
+    list_authors_t GetList() override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+    void ForEach(const std::function<void(const domain::Author&)>& visitor) override;
+
+private:
+    UnitOfWorkImpl& unit_;
+};
+
+class BookRepositoryImpl : public domain::BookRepository {
+public:
+    explicit BookRepositoryImpl(UnitOfWorkImpl& unit)
+        : unit_{unit} {
+    }
+
+    void Save(const domain::Book& book) override;
+    void Edit(const domain::Book& book) override;
+    void Delete(const domain::BookId& book_id) override;
+    list_books_t GetList() override;
+    list_books_t GetBookByAuthorId(const domain::AuthorId& author_id) override;
+    list_books_t GetBooksByTitle(const std::string& title) override;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) override;
+    void ForEach(const std::function<void(const domain::Book&)>& visitor) override;
+
+private:
+    UnitOfWorkImpl& unit_;
+};
+
+class TagRepositoryImpl : public domain::TagRepository {
+public:
+    explicit TagRepositoryImpl(UnitOfWorkImpl& unit)
+        : unit_{unit} {
+    }
+
+    void ClearTagsByBookId(const domain::BookId& book_id) override;
+    void Save(const domain::Tag& tag) override;
+    list_tags_t GetTagsByBookId(const domain::BookId& book_id) override;
+    // Хранилище увидит теги только после применения журнала, поэтому считается, что изменилось
+    bool SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) override;
+    void ForEach(const std::function<void(const domain::Tag&)>& visitor) override;
+
+private:
+    UnitOfWorkImpl& unit_;
+};
+
+/**
+ * Единица работы с отложенной записью. Записи копятся в памяти и при коммите одной записью
+ * уходят в журнал; коммит не ждёт хранилища. Чтения идут в единицу работы хранилища, которая
+ * открывается только после применения всего уже принятого журналом, - сеанс видит свои
+ * прошлые коммиты. Собственные ещё не закоммиченные записи этой единицы работы чтениям не видны.
+ */
+class UnitOfWorkImpl : public app::UnitOfWork {
+public:
+    UnitOfWorkImpl(app::UnitOfWorkFactory& storage, Flusher& flusher)
+        : storage_{storage}
+        , flusher_{flusher} {
+    }
+
+    void Commit() override;
+    // Точки сохранения отмечают место в накопленных записях, хранилища они не касаются
+    void BeginSavepoint() override;
+    void RollbackToSavepoint() override;
+    void ReleaseSavepoint() override;
+    // Срок ограничивает и ожидание журнала, и запросы хранилища
+    void SetDeadline(std::chrono::steady_clock::time_point deadline) override;
+    void ClearDeadline() noexcept override;
+
+    AuthorRepositoryImpl& Authors() override {
+        return authors_;
+    }
+    BookRepositoryImpl& Books() override {
+        return books_;
+    }
+    TagRepositoryImpl& Tags() override {
+        return tags_;
+    }
+    domain::StatsRepository& Stats() override {
+        return Read().Stats();
+    }
+
+    // Единица работы хранилища для чтений
+    app::UnitOfWork& Read();
+    void Record(Operation operation) {
+        operations_.push_back(std::move(operation));
+    }
+
+private:
+    app::UnitOfWorkFactory& storage_;
+    Flusher& flusher_;
+    std::shared_ptr<app::UnitOfWork> inner_;
+    operations_t operations_;
+    std::vector<size_t> savepoints_;
+    std::optional<std::chrono::steady_clock::time_point> deadline_;
+
+    AuthorRepositoryImpl authors_{*this};
+    BookRepositoryImpl books_{*this};
+    TagRepositoryImpl tags_{*this};
+};
+
+// Ставит журнал отложенной записи перед хранилищем, которое умеет хранить его позицию
+class UnitOfWorkFactoryImpl : public app::UnitOfWorkFactory {
+public:
+    // storage обслуживает чтения сеансов; журнал применяется через своё хранилище из make_apply_storage
+    UnitOfWorkFactoryImpl(std::unique_ptr<app::UnitOfWorkFactory> storage, Flusher::factory_maker_t make_apply_storage,
+                          JournalConfig config)
+        : storage_{std::move(storage)}
+        , flusher_{std::move(make_apply_storage), std::move(config)} {
+    }
+
+    Flusher& GetFlusher() noexcept {
+        return flusher_;
+    }
+
+    std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+        return std::make_shared<UnitOfWorkImpl>(*storage_, flusher_);
+    }
+    std::vector<std::string> TakeRejectedWrites() override {
+        return flusher_.TakeRejected();
+    }
+
+private:
+    std::unique_ptr<app::UnitOfWorkFactory> storage_;
+    // Останавливается первым: дожидается применения, пока хранилище сеансов ещё открыто
+    Flusher flusher_;
+};
+
+}  // namespace journal
@@ -1,30 +1,191 @@
 #include <cstdlib>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include "bookypedia.h"
+#include "metrics/metrics.h"
+#include "metrics/trace.h"
+#include "postgres/resharder.h"
+#include "snapshot/writer.h"
 
 using namespace std::literals;
 
 namespace {
 
 constexpr const char DB_URL_ENV_NAME[]{"BOOKYPEDIA_DB_URL"};
+constexpr const char SHARD_URLS_ENV_NAME[]{"BOOKYPEDIA_SHARD_URLS"};
+constexpr const char RESHARD_FROM_ENV_NAME[]{"BOOKYPEDIA_RESHARD_FROM"};
+constexpr const char REPLICA_STALENESS_MS_ENV_NAME[]{"BOOKYPEDIA_REPLICA_STALENESS_MS"};
+constexpr const char CACHE_MB_ENV_NAME[]{"BOOKYPEDIA_CACHE_MB"};
+constexpr const char CACHE_TTL_MS_ENV_NAME[]{"BOOKYPEDIA_CACHE_TTL_MS"};
+constexpr const char JOURNAL_PATH_ENV_NAME[]{"BOOKYPEDIA_JOURNAL_PATH"};
+constexpr const char JOURNAL_MAX_LAG_MS_ENV_NAME[]{"BOOKYPEDIA_JOURNAL_MAX_LAG_MS"};
+constexpr const char JOURNAL_MAX_PENDING_ENV_NAME[]{"BOOKYPEDIA_JOURNAL_MAX_PENDING"};
+constexpr const char METRICS_FILE_ENV_NAME[]{"BOOKYPEDIA_METRICS_FILE"};
+constexpr const char METRICS_ENV_NAME[]{"BOOKYPEDIA_METRICS"};
+constexpr const char TRACE_FILE_ENV_NAME[]{"BOOKYPEDIA_TRACE_FILE"};
+constexpr const char TRACE_SAMPLE_RATE_ENV_NAME[]{"BOOKYPEDIA_TRACE_SAMPLE_RATE"};
+constexpr const char STARTUP_REPORT_ENV_NAME[]{"BOOKYPEDIA_STARTUP_REPORT"};
+constexpr const char PREFETCH_ENV_NAME[]{"BOOKYPEDIA_PREFETCH"};
+constexpr const char CALL_TIMEOUT_MS_ENV_NAME[]{"BOOKYPEDIA_CALL_TIMEOUT_MS"};
+constexpr const char SLOW_QUERY_MS_ENV_NAME[]{"BOOKYPEDIA_SLOW_QUERY_MS"};
+constexpr const char SLOW_QUERY_LOG_ENV_NAME[]{"BOOKYPEDIA_SLOW_QUERY_LOG"};
+constexpr const char SLOW_QUERY_EXPLAIN_ENV_NAME[]{"BOOKYPEDIA_SLOW_QUERY_EXPLAIN_RATE"};
+
+// Адреса шардов разделяются ';' - запятые встречаются в URL с несколькими хостами
+std::vector<std::string> SplitUrls(std::string_view urls) {
+    std::vector<std::string> result;
+    while (!urls.empty()) {
+        const auto pos = urls.find(';');
+        auto url = urls.substr(0, pos);
+        if (!url.empty()) {
+            result.emplace_back(url);
+        }
+        urls.remove_prefix(pos == urls.npos ? urls.size() : pos + 1);
+    }
+    return result;
+}
 
 bookypedia::AppConfig GetConfigFromEnv() {
     bookypedia::AppConfig config;
-    if (const auto* url = std::getenv(DB_URL_ENV_NAME)) {
-        config.db_url = url;
+    if (const auto* urls = std::getenv(SHARD_URLS_ENV_NAME)) {
+        config.storage.urls = SplitUrls(urls);
+        if (const auto* previous = std::getenv(RESHARD_FROM_ENV_NAME)) {
+            config.storage.previous_shard_count = std::stoull(previous);
+        }
+    } else if (const auto* url = std::getenv(DB_URL_ENV_NAME)) {
+        config.storage.urls.emplace_back(url);
     } else {
         throw std::runtime_error(DB_URL_ENV_NAME + " environment variable not found"s);
     }
+    if (const auto* staleness = std::getenv(REPLICA_STALENESS_MS_ENV_NAME)) {
+        postgres::ReplicaConfig replica;
+        replica.max_staleness = std::chrono::milliseconds(std::stoll(staleness));
+        config.storage.replica = replica;
+    }
+    if (const auto* megabytes = std::getenv(CACHE_MB_ENV_NAME)) {
+        app::CatalogCacheConfig cache;
+        cache.max_bytes = std::stoull(megabytes) * 1024 * 1024;
+        if (const auto* ttl = std::getenv(CACHE_TTL_MS_ENV_NAME)) {
+            cache.max_age = std::chrono::milliseconds(std::stoll(ttl));
+        }
+        config.storage.cache = cache;
+    }
+    if (const auto* path = std::getenv(JOURNAL_PATH_ENV_NAME)) {
+        journal::JournalConfig journal;
+        journal.path = path;
+        if (const auto* lag = std::getenv(JOURNAL_MAX_LAG_MS_ENV_NAME)) {
+            journal.max_lag = std::chrono::milliseconds(std::stoll(lag));
+        }
+        if (const auto* pending = std::getenv(JOURNAL_MAX_PENDING_ENV_NAME)) {
+            journal.max_pending = std::stoull(pending);
+        }
+        config.storage.journal = std::move(journal);
+    }
+    if (const auto* path = std::getenv(METRICS_FILE_ENV_NAME)) {
+        config.metrics_file = path;
+    }
+    if (const auto* enabled = std::getenv(METRICS_ENV_NAME)) {
+        metrics::SetEnabled(enabled != "off"sv && enabled != "0"sv);
+    }
+    if (const auto* path = std::getenv(TRACE_FILE_ENV_NAME)) {
+        metrics::TraceConfig trace;
+        trace.path = path;
+        if (const auto* rate = std::getenv(TRACE_SAMPLE_RATE_ENV_NAME)) {
+            trace.sample_rate = std::stod(rate);
+        }
+        metrics::ConfigureTracing(std::move(trace));
+    }
+    if (const auto* report = std::getenv(STARTUP_REPORT_ENV_NAME)) {
+        config.startup_report = report != "off"sv && report != "0"sv;
+    }
+    if (const auto* prefetch = std::getenv(PREFETCH_ENV_NAME)) {
+        config.prefetch = prefetch != "off"sv && prefetch != "0"sv;
+    }
+    if (const auto* timeout = std::getenv(CALL_TIMEOUT_MS_ENV_NAME)) {
+        config.call_timeout = std::chrono::milliseconds(std::stoll(timeout));
+    }
+    if (const auto* threshold = std::getenv(SLOW_QUERY_MS_ENV_NAME)) {
+        postgres::SlowQueryConfig slow_log;
+        slow_log.threshold = std::chrono::milliseconds(std::stoll(threshold));
+        if (const auto* path = std::getenv(SLOW_QUERY_LOG_ENV_NAME)) {
+            slow_log.path = path;
+        }
+        if (const auto* rate = std::getenv(SLOW_QUERY_EXPLAIN_ENV_NAME)) {
+            slow_log.explain_sample_rate = std::stod(rate);
+        }
+        config.slow_query_log = std::move(slow_log);
+    }
     return config;
 }
 
+struct Args {
+    bool reshard = false;
+    std::string export_snapshot;
+};
+
+Args ApplyArgs(bookypedia::AppConfig& config, int argc, const char* argv[]) {
+    Args args;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg{argv[i]};
+        if (arg == "--batch"sv) {
+            config.batch = true;
+            continue;
+        }
+        if (arg == "--reshard"sv) {
+            args.reshard = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            throw std::invalid_argument("Missing value for "s + std::string(arg));
+        }
+        if (arg == "--script"sv) {
+            config.script_path = argv[++i];
+        } else if (arg == "--batch-size"sv) {
+            config.batch_size = std::stoull(argv[++i]);
+        } else if (arg == "--export-snapshot"sv) {
+            args.export_snapshot = argv[++i];
+        } else {
+            throw std::invalid_argument("Unknown argument "s + std::string(arg)
+                                        + ". Usage: bookypedia [--batch] [--script FILE] [--batch-size N] [--reshard]"s
+                                        + " [--export-snapshot FILE]"s);
+        }
+    }
+    return args;
+}
+
+int ExportSnapshot(const bookypedia::AppConfig& config, const std::string& path) {
+    auto factory = app::MakeUnitOfWorkFactory(config.storage);
+    auto unit = factory->CreateUnitOfWork();
+    const auto writer = snapshot::ExportCatalog(*unit);
+    writer.Write(path);
+    std::cerr << "Snapshot "sv << path << " written: "sv << writer.AuthorCount() << " authors, "sv
+              << writer.BookCount() << " books, "sv << writer.TagCount() << " tags"sv << std::endl;
+    return EXIT_SUCCESS;
+}
+
+int Reshard(const bookypedia::AppConfig& config) {
+    postgres::ShardedDatabase db{config.storage.urls, 0};
+    const auto stats = postgres::Resharder{db}.Run(std::cerr);
+    return stats.failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 }  // namespace
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] const char* argv[]) {
+int main(int argc, const char* argv[]) {
     try {
-        bookypedia::Application app{GetConfigFromEnv()};
+        auto config = GetConfigFromEnv();
+        const auto args = ApplyArgs(config, argc, argv);
+        if (args.reshard) {
+            return Reshard(config);
+        }
+        if (!args.export_snapshot.empty()) {
+            return ExportSnapshot(config, args.export_snapshot);
+        }
+        bookypedia::Application app{config};
         app.Run();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
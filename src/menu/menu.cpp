@@ -2,6 +2,7 @@
 
 #include <iomanip>
 #include <sstream>
+#include <utility>
 
 namespace menu {
 
@@ -12,9 +13,10 @@ Menu::Menu(std::istream& input, std::ostream& output)
 
 void Menu::AddAction(std::string action_name, std::string args, std::string description,
                      Handler handler) {
+    auto* latency = &metrics::Latency(metrics::Scope::COMMAND, action_name);
     if (!actions_
              .try_emplace(std::move(action_name), std::move(handler), std::move(args),
-                          std::move(description))
+                          std::move(description), latency)
              .second) {
         throw std::invalid_argument("A command has been added already");
     }
@@ -23,6 +25,15 @@ void Menu::AddAction(std::string action_name, std::string args, std::string desc
 void Menu::Run() {
     std::string line;
     while (std::getline(input_, line)) {
+        if (batch_mode_) {
+            const auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+        }
+        if (before_first_command_) {
+            std::exchange(before_first_command_, nullptr)();
+        }
         std::istringstream cmd_stream{std::move(line)};
         if (!ParseCommand(cmd_stream)) {
             break;
@@ -69,6 +80,7 @@ bool Menu::ParseCommand(std::istream& input) {
         std::string cmd;
         if (input >> cmd) {
             if (const auto it = actions_.find(cmd); it != actions_.cend()) {
+                metrics::ScopedTimer timer{*it->second.latency};
                 if (!it->second.handler(input)) {
                     return false;
                 }
@@ -4,6 +4,8 @@
 #include <map>
 #include <string>
 
+#include "../metrics/metrics.h"
+
 namespace menu {
 
 class Menu {
@@ -17,6 +19,16 @@ public:
 
     void Run();
 
+    // В пакетном режиме пустые строки и строки-комментарии (#) пропускаются
+    void SetBatchMode(bool batch_mode) noexcept {
+        batch_mode_ = batch_mode;
+    }
+
+    // Вызывается один раз, перед выполнением первой команды: например, чтобы дождаться прогрева
+    void SetBeforeFirstCommand(std::function<void()> hook) {
+        before_first_command_ = std::move(hook);
+    }
+
     void ShowInstructions() const;
 
 private:
@@ -24,6 +36,7 @@ private:
         Handler handler;
         std::string args;
         std::string description;
+        metrics::LatencyMetric* latency;
     };
 
     [[nodiscard]] bool ParseCommand(std::istream& input);
@@ -31,6 +44,8 @@ private:
     std::istream& input_;
     std::ostream& output_;
     std::map<std::string, ActionInfo> actions_;
+    bool batch_mode_ = false;
+    std::function<void()> before_first_command_;
 };
 
 }  // namespace menu
\ No newline at end of file
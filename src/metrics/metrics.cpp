@@ -0,0 +1,410 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+
+namespace metrics {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr size_t MAX_METRICS = 1024;
+
+std::atomic<bool> enabled{true};
+
+// Данные одного потока. Слоты создаются лениво владельцем потока и не удаляются,
+// пока жив поток; шард уходит из реестра под его блокировкой, поэтому сборщик читает без блокировок
+struct ThreadShard {
+    std::array<std::atomic<AtomicHistogram*>, MAX_METRICS> latencies{};
+    std::array<std::atomic<uint64_t>, MAX_METRICS> counters{};
+
+    ~ThreadShard() {
+        for (auto& slot : latencies) {
+            delete slot.load(std::memory_order_relaxed);
+        }
+    }
+
+    AtomicHistogram& GetLatency(size_t id) {
+        auto* histogram = latencies[id].load(std::memory_order_acquire);
+        if (!histogram) {
+            histogram = new AtomicHistogram;
+            latencies[id].store(histogram, std::memory_order_release);
+        }
+        return *histogram;
+    }
+
+    // Добавляет данные другого шарда; писать в этот шард в это время никто не должен
+    void Absorb(const ThreadShard& other) {
+        for (size_t id = 0; id < MAX_METRICS; ++id) {
+            if (auto* histogram = other.latencies[id].load(std::memory_order_acquire)) {
+                GetLatency(id).Absorb(*histogram);
+            }
+            if (auto value = other.counters[id].load(std::memory_order_relaxed); value != 0) {
+                counters[id].store(counters[id].load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+            }
+        }
+    }
+};
+
+thread_local ThreadShard* local_shard = nullptr;
+thread_local bool thread_exiting = false;
+
+class Registry {
+public:
+    static Registry& Instance() {
+        static Registry registry;
+        return registry;
+    }
+
+    LatencyMetric& GetLatency(Scope scope, std::string_view name) {
+        std::lock_guard lock{mutex_};
+        auto key = std::make_pair(scope, std::string(name));
+        if (auto it = latency_index_.find(key); it != latency_index_.end()) {
+            return *it->second;
+        }
+        CheckCapacity(latencies_.size());
+        auto& metric = latencies_.emplace_back(latencies_.size(), scope, std::move(key.second));
+        latency_index_.emplace(std::make_pair(scope, metric.GetName()), &metric);
+        return metric;
+    }
+
+    Counter& GetCounter(std::string_view name) {
+        std::lock_guard lock{mutex_};
+        if (auto it = counter_index_.find(name); it != counter_index_.end()) {
+            return *it->second;
+        }
+        CheckCapacity(counters_.size());
+        auto& counter = counters_.emplace_back(counters_.size(), std::string(name));
+        counter_index_.emplace(counter.GetName(), &counter);
+        return counter;
+    }
+
+    ThreadShard& LocalShard() {
+        if (!local_shard) {
+            local_shard = &RegisterThread();
+        }
+        return *local_shard;
+    }
+
+    std::vector<LatencySnapshot> CollectLatencies() {
+        std::lock_guard lock{mutex_};
+        std::vector<LatencySnapshot> result;
+        result.reserve(latencies_.size());
+        for (const auto& metric : latencies_) {
+            LatencySnapshot snapshot{metric.GetScope(), metric.GetName(), {}};
+            for (const auto& shard : shards_) {
+                if (auto* histogram = shard->latencies[metric.GetId()].load(std::memory_order_acquire)) {
+                    histogram->AddTo(snapshot.histogram);
+                }
+            }
+            result.push_back(std::move(snapshot));
+        }
+        return result;
+    }
+
+    std::vector<CounterSnapshot> CollectCounters() {
+        std::lock_guard lock{mutex_};
+        std::vector<CounterSnapshot> result;
+        result.reserve(counters_.size());
+        for (const auto& counter : counters_) {
+            uint64_t value = 0;
+            for (const auto& shard : shards_) {
+                value += shard->counters[counter.GetId()].load(std::memory_order_relaxed);
+            }
+            result.push_back({counter.GetName(), value});
+        }
+        return result;
+    }
+
+private:
+    // Шард живёт, пока жив поток. При выходе потока его данные добавляются к шарду завершённых
+    // потоков, а сам шард освобождается: короткоживущие потоки не копят по шарду на каждый
+    ThreadShard& RegisterThread() {
+        struct Owner {
+            std::unique_ptr<ThreadShard> shard = std::make_unique<ThreadShard>();
+
+            ~Owner() {
+                Instance().Retire(*shard);
+                local_shard = nullptr;
+                thread_exiting = true;
+            }
+        };
+        if (thread_exiting) {
+            // Метрика из деструкторов потока после освобождения его шарда: такой шард остаётся навсегда
+            auto* shard = new ThreadShard;
+            std::lock_guard lock{mutex_};
+            shards_.push_back(shard);
+            return *shard;
+        }
+        thread_local Owner owner;
+        std::lock_guard lock{mutex_};
+        shards_.push_back(owner.shard.get());
+        return *owner.shard;
+    }
+
+    void Retire(const ThreadShard& shard) {
+        std::lock_guard lock{mutex_};
+        retired_.Absorb(shard);
+        std::erase(shards_, &shard);
+    }
+
+    static void CheckCapacity(size_t size) {
+        if (size >= MAX_METRICS) {
+            throw std::length_error("Too many metrics registered");
+        }
+    }
+
+    std::mutex mutex_;
+    std::deque<LatencyMetric> latencies_;
+    std::map<std::pair<Scope, std::string>, LatencyMetric*> latency_index_;
+    std::deque<Counter> counters_;
+    std::map<std::string, Counter*, std::less<>> counter_index_;
+    // Первый элемент - данные завершившихся потоков, пишется только под mutex_
+    ThreadShard retired_;
+    std::vector<const ThreadShard*> shards_{&retired_};
+};
+
+// Границы корзин Prometheus-гистограммы, в микросекундах
+constexpr uint64_t PROMETHEUS_BOUNDS[] = {
+    100, 250, 500, 1'000, 2'500, 5'000, 10'000, 25'000, 50'000,
+    100'000, 250'000, 500'000, 1'000'000, 2'500'000, 5'000'000, 10'000'000,
+};
+
+double ToMilliseconds(uint64_t us) {
+    return static_cast<double>(us) / 1000.0;
+}
+
+double ToSeconds(uint64_t us) {
+    return static_cast<double>(us) / 1'000'000.0;
+}
+
+std::string EscapeLabel(std::string_view value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            result += '\\';
+        }
+        if (c == '\n') {
+            result += "\\n"sv;
+            continue;
+        }
+        result += c;
+    }
+    return result;
+}
+
+}  // namespace
+
+std::string_view ScopeName(Scope scope) noexcept {
+    switch (scope) {
+        case Scope::COMMAND: return "command"sv;
+        case Scope::USE_CASE: return "use_case"sv;
+        case Scope::STATEMENT: return "statement"sv;
+        case Scope::STARTUP: return "startup"sv;
+    }
+    return "unknown"sv;
+}
+
+size_t Histogram::BucketIndex(uint64_t value) noexcept {
+    if (value < SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    const unsigned exponent = std::bit_width(value) - 1;
+    if (exponent > MAX_EXPONENT) {
+        return BUCKETS - 1;
+    }
+    const unsigned shift = exponent - SUB_BUCKET_BITS;
+    const uint64_t sub_bucket = (value >> shift) - SUB_BUCKETS;
+    return static_cast<size_t>(SUB_BUCKETS + shift * SUB_BUCKETS + sub_bucket);
+}
+
+uint64_t Histogram::BucketUpperBound(size_t index) noexcept {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    const uint64_t shift = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    const uint64_t sub_bucket = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub_bucket + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value) noexcept {
+    ++buckets_[BucketIndex(value)];
+    ++count_;
+    sum_ += value;
+    max_ = std::max(max_, value);
+}
+
+void Histogram::Merge(const Histogram& other) noexcept {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        buckets_[i] += other.buckets_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    max_ = std::max(max_, other.max_);
+}
+
+uint64_t Histogram::Quantile(double q) const noexcept {
+    if (count_ == 0) {
+        return 0;
+    }
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * static_cast<double>(count_) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen >= rank) {
+            return std::min(BucketUpperBound(i), max_);
+        }
+    }
+    return max_;
+}
+
+uint64_t Histogram::CountAtMost(uint64_t value) const noexcept {
+    const auto last = BucketIndex(value);
+    uint64_t result = 0;
+    for (size_t i = 0; i <= last; ++i) {
+        result += buckets_[i];
+    }
+    return result;
+}
+
+void AtomicHistogram::Record(uint64_t value) noexcept {
+    // Единственный писатель, поэтому достаточно relaxed load/store без RMW
+    auto& bucket = buckets_[Histogram::BucketIndex(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+void AtomicHistogram::AddTo(Histogram& out) const noexcept {
+    for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+        out.buckets_[i] += buckets_[i].load(std::memory_order_relaxed);
+    }
+    out.count_ += count_.load(std::memory_order_relaxed);
+    out.sum_ += sum_.load(std::memory_order_relaxed);
+    out.max_ = std::max(out.max_, max_.load(std::memory_order_relaxed));
+}
+
+void AtomicHistogram::Absorb(const AtomicHistogram& other) noexcept {
+    auto add = [](std::atomic<uint64_t>& to, const std::atomic<uint64_t>& from) {
+        to.store(to.load(std::memory_order_relaxed) + from.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    };
+    for (size_t i = 0; i < Histogram::BUCKETS; ++i) {
+        add(buckets_[i], other.buckets_[i]);
+    }
+    add(count_, other.count_);
+    add(sum_, other.sum_);
+    if (auto max = other.max_.load(std::memory_order_relaxed); max > max_.load(std::memory_order_relaxed)) {
+        max_.store(max, std::memory_order_relaxed);
+    }
+}
+
+void LatencyMetric::Record(std::chrono::nanoseconds duration) noexcept {
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+    Registry::Instance().LocalShard().GetLatency(id_).Record(static_cast<uint64_t>(std::max<int64_t>(us, 0)));
+}
+
+void Counter::Increment(uint64_t delta) noexcept {
+    if (!IsEnabled()) {
+        return;
+    }
+    auto& slot = Registry::Instance().LocalShard().counters[id_];
+    slot.store(slot.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+LatencyMetric& Latency(Scope scope, std::string_view name) {
+    return Registry::Instance().GetLatency(scope, name);
+}
+
+Counter& GetCounter(std::string_view name) {
+    return Registry::Instance().GetCounter(name);
+}
+
+bool IsEnabled() noexcept {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+void SetEnabled(bool value) noexcept {
+    enabled.store(value, std::memory_order_relaxed);
+}
+
+std::vector<LatencySnapshot> CollectLatencies() {
+    return Registry::Instance().CollectLatencies();
+}
+
+std::vector<CounterSnapshot> CollectCounters() {
+    return Registry::Instance().CollectCounters();
+}
+
+void WriteSummary(std::ostream& out) {
+    const auto old_flags = out.flags();
+    const auto old_precision = out.precision();
+    out << std::left << std::setw(10) << "scope"sv << std::setw(34) << "name"sv << std::right
+        << std::setw(10) << "count"sv << std::setw(10) << "p50 ms"sv << std::setw(10) << "p99 ms"sv
+        << std::setw(10) << "max ms"sv << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (const auto& latency : CollectLatencies()) {
+        const auto& h = latency.histogram;
+        if (h.Count() == 0) {
+            continue;
+        }
+        out << std::left << std::setw(10) << ScopeName(latency.scope) << std::setw(34) << latency.name
+            << std::right << std::setw(10) << h.Count() << std::setw(10) << ToMilliseconds(h.Quantile(0.5))
+            << std::setw(10) << ToMilliseconds(h.Quantile(0.99)) << std::setw(10) << ToMilliseconds(h.Max())
+            << '\n';
+    }
+    for (const auto& counter : CollectCounters()) {
+        out << std::left << std::setw(44) << counter.name << std::right << std::setw(10) << counter.value << '\n';
+    }
+    out.flags(old_flags);
+    out.precision(old_precision);
+    out.flush();
+}
+
+void WritePrometheus(std::ostream& out) {
+    out << "# TYPE bookypedia_latency_seconds histogram\n"sv;
+    for (const auto& latency : CollectLatencies()) {
+        const auto& h = latency.histogram;
+        const auto labels = "scope=\""s + std::string(ScopeName(latency.scope)) + "\",name=\""s
+                            + EscapeLabel(latency.name) + "\""s;
+        for (auto bound : PROMETHEUS_BOUNDS) {
+            out << "bookypedia_latency_seconds_bucket{"sv << labels << ",le=\""sv << ToSeconds(bound) << "\"} "sv
+                << h.CountAtMost(bound) << '\n';
+        }
+        out << "bookypedia_latency_seconds_bucket{"sv << labels << ",le=\"+Inf\"} "sv << h.Count() << '\n';
+        out << "bookypedia_latency_seconds_sum{"sv << labels << "} "sv << ToSeconds(h.Sum()) << '\n';
+        out << "bookypedia_latency_seconds_count{"sv << labels << "} "sv << h.Count() << '\n';
+    }
+    for (const auto& counter : CollectCounters()) {
+        out << "# TYPE bookypedia_"sv << counter.name << "_total counter\n"sv;
+        out << "bookypedia_"sv << counter.name << "_total "sv << counter.value << '\n';
+    }
+}
+
+void WritePrometheusFile(const std::filesystem::path& path) {
+    // Пишем во временный файл и переименовываем, чтобы сборщик не прочитал половину
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream out{tmp_path, std::ios::trunc};
+        if (!out) {
+            throw std::runtime_error("Can't open "s + tmp_path.string());
+        }
+        WritePrometheus(out);
+    }
+    std::filesystem::rename(tmp_path, path);
+}
+
+}  // namespace metrics
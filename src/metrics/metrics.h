@@ -0,0 +1,200 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace metrics {
+
+enum class Scope { COMMAND, USE_CASE, STATEMENT, STARTUP };
+
+std::string_view ScopeName(Scope scope) noexcept;
+
+/**
+ * Гистограмма в стиле HDR: логарифмические интервалы, каждый из которых разбит
+ * на 16 линейных корзин, что даёт относительную погрешность не хуже 1/16.
+ * Значения хранятся в микросекундах.
+ */
+class Histogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 40;
+    static constexpr size_t BUCKETS = SUB_BUCKETS + (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static size_t BucketIndex(uint64_t value) noexcept;
+    static uint64_t BucketUpperBound(size_t index) noexcept;
+
+    void Record(uint64_t value) noexcept;
+    void Merge(const Histogram& other) noexcept;
+
+    uint64_t Count() const noexcept {
+        return count_;
+    }
+    uint64_t Sum() const noexcept {
+        return sum_;
+    }
+    uint64_t Max() const noexcept {
+        return max_;
+    }
+    uint64_t BucketCount(size_t index) const noexcept {
+        return buckets_[index];
+    }
+
+    // Верхняя граница корзины, в которую попадает квантиль q из [0, 1]
+    uint64_t Quantile(double q) const noexcept;
+    // Количество значений, не превышающих value (с точностью до корзины)
+    uint64_t CountAtMost(uint64_t value) const noexcept;
+
+private:
+    friend class AtomicHistogram;
+
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+    uint64_t max_ = 0;
+};
+
+// Гистограмма одного потока: пишет только владелец, читает сборщик
+class AtomicHistogram {
+public:
+    void Record(uint64_t value) noexcept;
+    void AddTo(Histogram& out) const noexcept;
+    // Добавляет значения гистограммы, чей поток уже завершился
+    void Absorb(const AtomicHistogram& other) noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, Histogram::BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+class LatencyMetric {
+public:
+    LatencyMetric(size_t id, Scope scope, std::string name)
+        : id_(id)
+        , scope_(scope)
+        , name_(std::move(name)) {
+    }
+
+    void Record(std::chrono::nanoseconds duration) noexcept;
+
+    Scope GetScope() const noexcept {
+        return scope_;
+    }
+    const std::string& GetName() const noexcept {
+        return name_;
+    }
+    size_t GetId() const noexcept {
+        return id_;
+    }
+
+private:
+    size_t id_;
+    Scope scope_;
+    std::string name_;
+};
+
+class Counter {
+public:
+    Counter(size_t id, std::string name)
+        : id_(id)
+        , name_(std::move(name)) {
+    }
+
+    void Increment(uint64_t delta = 1) noexcept;
+
+    const std::string& GetName() const noexcept {
+        return name_;
+    }
+    size_t GetId() const noexcept {
+        return id_;
+    }
+
+private:
+    size_t id_;
+    std::string name_;
+};
+
+// Метрики регистрируются один раз, ссылки на них стабильны до конца работы программы
+LatencyMetric& Latency(Scope scope, std::string_view name);
+Counter& GetCounter(std::string_view name);
+
+bool IsEnabled() noexcept;
+void SetEnabled(bool enabled) noexcept;
+
+namespace detail {
+
+// Интервал трассы: не трассируется, трассируется без записи (корень не попал в выборку) или записывается
+enum class SpanMode : uint8_t { OFF, SKIPPED, RECORDED };
+
+extern std::atomic<bool> tracing;
+
+SpanMode BeginTracedSpan() noexcept;
+void EndSpan(SpanMode mode, const LatencyMetric& metric, std::chrono::steady_clock::time_point start,
+             std::chrono::steady_clock::time_point end) noexcept;
+
+inline SpanMode BeginSpan() noexcept {
+    return tracing.load(std::memory_order_relaxed) ? BeginTracedSpan() : SpanMode::OFF;
+}
+
+}  // namespace detail
+
+// Время блока в гистограмму metric и, если включена трассировка, интервал в трассу
+class ScopedTimer {
+public:
+    explicit ScopedTimer(LatencyMetric& metric) noexcept
+        : metric_(metric)
+        , record_(IsEnabled())
+        , span_(detail::BeginSpan()) {
+        if (record_ || span_ == detail::SpanMode::RECORDED) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+    ~ScopedTimer() {
+        const auto end = record_ || span_ == detail::SpanMode::RECORDED ? std::chrono::steady_clock::now()
+                                                                         : std::chrono::steady_clock::time_point{};
+        if (record_) {
+            metric_.Record(end - start_);
+        }
+        if (span_ != detail::SpanMode::OFF) {
+            detail::EndSpan(span_, metric_, start_, end);
+        }
+    }
+
+private:
+    LatencyMetric& metric_;
+    bool record_;
+    detail::SpanMode span_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+struct LatencySnapshot {
+    Scope scope;
+    std::string name;
+    Histogram histogram;
+};
+
+struct CounterSnapshot {
+    std::string name;
+    uint64_t value;
+};
+
+std::vector<LatencySnapshot> CollectLatencies();
+std::vector<CounterSnapshot> CollectCounters();
+
+void WriteSummary(std::ostream& out);
+void WritePrometheus(std::ostream& out);
+void WritePrometheusFile(const std::filesystem::path& path);
+
+}  // namespace metrics
@@ -0,0 +1,69 @@
+#include "startup.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+namespace metrics {
+
+using namespace std::literals;
+
+namespace {
+
+double ToMilliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}  // namespace
+
+StartupTimeline& StartupTimeline::Instance() {
+    static StartupTimeline timeline;
+    return timeline;
+}
+
+void StartupTimeline::Record(std::string_view name, std::chrono::steady_clock::time_point start,
+                             std::chrono::steady_clock::time_point end) noexcept {
+    try {
+        if (IsEnabled()) {
+            Latency(Scope::STARTUP, name).Record(end - start);
+        }
+        std::lock_guard lock{mutex_};
+        phases_.push_back({std::string(name), start, end});
+    } catch (...) {
+        // Без строчки в отчёте о запуске можно обойтись
+    }
+}
+
+std::vector<StartupPhase> StartupTimeline::GetPhases() const {
+    std::lock_guard lock{mutex_};
+    return phases_;
+}
+
+void StartupTimeline::Clear() {
+    std::lock_guard lock{mutex_};
+    phases_.clear();
+}
+
+void StartupTimeline::Write(std::ostream& out, std::chrono::steady_clock::time_point origin,
+                            std::chrono::steady_clock::time_point ready) const {
+    auto phases = GetPhases();
+    std::stable_sort(phases.begin(), phases.end(), [](const StartupPhase& lhs, const StartupPhase& rhs) {
+        return lhs.start < rhs.start;
+    });
+    const auto old_flags = out.flags();
+    const auto old_precision = out.precision();
+    out << std::left << std::setw(34) << "startup phase"sv << std::right << std::setw(12) << "start ms"sv
+        << std::setw(12) << "time ms"sv << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (const auto& phase : phases) {
+        out << std::left << std::setw(34) << phase.name << std::right << std::setw(12)
+            << ToMilliseconds(phase.start - origin) << std::setw(12) << ToMilliseconds(phase.end - phase.start)
+            << '\n';
+    }
+    out << std::left << std::setw(34) << "ready"sv << std::right << std::setw(12) << ""sv << std::setw(12)
+        << ToMilliseconds(ready - origin) << '\n';
+    out.flags(old_flags);
+    out.precision(old_precision);
+}
+
+}  // namespace metrics
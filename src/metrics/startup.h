@@ -0,0 +1,63 @@
+#pragma once
+#include <chrono>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "metrics.h"
+
+namespace metrics {
+
+struct StartupPhase {
+    std::string name;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+/**
+ * Фазы запуска процесса: подключение, проверка схемы, подготовка запросов, прогрев кэша.
+ * Фазы идут параллельно из разных потоков, поэтому каждая хранит свои начало и конец,
+ * а не только длительность. Пишется независимо от IsEnabled(): отчёт о запуске нужен,
+ * даже когда метрики выключены. Длительности дублируются в гистограммы Scope::STARTUP
+ */
+class StartupTimeline {
+public:
+    static StartupTimeline& Instance();
+
+    void Record(std::string_view name, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end) noexcept;
+    std::vector<StartupPhase> GetPhases() const;
+    void Clear();
+
+    // Фазы в порядке начала: смещение от origin и длительность; последней строкой - время до ready
+    void Write(std::ostream& out, std::chrono::steady_clock::time_point origin,
+               std::chrono::steady_clock::time_point ready) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<StartupPhase> phases_;
+};
+
+class StartupTimer {
+public:
+    explicit StartupTimer(std::string_view name)
+        : name_{name}
+        , start_{std::chrono::steady_clock::now()} {
+    }
+
+    StartupTimer(const StartupTimer&) = delete;
+    StartupTimer& operator=(const StartupTimer&) = delete;
+
+    // Фаза записывается и при выходе по исключению: упавший запуск тоже стоит разобрать
+    ~StartupTimer() {
+        StartupTimeline::Instance().Record(name_, start_, std::chrono::steady_clock::now());
+    }
+
+private:
+    std::string_view name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace metrics
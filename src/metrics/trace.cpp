@@ -0,0 +1,345 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+
+namespace metrics {
+
+namespace detail {
+
+std::atomic<bool> tracing{false};
+
+}  // namespace detail
+
+using namespace std::literals;
+
+namespace {
+
+struct Span {
+    const LatencyMetric* metric = nullptr;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    uint64_t id = 0;
+    uint64_t parent = 0;
+};
+
+// Кольцевой буфер потока. Пишет владелец, читает экспорт; мьютекс почти всегда свободен
+struct ThreadTrace {
+    ThreadTrace(uint32_t thread, size_t capacity)
+        : thread{thread}
+        , spans(std::max<size_t>(capacity, 1)) {
+    }
+
+    void Push(const Span& span) {
+        std::lock_guard lock{mutex};
+        spans[next % spans.size()] = span;
+        ++next;
+    }
+
+    const uint32_t thread;
+    std::mutex mutex;
+    std::vector<Span> spans;
+    // Сколько интервалов записано всего; последние spans.size() из них ещё в буфере
+    uint64_t next = 0;
+};
+
+// Буфер текущего потока; nullptr - ещё не взят или уже возвращён при выходе потока
+thread_local ThreadTrace* local_trace = nullptr;
+thread_local bool trace_released = false;
+
+class Tracer {
+public:
+    static Tracer& Instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    void Configure(TraceConfig config) {
+        std::lock_guard lock{mutex_};
+        config_ = std::move(config);
+        sample_rate_.store(config_.sample_rate, std::memory_order_relaxed);
+    }
+
+    TraceConfig GetConfig() const {
+        std::lock_guard lock{mutex_};
+        return config_;
+    }
+
+    // Решение о выборке для корневого интервала потока
+    bool Sample() {
+        const auto rate = sample_rate_.load(std::memory_order_relaxed);
+        if (rate >= 1.0) {
+            return true;
+        }
+        thread_local std::minstd_rand random{std::random_device{}()};
+        return std::uniform_real_distribution<double>{0.0, 1.0}(random) < rate;
+    }
+
+    // nullptr, если поток уже вернул буфер: интервалы из его деструкторов не записываются
+    ThreadTrace* Local() {
+        if (!local_trace && !trace_released) {
+            local_trace = &Acquire();
+        }
+        return local_trace;
+    }
+
+    std::vector<SpanSnapshot> Collect() {
+        std::lock_guard lock{mutex_};
+        std::vector<SpanSnapshot> result;
+        for (const auto& thread : threads_) {
+            std::lock_guard thread_lock{thread->mutex};
+            const auto size = thread->spans.size();
+            const auto kept = std::min<uint64_t>(thread->next, size);
+            for (auto i = thread->next - kept; i < thread->next; ++i) {
+                const auto& span = thread->spans[i % size];
+                result.push_back({span.metric->GetScope(), span.metric->GetName(), thread->thread, span.start, span.end,
+                                  span.id, span.parent});
+            }
+        }
+        std::stable_sort(result.begin(), result.end(), [](const SpanSnapshot& lhs, const SpanSnapshot& rhs) {
+            return lhs.start < rhs.start;
+        });
+        return result;
+    }
+
+    void Clear() {
+        std::lock_guard lock{mutex_};
+        for (const auto& thread : threads_) {
+            std::lock_guard thread_lock{thread->mutex};
+            thread->next = 0;
+        }
+    }
+
+private:
+    // Буфер завершившегося потока остаётся со своими интервалами и достаётся следующему
+    // новому потоку, поэтому буферов не больше, чем потоков, живших одновременно
+    ThreadTrace& Acquire() {
+        struct Owner {
+            ThreadTrace* trace = nullptr;
+
+            ~Owner() {
+                Instance().Release(*trace);
+                local_trace = nullptr;
+                trace_released = true;
+            }
+        };
+        thread_local Owner owner;
+        std::lock_guard lock{mutex_};
+        if (!free_.empty()) {
+            owner.trace = free_.back();
+            free_.pop_back();
+            if (const auto capacity = std::max<size_t>(config_.buffer_spans, 1); owner.trace->spans.size() != capacity) {
+                // Ёмкость перенастроили: старые интервалы буфера пропадают
+                std::lock_guard trace_lock{owner.trace->mutex};
+                owner.trace->spans.assign(capacity, Span{});
+                owner.trace->next = 0;
+            }
+        } else {
+            owner.trace = threads_
+                              .emplace_back(std::make_unique<ThreadTrace>(static_cast<uint32_t>(threads_.size() + 1),
+                                                                          config_.buffer_spans))
+                              .get();
+        }
+        return *owner.trace;
+    }
+
+    void Release(ThreadTrace& trace) {
+        std::lock_guard lock{mutex_};
+        free_.push_back(&trace);
+    }
+
+    mutable std::mutex mutex_;
+    TraceConfig config_;
+    std::atomic<double> sample_rate_{1.0};
+    std::vector<std::unique_ptr<ThreadTrace>> threads_;
+    // Буферы завершившихся потоков
+    std::vector<ThreadTrace*> free_;
+};
+
+constexpr size_t MAX_DEPTH = 32;
+
+std::atomic<uint64_t> next_span_id{1};
+
+// Вложенность интервалов текущего потока; выборка решается для корня и наследуется вложенными.
+// Уровень может занимать родитель из другого потока, восстановленный ScopedTraceContext
+struct SpanStack {
+    size_t depth = 0;
+    bool sampled = false;
+    // Номера открытых интервалов по уровням; глубже MAX_DEPTH номера не сохраняются
+    std::array<uint64_t, MAX_DEPTH> ids{};
+
+    uint64_t IdAt(size_t level) const noexcept {
+        return level < MAX_DEPTH ? ids[level] : 0;
+    }
+    // Номер самого внутреннего открытого интервала, родителя следующего
+    uint64_t Top() const noexcept {
+        return depth == 0 ? 0 : IdAt(depth - 1);
+    }
+};
+
+thread_local SpanStack stack;
+
+void Push(const LatencyMetric& metric, std::chrono::steady_clock::time_point start,
+          std::chrono::steady_clock::time_point end, uint64_t id, uint64_t parent) noexcept {
+    try {
+        if (auto* trace = Tracer::Instance().Local()) {
+            trace->Push({&metric, start, end, id, parent});
+        }
+    } catch (const std::exception&) {
+        // Буфер не удалось создать - интервал теряется, но работа продолжается
+    }
+}
+
+void WriteJsonString(std::ostream& out, std::string_view text) {
+    out << '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out << "\\\""sv; break;
+            case '\\': out << "\\\\"sv; break;
+            case '\n': out << "\\n"sv; break;
+            case '\t': out << "\\t"sv; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u"sv << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+double ToMicroseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+namespace detail {
+
+SpanMode BeginTracedSpan() noexcept {
+    if (stack.depth == 0) {
+        stack.sampled = Tracer::Instance().Sample();
+    }
+    if (stack.depth < MAX_DEPTH) {
+        stack.ids[stack.depth] = stack.sampled ? next_span_id.fetch_add(1, std::memory_order_relaxed) : 0;
+    }
+    ++stack.depth;
+    return stack.sampled ? SpanMode::RECORDED : SpanMode::SKIPPED;
+}
+
+void EndSpan(SpanMode mode, const LatencyMetric& metric, std::chrono::steady_clock::time_point start,
+             std::chrono::steady_clock::time_point end) noexcept {
+    --stack.depth;
+    if (mode == SpanMode::RECORDED) {
+        Push(metric, start, end, stack.IdAt(stack.depth), stack.Top());
+    }
+}
+
+}  // namespace detail
+
+void ConfigureTracing(TraceConfig config) {
+    if (config.sample_rate < 0.0 || config.sample_rate > 1.0) {
+        throw std::invalid_argument("Trace sample rate must be within [0, 1]");
+    }
+    Tracer::Instance().Configure(std::move(config));
+    detail::tracing.store(true, std::memory_order_relaxed);
+}
+
+void DisableTracing() noexcept {
+    detail::tracing.store(false, std::memory_order_relaxed);
+}
+
+void RecordSpan(const LatencyMetric& metric, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end) noexcept {
+    if (!IsTracing()) {
+        return;
+    }
+    if (stack.depth == 0 ? Tracer::Instance().Sample() : stack.sampled) {
+        Push(metric, start, end, next_span_id.fetch_add(1, std::memory_order_relaxed), stack.Top());
+    }
+}
+
+TraceContext TraceContext::Current() noexcept {
+    TraceContext context;
+    context.active_ = IsTracing() && stack.depth > 0;
+    context.sampled_ = stack.sampled;
+    context.parent_ = stack.Top();
+    return context;
+}
+
+ScopedTraceContext::ScopedTraceContext(const TraceContext& context) noexcept
+    : saved_depth_{stack.depth}
+    , saved_sampled_{stack.sampled} {
+    if (!context.active_) {
+        return;
+    }
+    // Родитель занимает уровень, как открытый интервал: вложенные не решают выборку заново
+    if (stack.depth < MAX_DEPTH) {
+        stack.ids[stack.depth] = context.parent_;
+    }
+    ++stack.depth;
+    stack.sampled = context.sampled_;
+}
+
+ScopedTraceContext::~ScopedTraceContext() {
+    stack.depth = saved_depth_;
+    stack.sampled = saved_sampled_;
+}
+
+std::vector<SpanSnapshot> CollectSpans() {
+    return Tracer::Instance().Collect();
+}
+
+void ClearSpans() {
+    Tracer::Instance().Clear();
+}
+
+void WriteChromeTrace(std::ostream& out) {
+    const auto spans = CollectSpans();
+    // Время отсчитывается от первого интервала, чтобы ts не зависели от часов системы
+    const auto origin = spans.empty() ? std::chrono::steady_clock::time_point{} : spans.front().start;
+    const auto old_flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["sv;
+    bool first = true;
+    for (const auto& span : spans) {
+        out << (first ? "\n"sv : ",\n"sv);
+        first = false;
+        out << "{\"name\":"sv;
+        WriteJsonString(out, span.name);
+        out << ",\"cat\":"sv;
+        WriteJsonString(out, ScopeName(span.scope));
+        out << ",\"ph\":\"X\",\"pid\":1,\"tid\":"sv << span.thread << ",\"ts\":"sv << ToMicroseconds(span.start - origin)
+            << ",\"dur\":"sv << ToMicroseconds(span.end - span.start);
+        // Вложенность внутри дорожки видна по времени, а родитель из другого потока - только по args
+        out << ",\"args\":{\"id\":"sv << span.id << ",\"parent\":"sv << span.parent << "}}"sv;
+    }
+    out << "\n]}\n"sv;
+    out.flags(old_flags);
+}
+
+void WriteTraceFile() {
+    const auto config = Tracer::Instance().GetConfig();
+    // Пишем во временный файл и переименовываем, чтобы читатель не увидел половину трассы
+    auto tmp = config.path;
+    tmp += ".tmp";
+    {
+        std::ofstream out{tmp, std::ios::trunc};
+        if (!out) {
+            throw std::runtime_error("Can't open trace file " + tmp.string());
+        }
+        WriteChromeTrace(out);
+    }
+    std::filesystem::rename(tmp, config.path);
+}
+
+}  // namespace metrics
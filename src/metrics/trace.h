@@ -0,0 +1,90 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "metrics.h"
+
+namespace metrics {
+
+struct TraceConfig {
+    std::filesystem::path path{"bookypedia-trace.json"};
+    // Доля трассируемых корневых интервалов (обычно команд); вложенные интервалы
+    // попадают в трассу вместе со своим корнем
+    double sample_rate = 1.0;
+    // Ёмкость кольцевого буфера потока; при переполнении затираются самые старые интервалы
+    size_t buffer_spans = 64 * 1024;
+};
+
+// Трассировка выключена, пока её не настроили
+void ConfigureTracing(TraceConfig config);
+void DisableTracing() noexcept;
+
+inline bool IsTracing() noexcept {
+    return detail::tracing.load(std::memory_order_relaxed);
+}
+
+// Интервал без вложенных, например запрос, время которого измерено вызывающим
+void RecordSpan(const LatencyMetric& metric, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end) noexcept;
+
+/**
+ * Решение о выборке и открытый интервал потока. Захватывается там, где работа уходит
+ * в другой поток, и восстанавливается в нём ScopedTraceContext: интервалы задачи
+ * становятся вложенными в интервал вызывающего, а не отдельными корнями.
+ */
+class TraceContext {
+public:
+    // Контекст текущего потока; вне интервала - пустой, и задача начнёт свои корни
+    static TraceContext Current() noexcept;
+
+private:
+    friend class ScopedTraceContext;
+
+    bool active_ = false;
+    bool sampled_ = false;
+    uint64_t parent_ = 0;
+};
+
+// На время своей жизни делает context контекстом текущего потока
+class ScopedTraceContext {
+public:
+    explicit ScopedTraceContext(const TraceContext& context) noexcept;
+    ~ScopedTraceContext();
+
+    ScopedTraceContext(const ScopedTraceContext&) = delete;
+    ScopedTraceContext& operator=(const ScopedTraceContext&) = delete;
+
+private:
+    size_t saved_depth_;
+    bool saved_sampled_;
+};
+
+struct SpanSnapshot {
+    Scope scope;
+    std::string name;
+    // Дорожка в трассе, с 1 в порядке появления. Буфер завершившегося потока достаётся
+    // следующему новому потоку, поэтому потоки, не жившие одновременно, делят дорожку
+    uint32_t thread = 0;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+    // Номер интервала и объемлющего интервала, возможно из другого потока (0 - корень)
+    uint64_t id = 0;
+    uint64_t parent = 0;
+};
+
+// Интервалы из буферов всех потоков в порядке начала
+std::vector<SpanSnapshot> CollectSpans();
+// Забывает записанные интервалы
+void ClearSpans();
+
+// Формат Chrome trace (JSON Object Format), открывается в chrome://tracing и Perfetto UI
+void WriteChromeTrace(std::ostream& out);
+// В файл из TraceConfig::path
+void WriteTraceFile();
+
+}  // namespace metrics
@@ -0,0 +1,128 @@
+#include "change_feed.h"
+
+#include <charconv>
+#include <pqxx/pqxx>
+
+namespace postgres {
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+namespace {
+
+std::optional<ChangeTable> ParseTable(std::string_view table) {
+    if (table == "authors"sv) {
+        return ChangeTable::AUTHORS;
+    }
+    if (table == "books"sv) {
+        return ChangeTable::BOOKS;
+    }
+    if (table == "book_tags"sv) {
+        return ChangeTable::BOOK_TAGS;
+    }
+    return std::nullopt;
+}
+
+std::optional<ChangeOp> ParseOp(std::string_view op) {
+    if (op == "I"sv) {
+        return ChangeOp::INSERT;
+    }
+    if (op == "U"sv) {
+        return ChangeOp::UPDATE;
+    }
+    if (op == "D"sv) {
+        return ChangeOp::DELETE;
+    }
+    return std::nullopt;
+}
+
+// Отрезает от payload поле до ':'
+std::optional<std::string_view> NextField(std::string_view& payload) {
+    auto pos = payload.find(':');
+    if (pos == payload.npos) {
+        return std::nullopt;
+    }
+    auto field = payload.substr(0, pos);
+    payload.remove_prefix(pos + 1);
+    return field;
+}
+
+}  // namespace
+
+std::optional<ChangeEvent> ParseChangeEvent(std::string_view payload) {
+    auto seq_field = NextField(payload);
+    auto table_field = NextField(payload);
+    auto op_field = NextField(payload);
+    if (!seq_field || !table_field || !op_field || payload.empty()) {
+        return std::nullopt;
+    }
+
+    ChangeEvent event;
+    auto [end, error] = std::from_chars(seq_field->data(), seq_field->data() + seq_field->size(), event.seq);
+    if (error != std::errc{} || end != seq_field->data() + seq_field->size() || seq_field->empty()) {
+        return std::nullopt;
+    }
+    auto table = ParseTable(*table_field);
+    auto op = ParseOp(*op_field);
+    if (!table || !op) {
+        return std::nullopt;
+    }
+    event.table = *table;
+    event.op = *op;
+    event.id = std::string(payload);
+    return event;
+}
+
+void InstallChangeFeed(pqxx::work& work) {
+    work.exec(R"(
+CREATE TABLE IF NOT EXISTS catalog_feed (
+    id BOOLEAN PRIMARY KEY DEFAULT TRUE CHECK (id),
+    last_seq BIGINT NOT NULL
+);
+)"_zv);
+    work.exec("INSERT INTO catalog_feed (id, last_seq) VALUES (TRUE, 0) ON CONFLICT (id) DO NOTHING;"_zv);
+
+    // Номер берётся один раз на транзакцию и хранится в её локальной настройке
+    work.exec(R"(
+CREATE OR REPLACE FUNCTION catalog_notify() RETURNS trigger AS $$
+DECLARE
+    seq BIGINT := NULLIF(current_setting('bookypedia.change_seq', true), '')::BIGINT;
+    changed JSONB;
+BEGIN
+    IF TG_OP = 'DELETE' THEN
+        changed := to_jsonb(OLD);
+    ELSE
+        changed := to_jsonb(NEW);
+    END IF;
+    IF seq IS NULL THEN
+        UPDATE catalog_feed SET last_seq = last_seq + 1 RETURNING last_seq INTO seq;
+        PERFORM set_config('bookypedia.change_seq', seq::text, true);
+    END IF;
+    -- Триггер секционированной books срабатывает на секции, поэтому имя таблицы передаётся аргументом
+    PERFORM pg_notify('catalog_changes',
+        seq || ':' || COALESCE(TG_ARGV[0], TG_TABLE_NAME) || ':' || left(TG_OP, 1) || ':'
+            || COALESCE(changed->>'book_id', changed->>'id'));
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+)"_zv);
+
+    work.exec(R"(
+DO $$
+DECLARE
+    changed_table TEXT;
+BEGIN
+    FOREACH changed_table IN ARRAY ARRAY['authors', 'books', 'book_tags'] LOOP
+        IF NOT EXISTS (SELECT 1 FROM pg_trigger WHERE tgname = changed_table || '_change_feed'
+                       AND tgrelid = changed_table::regclass) THEN
+            EXECUTE format('CREATE CONSTRAINT TRIGGER %I AFTER INSERT OR UPDATE OR DELETE ON %I '
+                           'DEFERRABLE INITIALLY DEFERRED FOR EACH ROW EXECUTE FUNCTION catalog_notify(%L)',
+                           changed_table || '_change_feed', changed_table, changed_table);
+        END IF;
+    END LOOP;
+END;
+$$;
+)"_zv);
+}
+
+}  // namespace postgres
@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <pqxx/transaction>
+#include <string>
+#include <string_view>
+
+namespace postgres {
+
+// Настройки CatalogReplica
+struct ReplicaConfig {
+    // Реплика, которая дольше этого не получала подтверждения от базы (или не догнала
+    // собственные коммиты сеанса), не используется: чтения идут в базу
+    std::chrono::milliseconds max_staleness{1000};
+    // Как часто слушатель просыпается, если уведомлений нет
+    std::chrono::milliseconds poll_interval{100};
+};
+
+// Канал NOTIFY, в который триггеры публикуют изменения каталога
+inline constexpr std::string_view CHANGE_FEED_CHANNEL = "catalog_changes";
+
+enum class ChangeTable { AUTHORS, BOOKS, BOOK_TAGS };
+enum class ChangeOp { INSERT, UPDATE, DELETE };
+
+/**
+ * Изменение строки каталога. Полезная нагрузка уведомления - "seq:table:op:id",
+ * для book_tags id - это id книги.
+ * seq - номер транзакции в порядке коммитов, без пропусков: все изменения одной
+ * транзакции несут один номер, пропуск номера означает потерянные уведомления.
+ */
+struct ChangeEvent {
+    uint64_t seq = 0;
+    ChangeTable table = ChangeTable::AUTHORS;
+    ChangeOp op = ChangeOp::INSERT;
+    std::string id;
+};
+
+std::optional<ChangeEvent> ParseChangeEvent(std::string_view payload);
+
+// Следит, что номера транзакций из ленты идут подряд после снимка, с которого начали
+class ChangeSequence {
+public:
+    enum class Position {
+        APPLIED,  // транзакция уже учтена снимком
+        NEXT,     // следующая транзакция или продолжение текущей
+        GAP,      // часть уведомлений потеряна, нужна полная пересинхронизация
+    };
+
+    // Снимок согласован с транзакцией seq
+    void Reset(uint64_t seq) noexcept {
+        snapshot_seq_ = seq_ = seq;
+    }
+
+    Position Accept(uint64_t seq) noexcept {
+        if (seq <= snapshot_seq_) {
+            return Position::APPLIED;
+        }
+        if (seq != seq_ && seq != seq_ + 1) {
+            return Position::GAP;
+        }
+        seq_ = seq;
+        return Position::NEXT;
+    }
+
+    uint64_t Seq() const noexcept {
+        return seq_;
+    }
+
+private:
+    uint64_t snapshot_seq_ = 0;
+    uint64_t seq_ = 0;
+};
+
+/**
+ * Создаёт счётчик catalog_feed, функцию catalog_notify() и отложенные триггеры на authors, books и book_tags.
+ * Триггеры срабатывают при коммите, поэтому блокировка счётчика берётся последней и держится
+ * до конца коммита: номера идут в порядке коммитов, а откаченные транзакции номер не тратят.
+ * Платой за это коммиты пишущих транзакций идут по одному.
+ */
+void InstallChangeFeed(pqxx::work& work);
+
+}  // namespace postgres
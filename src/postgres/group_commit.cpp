@@ -0,0 +1,93 @@
+#include "group_commit.h"
+
+#include <pqxx/pqxx>
+#include <utility>
+
+#include "../metrics/metrics.h"
+
+namespace postgres {
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+GroupCommitter::GroupCommitter(std::string url, GroupCommitConfig config)
+    : url_{std::move(url)}
+    , connection_{std::in_place, url_}
+    , config_{config}
+    , thread_{[this] { Run(); }} {
+}
+
+GroupCommitter::~GroupCommitter() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    arrived_.notify_all();
+    thread_.join();
+}
+
+void GroupCommitter::WaitDurable() {
+    static auto& latency = metrics::Latency(metrics::Scope::STATEMENT, "group_commit.wait"sv);
+    metrics::ScopedTimer timer{latency};
+
+    std::unique_lock lock{mutex_};
+    auto group = current_;
+    if (++group->size == 1 || group->size >= config_.max_batch) {
+        arrived_.notify_one();
+    }
+    flushed_.wait(lock, [&group] {
+        return group->done;
+    });
+    if (group->error) {
+        std::rethrow_exception(group->error);
+    }
+}
+
+void GroupCommitter::Run() {
+    static auto& flushes = metrics::GetCounter("group_commit_flushes");
+    static auto& grouped = metrics::GetCounter("group_commit_transactions");
+
+    std::unique_lock lock{mutex_};
+    while (true) {
+        arrived_.wait(lock, [this] {
+            return stopping_ || current_->size > 0;
+        });
+        if (current_->size == 0) {
+            // Остановка без ожидающих
+            return;
+        }
+        // Собираем попутчиков, пока не истекло окно или группа не заполнилась
+        arrived_.wait_for(lock, config_.window, [this] {
+            return stopping_ || current_->size >= config_.max_batch;
+        });
+
+        auto group = std::exchange(current_, std::make_shared<Group>());
+        lock.unlock();
+        try {
+            Flush();
+        } catch (...) {
+            group->error = std::current_exception();
+        }
+        flushes.Increment();
+        grouped.Increment(group->size);
+        lock.lock();
+        group->done = true;
+        flushed_.notify_all();
+    }
+}
+
+void GroupCommitter::Flush() {
+    static auto& latency = metrics::Latency(metrics::Scope::STATEMENT, "group_commit.flush"sv);
+    metrics::ScopedTimer timer{latency};
+    if (!connection_->is_open()) {
+        // Соединение потеряно на прошлом сбросе: группа получила ошибку, следующая пробует заново
+        connection_.reset();
+        connection_.emplace(url_);
+    }
+    pqxx::work work{*connection_};
+    // Без xid у транзакции нет записи о коммите и нечего сбрасывать
+    work.exec("SET LOCAL synchronous_commit = on; SELECT txid_current();"_zv);
+    work.commit();
+}
+
+}  // namespace postgres
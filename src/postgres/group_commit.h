@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <pqxx/connection>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace postgres {
+
+// Объединять есть что, только если коммиты идут одновременно на разных соединениях. Поэтому
+// приложение, у которого один сеанс и одно соединение, групповой коммит не включает: им пользуется бенчмарк
+struct GroupCommitConfig {
+    // Сколько ждать попутчиков после первого коммита группы
+    std::chrono::microseconds window{200};
+    // Группа сбрасывается сразу, как только набралось столько коммитов
+    size_t max_batch = 64;
+};
+
+// Транзакция закоммичена и видна другим, но сброс WAL не удался: переживёт ли она сбой сервера, неизвестно
+class DurabilityUnknown : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Групповой коммит. Транзакции коммитятся с synchronous_commit = off и не ждут fsync,
+ * а затем встают в очередь WaitDurable. Отдельный поток раз в окно выполняет на своём
+ * соединении одну синхронную транзакцию с xid: её COMMIT сбрасывает WAL до своей записи,
+ * то есть и все асинхронные коммиты группы. Ошибка сброса достаётся каждому участнику
+ * группы, поэтому об успехе сеанс узнаёт только после того, как данные на диске.
+ */
+class GroupCommitter {
+public:
+    // Сбросы идут через отдельное соединение с базой url
+    GroupCommitter(std::string url, GroupCommitConfig config);
+    ~GroupCommitter();
+
+    GroupCommitter(const GroupCommitter&) = delete;
+    GroupCommitter& operator=(const GroupCommitter&) = delete;
+
+    // Блокирует, пока WAL не сброшен до момента вызова. Бросает, если сброс не удался
+    void WaitDurable();
+
+private:
+    struct Group {
+        size_t size = 0;
+        bool done = false;
+        std::exception_ptr error;
+    };
+
+    void Run();
+    void Flush();
+
+    const std::string url_;
+    std::optional<pqxx::connection> connection_;
+    const GroupCommitConfig config_;
+
+    std::mutex mutex_;
+    std::condition_variable arrived_;
+    std::condition_variable flushed_;
+    std::shared_ptr<Group> current_ = std::make_shared<Group>();
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}  // namespace postgres
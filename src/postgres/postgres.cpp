@@ -1,159 +1,812 @@
 #include "postgres.h"
 
+#include <algorithm>
+#include <limits>
+#include <tuple>
 #include <pqxx/zview.hxx>
 #include <pqxx/pqxx>
 
+#include "../domain/errors.h"
+#include "../metrics/metrics.h"
+#include "../metrics/startup.h"
+#include "query.h"
+#include "statement.h"
+
 namespace postgres {
 
 using namespace std::literals;
 using pqxx::operator"" _zv;
 
-void AuthorRepositoryImpl::DeleteAuthorAndDependencies(const domain::Author& author) {
+namespace {
+
+metrics::LatencyMetric& StatementLatency(std::string_view name) {
+    return metrics::Latency(metrics::Scope::STATEMENT, name);
+}
+
+// LIMIT принимает bigint, size_t может не поместиться
+int64_t LimitParam(size_t limit) {
+    return static_cast<int64_t>(std::min<size_t>(limit, std::numeric_limits<int64_t>::max()));
+}
+
+// Запросы репозиториев. Имя запроса - и имя подготовленного запроса, и метрика его задержки
+
+using AuthorsDeleteByName = Query<"authors.delete_by_name", "DELETE FROM authors WHERE name = $1;",
+    Params<std::string>, Columns<>>;
+using AuthorsDelete = Query<"authors.delete", "DELETE FROM authors WHERE id = $1;",
+    Params<domain::AuthorId>, Columns<>>;
+using AuthorsSave = Query<"authors.save", R"(
+INSERT INTO authors (id, name) VALUES ($1, $2)
+ON CONFLICT (id) DO UPDATE SET name=$2, version = authors.version + 1;
+)", Params<domain::AuthorId, std::string>, Columns<>>;
+using AuthorsUpdateVersioned = Query<"authors.update_versioned",
+    "UPDATE authors SET name = $2, version = version + 1 WHERE id = $1 AND version = $3;",
+    Params<domain::AuthorId, std::string, int>, Columns<>>;
+using AuthorsList = Query<"authors.list", "SELECT id, name, version FROM authors ORDER BY name ASC;",
+    Params<>, Columns<domain::AuthorId, std::string, int>>;
+using AuthorsByName = Query<"authors.by_name", "SELECT id, name, version FROM authors WHERE name = $1;",
+    Params<std::string>, Columns<domain::AuthorId, std::string, int>>;
+using AuthorsExists = Query<"authors.exists", "SELECT EXISTS (SELECT 1 FROM authors WHERE id = $1);",
+    Params<domain::AuthorId>, Columns<bool>>;
+
+using TagsByName = Query<"tags.by_name", "SELECT id FROM tags WHERE name = $1;",
+    Params<std::string>, Columns<int>>;
+using TagsInsert = Query<"tags.insert", "INSERT INTO tags (name) VALUES ($1) ON CONFLICT (name) DO NOTHING RETURNING id;",
+    Params<std::string>, Columns<int>>;
+using BookTagsClear = Query<"book_tags.clear", "DELETE FROM book_tags WHERE book_id = $1;",
+    Params<domain::BookId>, Columns<>>;
+using BookTagsSave = Query<"book_tags.save", "INSERT INTO book_tags (book_id, tag_id) VALUES ($1, $2) ON CONFLICT DO NOTHING;",
+    Params<domain::BookId, int>, Columns<>>;
+using BookTagsByBook = Query<"book_tags.by_book", "SELECT tag_id FROM book_tags WHERE book_id = $1;",
+    Params<domain::BookId>, Columns<int>>;
+using BookTagsNamesByBook = Query<"book_tags.names_by_book", R"(SELECT tags.id, tags.name FROM book_tags
+   INNER JOIN tags ON tags.id = book_tags.tag_id
+   WHERE book_id = $1;)", Params<domain::BookId>, Columns<int, std::string>>;
+// Один запрос: проверка версии книги ($5 = 0 - без проверки), недостающие теги словаря,
+// удаление лишних связей, добавление новых и обновление книги, только если что-то поменялось
+using BookTagsSync = Query<"book_tags.sync", R"(
+WITH current AS (
+    SELECT id, version FROM books
+    WHERE id = $1 AND ($5 = 0 OR version = $5)
+    FOR UPDATE
+), desired_names AS (
+    SELECT DISTINCT unnest($4::varchar[]) AS name
+), new_tags AS (
+    INSERT INTO tags (name)
+    SELECT name FROM desired_names
+    WHERE NOT EXISTS (SELECT 1 FROM tags WHERE tags.name = desired_names.name)
+    ON CONFLICT (name) DO NOTHING
+    RETURNING id
+), desired AS (
+    SELECT tags.id FROM tags INNER JOIN desired_names ON tags.name = desired_names.name
+    UNION ALL
+    SELECT id FROM new_tags
+), removed AS (
+    DELETE FROM book_tags
+    WHERE book_id = $1 AND EXISTS (SELECT 1 FROM current) AND tag_id NOT IN (SELECT id FROM desired)
+    RETURNING tag_id
+), added AS (
+    INSERT INTO book_tags (book_id, tag_id)
+    SELECT $1, id FROM desired
+    WHERE EXISTS (SELECT 1 FROM current) AND id NOT IN (SELECT tag_id FROM book_tags WHERE book_id = $1)
+    ON CONFLICT DO NOTHING
+    RETURNING tag_id
+), updated AS (
+    UPDATE books SET title = $2, publication_year = $3, version = books.version + 1
+    FROM current
+    WHERE books.id = current.id
+      AND ((title, publication_year) IS DISTINCT FROM ($2::varchar, $3::int)
+           OR EXISTS (SELECT 1 FROM removed) OR EXISTS (SELECT 1 FROM added))
+    RETURNING books.version
+)
+SELECT EXISTS (SELECT 1 FROM current),
+       (SELECT count(*) FROM updated) + (SELECT count(*) FROM removed) + (SELECT count(*) FROM added),
+       (SELECT count(*) FROM desired),
+       (SELECT count(*) FROM desired_names),
+       COALESCE((SELECT version FROM updated), (SELECT version FROM current), 0);
+)", Params<domain::BookId, std::string, int, std::vector<std::string>, int>, Columns<bool, int64_t, int64_t, int64_t, int>>;
 
+// Год книги берётся из book_years: по ключу секционирования план отсекает все секции, кроме одной
+using BooksDelete = Query<"books.delete", R"(
+DELETE FROM books WHERE id = $1 AND publication_year = (SELECT publication_year FROM book_years WHERE id = $1);
+)", Params<domain::BookId>, Columns<>>;
+using BooksEdit = Query<"books.edit", R"(
+UPDATE books SET title = $2, publication_year = $3, version = version + 1
+WHERE id = $1 AND publication_year = (SELECT publication_year FROM book_years WHERE id = $1)
+  AND ($4 = 0 OR version = $4);
+)", Params<domain::BookId, std::string, int, int>, Columns<>>;
+using BooksSave = Query<"books.save", "INSERT INTO books (id, author_id, title, publication_year) VALUES ($1, $2, $3, $4);",
+    Params<domain::BookId, domain::AuthorId, std::string, int>, Columns<>>;
+using BooksList = Query<"books.list", R"(SELECT books.id, author_id, name, title, publication_year, books.version
+   FROM books
+   INNER JOIN authors ON books.author_id = authors.id
+   ORDER BY title, name, publication_year;)",
+    Params<>, Columns<domain::BookId, domain::AuthorId, std::string, std::string, int, int>>;
+using BooksByAuthor = Query<"books.by_author", R"(SELECT id, author_id, title, publication_year, version FROM books WHERE author_id = $1
+   ORDER BY publication_year ASC, title ASC;)",
+    Params<domain::AuthorId>, Columns<domain::BookId, domain::AuthorId, std::string, int, int>>;
+using BooksByTitle = Query<"books.by_title", R"(SELECT books.id, author_id, name, title, publication_year, books.version
+   FROM books
+   INNER JOIN authors ON books.author_id = authors.id WHERE title = $1
+   ORDER BY name, publication_year;)",
+    Params<std::string>, Columns<domain::BookId, domain::AuthorId, std::string, std::string, int, int>>;
+// Страница выборки по годам. Ключ предыдущей страницы сравнивается кортежем с индексом books_by_year;
+// BETWEEN по ключу секционирования отсекает лишние секции и в общем плане подготовленного запроса
+using BooksByYears = Query<"books.by_years", R"(SELECT books.id, author_id, name, title, publication_year, books.version
+   FROM books
+   INNER JOIN authors ON books.author_id = authors.id
+   WHERE publication_year BETWEEN $1 AND $2
+     AND (publication_year, title COLLATE "C", books.id) > ($3, $4, $5)
+   ORDER BY publication_year, title COLLATE "C", books.id
+   LIMIT $6;)",
+    Params<int, int, int, std::string, domain::BookId, int64_t>,
+    Columns<domain::BookId, domain::AuthorId, std::string, std::string, int, int>>;
+using BooksByAuthorYears = Query<"books.by_author_years", R"(SELECT books.id, author_id, name, title, publication_year, books.version
+   FROM books
+   INNER JOIN authors ON books.author_id = authors.id
+   WHERE author_id = $1 AND publication_year BETWEEN $2 AND $3
+     AND (publication_year, title COLLATE "C", books.id) > ($4, $5, $6)
+   ORDER BY publication_year, title COLLATE "C", books.id
+   LIMIT $7;)",
+    Params<domain::AuthorId, int, int, int, std::string, domain::BookId, int64_t>,
+    Columns<domain::BookId, domain::AuthorId, std::string, std::string, int, int>>;
+using BooksExists = Query<"books.exists", "SELECT EXISTS (SELECT 1 FROM book_years WHERE id = $1);",
+    Params<domain::BookId>, Columns<bool>>;
+
+using StatsBooks = Query<"stats.books", "SELECT COALESCE(sum(book_count), 0)::int FROM year_stats;",
+    Params<>, Columns<int>>;
+using StatsAuthorBooks = Query<"stats.author_books", "SELECT book_count FROM author_stats WHERE author_id = $1;",
+    Params<domain::AuthorId>, Columns<int>>;
+using StatsTopAuthors = Query<"stats.top_authors", R"(SELECT author_id, name, book_count FROM author_stats
+   INNER JOIN authors ON authors.id = author_stats.author_id
+   WHERE book_count > 0
+   ORDER BY book_count DESC, name
+   LIMIT $1;)", Params<int64_t>, Columns<domain::AuthorId, std::string, int>>;
+using StatsTopTags = Query<"stats.top_tags", R"(SELECT tags.name, book_count FROM tag_stats
+   INNER JOIN tags ON tags.id = tag_stats.tag_id
+   WHERE book_count > 0
+   ORDER BY book_count DESC, tags.name
+   LIMIT $1;)", Params<int64_t>, Columns<std::string, int>>;
+using StatsYears = Query<"stats.years",
+    "SELECT publication_year, book_count FROM year_stats WHERE book_count > 0 ORDER BY publication_year;",
+    Params<>, Columns<int, int>>;
+using StatsVerify = Query<"stats.verify", R"(
+SELECT 'author', COALESCE(stats.author_id, actual.author_id)::text, COALESCE(stats.book_count, 0), COALESCE(actual.books, 0)
+FROM author_stats AS stats
+FULL JOIN (SELECT author_id, count(*)::int AS books FROM books GROUP BY author_id) AS actual
+    ON actual.author_id = stats.author_id
+WHERE COALESCE(stats.book_count, 0) <> COALESCE(actual.books, 0)
+UNION ALL
+SELECT 'tag', (SELECT name FROM tags WHERE id = COALESCE(stats.tag_id, actual.tag_id))::text,
+       COALESCE(stats.book_count, 0), COALESCE(actual.books, 0)
+FROM tag_stats AS stats
+FULL JOIN (SELECT tag_id, count(*)::int AS books FROM book_tags GROUP BY tag_id) AS actual
+    ON actual.tag_id = stats.tag_id
+WHERE COALESCE(stats.book_count, 0) <> COALESCE(actual.books, 0)
+UNION ALL
+SELECT 'year', COALESCE(stats.publication_year, actual.publication_year)::text,
+       COALESCE(stats.book_count, 0), COALESCE(actual.books, 0)
+FROM year_stats AS stats
+FULL JOIN (SELECT publication_year, count(*)::int AS books FROM books GROUP BY publication_year) AS actual
+    ON actual.publication_year = stats.publication_year
+WHERE COALESCE(stats.book_count, 0) <> COALESCE(actual.books, 0);
+)", Params<>, Columns<std::string, std::string, int, int>>;
+
+// Готовятся на каждом соединении Database после создания схемы
+void PrepareCatalogQueries(pqxx::connection& connection) {
+    PrepareQueries<AuthorsDeleteByName, AuthorsDelete, AuthorsSave, AuthorsUpdateVersioned, AuthorsList, AuthorsByName,
+                   AuthorsExists, TagsByName, TagsInsert, BookTagsClear, BookTagsSave, BookTagsByBook,
+                   BookTagsNamesByBook, BookTagsSync, BooksDelete, BooksEdit, BooksSave, BooksList, BooksByAuthor,
+                   BooksByTitle, BooksByYears, BooksByAuthorYears, BooksExists, StatsBooks, StatsAuthorBooks,
+                   StatsTopAuthors, StatsTopTags, StatsYears, StatsVerify>(connection);
+}
+
+domain::Book MakeBook(domain::BookId id, domain::AuthorId author_id, std::string author_name, std::string title,
+                      int year, int version) {
+    return domain::Book(id, {author_id, std::move(author_name)}, std::move(title), year, version);
+}
+
+void CreateTriggerIfMissing(pqxx::work& work, std::string_view table, std::string_view name, std::string_view definition) {
+    auto exists = work.exec_params1(
+        "SELECT EXISTS (SELECT 1 FROM pg_trigger WHERE tgname = $1 AND tgrelid = $2::regclass);"_zv,
+        std::string(name), std::string(table))[0].as<bool>();
+    if(!exists)
+        work.exec("CREATE TRIGGER "s + std::string(name) + " "s + std::string(definition) + ";"s);
+}
+
+// Триггеры пересчитывают счётчики в той же транзакции, что и запись.
+// Вставки и удаления - потабличные, с таблицами переходов: одно обновление счётчика на ключ за оператор
+void InstallCatalogStats(pqxx::work& work) {
+    const auto created = !work.query_value<bool>("SELECT to_regclass('year_stats') IS NOT NULL;"_zv);
+    work.exec(R"(
+CREATE TABLE IF NOT EXISTS author_stats (
+    author_id UUID PRIMARY KEY,
+    book_count INT NOT NULL
+);
+CREATE INDEX IF NOT EXISTS author_stats_top ON author_stats (book_count DESC);
+CREATE TABLE IF NOT EXISTS tag_stats (
+    tag_id INT PRIMARY KEY,
+    book_count INT NOT NULL
+);
+CREATE INDEX IF NOT EXISTS tag_stats_top ON tag_stats (book_count DESC);
+CREATE TABLE IF NOT EXISTS year_stats (
+    publication_year INT PRIMARY KEY,
+    book_count INT NOT NULL
+);
+)"_zv);
+
+    // Ключи сортируются, чтобы пачки разных транзакций блокировали строки счётчиков в одном порядке
+    work.exec(R"(
+CREATE OR REPLACE FUNCTION catalog_stats_books() RETURNS trigger AS $$
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        INSERT INTO author_stats AS stats (author_id, book_count)
+        SELECT author_id, count(*) FROM inserted GROUP BY author_id ORDER BY author_id
+        ON CONFLICT (author_id) DO UPDATE SET book_count = stats.book_count + EXCLUDED.book_count;
+        INSERT INTO year_stats AS stats (publication_year, book_count)
+        SELECT publication_year, count(*) FROM inserted GROUP BY publication_year ORDER BY publication_year
+        ON CONFLICT (publication_year) DO UPDATE SET book_count = stats.book_count + EXCLUDED.book_count;
+    ELSIF TG_OP = 'DELETE' THEN
+        UPDATE author_stats AS stats SET book_count = stats.book_count - changed.books
+        FROM (SELECT author_id, count(*) AS books FROM deleted GROUP BY author_id) AS changed
+        WHERE stats.author_id = changed.author_id;
+        UPDATE year_stats AS stats SET book_count = stats.book_count - changed.books
+        FROM (SELECT publication_year, count(*) AS books FROM deleted GROUP BY publication_year) AS changed
+        WHERE stats.publication_year = changed.publication_year;
+    ELSE
+        -- UPDATE: книги, сменившие автора или год. Переезд в другую секцию books не запускает
+        -- триггеры DELETE и INSERT уровня оператора, но попадает в таблицы переходов UPDATE
+        INSERT INTO author_stats AS stats (author_id, book_count)
+        SELECT author_id, sum(delta) FROM (
+            SELECT deleted.author_id, -1 AS delta FROM deleted JOIN inserted USING (id)
+            WHERE deleted.author_id <> inserted.author_id
+            UNION ALL
+            SELECT inserted.author_id, 1 FROM deleted JOIN inserted USING (id)
+            WHERE deleted.author_id <> inserted.author_id
+        ) AS changed GROUP BY author_id ORDER BY author_id
+        ON CONFLICT (author_id) DO UPDATE SET book_count = stats.book_count + EXCLUDED.book_count;
+        INSERT INTO year_stats AS stats (publication_year, book_count)
+        SELECT publication_year, sum(delta) FROM (
+            SELECT deleted.publication_year, -1 AS delta FROM deleted JOIN inserted USING (id)
+            WHERE deleted.publication_year <> inserted.publication_year
+            UNION ALL
+            SELECT inserted.publication_year, 1 FROM deleted JOIN inserted USING (id)
+            WHERE deleted.publication_year <> inserted.publication_year
+        ) AS changed GROUP BY publication_year ORDER BY publication_year
+        ON CONFLICT (publication_year) DO UPDATE SET book_count = stats.book_count + EXCLUDED.book_count;
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION catalog_stats_book_tags() RETURNS trigger AS $$
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        INSERT INTO tag_stats AS stats (tag_id, book_count)
+        SELECT tag_id, count(*) FROM inserted GROUP BY tag_id ORDER BY tag_id
+        ON CONFLICT (tag_id) DO UPDATE SET book_count = stats.book_count + EXCLUDED.book_count;
+    ELSE
+        UPDATE tag_stats AS stats SET book_count = stats.book_count - changed.books
+        FROM (SELECT tag_id, count(*) AS books FROM deleted GROUP BY tag_id) AS changed
+        WHERE stats.tag_id = changed.tag_id;
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION catalog_stats_authors() RETURNS trigger AS $$
+BEGIN
+    DELETE FROM author_stats WHERE author_id IN (SELECT id FROM deleted);
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+)"_zv);
+
+    CreateTriggerIfMissing(work, "books"sv, "books_stats_insert"sv,
+        "AFTER INSERT ON books REFERENCING NEW TABLE AS inserted FOR EACH STATEMENT EXECUTE FUNCTION catalog_stats_books()"sv);
+    CreateTriggerIfMissing(work, "books"sv, "books_stats_delete"sv,
+        "AFTER DELETE ON books REFERENCING OLD TABLE AS deleted FOR EACH STATEMENT EXECUTE FUNCTION catalog_stats_books()"sv);
+    // Таблицы переходов несовместимы со списком столбцов UPDATE OF - изменения отбирает сама функция
+    CreateTriggerIfMissing(work, "books"sv, "books_stats_update"sv,
+        R"(AFTER UPDATE ON books REFERENCING OLD TABLE AS deleted NEW TABLE AS inserted
+           FOR EACH STATEMENT EXECUTE FUNCTION catalog_stats_books())"sv);
+    CreateTriggerIfMissing(work, "book_tags"sv, "book_tags_stats_insert"sv,
+        "AFTER INSERT ON book_tags REFERENCING NEW TABLE AS inserted FOR EACH STATEMENT EXECUTE FUNCTION catalog_stats_book_tags()"sv);
+    CreateTriggerIfMissing(work, "book_tags"sv, "book_tags_stats_delete"sv,
+        "AFTER DELETE ON book_tags REFERENCING OLD TABLE AS deleted FOR EACH STATEMENT EXECUTE FUNCTION catalog_stats_book_tags()"sv);
+    CreateTriggerIfMissing(work, "authors"sv, "authors_stats_delete"sv,
+        "AFTER DELETE ON authors REFERENCING OLD TABLE AS deleted FOR EACH STATEMENT EXECUTE FUNCTION catalog_stats_authors()"sv);
+
+    if(created) {
+        // CREATE TRIGGER уже дождался пишущих транзакций и не пустит новые до коммита,
+        // поэтому пересчёт видит всё, что не увидят триггеры
+        work.exec(R"(
+INSERT INTO author_stats (author_id, book_count) SELECT author_id, count(*) FROM books GROUP BY author_id;
+INSERT INTO year_stats (publication_year, book_count) SELECT publication_year, count(*) FROM books GROUP BY publication_year;
+INSERT INTO tag_stats (tag_id, book_count) SELECT tag_id, count(*) FROM book_tags GROUP BY tag_id;
+)"_zv);
+    }
+}
+
+}  // namespace
+
+void AuthorRepositoryImpl::DeleteAuthorAndDependencies(const domain::Author& author) {
     if(!author.GetName().empty()) {
-        worker_.exec_params( R"( DELETE FROM authors WHERE name = $1; )"_zv,
-        author.GetName());
+        AuthorsDeleteByName::Exec(worker_, author.GetName());
         return;
     }
-
-    worker_.exec_params( R"( DELETE FROM authors WHERE id = $1; )"_zv,
-        author.GetId().ToString());
+    AuthorsDelete::Exec(worker_, author.GetId());
 }
 
 void AuthorRepositoryImpl::Save(const domain::Author& author) {
-    //pqxx::work work{connection_};
-    worker_.exec_params(
-        R"(
-INSERT INTO authors (id, name) VALUES ($1, $2)
-ON CONFLICT (id) DO UPDATE SET name=$2;
-)"_zv,
-        author.GetId().ToString(), author.GetName());
+    if(author.GetVersion() == 0) {
+        AuthorsSave::Exec(worker_, author.GetId(), author.GetName());
+        return;
+    }
+
+    auto result = AuthorsUpdateVersioned::Exec(worker_, author.GetId(), author.GetName(), author.GetVersion());
+    if(result.affected_rows() == 0)
+        throw domain::VersionConflict("Author was changed or deleted by another session");
 }
 
 void TagRepositoryImpl::ClearTagsByBookId(const domain::BookId& book_id) {
-    worker_.exec_params( R"( DELETE FROM book_tags WHERE book_id = $1; )"_zv, book_id.ToString());
+    BookTagsClear::Exec(worker_, book_id);
+}
+
+int TagRepositoryImpl::GetOrCreateTagId(const std::string& name) {
+    if(auto id = cache_.FindId(name))
+        return *id;
+    for(const auto & [id, created] : created_tags_) {
+        if(created == name)
+            return id;
+    }
+
+    auto found = TagsByName::Exec(worker_, name);
+    if(!found.empty()) {
+        // Чужие незакоммиченные строки не видны, значит тег уже закоммичен
+        auto id = TagsByName::Value(found);
+        cache_.Add(id, name);
+        return id;
+    }
+
+    auto inserted = TagsInsert::Exec(worker_, name);
+    if(inserted.empty()) {
+        // Тег успел вставить и закоммитить другой сеанс
+        auto id = TagsByName::Value(TagsByName::Exec(worker_, name));
+        cache_.Add(id, name);
+        return id;
+    }
+    auto id = TagsInsert::Value(inserted);
+    created_tags_.emplace_back(id, name);
+    return id;
 }
 
 void TagRepositoryImpl::Save(const domain::Tag& tag) {
-    worker_.exec_params(
-        R"(
-INSERT INTO book_tags (book_id, tag) VALUES ($1, $2);
-)"_zv,
-        tag.GetBookId().ToString(), tag.GetTag());
+    const auto tag_id = GetOrCreateTagId(tag.GetTag());
+    BookTagsSave::Exec(worker_, tag.GetBookId(), tag_id);
 }
 
 domain::TagRepository::list_tags_t TagRepositoryImpl::GetTagsByBookId(const domain::BookId& book) {
-    auto query_text = "SELECT book_id, tag FROM book_tags WHERE book_id = " + worker_.quote(book.ToString()) + " ORDER BY tag ASC;";
+    auto ids = BookTagsByBook::Exec(worker_, book);
     domain::TagRepository::list_tags_t list;
-    for(auto [book_id, tag] : worker_.query<std::string, std::string>(query_text)) {
-        list.push_back({domain::BookId::FromString(book_id), tag});
+    list.reserve(ids.size());
+    bool complete = true;
+    BookTagsByBook::ForEachRow(ids, [&](int tag_id) {
+        auto name = complete ? cache_.FindName(tag_id) : std::nullopt;
+        if(name)
+            list.push_back({book, std::move(*name)});
+        else
+            complete = false;
+    });
+
+    if(!complete) {
+        // В кэше есть не все теги книги - берём имена из словаря
+        list.clear();
+        BookTagsNamesByBook::ForEachRow(BookTagsNamesByBook::Exec(worker_, book), [&](int id, std::string name) {
+            if(std::none_of(created_tags_.begin(), created_tags_.end(), [id](const auto & created) { return created.first == id; }))
+                cache_.Add(id, name);
+            list.push_back({book, std::move(name)});
+        });
     }
 
+    std::sort(list.begin(), list.end(), [](const domain::Tag & lhs, const domain::Tag & rhs) {
+        return lhs.GetTag() < rhs.GetTag();
+    });
     return list;
 }
 
-domain::AuthorRepository::list_authors_t AuthorRepositoryImpl::GetList() { 
-    domain::AuthorRepository::list_authors_t authors_list;
-
-    auto query_text = "SELECT * FROM authors ORDER BY name ASC;"_zv;
-    for(auto [id, name] : worker_.query<std::string, std::string>(query_text)) {
-        authors_list.push_back(domain::Author(domain::AuthorId::FromString(id), name));
+bool TagRepositoryImpl::SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) {
+    auto expected_version = book.GetVersion();
+    bool changed = false;
+    for(int attempt = 0;; ++attempt) {
+        bool found = false;
+        int64_t changes = 0, resolved = 0, requested = 0;
+        int version = 0;
+        BookTagsSync::ForEachRow(
+            BookTagsSync::Exec(worker_, book.GetId(), book.GetTitle(), book.GetYear(), tags, expected_version),
+            [&](bool row_found, int64_t row_changes, int64_t row_resolved, int64_t row_requested, int row_version) {
+                std::tie(found, changes, resolved, requested, version) =
+                    std::tie(row_found, row_changes, row_resolved, row_requested, row_version);
+            });
+        if(!found)
+            throw domain::VersionConflict("Book was changed or deleted by another session");
+        changed = changed || changes > 0;
+        // Тег, одновременно созданный другим сеансом, не виден в снимке этого запроса -
+        // повторяем, следующий запрос получит новый снимок
+        if(resolved == requested || attempt > 0)
+            return changed;
+        expected_version = version;
     }
-    return authors_list;
+}
+
+void TagRepositoryImpl::ForEach(const std::function<void(const domain::Tag&)>& visitor) {
+    static auto& latency = StatementLatency("book_tags.stream"sv);
+    metrics::ScopedTimer timer{latency};
+    TranslateErrors([&] {
+        for(auto [book_id, name] : worker_.stream<std::string_view, std::string_view>(
+                "SELECT book_id, tags.name FROM book_tags INNER JOIN tags ON tags.id = book_tags.tag_id"sv)) {
+            visitor(domain::Tag(domain::BookId::FromString(book_id), std::string(name)));
+        }
+    });
+}
+
+void TagRepositoryImpl::OnCommit() {
+    for(const auto & [id, name] : created_tags_)
+        cache_.Add(id, name);
+    created_tags_.clear();
+}
+
+domain::AuthorRepository::list_authors_t AuthorRepositoryImpl::GetList() { 
+    return AuthorsList::Collect<domain::Author>(AuthorsList::Exec(worker_));
 }
 
 std::optional <domain::Author> AuthorRepositoryImpl::FindAuthorByName(const std::string & name) {
-    auto query_text = "SELECT * FROM authors WHERE name = "s + worker_.quote(name) + ";"s;
-    auto author = worker_.query01<std::string, std::string>(pqxx::zview(query_text));
-    if(!author) 
+    auto authors = AuthorsByName::Collect<domain::Author>(AuthorsByName::Exec(worker_, name));
+    if(authors.empty()) 
         return std::nullopt;
-    return domain::Author(domain::AuthorId::FromString(std::get<0>(*author)), std::get<1>(*author)); 
+    return std::move(authors.front());
+}
+
+void AuthorRepositoryImpl::ForEach(const std::function<void(const domain::Author&)>& visitor) {
+    static auto& latency = StatementLatency("authors.stream"sv);
+    metrics::ScopedTimer timer{latency};
+    // COPY TO STDOUT: строки приходят по мере чтения, без буферизации всего результата
+    TranslateErrors([&] {
+        for(auto [id, name, version] : worker_.stream<std::string_view, std::string_view, int>("SELECT id, name, version FROM authors ORDER BY name ASC"sv)) {
+            visitor(domain::Author(domain::AuthorId::FromString(id), std::string(name), version));
+        }
+    });
+}
+
+bool AuthorRepositoryImpl::Contains(const domain::AuthorId& author_id) {
+    return AuthorsExists::Value(AuthorsExists::Exec(worker_, author_id));
 }
 
 void BookRepositoryImpl::Delete(const domain::BookId& book_id) {
-    worker_.exec_params( "DELETE FROM books WHERE id = $1; "_zv, book_id.ToString());
+    BooksDelete::Exec(worker_, book_id);
 }
 
 void BookRepositoryImpl::Edit(const domain::Book& book) {
-        worker_.exec_params(
-        R"(
-UPDATE books SET title = $2, publication_year = $3 WHERE id = $1;
-)"_zv,
-        book.GetId().ToString(), book.GetTitle(), book.GetYear());
+    auto result = BooksEdit::Exec(worker_, book.GetId(), book.GetTitle(), book.GetYear(), book.GetVersion());
+    if(result.affected_rows() == 0)
+        throw domain::VersionConflict("Book was changed or deleted by another session");
 }
 
 void BookRepositoryImpl::Save(const domain::Book& book) {
-    worker_.exec_params(
-        R"(
-INSERT INTO books (id, author_id, title, publication_year) VALUES ($1, $2, $3, $4);
-)"_zv,
-        book.GetId().ToString(), book.GetAuthorId().ToString(), book.GetTitle(), book.GetYear());
+    BooksSave::Exec(worker_, book.GetId(), book.GetAuthorId(), book.GetTitle(), book.GetYear());
 }
 
 domain::BookRepository::list_books_t BookRepositoryImpl::GetList() { 
-    domain::BookRepository::list_books_t books_list;
-    auto query_text = R"(SELECT books.id, author_id, name, title, publication_year 
-                        FROM books 
-                        INNER JOIN authors ON books.author_id = authors.id 
-                        ORDER BY title, name, publication_year;)"_zv;
-    for(auto [id, author_id, author_name, title, year] : worker_.query<std::string, std::string,std::string,  std::string, int>(query_text)) {
-        books_list.push_back(domain::Book(domain::BookId::FromString(id), {domain::AuthorId::FromString(author_id), author_name}, title, year));
-    }
-    return books_list;
+    return BooksList::Collect<domain::Book>(BooksList::Exec(worker_), MakeBook);
 }
 
 domain::BookRepository::list_books_t BookRepositoryImpl::GetBookByAuthorId(const domain::AuthorId& author_id) {
-    domain::BookRepository::list_books_t books_list;
-    auto query_text = "SELECT id, author_id, title, publication_year FROM books WHERE author_id = " + worker_.quote(author_id.ToString()) + 
-                      " ORDER BY publication_year ASC, title ASC;";
-    for(auto [id, author_id, title, year] : worker_.query<std::string, std::string, std::string, int>(pqxx::zview(query_text))) {
-        books_list.push_back(domain::Book(domain::BookId::FromString(id), {domain::AuthorId::FromString(author_id),""}, title, year));
-    }
-    return books_list; 
+    return BooksByAuthor::Collect<domain::Book>(BooksByAuthor::Exec(worker_, author_id),
+        [](domain::BookId id, domain::AuthorId author_id, std::string title, int year, int version) {
+            return domain::Book(id, {author_id, ""}, std::move(title), year, version);
+        });
 }
 
 domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByTitle(const std::string& title) {
-    auto query_text = R"(SELECT books.id, author_id, name, title, publication_year 
-                        FROM books 
-                        INNER JOIN authors ON books.author_id = authors.id WHERE title = )"
-                        + worker_.quote(title) + ";"s;
-    domain::BookRepository::list_books_t books_list;
-    for(auto [id, author_id, author_name, title, year] : worker_.query<std::string, std::string,std::string,  std::string, int>(query_text)) {
-        books_list.push_back(domain::Book(domain::BookId::FromString(id), {domain::AuthorId::FromString(author_id), author_name}, title, year));
+    return BooksByTitle::Collect<domain::Book>(BooksByTitle::Exec(worker_, title), MakeBook);
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByYearRange(const domain::YearRangeQuery& query) {
+    // Первая страница начинается после ключа, меньшего любой книги диапазона
+    const auto after = query.after.value_or(domain::BookKey{query.from_year - 1, {}, {}});
+    const auto limit = LimitParam(query.limit);
+    if(query.author_id) {
+        return BooksByAuthorYears::Collect<domain::Book>(BooksByAuthorYears::Exec(worker_, *query.author_id,
+            query.from_year, query.to_year, after.year, after.title, after.id, limit), MakeBook);
     }
-   
-    return books_list;
+    return BooksByYears::Collect<domain::Book>(BooksByYears::Exec(worker_, query.from_year, query.to_year,
+        after.year, after.title, after.id, limit), MakeBook);
 }
 
-Database::Database(pqxx::connection connection)
-    : connection_{std::move(connection)} {
-    pqxx::work work{connection_};
-    work.exec(R"(
-CREATE TABLE IF NOT EXISTS authors (
-    id UUID PRIMARY KEY,
-    name VARCHAR(100) UNIQUE NOT NULL
-);
-)"_zv);
+void BookRepositoryImpl::ForEach(const std::function<void(const domain::Book&)>& visitor) {
+    static auto& latency = StatementLatency("books.stream"sv);
+    metrics::ScopedTimer timer{latency};
+    TranslateErrors([&] {
+        for(auto [id, author_id, author_name, title, year, version] : worker_.stream<std::string_view, std::string_view, std::string_view, std::string_view, int, int>(
+                R"(SELECT books.id, author_id, name, title, publication_year, books.version
+                   FROM books
+                   INNER JOIN authors ON books.author_id = authors.id
+                   ORDER BY title, name, publication_year)"sv)) {
+            visitor(domain::Book(domain::BookId::FromString(id),
+                                 {domain::AuthorId::FromString(author_id), std::string(author_name)},
+                                 std::string(title), year, version));
+        }
+    });
+}
+
+bool BookRepositoryImpl::Contains(const domain::BookId& book_id) {
+    return BooksExists::Value(BooksExists::Exec(worker_, book_id));
+}
+
+int StatsRepositoryImpl::CountBooks() {
+    return StatsBooks::Value(StatsBooks::Exec(worker_));
+}
+
+int StatsRepositoryImpl::CountAuthorBooks(const domain::AuthorId& author_id) {
+    auto result = StatsAuthorBooks::Exec(worker_, author_id);
+    return result.empty() ? 0 : StatsAuthorBooks::Value(result);
+}
+
+domain::StatsRepository::top_authors_t StatsRepositoryImpl::TopAuthors(size_t limit) {
+    return StatsTopAuthors::Collect<domain::AuthorBooks>(StatsTopAuthors::Exec(worker_, LimitParam(limit)),
+        [](domain::AuthorId id, std::string name, int books) {
+            return domain::AuthorBooks{id, std::move(name), books};
+        });
+}
+
+domain::StatsRepository::top_tags_t StatsRepositoryImpl::TopTags(size_t limit) {
+    return StatsTopTags::Collect<domain::TagBooks>(StatsTopTags::Exec(worker_, LimitParam(limit)),
+        [](std::string name, int books) {
+            return domain::TagBooks{std::move(name), books};
+        });
+}
+
+domain::StatsRepository::years_t StatsRepositoryImpl::BooksPerYear() {
+    return StatsYears::Collect<domain::YearBooks>(StatsYears::Exec(worker_), [](int year, int books) {
+        return domain::YearBooks{year, books};
+    });
+}
+
+domain::StatsRepository::mismatches_t StatsRepositoryImpl::Verify() {
+    return StatsVerify::Collect<domain::StatsMismatch>(StatsVerify::Exec(worker_),
+        [](std::string counter, std::string key, int stored, int actual) {
+            return domain::StatsMismatch{std::move(counter), std::move(key), stored, actual};
+        });
+}
+
+namespace {
+
+// Увеличивается с каждым изменением DDL ниже: иначе уже развёрнутые базы его не получат
+constexpr int SCHEMA_VERSION = 5;
+
+// Секции books по десятилетиям; годы вне [BOOKS_FIRST_DECADE, BOOKS_LAST_DECADE + 10) попадают в books_default
+constexpr int BOOKS_FIRST_DECADE = 1900;
+constexpr int BOOKS_LAST_DECADE = 2090;
+
+// books секционирована по publication_year, чтобы выборки по годам читали только нужные десятилетия.
+// Первичный ключ секционированной таблицы обязан включать ключ секционирования, поэтому он (id, publication_year);
+// уникальность id держит book_years, а внешний ключ book_tags -> books заменён триггерами (CreateBookYears)
+void CreateBooks(pqxx::work& work) {
+    const auto kind = work.query_value<std::string>(
+        "SELECT COALESCE((SELECT relkind::text FROM pg_class WHERE oid = to_regclass('books')), '');"_zv);
+    const bool migrate = kind == "r"sv;
+    if(migrate) {
+        // Старая несекционированная таблица: переименовываем, переливаем строки в новую и удаляем.
+        // Индекс первичного ключа переименовывается вместе с ограничением, иначе имя занято
+        work.exec("ALTER TABLE books ADD COLUMN IF NOT EXISTS version INT NOT NULL DEFAULT 1;"_zv);
+        work.exec("ALTER TABLE IF EXISTS book_tags DROP CONSTRAINT IF EXISTS books;"_zv);
+        work.exec("ALTER TABLE books RENAME TO books_unpartitioned;"_zv);
+        work.exec("ALTER TABLE books_unpartitioned RENAME CONSTRAINT book_id_constraint TO books_unpartitioned_pkey;"_zv);
+        work.exec("ALTER TABLE books_unpartitioned RENAME CONSTRAINT books_authors TO books_unpartitioned_authors;"_zv);
+    }
 
     work.exec(R"(
 CREATE TABLE IF NOT EXISTS books (
-    id UUID CONSTRAINT book_id_constraint PRIMARY KEY,
+    id UUID NOT NULL,
     author_id UUID NOT NULL,
     title VARCHAR(100) NOT NULL,
     publication_year int NOT NULL,
+    version INT NOT NULL DEFAULT 1,
+    CONSTRAINT book_id_constraint PRIMARY KEY (id, publication_year),
     CONSTRAINT books_authors FOREIGN KEY (author_id) REFERENCES authors (id) ON DELETE CASCADE
+) PARTITION BY RANGE (publication_year);
+)"_zv);
+    work.exec(R"(
+DO $$
+BEGIN
+    FOR decade IN )"s + std::to_string(BOOKS_FIRST_DECADE) + ".."s + std::to_string(BOOKS_LAST_DECADE) + R"( BY 10 LOOP
+        EXECUTE format('CREATE TABLE IF NOT EXISTS %I PARTITION OF books FOR VALUES FROM (%s) TO (%s)',
+                       'books_' || decade || 's', decade, decade + 10);
+    END LOOP;
+END;
+$$;
+)"s);
+    work.exec("CREATE TABLE IF NOT EXISTS books_default PARTITION OF books DEFAULT;"_zv);
+    // Ключ страницы выборки по годам: (publication_year, title, id), title побайтово
+    work.exec(R"(
+CREATE INDEX IF NOT EXISTS books_by_year ON books (publication_year, title COLLATE "C", id);
+CREATE INDEX IF NOT EXISTS books_by_author_year ON books (author_id, publication_year, title COLLATE "C", id);
+CREATE INDEX IF NOT EXISTS books_by_title ON books (title);
+)"_zv);
+
+    if(migrate) {
+        work.exec(R"(
+INSERT INTO books (id, author_id, title, publication_year, version)
+SELECT id, author_id, title, publication_year, version FROM books_unpartitioned;
+)"_zv);
+        work.exec("DROP TABLE books_unpartitioned;"_zv);
+    }
+
+    work.exec(R"(
+CREATE OR REPLACE FUNCTION books_delete_tags() RETURNS trigger AS $$
+BEGIN
+    DELETE FROM book_tags WHERE book_id IN (SELECT id FROM deleted);
+    DELETE FROM book_years WHERE id IN (SELECT id FROM deleted);
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+)"_zv);
+}
+
+/**
+ * book_years - id книги и её год. Первичный ключ по id держит уникальность, которую не даёт
+ * ключ (id, publication_year) секционированной books, а год по id позволяет запросам
+ * по одной книге читать одну секцию. Таблицу ведут триггеры books.
+ *
+ * Вместо внешнего ключа book_tags -> books тег проверяет книгу триггером: строка книги
+ * блокируется FOR KEY SHARE, как это сделал бы внешний ключ, поэтому удаление книги,
+ * её переезд в другую секцию и перенос автора на другой шард ждут транзакцию, добавившую тег,
+ * а тег к уже удалённой книге не добавится.
+ */
+void CreateBookYears(pqxx::work& work) {
+    const auto created = !work.query_value<bool>("SELECT to_regclass('book_years') IS NOT NULL;"_zv);
+    work.exec(R"(
+CREATE TABLE IF NOT EXISTS book_years (
+    id UUID PRIMARY KEY,
+    publication_year INT NOT NULL
+);
+
+CREATE OR REPLACE FUNCTION books_track_years() RETURNS trigger AS $$
+BEGIN
+    IF TG_OP = 'INSERT' THEN
+        INSERT INTO book_years (id, publication_year) SELECT id, publication_year FROM inserted;
+    ELSE
+        UPDATE book_years SET publication_year = inserted.publication_year
+        FROM inserted WHERE book_years.id = inserted.id AND book_years.publication_year <> inserted.publication_year;
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION book_tags_check_book() RETURNS trigger AS $$
+DECLARE
+    year INT;
+BEGIN
+    SELECT publication_year INTO year FROM book_years WHERE id = NEW.book_id;
+    PERFORM 1 FROM books WHERE id = NEW.book_id AND publication_year = year FOR KEY SHARE;
+    IF NOT FOUND THEN
+        RAISE EXCEPTION 'Book % does not exist', NEW.book_id USING ERRCODE = 'foreign_key_violation';
+    END IF;
+    RETURN NEW;
+END;
+$$ LANGUAGE plpgsql;
+)"_zv);
+    CreateTriggerIfMissing(work, "books"sv, "books_years_insert"sv,
+        "AFTER INSERT ON books REFERENCING NEW TABLE AS inserted FOR EACH STATEMENT EXECUTE FUNCTION books_track_years()"sv);
+    CreateTriggerIfMissing(work, "books"sv, "books_years_update"sv,
+        "AFTER UPDATE ON books REFERENCING NEW TABLE AS inserted FOR EACH STATEMENT EXECUTE FUNCTION books_track_years()"sv);
+    CreateTriggerIfMissing(work, "book_tags"sv, "book_tags_check_book"sv,
+        "BEFORE INSERT OR UPDATE OF book_id ON book_tags FOR EACH ROW EXECUTE FUNCTION book_tags_check_book()"sv);
+
+    if(created) {
+        // Как и у счётчиков: триггеры уже видят новые записи, остальное переносится здесь.
+        // Повторяющиеся id прежних версий схемы остаются в books, но в book_years попадает первый
+        work.exec(R"(
+INSERT INTO book_years (id, publication_year)
+SELECT DISTINCT ON (id) id, publication_year FROM books ORDER BY id, publication_year
+ON CONFLICT (id) DO NOTHING;
+)"_zv);
+    }
+}
+
+void CreateSchema(pqxx::work& work) {
+    work.exec(R"(
+CREATE TABLE IF NOT EXISTS authors (
+    id UUID PRIMARY KEY,
+    name VARCHAR(100) UNIQUE NOT NULL,
+    version INT NOT NULL DEFAULT 1
 );
 )"_zv);
+    work.exec("ALTER TABLE authors ADD COLUMN IF NOT EXISTS version INT NOT NULL DEFAULT 1;"_zv);
+
+    CreateBooks(work);
+
+    work.exec(R"(
+CREATE TABLE IF NOT EXISTS tags (
+    id SERIAL PRIMARY KEY,
+    name VARCHAR(30) UNIQUE NOT NULL
+);
+)"_zv);
+
+    auto legacy_tags = work.query_value<bool>(R"(
+SELECT EXISTS (SELECT 1 FROM information_schema.columns
+               WHERE table_schema = current_schema() AND table_name = 'book_tags' AND column_name = 'tag');
+)"_zv);
+    if(legacy_tags) {
+        // Старая схема хранила строку тега в каждой строке book_tags - переносим в словарь
+        work.exec(R"(
+INSERT INTO tags (name) SELECT DISTINCT tag FROM book_tags ON CONFLICT (name) DO NOTHING;
+)"_zv);
+        work.exec(R"(
+CREATE TABLE book_tags_migrated AS
+SELECT DISTINCT book_tags.book_id, tags.id AS tag_id FROM book_tags INNER JOIN tags ON tags.name = book_tags.tag;
+)"_zv);
+        work.exec("DROP TABLE book_tags;"_zv);
+        work.exec("ALTER TABLE book_tags_migrated RENAME TO book_tags;"_zv);
+        work.exec("ALTER TABLE book_tags ALTER COLUMN book_id SET NOT NULL, ALTER COLUMN tag_id SET NOT NULL;"_zv);
+        work.exec(R"(
+ALTER TABLE book_tags
+    ADD CONSTRAINT book_tags_pkey PRIMARY KEY (book_id, tag_id),
+    ADD CONSTRAINT book_tags_tag FOREIGN KEY (tag_id) REFERENCES tags (id);
+)"_zv);
+    }
 
     work.exec(R"(
 CREATE TABLE IF NOT EXISTS book_tags (
     book_id UUID NOT NULL,
-    tag VARCHAR(30) NOT NULL,
-    CONSTRAINT books FOREIGN KEY (book_id) REFERENCES books (id) ON DELETE CASCADE
+    tag_id INT NOT NULL,
+    CONSTRAINT book_tags_pkey PRIMARY KEY (book_id, tag_id),
+    CONSTRAINT book_tags_tag FOREIGN KEY (tag_id) REFERENCES tags (id)
 );
 )"_zv);
+    CreateBookYears(work);
+    CreateTriggerIfMissing(work, "books"sv, "books_delete_tags"sv,
+        "AFTER DELETE ON books REFERENCING OLD TABLE AS deleted FOR EACH STATEMENT EXECUTE FUNCTION books_delete_tags()"sv);
+
+    InstallCatalogStats(work);
+
+    // Применённые позиции журналов отложенной записи клиентов, см. journal::Flusher
+    work.exec(R"(
+CREATE TABLE IF NOT EXISTS journal_positions (
+    journal_id UUID PRIMARY KEY,
+    position BIGINT NOT NULL
+);
+)"_zv);
+
+    work.exec("CREATE TABLE IF NOT EXISTS schema_version (version INT NOT NULL);"_zv);
+    work.exec("DELETE FROM schema_version;"_zv);
+    work.exec_params("INSERT INTO schema_version (version) VALUES ($1);"_zv, SCHEMA_VERSION);
+}
+
+// Схема этой или более новой версии уже создана - DDL при запуске не нужен
+bool IsSchemaCurrent(pqxx::work& work) {
+    if(!work.query_value<bool>("SELECT to_regclass('schema_version') IS NOT NULL;"_zv))
+        return false;
+    return work.query_value<int>("SELECT COALESCE(max(version), 0) FROM schema_version;"_zv) >= SCHEMA_VERSION;
+}
 
-    work.commit();
+}  // namespace
+
+pqxx::connection Connect(const std::string & url) {
+    metrics::StartupTimer timer{"postgres.connect"sv};
+    return pqxx::connection{url};
+}
+
+Database::Database(pqxx::connection connection)
+    : connection_{std::move(connection)} {
+    {
+        metrics::StartupTimer timer{"postgres.schema"sv};
+        pqxx::work work{connection_};
+        if(!IsSchemaCurrent(work))
+            CreateSchema(work);
+        work.commit();
+    }
+    metrics::StartupTimer timer{"postgres.prepare"sv};
+    PrepareCatalogQueries(connection_);
 }
 
 }  // namespace postgres
\ No newline at end of file
@@ -1,10 +1,13 @@
 #pragma once
 #include <pqxx/connection>
 #include <pqxx/transaction>
+#include <vector>
 
 #include "../domain/author.h"
 #include "../domain/book.h"
+#include "../domain/stats.h"
 #include "../domain/tag.h"
+#include "tag_cache.h"
 
 namespace postgres {
 
@@ -18,6 +21,9 @@ public:
     void Save(const domain::Author& author) override;
     list_authors_t GetList() override;
     std::optional <domain::Author> FindAuthorByName(const std::string & name) override;
+    void ForEach(const std::function<void(const domain::Author&)>& visitor) override;
+
+    bool Contains(const domain::AuthorId & author_id);
 
 private:
     pqxx::work& worker_;
@@ -35,6 +41,10 @@ public:
     list_books_t GetList() override;
     list_books_t GetBookByAuthorId(const domain::AuthorId &) override;
     list_books_t GetBooksByTitle(const std::string &) override;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery & query) override;
+    void ForEach(const std::function<void(const domain::Book&)>& visitor) override;
+
+    bool Contains(const domain::BookId & book_id);
 
 private:
     pqxx::work& worker_;
@@ -42,25 +52,70 @@ private:
 
 class TagRepositoryImpl : public domain::TagRepository {
 public:
-    explicit TagRepositoryImpl(pqxx::work& worker)
-        : worker_{worker} {        
+    TagRepositoryImpl(pqxx::work& worker, TagIdCache& cache)
+        : worker_{worker}
+        , cache_{cache} {
     }
 
     void ClearTagsByBookId(const domain::BookId & book_id) override;
     void Save(const domain::Tag& tag) override;
     list_tags_t GetTagsByBookId(const domain::BookId & book) override;
+    bool SyncBookTags(const domain::Book & book, const std::vector<std::string> & tags) override;
+    void ForEach(const std::function<void(const domain::Tag&)>& visitor) override;
+
+    // Публикует в общий кэш теги, созданные в этой транзакции
+    void OnCommit();
+    // Число созданных тегов: откат к точке сохранения забывает созданные после неё
+    size_t CreatedCount() const noexcept {
+        return created_tags_.size();
+    }
+    void ForgetCreatedAfter(size_t count) {
+        created_tags_.resize(count);
+    }
+
+private:
+    int GetOrCreateTagId(const std::string & name);
+
+    pqxx::work& worker_;
+    TagIdCache& cache_;
+    std::vector<std::pair<int, std::string>> created_tags_;
+};
+
+// Счётчики author_stats, tag_stats и year_stats поддерживают триггеры каталога
+class StatsRepositoryImpl : public domain::StatsRepository {
+public:
+    explicit StatsRepositoryImpl(pqxx::work& worker)
+        : worker_{worker} {
+    }
+
+    int CountBooks() override;
+    int CountAuthorBooks(const domain::AuthorId& author_id) override;
+    top_authors_t TopAuthors(size_t limit) override;
+    top_tags_t TopTags(size_t limit) override;
+    years_t BooksPerYear() override;
+    mismatches_t Verify() override;
+
 private:
     pqxx::work& worker_;
 };
 
+// Открывает соединение, время подключения попадает в отчёт о запуске
+pqxx::connection Connect(const std::string & url);
+
+/**
+ * Соединение с подготовленной схемой и запросами. Если в базе уже записана версия схемы
+ * не меньше SCHEMA_VERSION, DDL при запуске не выполняется - остаётся одна проверка версии
+ */
 class Database {
 public:
     explicit Database(pqxx::connection connection);
 
     pqxx::connection & GetConnection() { return connection_; }
+    TagIdCache & GetTagCache() { return tag_cache_; }
 
 private:
     pqxx::connection connection_;
+    TagIdCache tag_cache_;
 };
 
 }  // namespace postgres
\ No newline at end of file
@@ -0,0 +1,293 @@
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <pqxx/connection>
+#include <pqxx/transaction>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../metrics/metrics.h"
+#include "../util/tagged_uuid.h"
+#include "statement.h"
+
+namespace postgres {
+
+// Строка, пригодная в качестве параметра шаблона
+template <size_t N>
+struct FixedString {
+    char data[N]{};
+
+    constexpr FixedString(const char (&text)[N]) {
+        std::copy_n(text, N, data);
+    }
+
+    constexpr std::string_view View() const {
+        return {data, N - 1};
+    }
+};
+
+template <typename... Ts>
+struct Params {};
+
+template <typename... Ts>
+struct Columns {};
+
+namespace detail {
+
+constexpr bool IsSqlSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+// Наибольший номер параметра $N в тексте запроса, не считая строковых литералов
+constexpr size_t CountPlaceholders(std::string_view sql) {
+    size_t count = 0;
+    bool in_literal = false;
+    for (size_t i = 0; i < sql.size(); ++i) {
+        if (sql[i] == '\'') {
+            in_literal = !in_literal;
+        } else if (!in_literal && sql[i] == '$') {
+            size_t number = 0;
+            while (i + 1 < sql.size() && sql[i + 1] >= '0' && sql[i + 1] <= '9') {
+                number = number * 10 + static_cast<size_t>(sql[++i] - '0');
+            }
+            count = std::max(count, number);
+        }
+    }
+    return count;
+}
+
+/**
+ * Число столбцов в списке простого SELECT ... FROM. 0 - определить нельзя:
+ * запрос не начинается с SELECT (CTE, INSERT ... RETURNING) или выбирает *.
+ */
+constexpr size_t CountSelectColumns(std::string_view sql) {
+    size_t pos = 0;
+    while (pos < sql.size() && IsSqlSpace(sql[pos])) {
+        ++pos;
+    }
+    if (sql.substr(pos, 7) != "SELECT ") {
+        return 0;
+    }
+    size_t columns = 1;
+    int depth = 0;
+    bool in_literal = false;
+    for (pos += 7; pos < sql.size(); ++pos) {
+        const char c = sql[pos];
+        if (c == '\'') {
+            in_literal = !in_literal;
+        }
+        if (in_literal) {
+            continue;
+        }
+        if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            --depth;
+        } else if (depth == 0) {
+            if (c == ',') {
+                ++columns;
+            } else if (c == '*' || c == ';') {
+                return c == '*' ? 0 : columns;
+            } else if (IsSqlSpace(c) && sql.substr(pos + 1, 5) == "FROM ") {
+                return columns;
+            }
+        }
+    }
+    return columns;
+}
+
+// Текстовый вид UUID в буфере на стеке, чтобы не создавать std::string на каждый параметр
+struct UuidParam {
+    char text[util::detail::UUID_TEXT_SIZE + 1]{};
+
+    pqxx::zview View() const noexcept {
+        return {text, util::detail::UUID_TEXT_SIZE};
+    }
+};
+
+template <typename T>
+struct ParamTraits {
+    static const T& Encode(const T& value) noexcept {
+        return value;
+    }
+};
+
+template <typename Tag>
+struct ParamTraits<util::TaggedUUID<Tag>> {
+    static UuidParam Encode(const util::TaggedUUID<Tag>& value) noexcept {
+        UuidParam param;
+        util::detail::UUIDToChars(*value, param.text);
+        return param;
+    }
+};
+
+template <typename T>
+decltype(auto) AsParam(const T& encoded) noexcept {
+    if constexpr (std::is_same_v<T, UuidParam>) {
+        return encoded.View();
+    } else {
+        return (encoded);
+    }
+}
+
+// Разбор столбца из текстового представления libpq
+template <typename T>
+struct ColumnTraits;
+
+template <>
+struct ColumnTraits<std::string_view> {
+    static std::string_view Decode(std::string_view text) noexcept {
+        return text;
+    }
+};
+
+template <>
+struct ColumnTraits<std::string> {
+    static std::string Decode(std::string_view text) {
+        return std::string(text);
+    }
+};
+
+template <>
+struct ColumnTraits<bool> {
+    static bool Decode(std::string_view text) {
+        if (text != "t" && text != "f") {
+            throw std::runtime_error("Column is not a boolean: " + std::string(text));
+        }
+        return text == "t";
+    }
+};
+
+template <typename Tag>
+struct ColumnTraits<util::TaggedUUID<Tag>> {
+    static util::TaggedUUID<Tag> Decode(std::string_view text) {
+        return util::TaggedUUID<Tag>::FromString(text);
+    }
+};
+
+template <typename T>
+    requires std::is_integral_v<T>
+struct ColumnTraits<T> {
+    static T Decode(std::string_view text) {
+        T value{};
+        const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc{} || end != text.data() + text.size()) {
+            throw std::runtime_error("Column is not an integer: " + std::string(text));
+        }
+        return value;
+    }
+};
+
+}  // namespace detail
+
+template <FixedString Name, FixedString Sql, typename ParamList, typename ColumnList>
+class Query;
+
+/**
+ * Запрос, объявленный один раз вместе с типами параметров и столбцов:
+ *
+ *     using AuthorsByName = Query<"authors.by_name", "SELECT id, name, version FROM authors WHERE name = $1;",
+ *                                 Params<std::string>, Columns<domain::AuthorId, std::string, int>>;
+ *
+ * Name - имя подготовленного запроса на соединении и метрики его задержки.
+ * Число параметров $N и столбцов простого SELECT сверяется при компиляции, типы аргументов -
+ * при вызове Exec, и они должны совпадать с Params в точности. Столбцы разбираются из string_view прямо в типы из Columns, без промежуточных строк.
+ */
+template <FixedString Name, FixedString Sql, typename... P, typename... C>
+class Query<Name, Sql, Params<P...>, Columns<C...>> {
+    static_assert(detail::CountPlaceholders(Sql.View()) == sizeof...(P),
+                  "Number of $N placeholders does not match Params<>");
+    static_assert(detail::CountSelectColumns(Sql.View()) == 0 || detail::CountSelectColumns(Sql.View()) == sizeof...(C),
+                  "Number of selected columns does not match Columns<>");
+
+public:
+    static constexpr std::string_view NAME = Name.View();
+    static constexpr std::string_view SQL = Sql.View();
+
+    static void Prepare(pqxx::connection& connection) {
+        connection.prepare(pqxx::zview(NAME.data(), NAME.size()), pqxx::zview(SQL.data(), SQL.size()));
+    }
+
+    template <typename... Args>
+    static pqxx::result Exec(pqxx::work& worker, const Args&... args) {
+        static_assert(sizeof...(Args) == sizeof...(P), "Wrong number of query arguments");
+        // Точное совпадение типов: при неявном преобразовании Encode вернул бы ссылку на временный объект,
+        // уничтоженный до выполнения запроса
+        static_assert((std::is_same_v<std::remove_cvref_t<Args>, P> && ...), "Query argument has a wrong type");
+        static auto& latency = metrics::Latency(metrics::Scope::STATEMENT, NAME);
+        const std::tuple<decltype(detail::ParamTraits<P>::Encode(std::declval<const P&>()))...> encoded{
+            detail::ParamTraits<P>::Encode(args)...};
+        return std::apply([&](const auto&... values) {
+            return ExecPrepared(worker, latency, pqxx::zview(NAME.data(), NAME.size()),
+                                pqxx::zview(SQL.data(), SQL.size()), detail::AsParam(values)...);
+        }, encoded);
+    }
+
+    // Вызывает make(C...) для каждой строки результата
+    template <typename Make>
+    static void ForEachRow(const pqxx::result& result, Make&& make) {
+        static_assert(std::is_invocable_v<Make&, C...>, "Row handler does not accept Columns<>");
+        CheckColumns(result);
+        for (const auto& row : result) {
+            DecodeRow(row, make, std::index_sequence_for<C...>{});
+        }
+    }
+
+    // Строит по объекту на строку; T(C...) или make(C...)
+    template <typename T, typename Make>
+    static std::vector<T> Collect(const pqxx::result& result, Make&& make) {
+        std::vector<T> list;
+        list.reserve(result.size());
+        ForEachRow(result, [&](C... columns) {
+            list.push_back(make(std::move(columns)...));
+        });
+        return list;
+    }
+
+    template <typename T>
+    static std::vector<T> Collect(const pqxx::result& result) {
+        static_assert(std::is_constructible_v<T, C...>, "Type is not constructible from Columns<>");
+        return Collect<T>(result, [](C... columns) {
+            return T(std::move(columns)...);
+        });
+    }
+
+    // Единственное значение первой строки; запрос должен вернуть ровно одну строку
+    static auto Value(const pqxx::result& result) {
+        static_assert(sizeof...(C) == 1, "Value() needs a single column");
+        CheckColumns(result);
+        if (result.size() != 1) {
+            throw std::runtime_error("Query " + std::string(NAME) + " returned " + std::to_string(result.size())
+                                     + " rows instead of one");
+        }
+        return detail::ColumnTraits<C...>::Decode(result[0][0].view());
+    }
+
+private:
+    static void CheckColumns(const pqxx::result& result) {
+        if (result.columns() != static_cast<int>(sizeof...(C))) {
+            throw std::runtime_error("Query " + std::string(NAME) + " returned " + std::to_string(result.columns())
+                                     + " columns, expected " + std::to_string(sizeof...(C)));
+        }
+    }
+
+    template <typename Make, size_t... I>
+    static void DecodeRow(const pqxx::row& row, Make& make, std::index_sequence<I...>) {
+        make(detail::ColumnTraits<C>::Decode(row[static_cast<pqxx::row::size_type>(I)].view())...);
+    }
+};
+
+// Подготавливает все запросы списка на соединении
+template <typename... Queries>
+void PrepareQueries(pqxx::connection& connection) {
+    (Queries::Prepare(connection), ...);
+}
+
+}  // namespace postgres
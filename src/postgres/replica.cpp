@@ -0,0 +1,664 @@
+#include "replica.h"
+
+#include <algorithm>
+#include <pqxx/pqxx>
+#include <tuple>
+
+#include "statement.h"
+
+namespace postgres {
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+namespace {
+
+metrics::LatencyMetric& ReplicaLatency(std::string_view name) {
+    return metrics::Latency(metrics::Scope::STATEMENT, name);
+}
+
+// Порядок books.list: title, name, publication_year
+bool BookLess(const domain::Book& lhs, const domain::Book& rhs) {
+    return std::forward_as_tuple(lhs.GetTitle(), lhs.GetAuthorName(), lhs.GetYear())
+         < std::forward_as_tuple(rhs.GetTitle(), rhs.GetAuthorName(), rhs.GetYear());
+}
+
+template <typename Index>
+void EraseFromIndex(Index& index, const std::string& key, const std::string& id) {
+    if (auto it = index.find(key); it != index.end()) {
+        it->second.erase(id);
+        if (it->second.empty()) {
+            index.erase(it);
+        }
+    }
+}
+
+}  // namespace
+
+void CatalogState::PutAuthor(const domain::Author& author) {
+    auto id = author.GetId().ToString();
+    if (auto it = authors_.find(id); it != authors_.end()) {
+        // Имя могло уже перейти к другому автору из той же пачки изменений
+        if (auto name = author_by_name_.find(it->second.GetName()); name != author_by_name_.end() && name->second == id) {
+            author_by_name_.erase(name);
+        }
+    }
+    author_by_name_.insert_or_assign(author.GetName(), id);
+    authors_.insert_or_assign(std::move(id), author);
+}
+
+void CatalogState::EraseAuthor(const std::string& author_id) {
+    auto it = authors_.find(author_id);
+    if (it == authors_.end()) {
+        return;
+    }
+    if (auto name = author_by_name_.find(it->second.GetName()); name != author_by_name_.end() && name->second == author_id) {
+        author_by_name_.erase(name);
+    }
+    authors_.erase(it);
+    if (auto books = books_by_author_.find(author_id); books != books_by_author_.end()) {
+        auto book_ids = std::move(books->second);
+        books_by_author_.erase(books);
+        for (const auto& book_id : book_ids) {
+            EraseBook(book_id);
+        }
+    }
+}
+
+void CatalogState::PutBook(const domain::Book& book) {
+    auto id = book.GetId().ToString();
+    if (auto it = books_.find(id); it != books_.end()) {
+        EraseFromIndex(books_by_author_, it->second.author_id, id);
+        EraseFromIndex(books_by_title_, it->second.title, id);
+    }
+    BookRow row{book.GetId(), book.GetAuthorId().ToString(), book.GetTitle(), book.GetYear(), book.GetVersion()};
+    books_by_author_[row.author_id].insert(id);
+    books_by_title_[row.title].insert(id);
+    books_.insert_or_assign(std::move(id), std::move(row));
+}
+
+void CatalogState::EraseBook(const std::string& book_id) {
+    auto it = books_.find(book_id);
+    if (it == books_.end()) {
+        return;
+    }
+    EraseFromIndex(books_by_author_, it->second.author_id, book_id);
+    EraseFromIndex(books_by_title_, it->second.title, book_id);
+    tags_.erase(book_id);
+    books_.erase(it);
+}
+
+void CatalogState::SetTags(const std::string& book_id, std::vector<std::string> tags) {
+    if (tags.empty()) {
+        tags_.erase(book_id);
+        return;
+    }
+    std::sort(tags.begin(), tags.end());
+    tags_.insert_or_assign(book_id, std::move(tags));
+}
+
+CatalogState::list_authors_t CatalogState::GetAuthors() const {
+    list_authors_t authors;
+    authors.reserve(authors_.size());
+    for (const auto& [id, author] : authors_) {
+        authors.push_back(author);
+    }
+    std::sort(authors.begin(), authors.end(), [](const domain::Author& lhs, const domain::Author& rhs) {
+        return lhs.GetName() < rhs.GetName();
+    });
+    return authors;
+}
+
+std::optional<domain::Author> CatalogState::FindAuthorByName(const std::string& name) const {
+    if (auto it = author_by_name_.find(name); it != author_by_name_.end()) {
+        return authors_.at(it->second);
+    }
+    return std::nullopt;
+}
+
+domain::Book CatalogState::MakeBook(const BookRow& row) const {
+    if (auto author = authors_.find(row.author_id); author != authors_.end()) {
+        return domain::Book(row.id, author->second, row.title, row.year, row.version);
+    }
+    return domain::Book(row.id, {domain::AuthorId::FromString(row.author_id), ""}, row.title, row.year, row.version);
+}
+
+CatalogState::list_books_t CatalogState::MakeBooks(const std::set<std::string>& ids) const {
+    list_books_t books;
+    books.reserve(ids.size());
+    for (const auto& id : ids) {
+        books.push_back(MakeBook(books_.at(id)));
+    }
+    return books;
+}
+
+CatalogState::list_books_t CatalogState::GetBooks() const {
+    list_books_t books;
+    books.reserve(books_.size());
+    for (const auto& [id, row] : books_) {
+        books.push_back(MakeBook(row));
+    }
+    std::sort(books.begin(), books.end(), BookLess);
+    return books;
+}
+
+CatalogState::list_books_t CatalogState::GetBooksByAuthor(const std::string& author_id) const {
+    auto it = books_by_author_.find(author_id);
+    if (it == books_by_author_.end()) {
+        return {};
+    }
+    auto books = MakeBooks(it->second);
+    // Порядок books.by_author: publication_year, title
+    std::sort(books.begin(), books.end(), [](const domain::Book& lhs, const domain::Book& rhs) {
+        return std::forward_as_tuple(lhs.GetYear(), lhs.GetTitle()) < std::forward_as_tuple(rhs.GetYear(), rhs.GetTitle());
+    });
+    return books;
+}
+
+CatalogState::list_books_t CatalogState::GetBooksByTitle(const std::string& title) const {
+    auto it = books_by_title_.find(title);
+    if (it == books_by_title_.end()) {
+        return {};
+    }
+    auto books = MakeBooks(it->second);
+    // Порядок books.by_title: name, publication_year
+    std::sort(books.begin(), books.end(), [](const domain::Book& lhs, const domain::Book& rhs) {
+        return std::forward_as_tuple(lhs.GetAuthorName(), lhs.GetYear()) < std::forward_as_tuple(rhs.GetAuthorName(), rhs.GetYear());
+    });
+    return books;
+}
+
+CatalogState::list_books_t CatalogState::GetBooksByYearRange(const domain::YearRangeQuery& query) const {
+    list_books_t books;
+    const auto collect = [this, &query, &books](const BookRow& row) {
+        if (row.year >= query.from_year && row.year <= query.to_year) {
+            books.push_back(MakeBook(row));
+        }
+    };
+    if (query.author_id) {
+        if (auto it = books_by_author_.find(query.author_id->ToString()); it != books_by_author_.end()) {
+            for (const auto& id : it->second) {
+                collect(books_.at(id));
+            }
+        }
+    } else {
+        for (const auto& [id, row] : books_) {
+            collect(row);
+        }
+    }
+    return domain::BookRepository::SelectYearRange(std::move(books), query);
+}
+
+CatalogState::list_tags_t CatalogState::GetTags(const domain::BookId& book_id) const {
+    list_tags_t tags;
+    if (auto it = tags_.find(book_id.ToString()); it != tags_.end()) {
+        tags.reserve(it->second.size());
+        for (const auto& name : it->second) {
+            tags.push_back({book_id, name});
+        }
+    }
+    return tags;
+}
+
+class CatalogReplica::Receiver : public pqxx::notification_receiver {
+public:
+    Receiver(pqxx::connection& connection, CatalogReplica& replica)
+        : pqxx::notification_receiver(connection, CHANGE_FEED_CHANNEL)
+        , replica_{replica} {
+    }
+
+    void operator()(const std::string& payload, int) override {
+        if (auto event = ParseChangeEvent(payload)) {
+            replica_.pending_.push_back(std::move(*event));
+        } else {
+            replica_.broken_feed_ = true;
+        }
+    }
+
+private:
+    CatalogReplica& replica_;
+};
+
+CatalogReplica::CatalogReplica(std::string url, ReplicaConfig config)
+    : url_{std::move(url)}
+    , config_{config}
+    , thread_{[this] { Run(); }} {
+}
+
+CatalogReplica::~CatalogReplica() {
+    {
+        std::lock_guard lock{wait_mutex_};
+        stopping_ = true;
+    }
+    applied_.notify_all();
+    thread_.join();
+}
+
+bool CatalogReplica::IsFresh() const noexcept {
+    if (!connected_.load()) {
+        return false;
+    }
+    const auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+    return std::chrono::steady_clock::duration(now - last_contact_.load()) <= config_.max_staleness;
+}
+
+void CatalogReplica::RequireSeq(uint64_t seq) {
+    auto required = required_seq_.load();
+    while (required < seq && !required_seq_.compare_exchange_weak(required, seq)) {
+    }
+}
+
+bool CatalogReplica::WaitUpToDate() const {
+    if (!IsFresh()) {
+        return false;
+    }
+    const auto required = required_seq_.load();
+    if (applied_seq_.load() >= required) {
+        return true;
+    }
+    static auto& latency = ReplicaLatency("replica.wait"sv);
+    metrics::ScopedTimer timer{latency};
+    std::unique_lock lock{wait_mutex_};
+    return applied_.wait_for(lock, config_.max_staleness, [this, required] {
+        return applied_seq_.load() >= required;
+    });
+}
+
+void CatalogReplica::Touch() noexcept {
+    last_contact_ = std::chrono::steady_clock::now().time_since_epoch().count();
+    connected_ = true;
+}
+
+void CatalogReplica::Run() {
+    static auto& reconnects = metrics::GetCounter("replica_reconnects");
+    std::unique_lock lock{wait_mutex_};
+    while (!stopping_) {
+        lock.unlock();
+        try {
+            pqxx::connection connection{url_};
+            Listen(connection);
+        } catch (const std::exception&) {
+            // Пока соединения нет, чтения идут в базу
+            connected_ = false;
+            reconnects.Increment();
+        }
+        lock.lock();
+        applied_.wait_for(lock, config_.poll_interval * 10, [this] {
+            return stopping_;
+        });
+    }
+}
+
+void CatalogReplica::Listen(pqxx::connection& connection) {
+    // LISTEN раньше снимка: всё, что закоммитят после снимка, придёт уведомлением
+    Receiver receiver{connection, *this};
+    Resync(connection);
+    const auto poll = std::chrono::duration_cast<std::chrono::microseconds>(config_.poll_interval).count();
+    while (true) {
+        {
+            std::lock_guard lock{wait_mutex_};
+            if (stopping_) {
+                return;
+            }
+        }
+        connection.await_notification(poll / 1'000'000, poll % 1'000'000);
+        if (broken_feed_ || !ApplyPending(connection)) {
+            Resync(connection);
+        }
+        Touch();
+    }
+}
+
+void CatalogReplica::Resync(pqxx::connection& connection) {
+    static auto& latency = ReplicaLatency("replica.resync"sv);
+    static auto& resyncs = metrics::GetCounter("replica_resyncs");
+    metrics::ScopedTimer timer{latency};
+
+    CatalogState state;
+    pqxx::work work{connection};
+    // Снимок и номер последней транзакции ленты должны быть согласованы
+    work.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ;"_zv);
+    const auto seq = work.query_value<int64_t>("SELECT last_seq FROM catalog_feed;"_zv);
+    for (auto [id, name, version] : work.stream<std::string_view, std::string_view, int>("SELECT id, name, version FROM authors"sv)) {
+        state.PutAuthor(domain::Author(domain::AuthorId::FromString(id), std::string(name), version));
+    }
+    for (auto [id, author_id, title, year, version] : work.stream<std::string_view, std::string_view, std::string_view, int, int>(
+             "SELECT id, author_id, title, publication_year, version FROM books"sv)) {
+        state.PutBook(domain::Book(domain::BookId::FromString(id), {domain::AuthorId::FromString(author_id), ""},
+                                   std::string(title), year, version));
+    }
+    std::unordered_map<std::string, std::vector<std::string>> tags;
+    for (auto [book_id, name] : work.stream<std::string_view, std::string_view>(
+             "SELECT book_id, tags.name FROM book_tags INNER JOIN tags ON tags.id = book_tags.tag_id"sv)) {
+        tags[std::string(book_id)].emplace_back(name);
+    }
+    for (auto& [book_id, names] : tags) {
+        state.SetTags(book_id, std::move(names));
+    }
+    work.commit();
+
+    // Всё, что пришло до снимка, в нём уже учтено
+    pending_.clear();
+    broken_feed_ = false;
+    sequence_.Reset(static_cast<uint64_t>(seq));
+    {
+        std::unique_lock lock{mutex_};
+        state_ = std::move(state);
+    }
+    {
+        std::lock_guard lock{wait_mutex_};
+        applied_seq_ = sequence_.Seq();
+    }
+    applied_.notify_all();
+    resyncs.Increment();
+}
+
+bool CatalogReplica::ApplyPending(pqxx::connection& connection) {
+    if (pending_.empty()) {
+        return true;
+    }
+    static auto& latency = ReplicaLatency("replica.apply"sv);
+    static auto& events = metrics::GetCounter("replica_events");
+    metrics::ScopedTimer timer{latency};
+
+    std::set<std::string> author_ids;
+    std::set<std::string> book_ids;
+    std::set<std::string> tagged_ids;
+    for (const auto& event : pending_) {
+        switch (sequence_.Accept(event.seq)) {
+            case ChangeSequence::Position::APPLIED:
+                continue;
+            case ChangeSequence::Position::GAP:
+                return false;
+            case ChangeSequence::Position::NEXT:
+                break;
+        }
+        switch (event.table) {
+            case ChangeTable::AUTHORS:
+                author_ids.insert(event.id);
+                break;
+            case ChangeTable::BOOKS:
+                book_ids.insert(event.id);
+                break;
+            case ChangeTable::BOOK_TAGS:
+                tagged_ids.insert(event.id);
+                break;
+        }
+    }
+    events.Increment(pending_.size());
+    pending_.clear();
+
+    // Перечитываем строки целиком: уведомление несёт только id, а состояние может быть и новее его
+    static auto& authors_latency = ReplicaLatency("replica.authors.fetch"sv);
+    static auto& books_latency = ReplicaLatency("replica.books.fetch"sv);
+    static auto& tags_latency = ReplicaLatency("replica.book_tags.fetch"sv);
+    pqxx::work work{connection};
+    work.exec("SET TRANSACTION ISOLATION LEVEL REPEATABLE READ;"_zv);
+    std::unordered_map<std::string, domain::Author> authors;
+    if (!author_ids.empty()) {
+        auto result = ExecStatement(work, authors_latency, "SELECT id, name, version FROM authors WHERE id = ANY($1::uuid[]);"_zv,
+                                    std::vector<std::string>(author_ids.begin(), author_ids.end()));
+        for (const auto& row : result) {
+            auto [id, name, version] = row.as<std::string, std::string, int>();
+            authors.emplace(id, domain::Author(domain::AuthorId::FromString(id), name, version));
+        }
+    }
+    std::unordered_map<std::string, domain::Book> books;
+    if (!book_ids.empty()) {
+        auto result = ExecStatement(work, books_latency,
+            "SELECT id, author_id, title, publication_year, version FROM books WHERE id = ANY($1::uuid[]);"_zv,
+            std::vector<std::string>(book_ids.begin(), book_ids.end()));
+        for (const auto& row : result) {
+            auto [id, author_id, title, year, version] = row.as<std::string, std::string, std::string, int, int>();
+            books.emplace(id, domain::Book(domain::BookId::FromString(id), {domain::AuthorId::FromString(author_id), ""}, title, year, version));
+        }
+    }
+    std::unordered_map<std::string, std::vector<std::string>> tags;
+    if (!tagged_ids.empty()) {
+        auto result = ExecStatement(work, tags_latency,
+            R"(SELECT book_id, tags.name FROM book_tags INNER JOIN tags ON tags.id = book_tags.tag_id
+               WHERE book_id = ANY($1::uuid[]);)"_zv,
+            std::vector<std::string>(tagged_ids.begin(), tagged_ids.end()));
+        for (const auto& row : result) {
+            auto [book_id, name] = row.as<std::string, std::string>();
+            tags[book_id].push_back(std::move(name));
+        }
+    }
+    work.commit();
+
+    {
+        std::unique_lock lock{mutex_};
+        for (const auto& id : author_ids) {
+            if (auto it = authors.find(id); it != authors.end()) {
+                state_.PutAuthor(it->second);
+            } else {
+                state_.EraseAuthor(id);
+            }
+        }
+        for (const auto& id : book_ids) {
+            if (auto it = books.find(id); it != books.end()) {
+                state_.PutBook(it->second);
+            } else {
+                state_.EraseBook(id);
+            }
+        }
+        for (const auto& id : tagged_ids) {
+            auto it = tags.find(id);
+            state_.SetTags(id, it != tags.end() ? std::move(it->second) : std::vector<std::string>{});
+        }
+    }
+    {
+        std::lock_guard lock{wait_mutex_};
+        applied_seq_ = sequence_.Seq();
+    }
+    applied_.notify_all();
+    return true;
+}
+
+UnitOfWorkImpl& ReplicaUnitOfWork::Primary() {
+    if (!primary_) {
+        primary_.emplace(db_.GetConnection(), db_.GetTagCache());
+        if (in_savepoint_) {
+            primary_->BeginSavepoint();
+        }
+        if (deadline_) {
+            primary_->SetDeadline(*deadline_);
+        }
+    }
+    return *primary_;
+}
+
+void ReplicaUnitOfWork::Commit() {
+    if (!primary_) {
+        return;
+    }
+    const auto seq = wrote_ ? primary_->FlushChangeFeed() : 0;
+    primary_->Commit();
+    if (seq != 0) {
+        replica_.RequireSeq(seq);
+    }
+}
+
+void ReplicaUnitOfWork::BeginSavepoint() {
+    in_savepoint_ = true;
+    if (primary_) {
+        primary_->BeginSavepoint();
+    }
+}
+
+void ReplicaUnitOfWork::RollbackToSavepoint() {
+    if (primary_) {
+        primary_->RollbackToSavepoint();
+    }
+}
+
+void ReplicaUnitOfWork::ReleaseSavepoint() {
+    in_savepoint_ = false;
+    if (primary_) {
+        primary_->ReleaseSavepoint();
+    }
+}
+
+void ReplicaUnitOfWork::SetDeadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+    if (primary_) {
+        primary_->SetDeadline(deadline);
+    }
+}
+
+void ReplicaUnitOfWork::ClearDeadline() noexcept {
+    deadline_.reset();
+    if (primary_) {
+        primary_->ClearDeadline();
+    }
+}
+
+void ReplicaAuthorRepository::DeleteAuthorAndDependencies(const domain::Author& author) {
+    unit_.Write().Authors().DeleteAuthorAndDependencies(author);
+}
+
+void ReplicaAuthorRepository::Save(const domain::Author& author) {
+    unit_.Write().Authors().Save(author);
+}
+
+domain::AuthorRepository::list_authors_t ReplicaAuthorRepository::GetList() {
+    return unit_.ReadThrough(
+        [](const CatalogState& state) {
+            return state.GetAuthors();
+        },
+        [](UnitOfWorkImpl& primary) {
+            return primary.Authors().GetList();
+        });
+}
+
+std::optional<domain::Author> ReplicaAuthorRepository::FindAuthorByName(const std::string& name) {
+    return unit_.ReadThrough(
+        [&name](const CatalogState& state) {
+            return state.FindAuthorByName(name);
+        },
+        [&name](UnitOfWorkImpl& primary) {
+            return primary.Authors().FindAuthorByName(name);
+        });
+}
+
+void ReplicaAuthorRepository::ForEach(const std::function<void(const domain::Author&)>& visitor) {
+    // Из базы - потоком, из реплики - копией, чтобы не держать блокировку во время обхода
+    auto authors = unit_.ReadThrough(
+        [](const CatalogState& state) {
+            return std::optional{state.GetAuthors()};
+        },
+        [&visitor](UnitOfWorkImpl& primary) {
+            primary.Authors().ForEach(visitor);
+            return std::optional<list_authors_t>{};
+        });
+    if (authors) {
+        for (const auto& author : *authors) {
+            visitor(author);
+        }
+    }
+}
+
+void ReplicaBookRepository::Delete(const domain::BookId& book_id) {
+    unit_.Write().Books().Delete(book_id);
+}
+
+void ReplicaBookRepository::Edit(const domain::Book& book) {
+    unit_.Write().Books().Edit(book);
+}
+
+void ReplicaBookRepository::Save(const domain::Book& book) {
+    unit_.Write().Books().Save(book);
+}
+
+domain::BookRepository::list_books_t ReplicaBookRepository::GetList() {
+    return unit_.ReadThrough(
+        [](const CatalogState& state) {
+            return state.GetBooks();
+        },
+        [](UnitOfWorkImpl& primary) {
+            return primary.Books().GetList();
+        });
+}
+
+domain::BookRepository::list_books_t ReplicaBookRepository::GetBookByAuthorId(const domain::AuthorId& author_id) {
+    return unit_.ReadThrough(
+        [&author_id](const CatalogState& state) {
+            return state.GetBooksByAuthor(author_id.ToString());
+        },
+        [&author_id](UnitOfWorkImpl& primary) {
+            return primary.Books().GetBookByAuthorId(author_id);
+        });
+}
+
+domain::BookRepository::list_books_t ReplicaBookRepository::GetBooksByTitle(const std::string& title) {
+    return unit_.ReadThrough(
+        [&title](const CatalogState& state) {
+            return state.GetBooksByTitle(title);
+        },
+        [&title](UnitOfWorkImpl& primary) {
+            return primary.Books().GetBooksByTitle(title);
+        });
+}
+
+domain::BookRepository::list_books_t ReplicaBookRepository::GetBooksByYearRange(const domain::YearRangeQuery& query) {
+    return unit_.ReadThrough(
+        [&query](const CatalogState& state) {
+            return state.GetBooksByYearRange(query);
+        },
+        [&query](UnitOfWorkImpl& primary) {
+            return primary.Books().GetBooksByYearRange(query);
+        });
+}
+
+void ReplicaBookRepository::ForEach(const std::function<void(const domain::Book&)>& visitor) {
+    auto books = unit_.ReadThrough(
+        [](const CatalogState& state) {
+            return std::optional{state.GetBooks()};
+        },
+        [&visitor](UnitOfWorkImpl& primary) {
+            primary.Books().ForEach(visitor);
+            return std::optional<list_books_t>{};
+        });
+    if (books) {
+        for (const auto& book : *books) {
+            visitor(book);
+        }
+    }
+}
+
+void ReplicaTagRepository::ClearTagsByBookId(const domain::BookId& book_id) {
+    unit_.Write().Tags().ClearTagsByBookId(book_id);
+}
+
+void ReplicaTagRepository::Save(const domain::Tag& tag) {
+    unit_.Write().Tags().Save(tag);
+}
+
+domain::TagRepository::list_tags_t ReplicaTagRepository::GetTagsByBookId(const domain::BookId& book_id) {
+    return unit_.ReadThrough(
+        [&book_id](const CatalogState& state) {
+            return state.GetTags(book_id);
+        },
+        [&book_id](UnitOfWorkImpl& primary) {
+            return primary.Tags().GetTagsByBookId(book_id);
+        });
+}
+
+bool ReplicaTagRepository::SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) {
+    return unit_.Write().Tags().SyncBookTags(book, tags);
+}
+
+void ReplicaTagRepository::ForEach(const std::function<void(const domain::Tag&)>& visitor) {
+    // Полная выгрузка тегов нужна только экспорту, реплика её не держит
+    unit_.Primary().Tags().ForEach(visitor);
+}
+
+ReplicatedUnitOfWorkFactory::ReplicatedUnitOfWorkFactory(const std::string& url, const ReplicaConfig& config)
+    : db_{Connect(url)} {
+    pqxx::work work{db_.GetConnection()};
+    InstallChangeFeed(work);
+    work.commit();
+    replica_ = std::make_unique<CatalogReplica>(url, config);
+}
+
+}  // namespace postgres
@@ -0,0 +1,286 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../unit/unit_of_work_factory.h"
+#include "change_feed.h"
+#include "postgres.h"
+#include "unit_of_work_impl.h"
+
+namespace postgres {
+
+/**
+ * Копия каталога в памяти. Списки отдаются в том же порядке, что и запросы репозиториев Postgres.
+ * Потокобезопасность обеспечивает CatalogReplica.
+ */
+class CatalogState {
+public:
+    using list_authors_t = domain::AuthorRepository::list_authors_t;
+    using list_books_t = domain::BookRepository::list_books_t;
+    using list_tags_t = domain::TagRepository::list_tags_t;
+
+    void PutAuthor(const domain::Author& author);
+    // Вместе с книгами автора, как ON DELETE CASCADE
+    void EraseAuthor(const std::string& author_id);
+    // Имя автора в книге не хранится, берётся из авторов при чтении
+    void PutBook(const domain::Book& book);
+    void EraseBook(const std::string& book_id);
+    void SetTags(const std::string& book_id, std::vector<std::string> tags);
+
+    list_authors_t GetAuthors() const;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) const;
+    list_books_t GetBooks() const;
+    list_books_t GetBooksByAuthor(const std::string& author_id) const;
+    list_books_t GetBooksByTitle(const std::string& title) const;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) const;
+    list_tags_t GetTags(const domain::BookId& book_id) const;
+
+    size_t AuthorCount() const noexcept {
+        return authors_.size();
+    }
+    size_t BookCount() const noexcept {
+        return books_.size();
+    }
+
+private:
+    struct BookRow {
+        domain::BookId id;
+        std::string author_id;
+        std::string title;
+        int year = 0;
+        int version = 0;
+    };
+
+    domain::Book MakeBook(const BookRow& row) const;
+    list_books_t MakeBooks(const std::set<std::string>& ids) const;
+
+    std::unordered_map<std::string, domain::Author> authors_;
+    std::unordered_map<std::string, std::string> author_by_name_;
+    std::unordered_map<std::string, BookRow> books_;
+    std::unordered_map<std::string, std::set<std::string>> books_by_author_;
+    std::map<std::string, std::set<std::string>> books_by_title_;
+    std::unordered_map<std::string, std::vector<std::string>> tags_;
+};
+
+/**
+ * Локальная копия каталога, которую поддерживает в актуальном состоянии лента изменений.
+ * Поток слушателя подписывается на CHANGE_FEED_CHANNEL, затем загружает снимок в транзакции
+ * REPEATABLE READ вместе с номером последней транзакции ленты, и дальше применяет уведомления:
+ * перечитывает изменённые строки по id. Пропуск номера или непонятное уведомление -
+ * полная пересинхронизация, обрыв соединения - переподключение и пересинхронизация.
+ */
+class CatalogReplica {
+public:
+    CatalogReplica(std::string url, ReplicaConfig config);
+    ~CatalogReplica();
+
+    CatalogReplica(const CatalogReplica&) = delete;
+    CatalogReplica& operator=(const CatalogReplica&) = delete;
+
+    // Связь с базой подтверждена не раньше max_staleness назад
+    bool IsFresh() const noexcept;
+    uint64_t AppliedSeq() const noexcept {
+        return applied_seq_.load();
+    }
+    // Следующие чтения должны видеть транзакцию seq (коммит этого сеанса)
+    void RequireSeq(uint64_t seq);
+
+    // Выполняет fn над копией под разделяемой блокировкой.
+    // std::nullopt, если копия устарела или не догнала RequireSeq за max_staleness
+    template <typename Fn>
+    auto Read(const Fn& fn) const -> std::optional<std::invoke_result_t<const Fn&, const CatalogState&>> {
+        if (!WaitUpToDate()) {
+            return std::nullopt;
+        }
+        std::shared_lock lock{mutex_};
+        return fn(state_);
+    }
+
+private:
+    class Receiver;
+
+    bool WaitUpToDate() const;
+    void Run();
+    void Listen(pqxx::connection& connection);
+    void Resync(pqxx::connection& connection);
+    // false - в ленте пропуск
+    bool ApplyPending(pqxx::connection& connection);
+    void Touch() noexcept;
+
+    const std::string url_;
+    const ReplicaConfig config_;
+
+    mutable std::shared_mutex mutex_;
+    CatalogState state_;
+
+    // Только для потока слушателя
+    ChangeSequence sequence_;
+    std::vector<ChangeEvent> pending_;
+    bool broken_feed_ = false;
+
+    std::atomic<uint64_t> applied_seq_{0};
+    std::atomic<uint64_t> required_seq_{0};
+    std::atomic<bool> connected_{false};
+    std::atomic<std::chrono::steady_clock::rep> last_contact_{0};
+
+    mutable std::mutex wait_mutex_;
+    mutable std::condition_variable applied_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+class ReplicaUnitOfWork;
+
+class ReplicaAuthorRepository : public domain::AuthorRepository {
+public:
+    explicit ReplicaAuthorRepository(ReplicaUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void DeleteAuthorAndDependencies(const domain::Author& author) override;
+    void Save(const domain::Author& author) override;
+    list_authors_t GetList() override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+    void ForEach(const std::function<void(const domain::Author&)>& visitor) override;
+
+private:
+    ReplicaUnitOfWork& unit_;
+};
+
+class ReplicaBookRepository : public domain::BookRepository {
+public:
+    explicit ReplicaBookRepository(ReplicaUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void Delete(const domain::BookId& book_id) override;
+    void Edit(const domain::Book& book) override;
+    void Save(const domain::Book& book) override;
+    list_books_t GetList() override;
+    list_books_t GetBookByAuthorId(const domain::AuthorId& author_id) override;
+    list_books_t GetBooksByTitle(const std::string& title) override;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) override;
+    void ForEach(const std::function<void(const domain::Book&)>& visitor) override;
+
+private:
+    ReplicaUnitOfWork& unit_;
+};
+
+class ReplicaTagRepository : public domain::TagRepository {
+public:
+    explicit ReplicaTagRepository(ReplicaUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void ClearTagsByBookId(const domain::BookId& book_id) override;
+    void Save(const domain::Tag& tag) override;
+    list_tags_t GetTagsByBookId(const domain::BookId& book_id) override;
+    bool SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) override;
+    void ForEach(const std::function<void(const domain::Tag&)>& visitor) override;
+
+private:
+    ReplicaUnitOfWork& unit_;
+};
+
+/**
+ * Единица работы, которая читает из реплики, пока сама ничего не записала.
+ * Транзакция в базе открывается только при первой записи или при чтении мимо реплики.
+ * После коммита записи следующие чтения ждут, пока реплика не применит эту транзакцию.
+ */
+class ReplicaUnitOfWork : public app::UnitOfWork {
+public:
+    ReplicaUnitOfWork(Database& db, CatalogReplica& replica)
+        : db_{db}
+        , replica_{replica} {
+    }
+
+    void Commit() override;
+    void BeginSavepoint() override;
+    void RollbackToSavepoint() override;
+    void ReleaseSavepoint() override;
+    // Срок действует и на транзакцию в базе, открытую позже; чтения реплики его не ждут
+    void SetDeadline(std::chrono::steady_clock::time_point deadline) override;
+    void ClearDeadline() noexcept override;
+
+    ReplicaAuthorRepository& Authors() override {
+        return authors_;
+    }
+    ReplicaBookRepository& Books() override {
+        return books_;
+    }
+    ReplicaTagRepository& Tags() override {
+        return tags_;
+    }
+    // Счётчики и так читаются за O(1), реплика их не держит
+    StatsRepositoryImpl& Stats() override {
+        return Primary().Stats();
+    }
+
+    UnitOfWorkImpl& Primary();
+    UnitOfWorkImpl& Write() {
+        wrote_ = true;
+        return Primary();
+    }
+
+    // Чтение из реплики или, если она не годится, из базы
+    template <typename Local, typename Remote>
+    auto ReadThrough(const Local& local, const Remote& remote) -> std::invoke_result_t<const Remote&, UnitOfWorkImpl&> {
+        static auto& hits = metrics::GetCounter("replica_reads");
+        static auto& misses = metrics::GetCounter("replica_read_misses");
+        if (!wrote_) {
+            if (auto result = replica_.Read(local)) {
+                hits.Increment();
+                return std::move(*result);
+            }
+        }
+        misses.Increment();
+        return remote(Primary());
+    }
+
+private:
+    Database& db_;
+    CatalogReplica& replica_;
+    std::optional<UnitOfWorkImpl> primary_;
+    bool wrote_ = false;
+    bool in_savepoint_ = false;
+    std::optional<std::chrono::steady_clock::time_point> deadline_;
+
+    ReplicaAuthorRepository authors_{*this};
+    ReplicaBookRepository books_{*this};
+    ReplicaTagRepository tags_{*this};
+};
+
+class ReplicatedUnitOfWorkFactory : public app::UnitOfWorkFactory {
+public:
+    // Ставит в базу url триггеры ленты изменений и запускает слушателя реплики
+    ReplicatedUnitOfWorkFactory(const std::string& url, const ReplicaConfig& config);
+
+    Database& GetDatabase() noexcept {
+        return db_;
+    }
+    CatalogReplica& GetReplica() noexcept {
+        return *replica_;
+    }
+
+    std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+        return std::make_shared<ReplicaUnitOfWork>(db_, *replica_);
+    }
+
+private:
+    Database db_;
+    std::unique_ptr<CatalogReplica> replica_;
+};
+
+}  // namespace postgres
@@ -0,0 +1,119 @@
+#include "resharder.h"
+
+#include <pqxx/pqxx>
+#include <string>
+#include <vector>
+
+#include "../metrics/metrics.h"
+#include "statement.h"
+
+namespace postgres {
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+namespace {
+
+metrics::LatencyMetric& ReshardLatency(std::string_view name) {
+    return metrics::Latency(metrics::Scope::STATEMENT, name);
+}
+
+}  // namespace
+
+ReshardStats Resharder::Run(std::ostream& log) {
+    ReshardStats stats;
+    const auto shard_count = db_.ShardCount();
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        std::vector<std::string> ids;
+        {
+            pqxx::work read{db_.Shard(shard).GetConnection()};
+            for (auto [id] : read.stream<std::string_view>("SELECT id FROM authors"sv)) {
+                ids.emplace_back(id);
+            }
+            read.commit();
+        }
+
+        for (const auto& id : ids) {
+            ++stats.authors_checked;
+            const auto author_id = domain::AuthorId::FromString(id);
+            const auto target = ShardIndex(author_id, shard_count);
+            if (target == shard) {
+                continue;
+            }
+            try {
+                if (MoveAuthor(author_id, shard, target, stats)) {
+                    ++stats.authors_moved;
+                }
+            } catch (const std::exception& ex) {
+                ++stats.failures;
+                log << "Failed to move author "sv << id << " from shard "sv << shard << " to "sv << target
+                    << ": "sv << ex.what() << std::endl;
+            }
+        }
+        log << "Shard "sv << shard << " done: "sv << stats.authors_moved << " authors moved so far"sv << std::endl;
+    }
+    log << "Resharding finished: "sv << stats.authors_checked << " authors checked, "sv << stats.authors_moved
+        << " moved with "sv << stats.books_moved << " books, "sv << stats.failures << " failures"sv << std::endl;
+    return stats;
+}
+
+bool Resharder::MoveAuthor(const domain::AuthorId& author_id, size_t from, size_t to, ReshardStats& stats) {
+    static auto& lock_latency = ReshardLatency("reshard.lock_author"sv);
+    static auto& books_latency = ReshardLatency("reshard.books"sv);
+    static auto& tags_latency = ReshardLatency("reshard.book_tags"sv);
+    static auto& insert_author_latency = ReshardLatency("reshard.insert_author"sv);
+    static auto& insert_book_latency = ReshardLatency("reshard.insert_book"sv);
+    static auto& delete_latency = ReshardLatency("reshard.delete_author"sv);
+
+    const auto id = author_id.ToString();
+    auto& source_db = db_.Shard(from);
+    auto& target_db = db_.Shard(to);
+
+    // Копия должна совпасть с тем, что удалится каскадно, поэтому до коммита копии блокируется
+    // всё переносимое. Строка автора держит вставку его книг (внешний ключ), строки книг -
+    // их правку, удаление и вставку тегов (триггер book_tags проверяет книгу под блокировкой),
+    // строки book_tags - удаление тегов
+    pqxx::work source{source_db.GetConnection()};
+    auto author = ExecStatement(source, lock_latency,
+        "SELECT name, version FROM authors WHERE id = $1 FOR UPDATE;"_zv, id);
+    if (author.empty()) {
+        return false;
+    }
+    auto books = ExecStatement(source, books_latency,
+        "SELECT id, title, publication_year, version FROM books WHERE author_id = $1 FOR UPDATE;"_zv, id);
+    auto book_tags = ExecStatement(source, tags_latency,
+        R"(SELECT book_tags.book_id, tags.name FROM book_tags
+           INNER JOIN books ON books.id = book_tags.book_id
+           INNER JOIN tags ON tags.id = book_tags.tag_id
+           WHERE books.author_id = $1
+           FOR UPDATE OF book_tags;)"_zv, id);
+
+    pqxx::work target{target_db.GetConnection()};
+    TagRepositoryImpl target_tags{target, target_db.GetTagCache()};
+    auto [name, version] = author[0].as<std::string, int>();
+    // ON CONFLICT DO NOTHING - копия могла остаться от прерванного запуска
+    ExecStatement(target, insert_author_latency,
+        "INSERT INTO authors (id, name, version) VALUES ($1, $2, $3) ON CONFLICT (id) DO NOTHING;"_zv,
+        id, name, version);
+    for (const auto& row : books) {
+        auto [book_id, title, year, book_version] = row.as<std::string, std::string, int, int>();
+        ExecStatement(target, insert_book_latency,
+            R"(INSERT INTO books (id, author_id, title, publication_year, version) VALUES ($1, $2, $3, $4, $5)
+               ON CONFLICT DO NOTHING;)"_zv,
+            book_id, id, title, year, book_version);
+    }
+    for (const auto& row : book_tags) {
+        auto [book_id, tag] = row.as<std::string, std::string>();
+        target_tags.Save({domain::BookId::FromString(book_id), std::move(tag)});
+    }
+    target.commit();
+    target_tags.OnCommit();
+
+    // Книги и их теги удаляются каскадно
+    ExecStatement(source, delete_latency, "DELETE FROM authors WHERE id = $1;"_zv, id);
+    source.commit();
+    stats.books_moved += books.size();
+    return true;
+}
+
+}  // namespace postgres
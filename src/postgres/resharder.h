@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <ostream>
+
+#include "../domain/author.h"
+#include "sharding.h"
+
+namespace postgres {
+
+struct ReshardStats {
+    size_t authors_checked = 0;
+    size_t authors_moved = 0;
+    size_t books_moved = 0;
+    size_t failures = 0;
+};
+
+/**
+ * Переносит авторов (вместе с книгами и тегами) на шард, положенный им по текущему числу шардов.
+ * Каждый автор переезжает отдельно: строка автора на старом шарде блокируется, копия коммитится
+ * на новом шарде, затем автор удаляется со старого. Приложение в это время работает
+ * с BOOKYPEDIA_RESHARD_FROM и находит автора на любом из двух шардов.
+ * Повторный запуск после сбоя идемпотентен.
+ */
+class Resharder {
+public:
+    explicit Resharder(ShardedDatabase& db)
+        : db_{db} {
+    }
+
+    ReshardStats Run(std::ostream& log);
+
+private:
+    // false - автора успели удалить
+    bool MoveAuthor(const domain::AuthorId& author_id, size_t from, size_t to, ReshardStats& stats);
+
+    ShardedDatabase& db_;
+};
+
+}  // namespace postgres
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "../util/tagged_uuid.h"
+
+namespace postgres {
+
+/**
+ * Jump consistent hash (Lamping, Veach): номер корзины из [0, buckets).
+ * При росте числа корзин с n до n + 1 ключи переезжают только в новую корзину n,
+ * поэтому добавление шарда в конец списка двигает лишь ~1/(n + 1) авторов.
+ */
+inline int32_t JumpConsistentHash(uint64_t key, int32_t buckets) {
+    int64_t bucket = -1;
+    int64_t next = 0;
+    while (next < buckets) {
+        bucket = next;
+        key = key * 2862933555777941757ULL + 1;
+        next = static_cast<int64_t>((bucket + 1) * (static_cast<double>(1LL << 31) / static_cast<double>((key >> 33) + 1)));
+    }
+    return static_cast<int32_t>(bucket);
+}
+
+// Ключ шардирования - первые 8 байт UUID. Они случайные, перемешивать их не нужно
+template <typename Tag>
+uint64_t ShardKey(const util::TaggedUUID<Tag>& id) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < sizeof(key); ++i) {
+        key = (key << 8) | (*id).data[i];
+    }
+    return key;
+}
+
+template <typename Tag>
+size_t ShardIndex(const util::TaggedUUID<Tag>& id, size_t shard_count) {
+    return static_cast<size_t>(JumpConsistentHash(ShardKey(id), static_cast<int32_t>(shard_count)));
+}
+
+/**
+ * Слияние k списков, каждый из которых упорядочен по less, в один упорядоченный.
+ * При равных ключах раньше идут элементы списка с меньшим номером.
+ */
+template <typename T, typename Less>
+std::vector<T> MergeSorted(std::vector<std::vector<T>> lists, Less less) {
+    size_t total = 0;
+    for (const auto& list : lists) {
+        total += list.size();
+    }
+
+    // Вершина кучи - (номер списка, позиция в нём)
+    using Cursor = std::pair<size_t, size_t>;
+    auto greater = [&lists, &less](const Cursor& lhs, const Cursor& rhs) {
+        const auto& left = lists[lhs.first][lhs.second];
+        const auto& right = lists[rhs.first][rhs.second];
+        if (less(right, left)) {
+            return true;
+        }
+        return !less(left, right) && lhs.first > rhs.first;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap{greater};
+    for (size_t i = 0; i < lists.size(); ++i) {
+        if (!lists[i].empty()) {
+            heap.emplace(i, 0);
+        }
+    }
+
+    std::vector<T> merged;
+    merged.reserve(total);
+    while (!heap.empty()) {
+        auto [list, pos] = heap.top();
+        heap.pop();
+        merged.push_back(std::move(lists[list][pos]));
+        if (pos + 1 < lists[list].size()) {
+            heap.emplace(list, pos + 1);
+        }
+    }
+    return merged;
+}
+
+}  // namespace postgres
@@ -0,0 +1,497 @@
+#include "sharding.h"
+
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+
+#include "../domain/errors.h"
+
+namespace postgres {
+
+using namespace std::literals;
+
+namespace {
+
+bool AuthorLess(const domain::Author& lhs, const domain::Author& rhs) {
+    return lhs.GetName() < rhs.GetName();
+}
+
+// Порядок books.list: title, name, publication_year
+bool BookLess(const domain::Book& lhs, const domain::Book& rhs) {
+    return std::forward_as_tuple(lhs.GetTitle(), lhs.GetAuthorName(), lhs.GetYear())
+         < std::forward_as_tuple(rhs.GetTitle(), rhs.GetAuthorName(), rhs.GetYear());
+}
+
+// Во время переезда автор какое-то время виден на обоих шардах
+template <typename T>
+void DropDuplicates(std::vector<T>& items) {
+    std::unordered_set<std::string> seen;
+    std::erase_if(items, [&seen](const T& item) {
+        return !seen.insert(item.GetId().ToString()).second;
+    });
+}
+
+}  // namespace
+
+ShardWorker::ShardWorker()
+    : thread_{[this] { Run(); }} {
+}
+
+ShardWorker::~ShardWorker() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+std::future<void> ShardWorker::Post(std::function<void()> task) {
+    std::packaged_task<void()> packaged{std::move(task)};
+    auto result = packaged.get_future();
+    {
+        std::lock_guard lock{mutex_};
+        tasks_.push_back(std::move(packaged));
+    }
+    wake_.notify_one();
+    return result;
+}
+
+void ShardWorker::Run() {
+    std::unique_lock lock{mutex_};
+    while (true) {
+        wake_.wait(lock, [this] {
+            return stopping_ || !tasks_.empty();
+        });
+        if (tasks_.empty()) {
+            return;
+        }
+        auto task = std::move(tasks_.front());
+        tasks_.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+ShardedDatabase::ShardedDatabase(const std::vector<std::string>& urls, size_t previous_shard_count)
+    : previous_shard_count_{previous_shard_count} {
+    if (urls.empty()) {
+        throw std::invalid_argument("Sharded database needs at least one shard");
+    }
+    if (previous_shard_count > urls.size()) {
+        // Jump hash умеет только дописывать шарды в конец списка
+        throw std::invalid_argument("Resharding can only append shards: "s + std::to_string(previous_shard_count)
+                                    + " -> "s + std::to_string(urls.size()));
+    }
+    if (previous_shard_count == urls.size()) {
+        previous_shard_count_ = 0;
+    }
+    // Шарды подключаются и проверяют схему параллельно: запуск ждёт самый медленный, а не их сумму
+    std::vector<std::future<std::unique_ptr<Database>>> pending;
+    pending.reserve(urls.size());
+    for (const auto& url : urls) {
+        pending.push_back(std::async(std::launch::async, [&url] {
+            return std::make_unique<Database>(Connect(url));
+        }));
+    }
+    shards_.reserve(urls.size());
+    for (auto& shard : pending) {
+        shards_.push_back(shard.get());
+    }
+    workers_.reserve(urls.size() - 1);
+    for (size_t i = 1; i < urls.size(); ++i) {
+        workers_.push_back(std::make_unique<ShardWorker>());
+    }
+}
+
+UnitOfWorkImpl& ShardedUnitOfWork::Shard(size_t index) {
+    auto& shard = shards_.at(index);
+    if (!shard) {
+        auto& db = db_.Shard(index);
+        shard = std::make_unique<UnitOfWorkImpl>(db.GetConnection(), db.GetTagCache());
+        if (in_savepoint_) {
+            shard->BeginSavepoint();
+        }
+        if (deadline_) {
+            shard->SetDeadline(*deadline_);
+        }
+    }
+    return *shard;
+}
+
+size_t ShardedUnitOfWork::AuthorShard(const domain::AuthorId& author_id) {
+    const auto target = ShardIndex(author_id, shards_.size());
+    if (!IsResharding()) {
+        return target;
+    }
+    const auto previous = ShardIndex(author_id, db_.PreviousShardCount());
+    if (previous == target || Shard(target).Authors().Contains(author_id)) {
+        return target;
+    }
+    // Автор ещё не переехал. Новые авторы сразу создаются на своём шарде
+    return Shard(previous).Authors().Contains(author_id) ? previous : target;
+}
+
+std::optional<size_t> ShardedUnitOfWork::BookShard(const domain::BookId& book_id) {
+    for (const auto& [id, shard] : new_books_) {
+        if (id == book_id) {
+            return shard;
+        }
+    }
+    // Во время переезда книга может оказаться не там, где её запомнили
+    if (auto shard = db_.Books().Find(book_id); shard && !IsResharding()) {
+        return shard;
+    }
+    auto found = FanOut([&book_id](UnitOfWorkImpl& shard) {
+        return shard.Books().Contains(book_id);
+    });
+    for (size_t i = 0; i < found.size(); ++i) {
+        if (found[i]) {
+            db_.Books().Add(book_id, i);
+            return i;
+        }
+    }
+    return std::nullopt;
+}
+
+void ShardedUnitOfWork::RememberBooks(const domain::BookRepository::list_books_t& books, size_t shard) {
+    for (const auto& book : books) {
+        db_.Books().Add(book.GetId(), shard);
+    }
+}
+
+void ShardedUnitOfWork::RememberNewBook(const domain::BookId& book_id, size_t shard) {
+    new_books_.emplace_back(book_id, shard);
+}
+
+void ShardedUnitOfWork::Commit() {
+    // Двухфазного коммита нет: записи одной команды идут в один шард, а рассылаемые на все шарды
+    // удаления можно безопасно повторить. Пакет из нескольких команд в одной транзакции
+    // мог бы затронуть несколько шардов, поэтому с шардами приложение его не разрешает
+    std::vector<bool> committed(shards_.size());
+    try {
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            if (shards_[i]) {
+                shards_[i]->Commit();
+                committed[i] = true;
+            }
+        }
+    } catch (...) {
+        // Книги закоммиченных шардов уже в базе, и без записи в каталоге их не найти
+        for (const auto& [id, shard] : new_books_) {
+            if (committed[shard]) {
+                db_.Books().Add(id, shard);
+            }
+        }
+        new_books_.clear();
+        throw;
+    }
+    for (const auto& [id, shard] : new_books_) {
+        db_.Books().Add(id, shard);
+    }
+    new_books_.clear();
+}
+
+void ShardedUnitOfWork::BeginSavepoint() {
+    in_savepoint_ = true;
+    for (auto& shard : shards_) {
+        if (shard) {
+            shard->BeginSavepoint();
+        }
+    }
+}
+
+void ShardedUnitOfWork::RollbackToSavepoint() {
+    for (auto& shard : shards_) {
+        if (shard) {
+            shard->RollbackToSavepoint();
+        }
+    }
+}
+
+void ShardedUnitOfWork::ReleaseSavepoint() {
+    for (auto& shard : shards_) {
+        if (shard) {
+            shard->ReleaseSavepoint();
+        }
+    }
+    in_savepoint_ = false;
+}
+
+void ShardedUnitOfWork::SetDeadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+    for (auto& shard : shards_) {
+        if (shard) {
+            shard->SetDeadline(deadline);
+        }
+    }
+}
+
+void ShardedUnitOfWork::ClearDeadline() noexcept {
+    deadline_.reset();
+    for (auto& shard : shards_) {
+        if (shard) {
+            shard->ClearDeadline();
+        }
+    }
+}
+
+void ShardedAuthorRepository::DeleteAuthorAndDependencies(const domain::Author& author) {
+    if (!author.GetName().empty()) {
+        unit_.FanOut([&author](UnitOfWorkImpl& shard) {
+            shard.Authors().DeleteAuthorAndDependencies(author);
+            return true;
+        });
+        return;
+    }
+    unit_.Shard(unit_.AuthorShard(author.GetId())).Authors().DeleteAuthorAndDependencies(author);
+}
+
+void ShardedAuthorRepository::Save(const domain::Author& author) {
+    // Ограничение UNIQUE на имя действует только внутри шарда.
+    // Проверка не защищает от одновременной вставки одного имени на разные шарды
+    auto existing = FindAuthorByName(author.GetName());
+    if (existing && existing->GetId() != author.GetId()) {
+        throw std::invalid_argument("Author "s + author.GetName() + " already exists"s);
+    }
+    unit_.Shard(unit_.AuthorShard(author.GetId())).Authors().Save(author);
+}
+
+domain::AuthorRepository::list_authors_t ShardedAuthorRepository::GetList() {
+    auto lists = unit_.FanOut([](UnitOfWorkImpl& shard) {
+        return shard.Authors().GetList();
+    });
+    auto authors = MergeSorted(std::move(lists), AuthorLess);
+    if (unit_.IsResharding()) {
+        DropDuplicates(authors);
+    }
+    return authors;
+}
+
+std::optional<domain::Author> ShardedAuthorRepository::FindAuthorByName(const std::string& name) {
+    auto found = unit_.FanOut([&name](UnitOfWorkImpl& shard) {
+        return shard.Authors().FindAuthorByName(name);
+    });
+    for (auto& author : found) {
+        if (author) {
+            return std::move(author);
+        }
+    }
+    return std::nullopt;
+}
+
+void ShardedBookRepository::Delete(const domain::BookId& book_id) {
+    if (auto shard = unit_.BookShard(book_id)) {
+        unit_.Shard(*shard).Books().Delete(book_id);
+    }
+}
+
+void ShardedBookRepository::Edit(const domain::Book& book) {
+    auto shard = unit_.BookShard(book.GetId());
+    if (!shard) {
+        throw domain::VersionConflict("Book was changed or deleted by another session");
+    }
+    unit_.Shard(*shard).Books().Edit(book);
+}
+
+void ShardedBookRepository::Save(const domain::Book& book) {
+    const auto shard = unit_.AuthorShard(book.GetAuthorId());
+    unit_.Shard(shard).Books().Save(book);
+    unit_.RememberNewBook(book.GetId(), shard);
+}
+
+domain::BookRepository::list_books_t ShardedBookRepository::GetList() {
+    auto lists = unit_.FanOut([](UnitOfWorkImpl& shard) {
+        return shard.Books().GetList();
+    });
+    for (size_t i = 0; i < lists.size(); ++i) {
+        unit_.RememberBooks(lists[i], i);
+    }
+    auto books = MergeSorted(std::move(lists), BookLess);
+    if (unit_.IsResharding()) {
+        DropDuplicates(books);
+    }
+    return books;
+}
+
+domain::BookRepository::list_books_t ShardedBookRepository::GetBookByAuthorId(const domain::AuthorId& author_id) {
+    const auto shard = unit_.AuthorShard(author_id);
+    auto books = unit_.Shard(shard).Books().GetBookByAuthorId(author_id);
+    unit_.RememberBooks(books, shard);
+    return books;
+}
+
+domain::BookRepository::list_books_t ShardedBookRepository::GetBooksByTitle(const std::string& title) {
+    auto lists = unit_.FanOut([&title](UnitOfWorkImpl& shard) {
+        return shard.Books().GetBooksByTitle(title);
+    });
+    for (size_t i = 0; i < lists.size(); ++i) {
+        unit_.RememberBooks(lists[i], i);
+    }
+    auto books = MergeSorted(std::move(lists), BookLess);
+    if (unit_.IsResharding()) {
+        DropDuplicates(books);
+    }
+    return books;
+}
+
+domain::BookRepository::list_books_t ShardedBookRepository::GetBooksByYearRange(const domain::YearRangeQuery& query) {
+    if (query.author_id) {
+        const auto shard = unit_.AuthorShard(*query.author_id);
+        auto books = unit_.Shard(shard).Books().GetBooksByYearRange(query);
+        unit_.RememberBooks(books, shard);
+        return books;
+    }
+    // Каждый шард отдаёт свою страницу после того же ключа; из слияния берутся первые limit
+    auto lists = unit_.FanOut([&query](UnitOfWorkImpl& shard) {
+        return shard.Books().GetBooksByYearRange(query);
+    });
+    for (size_t i = 0; i < lists.size(); ++i) {
+        unit_.RememberBooks(lists[i], i);
+    }
+    auto books = MergeSorted(std::move(lists), [](const domain::Book& lhs, const domain::Book& rhs) {
+        return domain::BookKeyLess(lhs, rhs);
+    });
+    if (unit_.IsResharding()) {
+        DropDuplicates(books);
+    }
+    if (books.size() > query.limit) {
+        books.erase(books.begin() + static_cast<std::ptrdiff_t>(query.limit), books.end());
+    }
+    return books;
+}
+
+void ShardedTagRepository::ClearTagsByBookId(const domain::BookId& book_id) {
+    if (auto shard = unit_.BookShard(book_id)) {
+        unit_.Shard(*shard).Tags().ClearTagsByBookId(book_id);
+    }
+}
+
+void ShardedTagRepository::Save(const domain::Tag& tag) {
+    auto shard = unit_.BookShard(tag.GetBookId());
+    if (!shard) {
+        throw std::invalid_argument("Book "s + tag.GetBookId().ToString() + " not found"s);
+    }
+    unit_.Shard(*shard).Tags().Save(tag);
+}
+
+domain::TagRepository::list_tags_t ShardedTagRepository::GetTagsByBookId(const domain::BookId& book_id) {
+    if (auto shard = unit_.BookShard(book_id)) {
+        return unit_.Shard(*shard).Tags().GetTagsByBookId(book_id);
+    }
+    return {};
+}
+
+bool ShardedTagRepository::SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) {
+    auto shard = unit_.BookShard(book.GetId());
+    if (!shard) {
+        throw domain::VersionConflict("Book was changed or deleted by another session");
+    }
+    return unit_.Shard(*shard).Tags().SyncBookTags(book, tags);
+}
+
+void ShardedTagRepository::ForEach(const std::function<void(const domain::Tag&)>& visitor) {
+    // Посетитель не обязан быть потокобезопасным, поэтому шарды обходятся по очереди
+    for (size_t i = 0; i < unit_.ShardCount(); ++i) {
+        unit_.Shard(i).Tags().ForEach(visitor);
+    }
+}
+
+int ShardedStatsRepository::CountBooks() {
+    auto counts = unit_.FanOut([](UnitOfWorkImpl& shard) {
+        return shard.Stats().CountBooks();
+    });
+    int books = 0;
+    for (auto count : counts) {
+        books += count;
+    }
+    return books;
+}
+
+int ShardedStatsRepository::CountAuthorBooks(const domain::AuthorId& author_id) {
+    return unit_.Shard(unit_.AuthorShard(author_id)).Stats().CountAuthorBooks(author_id);
+}
+
+domain::StatsRepository::top_authors_t ShardedStatsRepository::TopAuthors(size_t limit) {
+    // Автор целиком лежит на одном шарде, поэтому общий топ собирается из топов шардов
+    auto lists = unit_.FanOut([limit](UnitOfWorkImpl& shard) {
+        return shard.Stats().TopAuthors(limit);
+    });
+    auto authors = MergeSorted(std::move(lists), [](const domain::AuthorBooks& lhs, const domain::AuthorBooks& rhs) {
+        return std::forward_as_tuple(rhs.books, lhs.name) < std::forward_as_tuple(lhs.books, rhs.name);
+    });
+    if (unit_.IsResharding()) {
+        std::unordered_set<std::string> seen;
+        std::erase_if(authors, [&seen](const domain::AuthorBooks& author) {
+            return !seen.insert(author.author_id.ToString()).second;
+        });
+    }
+    if (authors.size() > limit) {
+        authors.resize(limit);
+    }
+    return authors;
+}
+
+domain::StatsRepository::top_tags_t ShardedStatsRepository::TopTags(size_t limit) {
+    // Тег встречается на многих шардах: топ шарда не годится, складываем счётчики целиком.
+    // Словарь тегов мал по сравнению с каталогом
+    auto lists = unit_.FanOut([](UnitOfWorkImpl& shard) {
+        return shard.Stats().TopTags(std::numeric_limits<size_t>::max());
+    });
+    std::unordered_map<std::string, int> counts;
+    for (const auto& list : lists) {
+        for (const auto& tag : list) {
+            counts[tag.tag] += tag.books;
+        }
+    }
+    top_tags_t tags;
+    tags.reserve(counts.size());
+    for (auto& [name, books] : counts) {
+        tags.push_back({name, books});
+    }
+    auto middle = tags.begin() + static_cast<std::ptrdiff_t>(std::min(limit, tags.size()));
+    std::partial_sort(tags.begin(), middle, tags.end(), [](const domain::TagBooks& lhs, const domain::TagBooks& rhs) {
+        return std::forward_as_tuple(rhs.books, lhs.tag) < std::forward_as_tuple(lhs.books, rhs.tag);
+    });
+    tags.erase(middle, tags.end());
+    return tags;
+}
+
+domain::StatsRepository::years_t ShardedStatsRepository::BooksPerYear() {
+    auto lists = unit_.FanOut([](UnitOfWorkImpl& shard) {
+        return shard.Stats().BooksPerYear();
+    });
+    std::map<int, int> counts;
+    for (const auto& list : lists) {
+        for (const auto& year : list) {
+            counts[year.year] += year.books;
+        }
+    }
+    years_t years;
+    years.reserve(counts.size());
+    for (const auto& [year, books] : counts) {
+        years.push_back({year, books});
+    }
+    return years;
+}
+
+domain::StatsRepository::mismatches_t ShardedStatsRepository::Verify() {
+    auto lists = unit_.FanOut([](UnitOfWorkImpl& shard) {
+        return shard.Stats().Verify();
+    });
+    mismatches_t mismatches;
+    for (size_t i = 0; i < lists.size(); ++i) {
+        for (auto& mismatch : lists[i]) {
+            mismatch.key = "shard "s + std::to_string(i) + ": "s + mismatch.key;
+            mismatches.push_back(std::move(mismatch));
+        }
+    }
+    return mismatches;
+}
+
+}  // namespace postgres
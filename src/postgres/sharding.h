@@ -0,0 +1,312 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../metrics/metrics.h"
+#include "../metrics/trace.h"
+#include "../unit/unit_of_work_factory.h"
+#include "postgres.h"
+#include "shard_routing.h"
+#include "unit_of_work_impl.h"
+
+namespace postgres {
+
+/**
+ * Книги и теги лежат на шарде своего автора, а операции с книгой знают только её id.
+ * Справочник запоминает шард уже встречавшихся книг, общий для всех единиц работы.
+ */
+class BookShardDirectory {
+public:
+    std::optional<size_t> Find(const domain::BookId& id) const {
+        std::shared_lock lock{mutex_};
+        if (auto it = shards_.find(id); it != shards_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    void Add(const domain::BookId& id, size_t shard) {
+        std::unique_lock lock{mutex_};
+        if (shards_.size() >= MAX_ENTRIES) {
+            // Промах стоит одного параллельного запроса по первичному ключу, вытеснение не нужно точным
+            shards_.clear();
+        }
+        shards_.insert_or_assign(id, shard);
+    }
+
+private:
+    static constexpr size_t MAX_ENTRIES = 1 << 20;
+
+    struct BookIdHash {
+        size_t operator()(const domain::BookId& id) const noexcept {
+            return static_cast<size_t>(ShardKey(id));
+        }
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<domain::BookId, size_t, BookIdHash> shards_;
+};
+
+/**
+ * Поток шарда для FanOut: задачи выполняются по очереди. Поток живёт столько же, сколько база,
+ * поэтому рассылка не создаёт поток (и его данные метрик) на каждый вызов.
+ */
+class ShardWorker {
+public:
+    ShardWorker();
+    ~ShardWorker();
+
+    ShardWorker(const ShardWorker&) = delete;
+    ShardWorker& operator=(const ShardWorker&) = delete;
+
+    // Будущее готово, когда задача выполнена; исключение задачи достаётся из него
+    std::future<void> Post(std::function<void()> task);
+
+private:
+    void Run();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::packaged_task<void()>> tasks_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+// Набор баз-шардов. Автор лежит на шарде ShardIndex(author_id, ShardCount())
+class ShardedDatabase {
+public:
+    // previous_shard_count != 0 - идёт перешардирование с такого числа шардов (urls - его продолжение)
+    ShardedDatabase(const std::vector<std::string>& urls, size_t previous_shard_count);
+
+    size_t ShardCount() const noexcept {
+        return shards_.size();
+    }
+    Database& Shard(size_t index) {
+        return *shards_[index];
+    }
+    size_t PreviousShardCount() const noexcept {
+        return previous_shard_count_;
+    }
+    BookShardDirectory& Books() noexcept {
+        return books_;
+    }
+    // Поток шарда index >= 1: задачу шарда 0 FanOut выполняет в вызывающем потоке
+    ShardWorker& Worker(size_t index) {
+        return *workers_[index - 1];
+    }
+
+private:
+    std::vector<std::unique_ptr<Database>> shards_;
+    std::vector<std::unique_ptr<ShardWorker>> workers_;
+    size_t previous_shard_count_;
+    BookShardDirectory books_;
+};
+
+class ShardedUnitOfWork;
+
+class ShardedAuthorRepository : public domain::AuthorRepository {
+public:
+    explicit ShardedAuthorRepository(ShardedUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void DeleteAuthorAndDependencies(const domain::Author& author) override;
+    void Save(const domain::Author& author) override;
+    list_authors_t GetList() override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+
+private:
+    ShardedUnitOfWork& unit_;
+};
+
+class ShardedBookRepository : public domain::BookRepository {
+public:
+    explicit ShardedBookRepository(ShardedUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void Delete(const domain::BookId& book_id) override;
+    void Edit(const domain::Book& book) override;
+    void Save(const domain::Book& book) override;
+    list_books_t GetList() override;
+    list_books_t GetBookByAuthorId(const domain::AuthorId& author_id) override;
+    list_books_t GetBooksByTitle(const std::string& title) override;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) override;
+
+private:
+    ShardedUnitOfWork& unit_;
+};
+
+class ShardedTagRepository : public domain::TagRepository {
+public:
+    explicit ShardedTagRepository(ShardedUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void ClearTagsByBookId(const domain::BookId& book_id) override;
+    void Save(const domain::Tag& tag) override;
+    list_tags_t GetTagsByBookId(const domain::BookId& book_id) override;
+    bool SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) override;
+    void ForEach(const std::function<void(const domain::Tag&)>& visitor) override;
+
+private:
+    ShardedUnitOfWork& unit_;
+};
+
+// Счётчики шардов складываются; автор лежит на одном шарде, а тег и год встречаются на всех
+class ShardedStatsRepository : public domain::StatsRepository {
+public:
+    explicit ShardedStatsRepository(ShardedUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    int CountBooks() override;
+    int CountAuthorBooks(const domain::AuthorId& author_id) override;
+    top_authors_t TopAuthors(size_t limit) override;
+    top_tags_t TopTags(size_t limit) override;
+    years_t BooksPerYear() override;
+    mismatches_t Verify() override;
+
+private:
+    ShardedUnitOfWork& unit_;
+};
+
+/**
+ * Единица работы поверх шардов: транзакция на шарде открывается при первом обращении к нему.
+ * Команды одного автора попадают на один шард, поэтому коммит атомарен для всех команд,
+ * кроме удаления автора по имени, которое рассылается на все шарды и идемпотентно.
+ */
+class ShardedUnitOfWork : public app::UnitOfWork {
+public:
+    explicit ShardedUnitOfWork(ShardedDatabase& db)
+        : db_{db}
+        , shards_(db.ShardCount()) {
+    }
+
+    void Commit() override;
+    void BeginSavepoint() override;
+    void RollbackToSavepoint() override;
+    void ReleaseSavepoint() override;
+    // Срок ставится на каждом открытом шарде и на шардах, открытых позже
+    void SetDeadline(std::chrono::steady_clock::time_point deadline) override;
+    void ClearDeadline() noexcept override;
+
+    ShardedAuthorRepository& Authors() override {
+        return authors_;
+    }
+    ShardedBookRepository& Books() override {
+        return books_;
+    }
+    ShardedTagRepository& Tags() override {
+        return tags_;
+    }
+    ShardedStatsRepository& Stats() override {
+        return stats_;
+    }
+
+    size_t ShardCount() const noexcept {
+        return shards_.size();
+    }
+    bool IsResharding() const noexcept {
+        return db_.PreviousShardCount() != 0;
+    }
+    UnitOfWorkImpl& Shard(size_t index);
+    size_t AuthorShard(const domain::AuthorId& author_id);
+    // std::nullopt, если книги нет ни на одном шарде
+    std::optional<size_t> BookShard(const domain::BookId& book_id);
+    void RememberBooks(const domain::BookRepository::list_books_t& books, size_t shard);
+    // Шард новой книги станет известен остальным единицам работы только после коммита
+    void RememberNewBook(const domain::BookId& book_id, size_t shard);
+
+    // Выполняет fn на всех шардах параллельно, результаты - в порядке шардов
+    template <typename Fn>
+    auto FanOut(const Fn& fn) -> std::vector<std::invoke_result_t<const Fn&, UnitOfWorkImpl&>> {
+        using Result = std::invoke_result_t<const Fn&, UnitOfWorkImpl&>;
+        static auto& fan_outs = metrics::GetCounter("shard_fan_outs");
+        fan_outs.Increment();
+        // Транзакции открываются здесь: дальше каждый поток работает только со своим соединением
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            Shard(i);
+        }
+        std::vector<std::optional<Result>> slots(shards_.size());
+        std::vector<std::future<void>> done;
+        done.reserve(shards_.size());
+        // Запросы шардов попадают в трассу вложенными в вызвавший интервал
+        const auto trace = metrics::TraceContext::Current();
+        for (size_t i = 1; i < shards_.size(); ++i) {
+            done.push_back(db_.Worker(i).Post([&fn, &trace, &slot = slots[i], shard = shards_[i].get()] {
+                metrics::ScopedTraceContext scope{trace};
+                slot.emplace(fn(*shard));
+            }));
+        }
+        // Задачи ссылаются на fn и слоты, поэтому до выхода дожидаемся всех, даже после ошибки
+        std::exception_ptr error;
+        try {
+            slots[0].emplace(fn(*shards_[0]));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (auto& future : done) {
+            try {
+                future.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        std::vector<Result> results;
+        results.reserve(shards_.size());
+        for (auto& slot : slots) {
+            results.push_back(std::move(*slot));
+        }
+        return results;
+    }
+
+private:
+    ShardedDatabase& db_;
+    std::vector<std::unique_ptr<UnitOfWorkImpl>> shards_;
+    bool in_savepoint_ = false;
+    std::optional<std::chrono::steady_clock::time_point> deadline_;
+    std::vector<std::pair<domain::BookId, size_t>> new_books_;
+
+    ShardedAuthorRepository authors_{*this};
+    ShardedBookRepository books_{*this};
+    ShardedTagRepository tags_{*this};
+    ShardedStatsRepository stats_{*this};
+};
+
+class ShardedUnitOfWorkFactory : public app::UnitOfWorkFactory {
+public:
+    ShardedUnitOfWorkFactory(const std::vector<std::string>& urls, size_t previous_shard_count)
+        : db_{urls, previous_shard_count} {
+    }
+
+    ShardedDatabase& GetDatabase() noexcept {
+        return db_;
+    }
+
+    std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+        return std::make_shared<ShardedUnitOfWork>(db_);
+    }
+
+private:
+    ShardedDatabase db_;
+};
+
+}  // namespace postgres
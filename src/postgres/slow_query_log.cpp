@@ -0,0 +1,159 @@
+#include "slow_query_log.h"
+
+#include <atomic>
+#include <cctype>
+#include <ctime>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace postgres {
+
+using namespace std::literals;
+
+namespace {
+
+std::unique_ptr<SlowQueryLog> instance;
+std::atomic<SlowQueryLog*> instance_ptr{nullptr};
+
+bool IsIdentifierChar(char c) {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
+}
+
+std::string Timestamp() {
+    const auto now = std::chrono::system_clock::now();
+    const auto time = std::chrono::system_clock::to_time_t(now);
+    std::tm tm{};
+    gmtime_r(&time, &tm);
+    std::ostringstream out;
+    out << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
+    return out.str();
+}
+
+}  // namespace
+
+std::string NormalizeSql(std::string_view sql) {
+    std::string result;
+    result.reserve(sql.size());
+    bool pending_space = false;
+    for (size_t i = 0; i < sql.size(); ++i) {
+        const char c = sql[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = !result.empty();
+            continue;
+        }
+        if (pending_space) {
+            result += ' ';
+            pending_space = false;
+        }
+        if (c == '\'') {
+            // Строковый литерал, '' внутри - экранированная кавычка
+            for (++i; i < sql.size(); ++i) {
+                if (sql[i] == '\'') {
+                    if (i + 1 < sql.size() && sql[i + 1] == '\'') {
+                        ++i;
+                        continue;
+                    }
+                    break;
+                }
+            }
+            result += '?';
+        } else if (std::isdigit(static_cast<unsigned char>(c)) && (result.empty() || !IsIdentifierChar(result.back()))) {
+            while (i + 1 < sql.size() && (std::isdigit(static_cast<unsigned char>(sql[i + 1])) || sql[i + 1] == '.')) {
+                ++i;
+            }
+            result += '?';
+        } else {
+            result += c;
+        }
+    }
+    while (!result.empty() && (result.back() == ';' || result.back() == ' ')) {
+        result.pop_back();
+    }
+    return result;
+}
+
+RotatingFile::RotatingFile(std::filesystem::path path, size_t max_size, size_t max_files)
+    : path_(std::move(path))
+    , max_size_(max_size)
+    , max_files_(std::max<size_t>(max_files, 1)) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path_, ec);
+    size_ = ec ? 0 : static_cast<size_t>(size);
+    out_.open(path_, std::ios::app);
+    if (!out_) {
+        throw std::runtime_error("Can't open "s + path_.string());
+    }
+}
+
+void RotatingFile::Write(std::string_view text) {
+    if (size_ > 0 && size_ + text.size() > max_size_) {
+        Rotate();
+    }
+    out_ << text;
+    out_.flush();
+    size_ += text.size();
+}
+
+void RotatingFile::Rotate() {
+    out_.close();
+    auto numbered = [this](size_t n) {
+        auto p = path_;
+        p += "." + std::to_string(n);
+        return p;
+    };
+    std::error_code ec;
+    std::filesystem::remove(numbered(max_files_), ec);
+    for (size_t n = max_files_; n > 1; --n) {
+        std::filesystem::rename(numbered(n - 1), numbered(n), ec);
+    }
+    std::filesystem::rename(path_, numbered(1), ec);
+    out_.open(path_, std::ios::trunc);
+    size_ = 0;
+}
+
+SlowQueryLog::SlowQueryLog(SlowQueryConfig config)
+    : config_(std::move(config))
+    , file_(config_.path, config_.max_file_size, config_.max_files) {
+}
+
+void SlowQueryLog::Configure(SlowQueryConfig config) {
+    instance_ptr.store(nullptr);
+    instance = std::make_unique<SlowQueryLog>(std::move(config));
+    instance_ptr.store(instance.get());
+}
+
+SlowQueryLog* SlowQueryLog::Instance() noexcept {
+    return instance_ptr.load(std::memory_order_relaxed);
+}
+
+bool SlowQueryLog::ShouldExplain() const {
+    if (config_.explain_sample_rate <= 0.0) {
+        return false;
+    }
+    thread_local std::minstd_rand engine{std::random_device{}()};
+    return std::uniform_real_distribution<double>{0.0, 1.0}(engine) < config_.explain_sample_rate;
+}
+
+void SlowQueryLog::Write(const SlowQueryRecord& record) {
+    std::ostringstream out;
+    out << Timestamp() << " statement="sv << record.statement << " duration_ms="sv << std::fixed
+        << std::setprecision(3) << static_cast<double>(record.duration.count()) / 1000.0 << " rows="sv
+        << record.rows << " params=["sv;
+    for (size_t i = 0; i < record.param_shapes.size(); ++i) {
+        out << (i ? ", "sv : ""sv) << record.param_shapes[i];
+    }
+    out << "] sql="sv << NormalizeSql(record.sql) << '\n';
+    if (!record.plan.empty()) {
+        std::istringstream plan{record.plan};
+        for (std::string line; std::getline(plan, line);) {
+            out << "    "sv << line << '\n';
+        }
+    }
+
+    std::lock_guard lock{mutex_};
+    file_.Write(out.str());
+}
+
+}  // namespace postgres
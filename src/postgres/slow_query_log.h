@@ -0,0 +1,71 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace postgres {
+
+struct SlowQueryConfig {
+    std::chrono::microseconds threshold{std::chrono::milliseconds(100)};
+    // Доля медленных запросов, которые повторно выполняются под EXPLAIN (ANALYZE, BUFFERS)
+    double explain_sample_rate = 0.0;
+    std::filesystem::path path{"bookypedia-slow.log"};
+    size_t max_file_size = 10 * 1024 * 1024;
+    size_t max_files = 5;
+};
+
+struct SlowQueryRecord {
+    std::string_view statement;
+    std::string_view sql;
+    std::vector<std::string> param_shapes;
+    size_t rows = 0;
+    std::chrono::microseconds duration{};
+    std::string plan;
+};
+
+// Оставляет форму запроса: схлопывает пробелы и заменяет литералы на '?'
+std::string NormalizeSql(std::string_view sql);
+
+class RotatingFile {
+public:
+    RotatingFile(std::filesystem::path path, size_t max_size, size_t max_files);
+
+    void Write(std::string_view text);
+
+private:
+    void Rotate();
+
+    std::filesystem::path path_;
+    size_t max_size_;
+    size_t max_files_;
+    size_t size_ = 0;
+    std::ofstream out_;
+};
+
+class SlowQueryLog {
+public:
+    explicit SlowQueryLog(SlowQueryConfig config);
+
+    // Лог не настроен по умолчанию, тогда Instance() возвращает nullptr
+    static void Configure(SlowQueryConfig config);
+    static SlowQueryLog* Instance() noexcept;
+
+    bool IsSlow(std::chrono::microseconds duration) const noexcept {
+        return duration >= config_.threshold;
+    }
+    bool ShouldExplain() const;
+
+    void Write(const SlowQueryRecord& record);
+
+private:
+    SlowQueryConfig config_;
+    std::mutex mutex_;
+    RotatingFile file_;
+};
+
+}  // namespace postgres
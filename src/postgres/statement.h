@@ -0,0 +1,130 @@
+#pragma once
+#include <chrono>
+#include <pqxx/pqxx>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "../metrics/metrics.h"
+#include "../metrics/trace.h"
+#include "../unit/constraint_violation.h"
+#include "../unit/deadline.h"
+#include "slow_query_log.h"
+
+namespace postgres {
+
+namespace detail {
+
+inline std::string ParamShape(const std::string& value) {
+    return "text(" + std::to_string(value.size()) + ")";
+}
+
+inline std::string ParamShape(std::string_view value) {
+    return "text(" + std::to_string(value.size()) + ")";
+}
+
+inline std::string ParamShape(const std::vector<std::string>& values) {
+    return "text[](" + std::to_string(values.size()) + ")";
+}
+
+template <typename T>
+std::enable_if_t<std::is_arithmetic_v<T>, std::string> ParamShape(const T&) {
+    return std::is_floating_point_v<T> ? "float" : "int";
+}
+
+template <typename... Args>
+void LogSlowStatement(SlowQueryLog& log, pqxx::work& worker, const metrics::LatencyMetric& latency,
+                      pqxx::zview sql, size_t rows, std::chrono::microseconds duration, const Args&... args) {
+    SlowQueryRecord record{latency.GetName(), sql, {ParamShape(args)...}, rows, duration, {}};
+    if (log.ShouldExplain()) {
+        // Повторное выполнение в точке сохранения, чтобы изменения EXPLAIN ANALYZE откатились
+        try {
+            pqxx::subtransaction explain{worker, "explain"};
+            const auto explain_sql = "EXPLAIN (ANALYZE, BUFFERS) " + std::string(sql);
+            for (const auto& row : explain.exec_params(pqxx::zview(explain_sql), args...)) {
+                record.plan += row[0].c_str();
+                record.plan += '\n';
+            }
+            explain.abort();
+        } catch (const std::exception& e) {
+            record.plan = "EXPLAIN failed: " + std::string(e.what());
+        }
+    }
+    log.Write(record);
+}
+
+}  // namespace detail
+
+/**
+ * Выполняет fn, превращая ошибки statement_timeout, lock_timeout и отмены сторожем
+ * (SQLSTATE 57014 и 55P03) в app::DeadlineExceeded, а нарушения ограничений схемы
+ * (класс 23) - в app::ConstraintViolation
+ */
+template <typename Fn>
+decltype(auto) TranslateErrors(Fn&& fn) {
+    try {
+        return fn();
+    } catch (const pqxx::integrity_constraint_violation& e) {
+        throw app::ConstraintViolation(e.what());
+    } catch (const pqxx::sql_error& e) {
+        if (e.sqlstate() == "57014" || e.sqlstate() == "55P03") {
+            throw app::DeadlineExceeded(e.what());
+        }
+        throw;
+    }
+}
+
+namespace detail {
+
+template <typename Exec, typename... Args>
+pqxx::result TimedStatement(pqxx::work& worker, metrics::LatencyMetric& latency, pqxx::zview sql, Exec&& exec,
+                            const Args&... args) {
+    auto* slow_log = SlowQueryLog::Instance();
+    if (!slow_log && !metrics::IsEnabled() && !metrics::IsTracing()) {
+        return TranslateErrors(exec);
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    auto result = TranslateErrors(exec);
+    const auto end = std::chrono::steady_clock::now();
+    const auto elapsed = end - start;
+    if (metrics::IsEnabled()) {
+        latency.Record(elapsed);
+    }
+    metrics::RecordSpan(latency, start, end);
+
+    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+    if (slow_log && slow_log->IsSlow(duration)) {
+        const auto rows = result.columns() > 0 ? static_cast<size_t>(result.size())
+                                               : static_cast<size_t>(result.affected_rows());
+        LogSlowStatement(*slow_log, worker, latency, sql, rows, duration, args...);
+    }
+    return result;
+}
+
+}  // namespace detail
+
+/**
+ * Выполняет параметризованный запрос репозитория: учитывает его время в метриках
+ * и пишет в журнал медленных запросов, если он настроен и порог превышен.
+ */
+template <typename... Args>
+pqxx::result ExecStatement(pqxx::work& worker, metrics::LatencyMetric& latency, pqxx::zview sql,
+                           const Args&... args) {
+    return detail::TimedStatement(worker, latency, sql, [&] {
+        return worker.exec_params(sql, args...);
+    }, args...);
+}
+
+// То же для запроса, заранее подготовленного на соединении под именем name.
+// Текст sql нужен только журналу медленных запросов
+template <typename... Args>
+pqxx::result ExecPrepared(pqxx::work& worker, metrics::LatencyMetric& latency, pqxx::zview name, pqxx::zview sql,
+                          const Args&... args) {
+    return detail::TimedStatement(worker, latency, sql, [&] {
+        return worker.exec_prepared(name, args...);
+    }, args...);
+}
+
+}  // namespace postgres
@@ -0,0 +1,53 @@
+#pragma once
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace postgres {
+
+/**
+ * Кэш словаря тегов (name <-> id), общий для всех единиц работы одного Database.
+ * Теги из словаря не удаляются, поэтому закэшированные пары не устаревают.
+ * В кэш попадают только закоммиченные теги.
+ */
+class TagIdCache {
+public:
+    std::optional<int> FindId(std::string_view name) const {
+        std::shared_lock lock{mutex_};
+        if (auto it = ids_.find(name); it != ids_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<std::string> FindName(int id) const {
+        std::shared_lock lock{mutex_};
+        if (auto it = names_.find(id); it != names_.end()) {
+            return it->second;
+        }
+        return std::nullopt;
+    }
+
+    void Add(int id, const std::string& name) {
+        std::unique_lock lock{mutex_};
+        ids_.emplace(name, id);
+        names_.emplace(id, name);
+    }
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, int, StringHash, std::equal_to<>> ids_;
+    std::unordered_map<int, std::string> names_;
+};
+
+}  // namespace postgres
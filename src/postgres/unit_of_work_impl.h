@@ -1,17 +1,89 @@
 #pragma once
 
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "group_commit.h"
 #include "postgres.h"
+#include "watchdog.h"
+#include "../metrics/metrics.h"
 #include "../unit/unit_of_work.h"
+#include "../unit/unit_of_work_factory.h"
 
 namespace postgres {
 
 class UnitOfWorkImpl : public app::UnitOfWork {
     public:
-        UnitOfWorkImpl(pqxx::connection & connection) : connection_(connection) {}
+        // group_commit == nullptr - каждая транзакция сама ждёт сброса WAL. С ним Commit бросает
+        // DurabilityUnknown, если транзакция закоммичена, а сброс WAL не удался
+        UnitOfWorkImpl(pqxx::connection & connection, TagIdCache & tag_cache, GroupCommitter * group_commit = nullptr)
+            : connection_(connection)
+            , tag_cache_(tag_cache)
+            , group_commit_(group_commit) {}
 
         void Commit() override {
+            static auto& latency = metrics::Latency(metrics::Scope::STATEMENT, "commit");
+            static auto& commits = metrics::GetCounter("transaction_commits");
+            metrics::ScopedTimer timer{latency};
+            // Транзакция без xid ничего не записала в WAL, ждать его сброса незачем
+            const bool wait_durable = group_commit_ && worker_.query_value<bool>(R"(
+SELECT set_config('synchronous_commit', 'off', true) IS NOT NULL AND txid_current_if_assigned() IS NOT NULL;
+)");
             worker_.commit();
             is_commited_ = true;
+            tags_.OnCommit();
+            commits.Increment();
+            if(wait_durable)
+                WaitDurable();
+        }
+        void BeginSavepoint() override {
+            worker_.exec("SAVEPOINT batch_command");
+            savepoint_tags_.push_back(tags_.CreatedCount());
+        }
+        void RollbackToSavepoint() override {
+            worker_.exec("ROLLBACK TO SAVEPOINT batch_command");
+            // Откаченные теги не должны попасть в кэш: их id снова выдаст последовательность
+            tags_.ForgetCreatedAfter(savepoint_tags_.back());
+        }
+        void ReleaseSavepoint() override {
+            worker_.exec("RELEASE SAVEPOINT batch_command");
+            savepoint_tags_.pop_back();
+        }
+        void SetDeadline(std::chrono::steady_clock::time_point deadline) override {
+            ClearDeadline();
+            // Остаток округляется вверх, чтобы сервер не прервал запрос раньше срока
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if(left.count() <= 0)
+                throw app::DeadlineExceeded("Deadline exceeded before the call started");
+            // Настройки LOCAL живут до конца транзакции, следующий вызов ставит свой срок
+            worker_.exec_params("SELECT set_config('statement_timeout', $1, true), set_config('lock_timeout', $1, true);",
+                                std::to_string(left.count()));
+            watchdog_ticket_ = QueryWatchdog::Instance().Arm(connection_, deadline);
+        }
+        void ClearDeadline() noexcept override {
+            if(watchdog_ticket_ != 0)
+                QueryWatchdog::Instance().Disarm(std::exchange(watchdog_ticket_, 0));
+        }
+        uint64_t GetJournalPosition(const std::string & journal_id) override {
+            return worker_.exec_params1(
+                "SELECT COALESCE((SELECT position FROM journal_positions WHERE journal_id = $1), 0);",
+                journal_id)[0].as<int64_t>();
+        }
+        void SetJournalPosition(const std::string & journal_id, uint64_t position) override {
+            worker_.exec_params(R"(
+INSERT INTO journal_positions (journal_id, position) VALUES ($1, $2)
+ON CONFLICT (journal_id) DO UPDATE SET position = $2;
+)", journal_id, static_cast<int64_t>(position));
+        }
+        // Запускает отложенные триггеры ленты изменений до коммита и возвращает номер,
+        // который получила транзакция (0 - она ничего не меняла или лента не установлена)
+        uint64_t FlushChangeFeed() {
+            return worker_.query_value<int64_t>(R"(
+SET CONSTRAINTS ALL IMMEDIATE;
+SELECT COALESCE(NULLIF(current_setting('bookypedia.change_seq', true), ''), '0')::BIGINT;
+)");
         }
         AuthorRepositoryImpl & Authors() override {
             return authors_;
@@ -22,19 +94,59 @@ class UnitOfWorkImpl : public app::UnitOfWork {
         TagRepositoryImpl & Tags() override {
             return tags_;
         }
+        StatsRepositoryImpl & Stats() override {
+            return stats_;
+        }
         ~UnitOfWorkImpl() {
+            ClearDeadline();
             //if(!is_commited_)
             //    Commit();
+            if(!is_commited_) {
+                static auto& rollbacks = metrics::GetCounter("transaction_rollbacks");
+                rollbacks.Increment();
+            }
         }
     private:
+        void WaitDurable() {
+            try {
+                group_commit_->WaitDurable();
+            } catch (const std::exception& ex) {
+                static auto& unconfirmed = metrics::GetCounter("group_commit_unconfirmed");
+                unconfirmed.Increment();
+                throw DurabilityUnknown(std::string("Transaction committed, durability unknown: ") + ex.what());
+            }
+        }
+
         bool is_commited_{false};
+        QueryWatchdog::ticket_t watchdog_ticket_{0};
+        // Число созданных тегов на момент каждой открытой точки сохранения
+        std::vector<size_t> savepoint_tags_;
 
         pqxx::connection & connection_;        
+        TagIdCache & tag_cache_;
+        GroupCommitter * group_commit_;
         pqxx::work worker_{connection_};
 
         postgres::AuthorRepositoryImpl authors_{worker_};
         postgres::BookRepositoryImpl books_{worker_};
-        postgres::TagRepositoryImpl tags_{worker_};
+        postgres::TagRepositoryImpl tags_{worker_, tag_cache_};
+        postgres::StatsRepositoryImpl stats_{worker_};
+};
+
+class UnitOfWorkFactoryImpl : public app::UnitOfWorkFactory {
+    public:
+        explicit UnitOfWorkFactoryImpl(pqxx::connection connection)
+            : db_{std::move(connection)} {}
+
+        Database & GetDatabase() {
+            return db_;
+        }
+
+        std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+            return std::make_shared<UnitOfWorkImpl>(db_.GetConnection(), db_.GetTagCache());
+        }
+    private:
+        Database db_;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "watchdog.h"
+
+#include <algorithm>
+
+#include "../metrics/metrics.h"
+
+namespace postgres {
+
+QueryWatchdog& QueryWatchdog::Instance() {
+    static QueryWatchdog instance;
+    return instance;
+}
+
+QueryWatchdog::QueryWatchdog()
+    : thread_{[this] {
+        Run();
+    }} {
+}
+
+QueryWatchdog::~QueryWatchdog() {
+    {
+        std::lock_guard lock{mutex_};
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+QueryWatchdog::ticket_t QueryWatchdog::Arm(pqxx::connection& connection, clock_t::time_point deadline) {
+    ticket_t ticket = 0;
+    {
+        std::lock_guard lock{mutex_};
+        ticket = next_ticket_++;
+        entries_.emplace(ticket, Entry{deadline, &connection});
+    }
+    // Новый срок может оказаться раньше того, до которого спит поток
+    wake_.notify_one();
+    return ticket;
+}
+
+void QueryWatchdog::Disarm(ticket_t ticket) noexcept {
+    // Отмена выполняется под mutex_, поэтому после снятия соединение уже не отменят
+    std::lock_guard lock{mutex_};
+    entries_.erase(ticket);
+}
+
+void QueryWatchdog::Run() {
+    static auto& cancels = metrics::GetCounter("watchdog_cancels");
+    std::unique_lock lock{mutex_};
+    while (!stopping_) {
+        if (entries_.empty()) {
+            wake_.wait(lock);
+            continue;
+        }
+        // Вызовов со сроком не больше, чем соединений, так что хватает линейного поиска
+        const auto earliest = std::min_element(entries_.begin(), entries_.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.second.deadline < rhs.second.deadline;
+        });
+        // Пока поток спит, запись могут снять, поэтому срок копируется
+        const auto deadline = earliest->second.deadline;
+        if (clock_t::now() < deadline) {
+            wake_.wait_until(lock, deadline);
+            continue;
+        }
+        try {
+            earliest->second.connection->cancel_query();
+            cancels.Increment();
+        } catch (const std::exception&) {
+            // Соединение уже разорвано - отменять нечего, вызов и так получит ошибку
+        }
+        entries_.erase(earliest);
+    }
+}
+
+}  // namespace postgres
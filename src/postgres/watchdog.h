@@ -0,0 +1,52 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <pqxx/connection>
+#include <thread>
+
+namespace postgres {
+
+/**
+ * Сторож сроков вызовов. statement_timeout ограничивает каждый запрос по отдельности,
+ * а вызов сценария может выполнить их несколько; если соединение не сняли с учёта до срока,
+ * сторож отменяет его текущий запрос через PQcancel, и запрос завершается ошибкой 57014.
+ */
+class QueryWatchdog {
+public:
+    using clock_t = std::chrono::steady_clock;
+    using ticket_t = uint64_t;
+
+    // Общий сторож процесса, поток запускается при первом обращении
+    static QueryWatchdog& Instance();
+
+    QueryWatchdog();
+    ~QueryWatchdog();
+
+    QueryWatchdog(const QueryWatchdog&) = delete;
+    QueryWatchdog& operator=(const QueryWatchdog&) = delete;
+
+    // Соединение должно жить до Disarm
+    ticket_t Arm(pqxx::connection& connection, clock_t::time_point deadline);
+    // После возврата сторож этот запрос уже не отменит
+    void Disarm(ticket_t ticket) noexcept;
+
+private:
+    struct Entry {
+        clock_t::time_point deadline;
+        pqxx::connection* connection = nullptr;
+    };
+
+    void Run();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::map<ticket_t, Entry> entries_;
+    ticket_t next_ticket_ = 1;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+}  // namespace postgres
@@ -0,0 +1,163 @@
+#include "catalog.h"
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <cstring>
+
+namespace snapshot {
+
+using namespace std::literals;
+namespace bip = boost::interprocess;
+
+namespace {
+
+bool IdLess(const uint8_t (&lhs)[16], const util::detail::UUIDType& rhs) {
+    return std::lexicographical_compare(lhs, lhs + 16, rhs.begin(), rhs.end());
+}
+
+bool IdEqual(const uint8_t (&lhs)[16], const util::detail::UUIDType& rhs) {
+    return std::equal(lhs, lhs + 16, rhs.begin());
+}
+
+bool AllBelow(std::span<const uint32_t> indexes, size_t size) {
+    return std::all_of(indexes.begin(), indexes.end(), [size](uint32_t index) {
+        return index < size;
+    });
+}
+
+}  // namespace
+
+Catalog::Catalog(const std::string& path, bool verify_checksum)
+    : file_{path.c_str(), bip::read_only}
+    , region_{file_, bip::read_only} {
+    data_ = static_cast<const char*>(region_.get_address());
+    const auto size = region_.get_size();
+    if (size < sizeof(Header)) {
+        throw FormatError("Snapshot "s + path + " is truncated"s);
+    }
+    header_ = reinterpret_cast<const Header*>(data_);
+    if (std::memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw FormatError(path + " is not a bookypedia snapshot"s);
+    }
+    if (header_->version != FORMAT_VERSION || header_->header_size != sizeof(Header)) {
+        throw FormatError("Unsupported snapshot version "s + std::to_string(header_->version));
+    }
+    if (header_->file_size != size) {
+        throw FormatError("Snapshot "s + path + " is truncated"s);
+    }
+    if (verify_checksum) {
+        boost::crc_32_type crc;
+        crc.process_bytes(data_ + sizeof(Header), size - sizeof(Header));
+        if (crc.checksum() != header_->checksum) {
+            throw FormatError("Snapshot "s + path + " is corrupted: checksum mismatch"s);
+        }
+    }
+
+    const auto strings = SectionSpan<char>(header_->strings);
+    strings_ = {strings.data(), strings.size()};
+    authors_ = SectionSpan<AuthorRecord>(header_->authors);
+    authors_by_id_ = SectionSpan<uint32_t>(header_->authors_by_id);
+    books_ = SectionSpan<BookRecord>(header_->books);
+    books_by_title_ = SectionSpan<uint32_t>(header_->books_by_title);
+    books_by_id_ = SectionSpan<uint32_t>(header_->books_by_id);
+    tag_names_ = SectionSpan<StringRef>(header_->tag_names);
+    book_tags_ = SectionSpan<uint32_t>(header_->book_tags);
+    if (authors_by_id_.size() != authors_.size() || books_by_title_.size() != books_.size()
+        || books_by_id_.size() != books_.size()) {
+        throw FormatError("Snapshot indexes do not match records"s);
+    }
+    // Номера из индексов дальше берутся без проверок, поэтому проверяются здесь, даже без контрольной суммы
+    if (!AllBelow(authors_by_id_, authors_.size()) || !AllBelow(books_by_title_, books_.size())
+        || !AllBelow(books_by_id_, books_.size())) {
+        throw FormatError("Snapshot index is out of bounds"s);
+    }
+}
+
+template <typename T>
+std::span<const T> Catalog::SectionSpan(const Section& section) const {
+    if (section.offset % alignof(T) != 0 || section.offset > header_->file_size
+        || section.count > (header_->file_size - section.offset) / sizeof(T)) {
+        throw FormatError("Snapshot section is out of bounds"s);
+    }
+    return {reinterpret_cast<const T*>(data_ + section.offset), static_cast<size_t>(section.count)};
+}
+
+std::string_view Catalog::String(StringRef ref) const {
+    if (ref.offset > strings_.size() || ref.size > strings_.size() - ref.offset) {
+        throw FormatError("Snapshot string is out of bounds"s);
+    }
+    return strings_.substr(ref.offset, ref.size);
+}
+
+std::string_view Catalog::TagName(uint32_t tag) const {
+    if (tag >= tag_names_.size()) {
+        throw FormatError("Snapshot tag is out of bounds"s);
+    }
+    return String(tag_names_[tag]);
+}
+
+const AuthorRecord& Catalog::AuthorOf(const BookRecord& book) const {
+    if (book.author >= authors_.size()) {
+        throw FormatError("Snapshot book author is out of bounds"s);
+    }
+    return authors_[book.author];
+}
+
+std::span<const BookRecord> Catalog::BooksOf(const AuthorRecord& author) const {
+    if (author.first_book > books_.size() || author.book_count > books_.size() - author.first_book) {
+        throw FormatError("Snapshot author books are out of bounds"s);
+    }
+    return books_.subspan(author.first_book, author.book_count);
+}
+
+std::span<const uint32_t> Catalog::TagsOf(const BookRecord& book) const {
+    if (book.first_tag > book_tags_.size() || book.tag_count > book_tags_.size() - book.first_tag) {
+        throw FormatError("Snapshot book tags are out of bounds"s);
+    }
+    return book_tags_.subspan(book.first_tag, book.tag_count);
+}
+
+const AuthorRecord* Catalog::FindAuthorByName(std::string_view name) const {
+    auto it = std::lower_bound(authors_.begin(), authors_.end(), name, [this](const AuthorRecord& author, std::string_view value) {
+        return String(author.name) < value;
+    });
+    if (it == authors_.end() || String(it->name) != name) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+std::optional<uint32_t> Catalog::FindAuthor(const util::detail::UUIDType& id) const {
+    auto it = std::lower_bound(authors_by_id_.begin(), authors_by_id_.end(), id, [this](uint32_t index, const auto& value) {
+        return IdLess(authors_[index].id, value);
+    });
+    if (it == authors_by_id_.end() || !IdEqual(authors_[*it].id, id)) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+std::optional<uint32_t> Catalog::FindBook(const util::detail::UUIDType& id) const {
+    auto it = std::lower_bound(books_by_id_.begin(), books_by_id_.end(), id, [this](uint32_t index, const auto& value) {
+        return IdLess(books_[index].id, value);
+    });
+    if (it == books_by_id_.end() || !IdEqual(books_[*it].id, id)) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+std::span<const uint32_t> Catalog::FindBooksByTitle(std::string_view title) const {
+    auto title_of = [this](uint32_t index) {
+        return String(books_[index].title);
+    };
+    auto first = std::lower_bound(books_by_title_.begin(), books_by_title_.end(), title, [&title_of](uint32_t index, std::string_view value) {
+        return title_of(index) < value;
+    });
+    auto last = std::upper_bound(first, books_by_title_.end(), title, [&title_of](std::string_view value, uint32_t index) {
+        return value < title_of(index);
+    });
+    return {first, last};
+}
+
+}  // namespace snapshot
@@ -0,0 +1,83 @@
+#pragma once
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "../util/tagged_uuid.h"
+#include "format.h"
+
+namespace snapshot {
+
+class FormatError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Снимок каталога, отображённый в память только для чтения.
+ * При открытии проверяются заголовок, границы секций и номера записей в индексах (и, если нужно,
+ * контрольная сумма), записи читаются прямо из отображения. Ссылки из самих записей
+ * (строки, автор книги, её теги) проверяются при каждом обращении.
+ */
+class Catalog {
+public:
+    explicit Catalog(const std::string& path, bool verify_checksum = true);
+
+    Catalog(const Catalog&) = delete;
+    Catalog& operator=(const Catalog&) = delete;
+
+    std::span<const AuthorRecord> Authors() const noexcept {
+        return authors_;
+    }
+    std::span<const BookRecord> Books() const noexcept {
+        return books_;
+    }
+    std::span<const uint32_t> BooksByTitle() const noexcept {
+        return books_by_title_;
+    }
+
+    std::string_view String(StringRef ref) const;
+    std::string_view TagName(uint32_t tag) const;
+    const AuthorRecord& AuthorOf(const BookRecord& book) const;
+    std::span<const BookRecord> BooksOf(const AuthorRecord& author) const;
+    std::span<const uint32_t> TagsOf(const BookRecord& book) const;
+
+    const AuthorRecord* FindAuthorByName(std::string_view name) const;
+    std::optional<uint32_t> FindAuthor(const util::detail::UUIDType& id) const;
+    std::optional<uint32_t> FindBook(const util::detail::UUIDType& id) const;
+    // Номера книг с этим названием, по имени автора и году
+    std::span<const uint32_t> FindBooksByTitle(std::string_view title) const;
+
+private:
+    template <typename T>
+    std::span<const T> SectionSpan(const Section& section) const;
+
+    boost::interprocess::file_mapping file_;
+    boost::interprocess::mapped_region region_;
+    const char* data_ = nullptr;
+    const Header* header_ = nullptr;
+
+    std::string_view strings_;
+    std::span<const AuthorRecord> authors_;
+    std::span<const uint32_t> authors_by_id_;
+    std::span<const BookRecord> books_;
+    std::span<const uint32_t> books_by_title_;
+    std::span<const uint32_t> books_by_id_;
+    std::span<const StringRef> tag_names_;
+    std::span<const uint32_t> book_tags_;
+};
+
+// Идентификатор из записи снимка
+template <typename Id>
+Id IdFromRecord(const uint8_t (&bytes)[16]) {
+    util::detail::UUIDType uuid;
+    std::copy(bytes, bytes + 16, uuid.begin());
+    return Id{uuid};
+}
+
+}  // namespace snapshot
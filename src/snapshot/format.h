@@ -0,0 +1,80 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+
+namespace snapshot {
+
+/**
+ * Формат файла снимка каталога. Все числа little-endian, записи фиксированной ширины,
+ * строки лежат в общей арене и адресуются парой (смещение, длина).
+ * Файл отображается в память как есть: секции выровнены по 8 байт, индексы уже отсортированы.
+ *
+ *   Header
+ *   strings        - арена строк
+ *   authors        - AuthorRecord, по имени
+ *   authors_by_id  - uint32 номера авторов, по id
+ *   books          - BookRecord, сгруппированы по автору (в порядке authors),
+ *                    внутри автора по году и названию - как GetBookByAuthorId
+ *   books_by_title - uint32 номера книг, по (название, имя автора, год) - как GetList
+ *   books_by_id    - uint32 номера книг, по id
+ *   tag_names      - StringRef, по имени
+ *   book_tags      - uint32 номера тегов, у каждой книги свой отрезок, по имени тега
+ */
+
+constexpr char MAGIC[8] = {'B', 'K', 'P', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t FORMAT_VERSION = 1;
+
+static_assert(std::endian::native == std::endian::little, "Snapshot format assumes a little-endian host");
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct Section {
+    uint64_t offset;  // от начала файла
+    uint64_t count;   // элементов (для арены строк - байт)
+};
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    // CRC-32 всех байт файла после заголовка
+    uint64_t checksum;
+    Section strings;
+    Section authors;
+    Section authors_by_id;
+    Section books;
+    Section books_by_title;
+    Section books_by_id;
+    Section tag_names;
+    Section book_tags;
+};
+
+struct AuthorRecord {
+    uint8_t id[16];
+    StringRef name;
+    int32_t version;
+    uint32_t first_book;
+    uint32_t book_count;
+    uint32_t reserved;
+};
+
+struct BookRecord {
+    uint8_t id[16];
+    StringRef title;
+    uint32_t author;
+    int32_t year;
+    int32_t version;
+    uint32_t first_tag;
+    uint32_t tag_count;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(Header) == 160);
+static_assert(sizeof(AuthorRecord) == 40);
+static_assert(sizeof(BookRecord) == 48);
+
+}  // namespace snapshot
@@ -0,0 +1,232 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+#include "../metrics/metrics.h"
+
+namespace snapshot {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr auto SCHEME = "snapshot:"sv;
+
+metrics::LatencyMetric& SnapshotLatency(std::string_view name) {
+    return metrics::Latency(metrics::Scope::STATEMENT, name);
+}
+
+domain::Author MakeAuthor(const Catalog& catalog, const AuthorRecord& author) {
+    return domain::Author(IdFromRecord<domain::AuthorId>(author.id), std::string(catalog.String(author.name)),
+                          author.version);
+}
+
+}  // namespace
+
+bool IsSnapshotUrl(std::string_view url) {
+    return url.substr(0, SCHEME.size()) == SCHEME;
+}
+
+SnapshotUrl ParseUrl(std::string_view url) {
+    url.remove_prefix(SCHEME.size());
+    if (url.substr(0, 2) == "//"sv) {
+        url.remove_prefix(2);
+    }
+    SnapshotUrl result;
+    if (auto query = url.find('?'); query != url.npos) {
+        result.verify_checksum = url.substr(query + 1) != "verify=0"sv;
+        url = url.substr(0, query);
+    }
+    result.path = std::string(url);
+    return result;
+}
+
+domain::AuthorRepository::list_authors_t AuthorRepositoryImpl::GetList() {
+    list_authors_t authors;
+    authors.reserve(catalog_.Authors().size());
+    ForEach([&authors](const domain::Author& author) {
+        authors.push_back(author);
+    });
+    return authors;
+}
+
+std::optional<domain::Author> AuthorRepositoryImpl::FindAuthorByName(const std::string& name) {
+    static auto& latency = SnapshotLatency("snapshot.authors.by_name"sv);
+    metrics::ScopedTimer timer{latency};
+    if (const auto* author = catalog_.FindAuthorByName(name)) {
+        return MakeAuthor(catalog_, *author);
+    }
+    return std::nullopt;
+}
+
+void AuthorRepositoryImpl::ForEach(const std::function<void(const domain::Author&)>& visitor) {
+    static auto& latency = SnapshotLatency("snapshot.authors.list"sv);
+    metrics::ScopedTimer timer{latency};
+    for (const auto& author : catalog_.Authors()) {
+        visitor(MakeAuthor(catalog_, author));
+    }
+}
+
+domain::Book BookRepositoryImpl::MakeBook(const BookRecord& book) const {
+    return domain::Book(IdFromRecord<domain::BookId>(book.id), MakeAuthor(catalog_, catalog_.AuthorOf(book)),
+                        std::string(catalog_.String(book.title)), book.year, book.version);
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetList() {
+    list_books_t books;
+    books.reserve(catalog_.Books().size());
+    ForEach([&books](const domain::Book& book) {
+        books.push_back(book);
+    });
+    return books;
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBookByAuthorId(const domain::AuthorId& author_id) {
+    static auto& latency = SnapshotLatency("snapshot.books.by_author"sv);
+    metrics::ScopedTimer timer{latency};
+    list_books_t books;
+    if (auto author = catalog_.FindAuthor(*author_id)) {
+        for (const auto& book : catalog_.BooksOf(catalog_.Authors()[*author])) {
+            books.push_back(MakeBook(book));
+        }
+    }
+    return books;
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByTitle(const std::string& title) {
+    static auto& latency = SnapshotLatency("snapshot.books.by_title"sv);
+    metrics::ScopedTimer timer{latency};
+    list_books_t books;
+    for (auto index : catalog_.FindBooksByTitle(title)) {
+        books.push_back(MakeBook(catalog_.Books()[index]));
+    }
+    return books;
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByYearRange(const domain::YearRangeQuery& query) {
+    static auto& latency = SnapshotLatency("snapshot.books.by_years"sv);
+    metrics::ScopedTimer timer{latency};
+    // Индекса по годам в снимке нет: записи книг компактные, год сверяется до сборки domain::Book
+    std::span<const BookRecord> records = catalog_.Books();
+    if (query.author_id) {
+        const auto author = catalog_.FindAuthor(**query.author_id);
+        if (!author) {
+            return {};
+        }
+        records = catalog_.BooksOf(catalog_.Authors()[*author]);
+    }
+    list_books_t books;
+    for (const auto& record : records) {
+        if (record.year >= query.from_year && record.year <= query.to_year) {
+            books.push_back(MakeBook(record));
+        }
+    }
+    return SelectYearRange(std::move(books), query);
+}
+
+void BookRepositoryImpl::ForEach(const std::function<void(const domain::Book&)>& visitor) {
+    static auto& latency = SnapshotLatency("snapshot.books.list"sv);
+    metrics::ScopedTimer timer{latency};
+    for (auto index : catalog_.BooksByTitle()) {
+        visitor(MakeBook(catalog_.Books()[index]));
+    }
+}
+
+domain::TagRepository::list_tags_t TagRepositoryImpl::GetTagsByBookId(const domain::BookId& book_id) {
+    static auto& latency = SnapshotLatency("snapshot.book_tags.by_book"sv);
+    metrics::ScopedTimer timer{latency};
+    list_tags_t tags;
+    if (auto book = catalog_.FindBook(*book_id)) {
+        for (auto tag : catalog_.TagsOf(catalog_.Books()[*book])) {
+            tags.push_back({book_id, std::string(catalog_.TagName(tag))});
+        }
+    }
+    return tags;
+}
+
+void TagRepositoryImpl::ForEach(const std::function<void(const domain::Tag&)>& visitor) {
+    for (const auto& book : catalog_.Books()) {
+        const auto book_id = IdFromRecord<domain::BookId>(book.id);
+        for (auto tag : catalog_.TagsOf(book)) {
+            visitor(domain::Tag(book_id, std::string(catalog_.TagName(tag))));
+        }
+    }
+}
+
+int StatsRepositoryImpl::CountBooks() {
+    return static_cast<int>(catalog_.Books().size());
+}
+
+int StatsRepositoryImpl::CountAuthorBooks(const domain::AuthorId& author_id) {
+    if (auto author = catalog_.FindAuthor(*author_id)) {
+        return static_cast<int>(catalog_.Authors()[*author].book_count);
+    }
+    return 0;
+}
+
+domain::StatsRepository::top_authors_t StatsRepositoryImpl::TopAuthors(size_t limit) {
+    static auto& latency = SnapshotLatency("snapshot.stats.top_authors"sv);
+    metrics::ScopedTimer timer{latency};
+    // Авторы уже отсортированы по имени: стабильная сортировка по числу книг сохраняет этот порядок при равенстве
+    std::vector<const AuthorRecord*> authors;
+    authors.reserve(catalog_.Authors().size());
+    for (const auto& author : catalog_.Authors()) {
+        if (author.book_count > 0) {
+            authors.push_back(&author);
+        }
+    }
+    std::stable_sort(authors.begin(), authors.end(), [](const AuthorRecord* lhs, const AuthorRecord* rhs) {
+        return lhs->book_count > rhs->book_count;
+    });
+    top_authors_t top;
+    for (size_t i = 0; i < authors.size() && i < limit; ++i) {
+        top.push_back({IdFromRecord<domain::AuthorId>(authors[i]->id), std::string(catalog_.String(authors[i]->name)),
+                       static_cast<int>(authors[i]->book_count)});
+    }
+    return top;
+}
+
+domain::StatsRepository::top_tags_t StatsRepositoryImpl::TopTags(size_t limit) {
+    static auto& latency = SnapshotLatency("snapshot.stats.top_tags"sv);
+    metrics::ScopedTimer timer{latency};
+    std::vector<int> counts;
+    for (const auto& book : catalog_.Books()) {
+        for (auto tag : catalog_.TagsOf(book)) {
+            if (tag >= counts.size()) {
+                counts.resize(tag + 1);
+            }
+            ++counts[tag];
+        }
+    }
+    top_tags_t tags;
+    for (uint32_t tag = 0; tag < counts.size(); ++tag) {
+        if (counts[tag] > 0) {
+            tags.push_back({std::string(catalog_.TagName(tag)), counts[tag]});
+        }
+    }
+    auto middle = tags.begin() + static_cast<std::ptrdiff_t>(std::min(limit, tags.size()));
+    std::partial_sort(tags.begin(), middle, tags.end(), [](const domain::TagBooks& lhs, const domain::TagBooks& rhs) {
+        return std::forward_as_tuple(rhs.books, lhs.tag) < std::forward_as_tuple(lhs.books, rhs.tag);
+    });
+    tags.erase(middle, tags.end());
+    return tags;
+}
+
+domain::StatsRepository::years_t StatsRepositoryImpl::BooksPerYear() {
+    static auto& latency = SnapshotLatency("snapshot.stats.years"sv);
+    metrics::ScopedTimer timer{latency};
+    std::map<int, int> counts;
+    for (const auto& book : catalog_.Books()) {
+        ++counts[book.year];
+    }
+    years_t years;
+    years.reserve(counts.size());
+    for (const auto& [year, books] : counts) {
+        years.push_back({year, books});
+    }
+    return years;
+}
+
+}  // namespace snapshot
@@ -0,0 +1,123 @@
+#pragma once
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+#include "../domain/stats.h"
+#include "../domain/tag.h"
+#include "catalog.h"
+
+namespace snapshot {
+
+class ReadOnlyError : public std::runtime_error {
+public:
+    ReadOnlyError()
+        : std::runtime_error("Snapshot catalog is read-only") {
+    }
+};
+
+struct SnapshotUrl {
+    std::string path;
+    bool verify_checksum = true;
+};
+
+// snapshot://path или snapshot:path, ?verify=0 - не считать контрольную сумму при открытии
+bool IsSnapshotUrl(std::string_view url);
+SnapshotUrl ParseUrl(std::string_view url);
+
+class AuthorRepositoryImpl : public domain::AuthorRepository {
+public:
+    explicit AuthorRepositoryImpl(const Catalog& catalog)
+        : catalog_{catalog} {
+    }
+
+    void DeleteAuthorAndDependencies(const domain::Author&) override {
+        throw ReadOnlyError();
+    }
+    void Save(const domain::Author&) override {
+        throw ReadOnlyError();
+    }
+    list_authors_t GetList() override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+    void ForEach(const std::function<void(const domain::Author&)>& visitor) override;
+
+private:
+    const Catalog& catalog_;
+};
+
+class BookRepositoryImpl : public domain::BookRepository {
+public:
+    explicit BookRepositoryImpl(const Catalog& catalog)
+        : catalog_{catalog} {
+    }
+
+    void Save(const domain::Book&) override {
+        throw ReadOnlyError();
+    }
+    void Edit(const domain::Book&) override {
+        throw ReadOnlyError();
+    }
+    void Delete(const domain::BookId&) override {
+        throw ReadOnlyError();
+    }
+    list_books_t GetList() override;
+    list_books_t GetBookByAuthorId(const domain::AuthorId& author_id) override;
+    list_books_t GetBooksByTitle(const std::string& title) override;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) override;
+    void ForEach(const std::function<void(const domain::Book&)>& visitor) override;
+
+private:
+    domain::Book MakeBook(const BookRecord& book) const;
+
+    const Catalog& catalog_;
+};
+
+class TagRepositoryImpl : public domain::TagRepository {
+public:
+    explicit TagRepositoryImpl(const Catalog& catalog)
+        : catalog_{catalog} {
+    }
+
+    void ClearTagsByBookId(const domain::BookId&) override {
+        throw ReadOnlyError();
+    }
+    void Save(const domain::Tag&) override {
+        throw ReadOnlyError();
+    }
+    bool SyncBookTags(const domain::Book&, const std::vector<std::string>&) override {
+        throw ReadOnlyError();
+    }
+    list_tags_t GetTagsByBookId(const domain::BookId& book_id) override;
+    void ForEach(const std::function<void(const domain::Tag&)>& visitor) override;
+
+private:
+    const Catalog& catalog_;
+};
+
+// Отдельных счётчиков в снимке нет: число книг автора лежит в его записи,
+// теги и годы считаются одним проходом по отображению
+class StatsRepositoryImpl : public domain::StatsRepository {
+public:
+    explicit StatsRepositoryImpl(const Catalog& catalog)
+        : catalog_{catalog} {
+    }
+
+    int CountBooks() override;
+    int CountAuthorBooks(const domain::AuthorId& author_id) override;
+    top_authors_t TopAuthors(size_t limit) override;
+    top_tags_t TopTags(size_t limit) override;
+    years_t BooksPerYear() override;
+    // Снимок неизменен и согласован при записи, сверять нечего
+    mismatches_t Verify() override {
+        return {};
+    }
+
+private:
+    const Catalog& catalog_;
+};
+
+}  // namespace snapshot
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "snapshot.h"
+#include "../unit/unit_of_work.h"
+#include "../unit/unit_of_work_factory.h"
+
+namespace snapshot {
+
+// Снимок неизменен, поэтому транзакции и точки сохранения ничего не делают
+class UnitOfWorkImpl : public app::UnitOfWork {
+    public:
+        explicit UnitOfWorkImpl(const Catalog & catalog)
+            : authors_{catalog}
+            , books_{catalog}
+            , tags_{catalog}
+            , stats_{catalog} {}
+
+        void Commit() override {}
+        void BeginSavepoint() override {}
+        void RollbackToSavepoint() override {}
+        void ReleaseSavepoint() override {}
+        AuthorRepositoryImpl & Authors() override {
+            return authors_;
+        }
+        BookRepositoryImpl & Books() override {
+            return books_;
+        }
+        TagRepositoryImpl & Tags() override {
+            return tags_;
+        }
+        StatsRepositoryImpl & Stats() override {
+            return stats_;
+        }
+    private:
+        AuthorRepositoryImpl authors_;
+        BookRepositoryImpl books_;
+        TagRepositoryImpl tags_;
+        StatsRepositoryImpl stats_;
+};
+
+class UnitOfWorkFactoryImpl : public app::UnitOfWorkFactory {
+    public:
+        explicit UnitOfWorkFactoryImpl(const SnapshotUrl & url)
+            : catalog_{url.path, url.verify_checksum} {}
+
+        std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+            return std::make_shared<UnitOfWorkImpl>(catalog_);
+        }
+    private:
+        Catalog catalog_;
+};
+
+}
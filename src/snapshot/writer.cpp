@@ -0,0 +1,300 @@
+#include "writer.h"
+
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <tuple>
+#include <unistd.h>
+
+#include "format.h"
+
+namespace snapshot {
+
+using namespace std::literals;
+
+namespace {
+
+using Uuid = util::detail::UUIDType;
+
+// Смещения и номера в формате 32-битные
+uint32_t ToUint32(size_t value, std::string_view what) {
+    if (value > std::numeric_limits<uint32_t>::max()) {
+        throw std::length_error("Snapshot "s + std::string(what) + " does not fit in 32 bits"s);
+    }
+    return static_cast<uint32_t>(value);
+}
+
+class FileBuilder {
+public:
+    FileBuilder() {
+        data_.resize(sizeof(Header));
+    }
+
+    StringRef AddString(std::string_view value) {
+        // Конец строки тоже должен уместиться: смещение + длина не больше 4 ГиБ
+        ToUint32(strings_.size() + value.size(), "string arena"sv);
+        StringRef ref{static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(value.size())};
+        strings_ += value;
+        return ref;
+    }
+
+    template <typename T>
+    Section AppendArray(const std::vector<T>& items) {
+        Align();
+        Section section{data_.size(), items.size()};
+        const auto* bytes = reinterpret_cast<const char*>(items.data());
+        data_.append(bytes, bytes + items.size() * sizeof(T));
+        return section;
+    }
+
+    Section AppendStrings() {
+        Align();
+        Section section{data_.size(), strings_.size()};
+        data_ += strings_;
+        return section;
+    }
+
+    std::string Finish(Header header) {
+        Align();
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = FORMAT_VERSION;
+        header.header_size = sizeof(Header);
+        header.file_size = data_.size();
+        boost::crc_32_type crc;
+        crc.process_bytes(data_.data() + sizeof(Header), data_.size() - sizeof(Header));
+        header.checksum = crc.checksum();
+        std::memcpy(data_.data(), &header, sizeof(Header));
+        return std::move(data_);
+    }
+
+private:
+    void Align() {
+        data_.resize((data_.size() + 7) / 8 * 8, '\0');
+    }
+
+    std::string data_;
+    std::string strings_;
+};
+
+void CopyId(const Uuid& id, uint8_t (&out)[16]) {
+    std::copy(id.begin(), id.end(), out);
+}
+
+// Номер элемента с таким id в отсортированном по id индексе
+template <typename Id>
+std::optional<uint32_t> FindById(const std::vector<uint32_t>& by_id, const std::vector<Id>& ids, const Uuid& id) {
+    auto it = std::lower_bound(by_id.begin(), by_id.end(), id, [&ids](uint32_t index, const Uuid& value) {
+        return *ids[index] < value;
+    });
+    if (it == by_id.end() || *ids[*it] != id) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+std::vector<uint32_t> SortedById(size_t count, auto id_of) {
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&id_of](uint32_t lhs, uint32_t rhs) {
+        return *id_of(lhs) < *id_of(rhs);
+    });
+    return order;
+}
+
+}  // namespace
+
+void Writer::AddAuthor(const domain::Author& author) {
+    authors_.push_back(author);
+}
+
+void Writer::AddBook(const domain::Book& book) {
+    books_.push_back(book);
+}
+
+void Writer::AddTag(const domain::Tag& tag) {
+    tags_.push_back(tag);
+}
+
+std::string Writer::Build() const {
+    FileBuilder file;
+
+    // Авторы по имени
+    auto authors = authors_;
+    std::sort(authors.begin(), authors.end(), [](const domain::Author& lhs, const domain::Author& rhs) {
+        return lhs.GetName() < rhs.GetName();
+    });
+    std::vector<domain::AuthorId> author_ids;
+    author_ids.reserve(authors.size());
+    for (const auto& author : authors) {
+        author_ids.push_back(author.GetId());
+    }
+    const auto authors_by_id = SortedById(authors.size(), [&author_ids](uint32_t i) -> const domain::AuthorId& {
+        return author_ids[i];
+    });
+
+    // Книги по автору, году и названию. Книги без автора в каталоге пропускаются
+    struct BookRow {
+        uint32_t author;
+        const domain::Book* book;
+    };
+    std::vector<BookRow> rows;
+    rows.reserve(books_.size());
+    for (const auto& book : books_) {
+        if (auto author = FindById(authors_by_id, author_ids, *book.GetAuthorId())) {
+            rows.push_back({*author, &book});
+        }
+    }
+    std::sort(rows.begin(), rows.end(), [](const BookRow& lhs, const BookRow& rhs) {
+        return std::forward_as_tuple(lhs.author, lhs.book->GetYear(), lhs.book->GetTitle())
+             < std::forward_as_tuple(rhs.author, rhs.book->GetYear(), rhs.book->GetTitle());
+    });
+    std::vector<domain::BookId> book_ids;
+    book_ids.reserve(rows.size());
+    for (const auto& row : rows) {
+        book_ids.push_back(row.book->GetId());
+    }
+    const auto books_by_id = SortedById(rows.size(), [&book_ids](uint32_t i) -> const domain::BookId& {
+        return book_ids[i];
+    });
+
+    // Словарь тегов и теги каждой книги
+    std::vector<std::string> tag_names;
+    for (const auto& tag : tags_) {
+        tag_names.push_back(tag.GetTag());
+    }
+    std::sort(tag_names.begin(), tag_names.end());
+    tag_names.erase(std::unique(tag_names.begin(), tag_names.end()), tag_names.end());
+    std::vector<std::vector<uint32_t>> tags_of_book(rows.size());
+    for (const auto& tag : tags_) {
+        if (auto book = FindById(books_by_id, book_ids, *tag.GetBookId())) {
+            const auto name = std::lower_bound(tag_names.begin(), tag_names.end(), tag.GetTag());
+            tags_of_book[*book].push_back(static_cast<uint32_t>(name - tag_names.begin()));
+        }
+    }
+
+    ToUint32(authors.size(), "author count"sv);
+    ToUint32(rows.size(), "book count"sv);
+    std::vector<AuthorRecord> author_records(authors.size());
+    for (size_t i = 0; i < authors.size(); ++i) {
+        auto& record = author_records[i];
+        CopyId(*authors[i].GetId(), record.id);
+        record.name = file.AddString(authors[i].GetName());
+        record.version = authors[i].GetVersion();
+    }
+
+    std::vector<BookRecord> book_records(rows.size());
+    std::vector<uint32_t> book_tags;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const auto& book = *rows[i].book;
+        auto& record = book_records[i];
+        CopyId(*book.GetId(), record.id);
+        record.title = file.AddString(book.GetTitle());
+        record.author = rows[i].author;
+        record.year = book.GetYear();
+        record.version = book.GetVersion();
+
+        auto& author = author_records[rows[i].author];
+        if (author.book_count++ == 0) {
+            author.first_book = static_cast<uint32_t>(i);
+        }
+
+        auto& tags = tags_of_book[i];
+        std::sort(tags.begin(), tags.end());
+        tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+        record.first_tag = ToUint32(book_tags.size(), "book tag count"sv);
+        record.tag_count = static_cast<uint32_t>(tags.size());
+        ToUint32(book_tags.size() + tags.size(), "book tag count"sv);
+        book_tags.insert(book_tags.end(), tags.begin(), tags.end());
+    }
+
+    std::vector<uint32_t> books_by_title(rows.size());
+    std::iota(books_by_title.begin(), books_by_title.end(), 0);
+    std::sort(books_by_title.begin(), books_by_title.end(), [&rows, &authors](uint32_t lhs, uint32_t rhs) {
+        const auto& left = *rows[lhs].book;
+        const auto& right = *rows[rhs].book;
+        return std::forward_as_tuple(left.GetTitle(), authors[rows[lhs].author].GetName(), left.GetYear())
+             < std::forward_as_tuple(right.GetTitle(), authors[rows[rhs].author].GetName(), right.GetYear());
+    });
+
+    std::vector<StringRef> tag_refs;
+    tag_refs.reserve(tag_names.size());
+    for (const auto& name : tag_names) {
+        tag_refs.push_back(file.AddString(name));
+    }
+
+    Header header{};
+    header.strings = file.AppendStrings();
+    header.authors = file.AppendArray(author_records);
+    header.authors_by_id = file.AppendArray(authors_by_id);
+    header.books = file.AppendArray(book_records);
+    header.books_by_title = file.AppendArray(books_by_title);
+    header.books_by_id = file.AppendArray(books_by_id);
+    header.tag_names = file.AppendArray(tag_refs);
+    header.book_tags = file.AppendArray(book_tags);
+    return file.Finish(header);
+}
+
+void Writer::Write(const std::string& path) const {
+    const auto data = Build();
+    const auto tmp_path = path + ".tmp"s;
+    const int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Can't write snapshot "s + tmp_path);
+    }
+    // Содержимое на диске раньше, чем переименование: после сбоя под path не окажется пустой или недописанный файл
+    size_t written = 0;
+    while (written < data.size()) {
+        const auto result = ::write(fd, data.data() + written, data.size() - written);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0) {
+            const auto error = errno;
+            ::close(fd);
+            std::remove(tmp_path.c_str());
+            throw std::system_error(error, std::generic_category(), "Can't write snapshot "s + tmp_path);
+        }
+        written += static_cast<size_t>(result);
+    }
+    if (::fsync(fd) != 0 || ::close(fd) != 0) {
+        const auto error = errno;
+        std::remove(tmp_path.c_str());
+        throw std::system_error(error, std::generic_category(), "Can't sync snapshot "s + tmp_path);
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Can't replace snapshot "s + path);
+    }
+    // Переименование тоже должно пережить сбой
+    const auto slash = path.rfind('/');
+    const auto dir = slash == std::string::npos ? "."s : (slash == 0 ? "/"s : path.substr(0, slash));
+    const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd >= 0) {
+        ::fsync(dir_fd);
+        ::close(dir_fd);
+    }
+}
+
+Writer ExportCatalog(app::UnitOfWork& unit) {
+    Writer writer;
+    unit.Authors().ForEach([&writer](const domain::Author& author) {
+        writer.AddAuthor(author);
+    });
+    unit.Books().ForEach([&writer](const domain::Book& book) {
+        writer.AddBook(book);
+    });
+    unit.Tags().ForEach([&writer](const domain::Tag& tag) {
+        writer.AddTag(tag);
+    });
+    return writer;
+}
+
+}  // namespace snapshot
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+#include "../domain/tag.h"
+#include "../unit/unit_of_work.h"
+
+namespace snapshot {
+
+// Собирает каталог и записывает его файлом снимка (формат - в format.h)
+class Writer {
+public:
+    void AddAuthor(const domain::Author& author);
+    // Имя автора книги не используется: книга связывается с автором по id
+    void AddBook(const domain::Book& book);
+    void AddTag(const domain::Tag& tag);
+
+    // Готовое содержимое файла
+    std::string Build() const;
+    // Пишет во временный файл рядом и переименовывает: читатели не увидят недописанный снимок
+    void Write(const std::string& path) const;
+
+    size_t AuthorCount() const noexcept {
+        return authors_.size();
+    }
+    size_t BookCount() const noexcept {
+        return books_.size();
+    }
+    size_t TagCount() const noexcept {
+        return tags_.size();
+    }
+
+private:
+    std::vector<domain::Author> authors_;
+    std::vector<domain::Book> books_;
+    std::vector<domain::Tag> tags_;
+};
+
+// Выгружает весь каталог, видимый в транзакции unit
+Writer ExportCatalog(app::UnitOfWork& unit);
+
+}  // namespace snapshot
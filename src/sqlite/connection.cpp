@@ -0,0 +1,121 @@
+#include "connection.h"
+
+#include <sqlite3.h>
+
+#include "../unit/constraint_violation.h"
+
+namespace sqlite {
+
+using namespace std::literals;
+
+namespace {
+
+[[noreturn]] void ThrowError(sqlite3* db, std::string_view what) {
+    auto message = std::string(what) + ": "s + sqlite3_errmsg(db);
+    if ((sqlite3_errcode(db) & 0xff) == SQLITE_CONSTRAINT) {
+        throw app::ConstraintViolation(message);
+    }
+    throw Error(message);
+}
+
+}  // namespace
+
+Statement::~Statement() {
+    sqlite3_reset(stmt_);
+    sqlite3_clear_bindings(stmt_);
+}
+
+bool Statement::Step() {
+    switch (sqlite3_step(stmt_)) {
+        case SQLITE_ROW:
+            return true;
+        case SQLITE_DONE:
+            return false;
+        default:
+            ThrowError(db_, sqlite3_sql(stmt_));
+    }
+}
+
+int Statement::Run() {
+    while (Step()) {
+    }
+    return sqlite3_changes(db_);
+}
+
+int Statement::ColumnInt(int column) const {
+    return sqlite3_column_int(stmt_, column);
+}
+
+int64_t Statement::ColumnInt64(int column) const {
+    return sqlite3_column_int64(stmt_, column);
+}
+
+std::string_view Statement::ColumnView(int column) const {
+    const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, column));
+    if (!text) {
+        return {};
+    }
+    return {text, static_cast<size_t>(sqlite3_column_bytes(stmt_, column))};
+}
+
+void Statement::BindOne(int index, std::string_view value) {
+    if (sqlite3_bind_text(stmt_, index, value.data(), static_cast<int>(value.size()), SQLITE_TRANSIENT) != SQLITE_OK) {
+        ThrowError(db_, "bind"sv);
+    }
+}
+
+void Statement::BindOne(int index, int64_t value) {
+    if (sqlite3_bind_int64(stmt_, index, value) != SQLITE_OK) {
+        ThrowError(db_, "bind"sv);
+    }
+}
+
+Connection::Connection(const std::string& path) {
+    if (sqlite3_open_v2(path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX,
+                        nullptr) != SQLITE_OK) {
+        std::string message = db_ ? sqlite3_errmsg(db_) : "out of memory";
+        sqlite3_close(db_);
+        throw Error("Can't open "s + path + ": "s + message);
+    }
+    // Запись другим процессом не обрывает транзакцию сразу, а ждёт освобождения блокировки
+    sqlite3_busy_timeout(db_, 5000);
+}
+
+Connection::~Connection() {
+    for (auto& [sql, stmt] : statements_) {
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_close(db_);
+}
+
+void Connection::StartPendingBegin() {
+    if (CancelPendingBegin()) {
+        Exec("BEGIN IMMEDIATE;");
+    }
+}
+
+void Connection::Exec(const char* sql) {
+    StartPendingBegin();
+    char* error = nullptr;
+    if (sqlite3_exec(db_, sql, nullptr, nullptr, &error) != SQLITE_OK) {
+        std::string message = error ? error : sqlite3_errmsg(db_);
+        sqlite3_free(error);
+        throw Error(message);
+    }
+}
+
+Statement Connection::Prepare(std::string_view sql) {
+    StartPendingBegin();
+    auto it = statements_.find(sql);
+    if (it == statements_.end()) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v3(db_, sql.data(), static_cast<int>(sql.size()), SQLITE_PREPARE_PERSISTENT, &stmt,
+                               nullptr) != SQLITE_OK) {
+            ThrowError(db_, sql);
+        }
+        it = statements_.emplace(std::string(sql), stmt).first;
+    }
+    return Statement{db_, it->second};
+}
+
+}  // namespace sqlite
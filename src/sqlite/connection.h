@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace sqlite {
+
+class Error : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * Подготовленный запрос из кэша соединения. Привязанные параметры и позиция курсора
+ * сбрасываются в деструкторе, сам запрос остаётся в кэше для следующего вызова.
+ */
+class Statement {
+public:
+    Statement(sqlite3* db, sqlite3_stmt* stmt) noexcept
+        : db_{db}
+        , stmt_{stmt} {
+    }
+    ~Statement();
+
+    Statement(const Statement&) = delete;
+    Statement& operator=(const Statement&) = delete;
+
+    template <typename... Args>
+    Statement& Bind(const Args&... args) {
+        int index = 0;
+        (BindOne(++index, args), ...);
+        return *this;
+    }
+
+    // true - получена очередная строка, false - запрос выполнен до конца
+    bool Step();
+    // Выполняет запрос, не возвращающий строк. Возвращает число изменённых строк
+    int Run();
+
+    int ColumnInt(int column) const;
+    int64_t ColumnInt64(int column) const;
+    // Действительна до следующего Step
+    std::string_view ColumnView(int column) const;
+    std::string ColumnText(int column) const {
+        return std::string(ColumnView(column));
+    }
+
+private:
+    void BindOne(int index, std::string_view value);
+    void BindOne(int index, const std::string& value) {
+        BindOne(index, std::string_view{value});
+    }
+    void BindOne(int index, const char* value) {
+        BindOne(index, std::string_view{value});
+    }
+    void BindOne(int index, int64_t value);
+    template <typename T>
+    std::enable_if_t<std::is_integral_v<T>> BindOne(int index, T value) {
+        BindOne(index, static_cast<int64_t>(value));
+    }
+
+    sqlite3* db_;
+    sqlite3_stmt* stmt_;
+};
+
+// Соединение с файлом базы и кэш подготовленных по нему запросов
+class Connection {
+public:
+    explicit Connection(const std::string& path);
+    ~Connection();
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    // Запросы без параметров и результата: схема, BEGIN/COMMIT, PRAGMA
+    void Exec(const char* sql);
+    // Запрос готовится при первом вызове с этим текстом и дальше берётся из кэша
+    Statement Prepare(std::string_view sql);
+
+    // Транзакция начнётся BEGIN IMMEDIATE перед первым запросом через Exec или Prepare; до него блокировок нет
+    void BeginOnFirstUse() noexcept {
+        begin_pending_ = true;
+    }
+    // Отменяет ещё не начатую транзакцию. false - она уже идёт, и её нужно завершить
+    bool CancelPendingBegin() noexcept {
+        return std::exchange(begin_pending_, false);
+    }
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    void StartPendingBegin();
+
+    sqlite3* db_ = nullptr;
+    bool begin_pending_ = false;
+    std::unordered_map<std::string, sqlite3_stmt*, StringHash, std::equal_to<>> statements_;
+};
+
+}  // namespace sqlite
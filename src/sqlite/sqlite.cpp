@@ -0,0 +1,527 @@
+#include "sqlite.h"
+
+#include <algorithm>
+#include <limits>
+#include <set>
+
+#include "../domain/errors.h"
+#include "../metrics/metrics.h"
+#include "../metrics/startup.h"
+
+namespace sqlite {
+
+using namespace std::literals;
+
+namespace {
+
+constexpr auto SCHEME = "sqlite:"sv;
+
+metrics::LatencyMetric& StatementLatency(std::string_view name) {
+    return metrics::Latency(metrics::Scope::STATEMENT, name);
+}
+
+domain::Author AuthorFromRow(const Statement& stmt) {
+    return domain::Author(domain::AuthorId::FromString(stmt.ColumnView(0)), stmt.ColumnText(1), stmt.ColumnInt(2));
+}
+
+// Столбцы: id, author_id, name, title, publication_year, version
+domain::Book BookFromRow(const Statement& stmt) {
+    return domain::Book(domain::BookId::FromString(stmt.ColumnView(0)),
+                        {domain::AuthorId::FromString(stmt.ColumnView(1)), stmt.ColumnText(2)},
+                        stmt.ColumnText(3), stmt.ColumnInt(4), stmt.ColumnInt(5));
+}
+
+domain::BookRepository::list_books_t BooksFromStatement(Statement& stmt) {
+    domain::BookRepository::list_books_t books;
+    while (stmt.Step()) {
+        books.push_back(BookFromRow(stmt));
+    }
+    return books;
+}
+
+}  // namespace
+
+bool IsSqliteUrl(std::string_view url) {
+    return url.substr(0, SCHEME.size()) == SCHEME;
+}
+
+std::string PathFromUrl(std::string_view url) {
+    url.remove_prefix(SCHEME.size());
+    if (url.substr(0, 2) == "//"sv) {
+        url.remove_prefix(2);
+    }
+    return std::string(url);
+}
+
+void AuthorRepositoryImpl::DeleteAuthorAndDependencies(const domain::Author& author) {
+    if (!author.GetName().empty()) {
+        static auto& latency = StatementLatency("authors.delete_by_name"sv);
+        metrics::ScopedTimer timer{latency};
+        connection_.Prepare("DELETE FROM authors WHERE name = ?;"sv).Bind(author.GetName()).Run();
+        return;
+    }
+
+    static auto& latency = StatementLatency("authors.delete"sv);
+    metrics::ScopedTimer timer{latency};
+    connection_.Prepare("DELETE FROM authors WHERE id = ?;"sv).Bind(author.GetId().ToString()).Run();
+}
+
+void AuthorRepositoryImpl::Save(const domain::Author& author) {
+    if (author.GetVersion() == 0) {
+        static auto& latency = StatementLatency("authors.save"sv);
+        metrics::ScopedTimer timer{latency};
+        connection_.Prepare(R"(
+INSERT INTO authors (id, name) VALUES (?1, ?2)
+ON CONFLICT (id) DO UPDATE SET name = ?2, version = authors.version + 1;
+)"sv).Bind(author.GetId().ToString(), author.GetName()).Run();
+        return;
+    }
+
+    static auto& latency = StatementLatency("authors.update_versioned"sv);
+    metrics::ScopedTimer timer{latency};
+    auto changed = connection_.Prepare("UPDATE authors SET name = ?2, version = version + 1 WHERE id = ?1 AND version = ?3;"sv)
+        .Bind(author.GetId().ToString(), author.GetName(), author.GetVersion()).Run();
+    if (changed == 0) {
+        throw domain::VersionConflict("Author was changed or deleted by another session");
+    }
+}
+
+domain::AuthorRepository::list_authors_t AuthorRepositoryImpl::GetList() {
+    list_authors_t authors;
+    ForEach([&authors](const domain::Author& author) {
+        authors.push_back(author);
+    });
+    return authors;
+}
+
+std::optional<domain::Author> AuthorRepositoryImpl::FindAuthorByName(const std::string& name) {
+    static auto& latency = StatementLatency("authors.by_name"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare("SELECT id, name, version FROM authors WHERE name = ?;"sv);
+    stmt.Bind(name);
+    if (!stmt.Step()) {
+        return std::nullopt;
+    }
+    return AuthorFromRow(stmt);
+}
+
+void AuthorRepositoryImpl::ForEach(const std::function<void(const domain::Author&)>& visitor) {
+    static auto& latency = StatementLatency("authors.list"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare("SELECT id, name, version FROM authors ORDER BY name ASC;"sv);
+    while (stmt.Step()) {
+        visitor(AuthorFromRow(stmt));
+    }
+}
+
+void BookRepositoryImpl::Delete(const domain::BookId& book_id) {
+    static auto& latency = StatementLatency("books.delete"sv);
+    metrics::ScopedTimer timer{latency};
+    connection_.Prepare("DELETE FROM books WHERE id = ?;"sv).Bind(book_id.ToString()).Run();
+}
+
+void BookRepositoryImpl::Edit(const domain::Book& book) {
+    static auto& latency = StatementLatency("books.edit"sv);
+    metrics::ScopedTimer timer{latency};
+    auto changed = connection_.Prepare(R"(
+UPDATE books SET title = ?2, publication_year = ?3, version = version + 1
+WHERE id = ?1 AND (?4 = 0 OR version = ?4);
+)"sv).Bind(book.GetId().ToString(), book.GetTitle(), book.GetYear(), book.GetVersion()).Run();
+    if (changed == 0) {
+        throw domain::VersionConflict("Book was changed or deleted by another session");
+    }
+}
+
+void BookRepositoryImpl::Save(const domain::Book& book) {
+    static auto& latency = StatementLatency("books.save"sv);
+    metrics::ScopedTimer timer{latency};
+    connection_.Prepare("INSERT INTO books (id, author_id, title, publication_year) VALUES (?, ?, ?, ?);"sv)
+        .Bind(book.GetId().ToString(), book.GetAuthorId().ToString(), book.GetTitle(), book.GetYear())
+        .Run();
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetList() {
+    list_books_t books;
+    ForEach([&books](const domain::Book& book) {
+        books.push_back(book);
+    });
+    return books;
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBookByAuthorId(const domain::AuthorId& author_id) {
+    static auto& latency = StatementLatency("books.by_author"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(R"(
+SELECT id, author_id, '', title, publication_year, version FROM books WHERE author_id = ?
+ORDER BY publication_year ASC, title ASC;
+)"sv);
+    stmt.Bind(author_id.ToString());
+    return BooksFromStatement(stmt);
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByTitle(const std::string& title) {
+    static auto& latency = StatementLatency("books.by_title"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(R"(
+SELECT books.id, author_id, name, title, publication_year, books.version
+FROM books INNER JOIN authors ON books.author_id = authors.id
+WHERE title = ?
+ORDER BY name, publication_year;
+)"sv);
+    stmt.Bind(title);
+    return BooksFromStatement(stmt);
+}
+
+domain::BookRepository::list_books_t BookRepositoryImpl::GetBooksByYearRange(const domain::YearRangeQuery& query) {
+    static auto& latency = StatementLatency("books.by_years"sv);
+    metrics::ScopedTimer timer{latency};
+    // Секций в SQLite нет - диапазон и ключ страницы читаются по индексу books_by_year.
+    // BINARY сравнивает title побайтово, id хранится строкой в нижнем регистре - порядок как у BookKeyLess
+    const auto after = query.after.value_or(domain::BookKey{query.from_year - 1, {}, {}});
+    const auto limit = static_cast<int64_t>(std::min<size_t>(query.limit, std::numeric_limits<int64_t>::max()));
+    if (query.author_id) {
+        auto stmt = connection_.Prepare(R"(
+SELECT books.id, author_id, name, title, publication_year, books.version
+FROM books INNER JOIN authors ON books.author_id = authors.id
+WHERE author_id = ? AND publication_year BETWEEN ? AND ? AND (publication_year, title, books.id) > (?, ?, ?)
+ORDER BY publication_year, title, books.id
+LIMIT ?;
+)"sv);
+        stmt.Bind(query.author_id->ToString(), query.from_year, query.to_year, after.year, after.title,
+                  after.id.ToString(), limit);
+        return BooksFromStatement(stmt);
+    }
+    auto stmt = connection_.Prepare(R"(
+SELECT books.id, author_id, name, title, publication_year, books.version
+FROM books INNER JOIN authors ON books.author_id = authors.id
+WHERE publication_year BETWEEN ? AND ? AND (publication_year, title, books.id) > (?, ?, ?)
+ORDER BY publication_year, title, books.id
+LIMIT ?;
+)"sv);
+    stmt.Bind(query.from_year, query.to_year, after.year, after.title, after.id.ToString(), limit);
+    return BooksFromStatement(stmt);
+}
+
+void BookRepositoryImpl::ForEach(const std::function<void(const domain::Book&)>& visitor) {
+    static auto& latency = StatementLatency("books.list"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(R"(
+SELECT books.id, author_id, name, title, publication_year, books.version
+FROM books INNER JOIN authors ON books.author_id = authors.id
+ORDER BY title, name, publication_year;
+)"sv);
+    while (stmt.Step()) {
+        visitor(BookFromRow(stmt));
+    }
+}
+
+void TagRepositoryImpl::ClearTagsByBookId(const domain::BookId& book_id) {
+    static auto& latency = StatementLatency("book_tags.clear"sv);
+    metrics::ScopedTimer timer{latency};
+    connection_.Prepare("DELETE FROM book_tags WHERE book_id = ?;"sv).Bind(book_id.ToString()).Run();
+}
+
+int TagRepositoryImpl::GetOrCreateTagId(const std::string& name) {
+    static auto& latency = StatementLatency("tags.insert"sv);
+    metrics::ScopedTimer timer{latency};
+    // Вставка и чтение идут в одной транзакции записи: тег виден, кто бы его ни создал
+    connection_.Prepare("INSERT INTO tags (name) VALUES (?) ON CONFLICT (name) DO NOTHING;"sv).Bind(name).Run();
+    auto stmt = connection_.Prepare("SELECT id FROM tags WHERE name = ?;"sv);
+    stmt.Bind(name);
+    stmt.Step();
+    return stmt.ColumnInt(0);
+}
+
+void TagRepositoryImpl::Save(const domain::Tag& tag) {
+    const auto tag_id = GetOrCreateTagId(tag.GetTag());
+    static auto& latency = StatementLatency("book_tags.save"sv);
+    metrics::ScopedTimer timer{latency};
+    connection_.Prepare("INSERT INTO book_tags (book_id, tag_id) VALUES (?, ?) ON CONFLICT DO NOTHING;"sv)
+        .Bind(tag.GetBookId().ToString(), tag_id)
+        .Run();
+}
+
+domain::TagRepository::list_tags_t TagRepositoryImpl::GetTagsByBookId(const domain::BookId& book_id) {
+    static auto& latency = StatementLatency("book_tags.names_by_book"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(R"(
+SELECT tags.name FROM book_tags INNER JOIN tags ON tags.id = book_tags.tag_id
+WHERE book_id = ?
+ORDER BY tags.name;
+)"sv);
+    stmt.Bind(book_id.ToString());
+    list_tags_t tags;
+    while (stmt.Step()) {
+        tags.push_back({book_id, stmt.ColumnText(0)});
+    }
+    return tags;
+}
+
+bool TagRepositoryImpl::SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) {
+    static auto& latency = StatementLatency("book_tags.sync"sv);
+    metrics::ScopedTimer timer{latency};
+    const auto book_id = book.GetId().ToString();
+
+    std::string title;
+    int year = 0;
+    {
+        auto current = connection_.Prepare("SELECT title, publication_year, version FROM books WHERE id = ?;"sv);
+        current.Bind(book_id);
+        if (!current.Step() || (book.GetVersion() != 0 && current.ColumnInt(2) != book.GetVersion())) {
+            throw domain::VersionConflict("Book was changed or deleted by another session");
+        }
+        title = current.ColumnText(0);
+        year = current.ColumnInt(1);
+    }
+
+    std::set<int> desired;
+    for (const auto& tag : tags) {
+        desired.insert(GetOrCreateTagId(tag));
+    }
+    std::set<int> existing;
+    {
+        auto current_tags = connection_.Prepare("SELECT tag_id FROM book_tags WHERE book_id = ?;"sv);
+        current_tags.Bind(book_id);
+        while (current_tags.Step()) {
+            existing.insert(current_tags.ColumnInt(0));
+        }
+    }
+
+    bool changed = false;
+    for (auto tag_id : existing) {
+        if (!desired.count(tag_id)) {
+            connection_.Prepare("DELETE FROM book_tags WHERE book_id = ? AND tag_id = ?;"sv).Bind(book_id, tag_id).Run();
+            changed = true;
+        }
+    }
+    for (auto tag_id : desired) {
+        if (!existing.count(tag_id)) {
+            connection_.Prepare("INSERT INTO book_tags (book_id, tag_id) VALUES (?, ?);"sv).Bind(book_id, tag_id).Run();
+            changed = true;
+        }
+    }
+    if (changed || title != book.GetTitle() || year != book.GetYear()) {
+        connection_.Prepare(R"(
+UPDATE books SET title = ?2, publication_year = ?3, version = version + 1 WHERE id = ?1;
+)"sv).Bind(book_id, book.GetTitle(), book.GetYear()).Run();
+        changed = true;
+    }
+    return changed;
+}
+
+void TagRepositoryImpl::ForEach(const std::function<void(const domain::Tag&)>& visitor) {
+    static auto& latency = StatementLatency("book_tags.stream"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(
+        "SELECT book_id, tags.name FROM book_tags INNER JOIN tags ON tags.id = book_tags.tag_id;"sv);
+    while (stmt.Step()) {
+        visitor(domain::Tag(domain::BookId::FromString(stmt.ColumnView(0)), stmt.ColumnText(1)));
+    }
+}
+
+int StatsRepositoryImpl::CountBooks() {
+    static auto& latency = StatementLatency("stats.books"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare("SELECT COALESCE(sum(book_count), 0) FROM year_stats;"sv);
+    stmt.Step();
+    return stmt.ColumnInt(0);
+}
+
+int StatsRepositoryImpl::CountAuthorBooks(const domain::AuthorId& author_id) {
+    static auto& latency = StatementLatency("stats.author_books"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare("SELECT book_count FROM author_stats WHERE author_id = ?;"sv);
+    stmt.Bind(author_id.ToString());
+    return stmt.Step() ? stmt.ColumnInt(0) : 0;
+}
+
+domain::StatsRepository::top_authors_t StatsRepositoryImpl::TopAuthors(size_t limit) {
+    static auto& latency = StatementLatency("stats.top_authors"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(R"(
+SELECT author_id, name, book_count FROM author_stats
+INNER JOIN authors ON authors.id = author_stats.author_id
+WHERE book_count > 0
+ORDER BY book_count DESC, name
+LIMIT ?;
+)"sv);
+    stmt.Bind(static_cast<int64_t>(std::min<size_t>(limit, std::numeric_limits<int64_t>::max())));
+    top_authors_t authors;
+    while (stmt.Step()) {
+        authors.push_back({domain::AuthorId::FromString(stmt.ColumnView(0)), stmt.ColumnText(1), stmt.ColumnInt(2)});
+    }
+    return authors;
+}
+
+domain::StatsRepository::top_tags_t StatsRepositoryImpl::TopTags(size_t limit) {
+    static auto& latency = StatementLatency("stats.top_tags"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(R"(
+SELECT tags.name, book_count FROM tag_stats
+INNER JOIN tags ON tags.id = tag_stats.tag_id
+WHERE book_count > 0
+ORDER BY book_count DESC, tags.name
+LIMIT ?;
+)"sv);
+    stmt.Bind(static_cast<int64_t>(std::min<size_t>(limit, std::numeric_limits<int64_t>::max())));
+    top_tags_t tags;
+    while (stmt.Step()) {
+        tags.push_back({stmt.ColumnText(0), stmt.ColumnInt(1)});
+    }
+    return tags;
+}
+
+domain::StatsRepository::years_t StatsRepositoryImpl::BooksPerYear() {
+    static auto& latency = StatementLatency("stats.years"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(
+        "SELECT publication_year, book_count FROM year_stats WHERE book_count > 0 ORDER BY publication_year;"sv);
+    years_t years;
+    while (stmt.Step()) {
+        years.push_back({stmt.ColumnInt(0), stmt.ColumnInt(1)});
+    }
+    return years;
+}
+
+domain::StatsRepository::mismatches_t StatsRepositoryImpl::Verify() {
+    static auto& latency = StatementLatency("stats.verify"sv);
+    metrics::ScopedTimer timer{latency};
+    auto stmt = connection_.Prepare(R"(
+SELECT 'author', COALESCE(stats.author_id, actual.author_id), COALESCE(stats.book_count, 0), COALESCE(actual.books, 0)
+FROM author_stats AS stats
+FULL JOIN (SELECT author_id, count(*) AS books FROM books GROUP BY author_id) AS actual
+    ON actual.author_id = stats.author_id
+WHERE COALESCE(stats.book_count, 0) <> COALESCE(actual.books, 0)
+UNION ALL
+SELECT 'tag', COALESCE((SELECT name FROM tags WHERE id = COALESCE(stats.tag_id, actual.tag_id)), ''),
+       COALESCE(stats.book_count, 0), COALESCE(actual.books, 0)
+FROM tag_stats AS stats
+FULL JOIN (SELECT tag_id, count(*) AS books FROM book_tags GROUP BY tag_id) AS actual
+    ON actual.tag_id = stats.tag_id
+WHERE COALESCE(stats.book_count, 0) <> COALESCE(actual.books, 0)
+UNION ALL
+SELECT 'year', CAST(COALESCE(stats.publication_year, actual.publication_year) AS TEXT),
+       COALESCE(stats.book_count, 0), COALESCE(actual.books, 0)
+FROM year_stats AS stats
+FULL JOIN (SELECT publication_year, count(*) AS books FROM books GROUP BY publication_year) AS actual
+    ON actual.publication_year = stats.publication_year
+WHERE COALESCE(stats.book_count, 0) <> COALESCE(actual.books, 0);
+)"sv);
+    mismatches_t mismatches;
+    while (stmt.Step()) {
+        mismatches.push_back({stmt.ColumnText(0), stmt.ColumnText(1), stmt.ColumnInt(2), stmt.ColumnInt(3)});
+    }
+    return mismatches;
+}
+
+Database::Database(const std::string& path)
+    : connection_{path} {
+    metrics::StartupTimer timer{"sqlite.schema"sv};
+    // WAL: читатели не блокируют писателя; NORMAL - fsync только на контрольных точках WAL
+    connection_.Exec("PRAGMA journal_mode = WAL;");
+    connection_.Exec("PRAGMA synchronous = NORMAL;");
+    connection_.Exec("PRAGMA foreign_keys = ON;");
+
+    connection_.Exec(R"(
+BEGIN;
+CREATE TABLE IF NOT EXISTS authors (
+    id TEXT PRIMARY KEY,
+    name VARCHAR(100) UNIQUE NOT NULL,
+    version INT NOT NULL DEFAULT 1
+);
+CREATE TABLE IF NOT EXISTS books (
+    id TEXT CONSTRAINT book_id_constraint PRIMARY KEY,
+    author_id TEXT NOT NULL,
+    title VARCHAR(100) NOT NULL,
+    publication_year INT NOT NULL,
+    version INT NOT NULL DEFAULT 1,
+    CONSTRAINT books_authors FOREIGN KEY (author_id) REFERENCES authors (id) ON DELETE CASCADE
+);
+CREATE TABLE IF NOT EXISTS tags (
+    id INTEGER PRIMARY KEY,
+    name VARCHAR(30) UNIQUE NOT NULL
+);
+CREATE TABLE IF NOT EXISTS book_tags (
+    book_id TEXT NOT NULL,
+    tag_id INT NOT NULL,
+    CONSTRAINT book_tags_pkey PRIMARY KEY (book_id, tag_id),
+    CONSTRAINT books FOREIGN KEY (book_id) REFERENCES books (id) ON DELETE CASCADE,
+    CONSTRAINT book_tags_tag FOREIGN KEY (tag_id) REFERENCES tags (id)
+) WITHOUT ROWID;
+-- Те же индексы, что у Postgres. books_by_author_year служит и проверке внешнего ключа: SQLite ищет
+-- по дочерней таблице, и без индекса по author_id каскадное удаление автора читало бы все книги
+DROP INDEX IF EXISTS books_author_id;
+CREATE INDEX IF NOT EXISTS books_by_year ON books (publication_year, title, id);
+CREATE INDEX IF NOT EXISTS books_by_author_year ON books (author_id, publication_year, title, id);
+CREATE INDEX IF NOT EXISTS books_by_title ON books (title);
+CREATE TABLE IF NOT EXISTS journal_positions (
+    journal_id TEXT PRIMARY KEY,
+    position INTEGER NOT NULL
+) WITHOUT ROWID;
+COMMIT;
+)");
+
+    // Счётчики каталога. Проверка и пересчёт - в той же транзакции записи, что и создание таблиц
+    connection_.Exec("BEGIN IMMEDIATE;");
+    bool stats_exist = false;
+    {
+        auto stmt = connection_.Prepare("SELECT count(*) FROM sqlite_master WHERE type = 'table' AND name = 'year_stats';"sv);
+        stmt.Step();
+        stats_exist = stmt.ColumnInt(0) > 0;
+    }
+    connection_.Exec(R"(
+CREATE TABLE IF NOT EXISTS author_stats (
+    author_id TEXT PRIMARY KEY,
+    book_count INT NOT NULL
+) WITHOUT ROWID;
+CREATE INDEX IF NOT EXISTS author_stats_top ON author_stats (book_count DESC);
+CREATE TABLE IF NOT EXISTS tag_stats (
+    tag_id INTEGER PRIMARY KEY,
+    book_count INT NOT NULL
+);
+CREATE INDEX IF NOT EXISTS tag_stats_top ON tag_stats (book_count DESC);
+CREATE TABLE IF NOT EXISTS year_stats (
+    publication_year INTEGER PRIMARY KEY,
+    book_count INT NOT NULL
+);
+CREATE TRIGGER IF NOT EXISTS books_stats_insert AFTER INSERT ON books BEGIN
+    INSERT INTO author_stats (author_id, book_count) VALUES (NEW.author_id, 1)
+        ON CONFLICT (author_id) DO UPDATE SET book_count = book_count + 1;
+    INSERT INTO year_stats (publication_year, book_count) VALUES (NEW.publication_year, 1)
+        ON CONFLICT (publication_year) DO UPDATE SET book_count = book_count + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS books_stats_delete AFTER DELETE ON books BEGIN
+    UPDATE author_stats SET book_count = book_count - 1 WHERE author_id = OLD.author_id;
+    UPDATE year_stats SET book_count = book_count - 1 WHERE publication_year = OLD.publication_year;
+END;
+CREATE TRIGGER IF NOT EXISTS books_stats_update AFTER UPDATE OF author_id, publication_year ON books
+WHEN OLD.author_id IS NOT NEW.author_id OR OLD.publication_year IS NOT NEW.publication_year BEGIN
+    UPDATE author_stats SET book_count = book_count - 1 WHERE author_id = OLD.author_id;
+    INSERT INTO author_stats (author_id, book_count) VALUES (NEW.author_id, 1)
+        ON CONFLICT (author_id) DO UPDATE SET book_count = book_count + 1;
+    UPDATE year_stats SET book_count = book_count - 1 WHERE publication_year = OLD.publication_year;
+    INSERT INTO year_stats (publication_year, book_count) VALUES (NEW.publication_year, 1)
+        ON CONFLICT (publication_year) DO UPDATE SET book_count = book_count + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS book_tags_stats_insert AFTER INSERT ON book_tags BEGIN
+    INSERT INTO tag_stats (tag_id, book_count) VALUES (NEW.tag_id, 1)
+        ON CONFLICT (tag_id) DO UPDATE SET book_count = book_count + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS book_tags_stats_delete AFTER DELETE ON book_tags BEGIN
+    UPDATE tag_stats SET book_count = book_count - 1 WHERE tag_id = OLD.tag_id;
+END;
+CREATE TRIGGER IF NOT EXISTS authors_stats_delete AFTER DELETE ON authors BEGIN
+    DELETE FROM author_stats WHERE author_id = OLD.id;
+END;
+)");
+    if (!stats_exist) {
+        connection_.Exec(R"(
+INSERT INTO author_stats (author_id, book_count) SELECT author_id, count(*) FROM books GROUP BY author_id;
+INSERT INTO year_stats (publication_year, book_count) SELECT publication_year, count(*) FROM books GROUP BY publication_year;
+INSERT INTO tag_stats (tag_id, book_count) SELECT tag_id, count(*) FROM book_tags GROUP BY tag_id;
+)");
+    }
+    connection_.Exec("COMMIT;");
+}
+
+}  // namespace sqlite
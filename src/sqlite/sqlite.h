@@ -0,0 +1,103 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../domain/author.h"
+#include "../domain/book.h"
+#include "../domain/stats.h"
+#include "../domain/tag.h"
+#include "connection.h"
+
+namespace sqlite {
+
+// sqlite:path, sqlite://path или sqlite::memory:
+bool IsSqliteUrl(std::string_view url);
+std::string PathFromUrl(std::string_view url);
+
+class AuthorRepositoryImpl : public domain::AuthorRepository {
+public:
+    explicit AuthorRepositoryImpl(Connection& connection)
+        : connection_{connection} {
+    }
+
+    void DeleteAuthorAndDependencies(const domain::Author& author) override;
+    void Save(const domain::Author& author) override;
+    list_authors_t GetList() override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+    void ForEach(const std::function<void(const domain::Author&)>& visitor) override;
+
+private:
+    Connection& connection_;
+};
+
+class BookRepositoryImpl : public domain::BookRepository {
+public:
+    explicit BookRepositoryImpl(Connection& connection)
+        : connection_{connection} {
+    }
+
+    void Delete(const domain::BookId& book_id) override;
+    void Edit(const domain::Book& book) override;
+    void Save(const domain::Book& book) override;
+    list_books_t GetList() override;
+    list_books_t GetBookByAuthorId(const domain::AuthorId& author_id) override;
+    list_books_t GetBooksByTitle(const std::string& title) override;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) override;
+    void ForEach(const std::function<void(const domain::Book&)>& visitor) override;
+
+private:
+    Connection& connection_;
+};
+
+class TagRepositoryImpl : public domain::TagRepository {
+public:
+    explicit TagRepositoryImpl(Connection& connection)
+        : connection_{connection} {
+    }
+
+    void ClearTagsByBookId(const domain::BookId& book_id) override;
+    void Save(const domain::Tag& tag) override;
+    list_tags_t GetTagsByBookId(const domain::BookId& book_id) override;
+    bool SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) override;
+    void ForEach(const std::function<void(const domain::Tag&)>& visitor) override;
+
+private:
+    int GetOrCreateTagId(const std::string& name);
+
+    Connection& connection_;
+};
+
+// Счётчики author_stats, tag_stats и year_stats поддерживают построчные триггеры
+class StatsRepositoryImpl : public domain::StatsRepository {
+public:
+    explicit StatsRepositoryImpl(Connection& connection)
+        : connection_{connection} {
+    }
+
+    int CountBooks() override;
+    int CountAuthorBooks(const domain::AuthorId& author_id) override;
+    top_authors_t TopAuthors(size_t limit) override;
+    top_tags_t TopTags(size_t limit) override;
+    years_t BooksPerYear() override;
+    mismatches_t Verify() override;
+
+private:
+    Connection& connection_;
+};
+
+// Файл базы в режиме WAL со схемой, повторяющей postgres::Database
+class Database {
+public:
+    explicit Database(const std::string& path);
+
+    Connection& GetConnection() {
+        return connection_;
+    }
+
+private:
+    Connection connection_;
+};
+
+}  // namespace sqlite
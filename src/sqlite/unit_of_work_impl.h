@@ -0,0 +1,106 @@
+#pragma once
+
+#include "sqlite.h"
+#include "../metrics/metrics.h"
+#include "../unit/unit_of_work.h"
+#include "../unit/unit_of_work_factory.h"
+
+namespace sqlite {
+
+class UnitOfWorkImpl : public app::UnitOfWork {
+    public:
+        // read_only - единица работы только читает: снимок берётся при первом чтении, и другим соединениям
+        // она не мешает. Иначе блокировка записи берётся сразу с началом транзакции: при BEGIN DEFERRED запись
+        // после чтения, которое опередил коммит другого соединения, получила бы SQLITE_BUSY_SNAPSHOT без ожидания.
+        // Начало откладывается до первого запроса, чтобы ждущий ввода сеанс не держал блокировку
+        explicit UnitOfWorkImpl(Connection & connection, bool read_only = false)
+            : connection_(connection) {
+            if(read_only) {
+                connection_.Exec("BEGIN DEFERRED;");
+            } else {
+                connection_.BeginOnFirstUse();
+            }
+        }
+
+        void Commit() override {
+            static auto& latency = metrics::Latency(metrics::Scope::STATEMENT, "commit");
+            static auto& commits = metrics::GetCounter("transaction_commits");
+            {
+                metrics::ScopedTimer timer{latency};
+                if(!connection_.CancelPendingBegin()) {
+                    connection_.Exec("COMMIT;");
+                }
+            }
+            is_commited_ = true;
+            commits.Increment();
+        }
+        void BeginSavepoint() override {
+            connection_.Exec("SAVEPOINT batch_command;");
+        }
+        void RollbackToSavepoint() override {
+            connection_.Exec("ROLLBACK TO SAVEPOINT batch_command;");
+        }
+        void ReleaseSavepoint() override {
+            connection_.Exec("RELEASE SAVEPOINT batch_command;");
+        }
+        uint64_t GetJournalPosition(const std::string & journal_id) override {
+            auto stmt = connection_.Prepare("SELECT position FROM journal_positions WHERE journal_id = ?;");
+            stmt.Bind(journal_id);
+            return stmt.Step() ? static_cast<uint64_t>(stmt.ColumnInt64(0)) : 0;
+        }
+        void SetJournalPosition(const std::string & journal_id, uint64_t position) override {
+            connection_.Prepare(R"(
+INSERT INTO journal_positions (journal_id, position) VALUES (?1, ?2)
+ON CONFLICT (journal_id) DO UPDATE SET position = ?2;
+)").Bind(journal_id, static_cast<int64_t>(position)).Run();
+        }
+        AuthorRepositoryImpl & Authors() override {
+            return authors_;
+        }
+        BookRepositoryImpl & Books() override {
+            return books_;
+        }
+        TagRepositoryImpl & Tags() override {
+            return tags_;
+        }
+        StatsRepositoryImpl & Stats() override {
+            return stats_;
+        }
+        ~UnitOfWorkImpl() {
+            if(!is_commited_ && !connection_.CancelPendingBegin()) {
+                static auto& rollbacks = metrics::GetCounter("transaction_rollbacks");
+                rollbacks.Increment();
+                try {
+                    connection_.Exec("ROLLBACK;");
+                } catch (const Error&) {
+                    // Транзакцию уже откатил сам SQLite после ошибки
+                }
+            }
+        }
+    private:
+        bool is_commited_{false};
+
+        Connection & connection_;
+
+        AuthorRepositoryImpl authors_{connection_};
+        BookRepositoryImpl books_{connection_};
+        TagRepositoryImpl tags_{connection_};
+        StatsRepositoryImpl stats_{connection_};
+};
+
+class UnitOfWorkFactoryImpl : public app::UnitOfWorkFactory {
+    public:
+        // read_only - единицы работы только читают, как у хранилища чтений перед журналом
+        explicit UnitOfWorkFactoryImpl(const std::string & path, bool read_only = false)
+            : db_{path}
+            , read_only_{read_only} {}
+
+        std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+            return std::make_shared<UnitOfWorkImpl>(db_.GetConnection(), read_only_);
+        }
+    private:
+        Database db_;
+        const bool read_only_;
+};
+
+}
@@ -0,0 +1,147 @@
+#include "output.h"
+
+#include <charconv>
+
+namespace ui {
+
+using namespace std::literals;
+
+namespace {
+
+template <typename T>
+std::string_view FormatNumber(char (&buffer)[24], T value) {
+    auto [end, ec] = std::to_chars(std::begin(buffer), std::end(buffer), value);
+    return {buffer, static_cast<size_t>(end - buffer)};
+}
+
+}  // namespace
+
+std::optional<OutputFormat> ParseOutputFormat(std::string_view name) {
+    if (name.empty() || name == "human"sv) {
+        return OutputFormat::HUMAN;
+    }
+    if (name == "tsv"sv) {
+        return OutputFormat::TSV;
+    }
+    if (name == "jsonl"sv || name == "json"sv) {
+        return OutputFormat::JSONL;
+    }
+    return std::nullopt;
+}
+
+BufferedOutput::BufferedOutput(std::ostream& out, size_t capacity)
+    : out_(out)
+    , capacity_(capacity) {
+    buffer_.reserve(capacity_ + 256);
+}
+
+BufferedOutput::~BufferedOutput() {
+    try {
+        Flush();
+    } catch (...) {
+    }
+}
+
+BufferedOutput& BufferedOutput::operator<<(int value) {
+    char buffer[24];
+    return *this << FormatNumber(buffer, value);
+}
+
+BufferedOutput& BufferedOutput::operator<<(size_t value) {
+    char buffer[24];
+    return *this << FormatNumber(buffer, value);
+}
+
+void BufferedOutput::Drain() {
+    out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+    buffer_.clear();
+}
+
+void BufferedOutput::Flush() {
+    Drain();
+    out_.flush();
+}
+
+void RowWriter::WriteAuthor(const app::detail::AuthorInfo& author) {
+    ++row_number_;
+    switch (format_) {
+        case OutputFormat::HUMAN:
+            out_ << row_number_ << ' ' << author.name << '\n';
+            break;
+        case OutputFormat::TSV:
+            WriteTsvField(author.id);
+            out_ << '\t';
+            WriteTsvField(author.name);
+            out_ << '\n';
+            break;
+        case OutputFormat::JSONL:
+            out_ << "{\"id\":"sv;
+            WriteJsonString(author.id);
+            out_ << ",\"name\":"sv;
+            WriteJsonString(author.name);
+            out_ << "}\n"sv;
+            break;
+    }
+}
+
+void RowWriter::WriteBook(const app::detail::BookInfo& book) {
+    ++row_number_;
+    switch (format_) {
+        case OutputFormat::HUMAN:
+            out_ << row_number_ << ' ' << book.title << " by "sv << book.author_name << ", "sv
+                 << book.publication_year << '\n';
+            break;
+        case OutputFormat::TSV:
+            WriteTsvField(book.id);
+            out_ << '\t';
+            WriteTsvField(book.title);
+            out_ << '\t';
+            WriteTsvField(book.author_name);
+            out_ << '\t' << book.publication_year << '\n';
+            break;
+        case OutputFormat::JSONL:
+            out_ << "{\"id\":"sv;
+            WriteJsonString(book.id);
+            out_ << ",\"title\":"sv;
+            WriteJsonString(book.title);
+            out_ << ",\"author\":"sv;
+            WriteJsonString(book.author_name);
+            out_ << ",\"year\":"sv << book.publication_year << "}\n"sv;
+            break;
+    }
+}
+
+void RowWriter::WriteTsvField(std::string_view value) {
+    for (char c : value) {
+        switch (c) {
+            case '\\': out_ << "\\\\"sv; break;
+            case '\t': out_ << "\\t"sv; break;
+            case '\n': out_ << "\\n"sv; break;
+            case '\r': out_ << "\\r"sv; break;
+            default: out_ << c;
+        }
+    }
+}
+
+void RowWriter::WriteJsonString(std::string_view value) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    out_ << '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out_ << "\\\""sv; break;
+            case '\\': out_ << "\\\\"sv; break;
+            case '\n': out_ << "\\n"sv; break;
+            case '\r': out_ << "\\r"sv; break;
+            case '\t': out_ << "\\t"sv; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out_ << "\\u00"sv << HEX[(c >> 4) & 0xF] << HEX[c & 0xF];
+                } else {
+                    out_ << c;
+                }
+        }
+    }
+    out_ << '"';
+}
+
+}  // namespace ui
@@ -0,0 +1,74 @@
+#pragma once
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include "../app/use_cases.h"
+
+namespace ui {
+
+enum class OutputFormat { HUMAN, TSV, JSONL };
+
+std::optional<OutputFormat> ParseOutputFormat(std::string_view name);
+
+/**
+ * Накапливает вывод в буфере и отдаёт его потоку крупными блоками.
+ * Поток сбрасывается только в Flush() и в деструкторе.
+ */
+class BufferedOutput {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit BufferedOutput(std::ostream& out, size_t capacity = DEFAULT_CAPACITY);
+    BufferedOutput(const BufferedOutput&) = delete;
+    BufferedOutput& operator=(const BufferedOutput&) = delete;
+    ~BufferedOutput();
+
+    BufferedOutput& operator<<(std::string_view text) {
+        buffer_.append(text);
+        if (buffer_.size() >= capacity_) {
+            Drain();
+        }
+        return *this;
+    }
+    BufferedOutput& operator<<(char c) {
+        buffer_.push_back(c);
+        if (buffer_.size() >= capacity_) {
+            Drain();
+        }
+        return *this;
+    }
+    BufferedOutput& operator<<(int value);
+    BufferedOutput& operator<<(size_t value);
+
+    void Flush();
+
+private:
+    void Drain();
+
+    std::ostream& out_;
+    size_t capacity_;
+    std::string buffer_;
+};
+
+class RowWriter {
+public:
+    RowWriter(BufferedOutput& out, OutputFormat format)
+        : out_(out)
+        , format_(format) {
+    }
+
+    void WriteAuthor(const app::detail::AuthorInfo& author);
+    void WriteBook(const app::detail::BookInfo& book);
+
+private:
+    void WriteTsvField(std::string_view value);
+    void WriteJsonString(std::string_view value);
+
+    BufferedOutput& out_;
+    OutputFormat format_;
+    size_t row_number_ = 0;
+};
+
+}  // namespace ui
@@ -0,0 +1,63 @@
+#include "tag_tokenizer.h"
+
+#include <algorithm>
+
+namespace ui {
+
+namespace {
+
+bool IsSpace(char c) noexcept {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+std::string_view Trim(std::string_view token) noexcept {
+    while (!token.empty() && IsSpace(token.front())) {
+        token.remove_prefix(1);
+    }
+    while (!token.empty() && IsSpace(token.back())) {
+        token.remove_suffix(1);
+    }
+    return token;
+}
+
+}  // namespace
+
+std::vector<std::string> TokenizeTags(std::string_view raw) {
+    std::vector<std::string> tags;
+    tags.reserve(std::count(raw.begin(), raw.end(), ',') + 1);
+
+    size_t pos = 0;
+    while (pos <= raw.size()) {
+        auto comma = raw.find(',', pos);
+        if (comma == std::string_view::npos) {
+            comma = raw.size();
+        }
+        const auto token = Trim(raw.substr(pos, comma - pos));
+        pos = comma + 1;
+        if (token.empty()) {
+            continue;
+        }
+
+        auto& tag = tags.emplace_back();
+        tag.reserve(token.size());
+        for (size_t i = 0; i < token.size(); ++i) {
+            if (!IsSpace(token[i])) {
+                tag += token[i];
+                continue;
+            }
+            size_t run_end = i + 1;
+            while (run_end < token.size() && IsSpace(token[run_end])) {
+                ++run_end;
+            }
+            // Одиночный пробельный символ сохраняется, серия заменяется пробелом
+            tag += run_end - i > 1 ? ' ' : token[i];
+            i = run_end - 1;
+        }
+    }
+
+    std::sort(tags.begin(), tags.end());
+    tags.erase(std::unique(tags.begin(), tags.end()), tags.end());
+    return tags;
+}
+
+}  // namespace ui
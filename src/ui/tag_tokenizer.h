@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ui {
+
+/**
+ * Разбирает строку тегов через запятую за один проход: обрезает пробелы по краям,
+ * схлопывает серии пробельных символов внутри тега в один пробел,
+ * отбрасывает пустые теги, сортирует и удаляет дубликаты.
+ */
+std::vector<std::string> TokenizeTags(std::string_view raw);
+
+}  // namespace ui
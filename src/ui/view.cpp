@@ -4,13 +4,14 @@
 #include <boost/algorithm/string.hpp>
 #include <cassert>
 #include <iostream>
-#include <boost/regex.hpp>
 
 #include "../app/use_cases.h"
+#include "../domain/errors.h"
 #include "../menu/menu.h"
+#include "output.h"
+#include "tag_tokenizer.h"
 
 using namespace std::literals;
-namespace ph = std::placeholders;
 
 namespace ui {
 
@@ -29,8 +30,19 @@ template <typename T>
 void PrintVector(std::ostream& out, const std::vector<T>& vector) {
     int i = 1;
     for (auto& value : vector) {
-        out << i++ << " " << value << std::endl;
+        out << i++ << " " << value << '\n';
     }
+    out.flush();
+}
+
+OutputFormat ReadOutputFormat(std::istream& cmd_input) {
+    std::string format_name;
+    std::getline(cmd_input, format_name);
+    boost::algorithm::trim(format_name);
+    auto format = ParseOutputFormat(format_name);
+    if(!format)
+        throw std::invalid_argument("Unknown output format "s + format_name + ", expected human, tsv or jsonl"s);
+    return *format;
 }
 
 View::View(menu::Menu& menu, app::UseCases& use_cases, std::istream& input, std::ostream& output)
@@ -38,16 +50,37 @@ View::View(menu::Menu& menu, app::UseCases& use_cases, std::istream& input, std:
     , use_cases_{use_cases}
     , input_{input}
     , output_{output} {
-    menu_.AddAction("AddAuthor"s, "name"s, "Adds author"s, std::bind(&View::AddAuthor, this, ph::_1));
-    menu_.AddAction("EditAuthor"s, "[name]"s, "Edit name author"s, std::bind(&View::EditAuthor, this, ph::_1));
-    menu_.AddAction("AddBook"s, "<pub year> <title>"s, "Adds book"s, std::bind(&View::AddBook, this, ph::_1));
-    menu_.AddAction("EditBook"s, "[title]"s, "Edit book"s, std::bind(&View::EditBook, this, ph::_1));
-    menu_.AddAction("DeleteAuthor"s, "[name]"s, "Cascade delete author"s,std::bind(&View::DeleteAuthor, this, ph::_1));
-    menu_.AddAction("DeleteBook"s, "[title]"s, "Cascade delete author"s,std::bind(&View::DeleteBook, this, ph::_1));
-    menu_.AddAction("ShowBook"s, {}, "Show book"s, std::bind(&View::ShowBook, this, ph::_1));
-    menu_.AddAction("ShowAuthors"s, {}, "Show authors"s, std::bind(&View::ShowAuthors, this));
-    menu_.AddAction("ShowBooks"s, {}, "Show books"s, std::bind(&View::ShowBooks, this));
-    menu_.AddAction("ShowAuthorBooks"s, {}, "Show author books"s,std::bind(&View::ShowAuthorBooks, this));
+    menu_.AddAction("AddAuthor"s, "name"s, "Adds author"s, Command(&View::AddAuthor));
+    menu_.AddAction("EditAuthor"s, "[name]"s, "Edit name author"s, Command(&View::EditAuthor));
+    menu_.AddAction("AddBook"s, "<pub year> <title>"s, "Adds book"s, Command(&View::AddBook));
+    menu_.AddAction("EditBook"s, "[title]"s, "Edit book"s, Command(&View::EditBook));
+    menu_.AddAction("DeleteAuthor"s, "[name]"s, "Cascade delete author"s,Command(&View::DeleteAuthor));
+    menu_.AddAction("DeleteBook"s, "[title]"s, "Cascade delete author"s,Command(&View::DeleteBook));
+    menu_.AddAction("ShowBook"s, {}, "Show book"s, Command(&View::ShowBook));
+    menu_.AddAction("ShowAuthors"s, "[human|tsv|jsonl]"s, "Show authors"s, Command(&View::ShowAuthors));
+    menu_.AddAction("ShowBooks"s, "[human|tsv|jsonl]"s, "Show books"s, Command(&View::ShowBooks));
+    menu_.AddAction("ShowAuthorBooks"s, "[human|tsv|jsonl]"s, "Show author books"s,Command(&View::ShowAuthorBooks));
+    menu_.AddAction("ShowBooksByYears"s, "<from year> <to year> [author]"s, "Show books published in a range of years"s,
+                    Command(&View::ShowBooksByYears));
+    menu_.AddAction("CatalogStats"s, "[top]"s, "Show catalog statistics"s, Command(&View::ShowStats));
+    menu_.AddAction("CheckStats"s, {}, "Compare statistics with a full recount"s, Command(&View::CheckStats));
+}
+
+std::function<bool(std::istream&)> View::Command(handler_t handler) const {
+    return [this, handler](std::istream& cmd_input) {
+        // Коммит отложенной записи отвечает до применения: об отказе хранилища сообщаем на следующей команде
+        for (const auto& rejected : use_cases_.TakeRejectedWrites()) {
+            output_ << "Earlier change was not saved: "sv << rejected << std::endl;
+        }
+        try {
+            return (this->*handler)(cmd_input);
+        } catch (const app::DeadlineExceeded&) {
+            // После отмены запроса транзакция непригодна и для чтения, откатываем и её
+            use_cases_.Rollback();
+            output_ << "Command timed out"sv << std::endl;
+            return true;
+        }
+    };
 }
 
 bool View::AddAuthor(std::istream& cmd_input) const {
@@ -147,23 +180,28 @@ bool View::EditAuthor(std::istream& cmd_input) const {
         std::string name;
         std::getline(cmd_input, name);
         boost::algorithm::trim(name);
-        std::string author_id;
+        detail::AuthorInfo author;
         if(name.empty()) {
-            author_id = SelectAuthor().value();
+            author = SelectAuthorInfo().value();
         } else {
             auto author_opt = use_cases_.FindAuthorByName(name);
             if(!author_opt)
                 throw std::invalid_argument("Author name not exist");
-            author_id = author_opt->id;
+            author = *author_opt;
         }
+        use_cases_.FinishRead();
 
         output_ << "Enter new name:" << std::endl;
         std::string new_name;
         std::getline(input_, new_name);
         boost::algorithm::trim(new_name);
 
-        use_cases_.EditAuthorName(author_id, new_name);
+        use_cases_.EditAuthorName(author.id, author.version, new_name);
 
+    } catch (const domain::VersionConflict&) {
+        output_ << "Author was changed by another user, try again"s << std::endl;
+        use_cases_.Rollback();
+        return true;
     } catch (const std::exception& ex) {
         output_ << "Failed to edit author"s  << std::endl;
         use_cases_.Rollback();
@@ -191,6 +229,9 @@ bool View::EditBook(std::istream& cmd_input) const {
             book = *book_opt;
         }
 
+        auto current_tags = boost::algorithm::join(use_cases_.GetTagsByBookId(book.id), ", ");
+        use_cases_.FinishRead();
+
         output_ << "Enter new title or empty line to use the current one (" << book.title << "):" << std::endl;
         std::string new_title;
         std::getline(input_, new_title);
@@ -206,13 +247,17 @@ bool View::EditBook(std::istream& cmd_input) const {
         if(new_year.empty())
             new_year_value = book.publication_year;
 
-        output_ << "Enter tags ( current tags: " << boost::algorithm::join(use_cases_.GetTagsByBookId(book.id), ", ") << "):" << std::endl;
+        output_ << "Enter tags ( current tags: " << current_tags << "):" << std::endl;
 
         std::string tags;
         std::getline(input_, tags);
         boost::algorithm::trim(tags);
 
-        use_cases_.EditBook(book.id,new_title, new_year_value, ParseTags(tags));
+        use_cases_.EditBook(book.id, book.version, new_title, new_year_value, ParseTags(tags));
+    } catch (const domain::VersionConflict&) {
+        output_ << "Book was changed by another user, try again"s << std::endl;
+        use_cases_.Rollback();
+        return true;
     } catch (const std::exception& ex) {
         output_ << "Book not found"s  << std::endl;
         use_cases_.Rollback();
@@ -222,13 +267,25 @@ bool View::EditBook(std::istream& cmd_input) const {
     return true; 
 }
 
-bool View::ShowAuthors() const {
-    PrintVector(output_, GetAuthors());
+bool View::ShowAuthors(std::istream& cmd_input) const {
+    auto format = ReadOutputFormat(cmd_input);
+    BufferedOutput out{output_};
+    RowWriter writer{out, format};
+    use_cases_.ForEachAuthor([&writer](const detail::AuthorInfo & author) {
+        writer.WriteAuthor(author);
+    });
+    out.Flush();
     return true;
 }
 
-bool View::ShowBooks() const {
-    PrintVector(output_, GetBooks());
+bool View::ShowBooks(std::istream& cmd_input) const {
+    auto format = ReadOutputFormat(cmd_input);
+    BufferedOutput out{output_};
+    RowWriter writer{out, format};
+    use_cases_.ForEachBook([&writer](const detail::BookInfo & book) {
+        writer.WriteBook(book);
+    });
+    out.Flush();
     return true;
 }
 
@@ -257,44 +314,108 @@ bool View::ShowBook(std::istream& cmd_input) const {
         auto tags = use_cases_.GetTagsByBookId(book.id);
         if(!tags.empty())
             output_ << "Tags: " << boost::algorithm::join(tags, ", ") << std::endl;
+    } catch (const app::DeadlineExceeded&) {
+        throw;
     } catch (const std::exception& ex) {
         //return false;
     }
     return true;
 }
 
-bool View::ShowAuthorBooks() const {
+bool View::ShowAuthorBooks(std::istream& cmd_input) const {
+    auto format = ReadOutputFormat(cmd_input);
     try {
         if (auto author_id = SelectAuthor()) {
-            PrintVector(output_, GetAuthorBooks(*author_id));
+            BufferedOutput out{output_};
+            RowWriter writer{out, format};
+            for(const auto & book : GetAuthorBooks(*author_id))
+                writer.WriteBook(book);
+            out.Flush();
         }
+    } catch (const app::DeadlineExceeded&) {
+        throw;
     } catch (const std::exception& ex) {
         throw std::runtime_error("Failed to Show Books"s );
     }
     return true;
 }
 
-std::vector<std::string> View::ParseTags(const std::string& tags_raw) const {
-    boost::regex reg("\\s{2,}");
-    auto tags_without_extra_spaces = boost::regex_replace(tags_raw, reg, " ");
-
-    std::vector<std::string> tokens;
-    
-    boost::split(tokens, tags_without_extra_spaces, boost::is_any_of(","));
-
-    for(auto & token : tokens) {
-        boost::algorithm::trim(token);
+bool View::ShowBooksByYears(std::istream& cmd_input) const {
+    constexpr size_t PAGE_SIZE = 100;
+    int from_year = 0;
+    int to_year = 0;
+    if(!(cmd_input >> from_year >> to_year) || from_year > to_year) {
+        output_ << "Expected <from year> <to year>"sv << std::endl;
+        return true;
     }
+    std::string author_name;
+    std::getline(cmd_input, author_name);
+    boost::algorithm::trim(author_name);
+    std::string author_id;
+    if(!author_name.empty()) {
+        auto author = use_cases_.FindAuthorByName(author_name);
+        if(!author) {
+            use_cases_.FinishRead();
+            output_ << "Author not found"sv << std::endl;
+            return true;
+        }
+        author_id = author->id;
+    }
+
+    BufferedOutput out{output_};
+    RowWriter writer{out, OutputFormat::HUMAN};
+    std::string page;
+    do {
+        auto books = use_cases_.GetBooksByYearRange(from_year, to_year, author_id, page, PAGE_SIZE);
+        for(const auto & book : books.books)
+            writer.WriteBook(book);
+        page = std::move(books.next_page);
+    } while(!page.empty());
+    use_cases_.FinishRead();
+    out.Flush();
+    return true;
+}
 
-    tokens.erase(std::remove_if(tokens.begin(), tokens.end(),
-                            [](const std::string& s) { return s.empty(); }),
-             tokens.end());
+bool View::ShowStats(std::istream& cmd_input) const {
+    constexpr size_t DEFAULT_TOP = 10;
+    std::string top_raw;
+    std::getline(cmd_input, top_raw);
+    boost::algorithm::trim(top_raw);
+    const size_t top = top_raw.empty() ? DEFAULT_TOP : std::stoul(top_raw);
+
+    auto stats = use_cases_.GetCatalogStats(top);
+    use_cases_.FinishRead();
+    output_ << "Books: " << stats.books << '\n';
+    output_ << "Top authors:" << '\n';
+    int i = 1;
+    for(const auto & author : stats.top_authors)
+        output_ << i++ << " " << author.name << ": " << author.books << '\n';
+    output_ << "Top tags:" << '\n';
+    i = 1;
+    for(const auto & tag : stats.top_tags)
+        output_ << i++ << " " << tag.name << ": " << tag.books << '\n';
+    output_ << "Books per year:" << '\n';
+    for(const auto & [year, books] : stats.books_per_year)
+        output_ << year << ": " << books << '\n';
+    output_.flush();
+    return true;
+}
 
-    std::sort(tokens.begin(), tokens.end());
-    auto last = std::unique(tokens.begin(), tokens.end());
-    tokens.erase(last, tokens.end());
+bool View::CheckStats(std::istream&) const {
+    auto problems = use_cases_.CheckStats();
+    use_cases_.FinishRead();
+    if(problems.empty()) {
+        output_ << "Statistics are consistent" << std::endl;
+        return true;
+    }
+    for(const auto & problem : problems)
+        output_ << problem << '\n';
+    output_.flush();
+    return true;
+}
 
-    return tokens;
+std::vector<std::string> View::ParseTags(const std::string& tags_raw) const {
+    return TokenizeTags(tags_raw);
 }
 
 std::vector<std::string> View::GetTags() const {
@@ -348,6 +469,13 @@ std::optional<detail::AddBookParams> View::GetBookParams(
 }
 
 std::optional<std::string> View::SelectAuthor() const {
+    auto author = SelectAuthorInfo();
+    if(!author)
+        return std::nullopt;
+    return author->id;
+}
+
+std::optional<detail::AuthorInfo> View::SelectAuthorInfo() const {
     output_ << "Select author:" << std::endl;
     auto authors = GetAuthors();
     PrintVector(output_, authors);
@@ -370,7 +498,7 @@ std::optional<std::string> View::SelectAuthor() const {
         throw std::runtime_error("Invalid author num");
     }
 
-    return authors[author_idx].id;
+    return authors[author_idx];
 }
 
 std::optional<detail::BookInfo> View::SelectBook() const {
@@ -380,9 +508,12 @@ std::optional<detail::BookInfo> View::SelectBook() const {
 std::optional<detail::BookInfo> View::SelectBookOneOf( const std::vector<detail::BookInfo>& books) const {
     PrintVector(output_, books);
     output_ << "Enter the book # or empty line to cancel" << std::endl;
+    // Теги выбранной книги понадобятся ShowBook и EditBook - грузим их, пока пользователь выбирает
+    use_cases_.PrefetchBookDetails(books);
 
     std::string str;
     if (!std::getline(input_, str) || str.empty()) {
+        use_cases_.CancelPrefetch();
         return std::nullopt;
     }
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <functional>
 #include <iosfwd>
 #include <optional>
 #include <string>
@@ -18,21 +19,30 @@ public:
     View(menu::Menu& menu, app::UseCases& use_cases, std::istream& input, std::ostream& output);
 
 private:
+    using handler_t = bool (View::*)(std::istream&) const;
+
+    // Команда, вызов которой не уложился в срок, откатывает транзакцию и сообщает об этом
+    std::function<bool(std::istream&)> Command(handler_t handler) const;
+
     bool AddAuthor(std::istream& cmd_input) const;
     bool AddBook(std::istream& cmd_input) const;
     bool DeleteAuthor(std::istream& cmd_input) const;
     bool DeleteBook(std::istream& cmd_input) const;
     bool EditAuthor(std::istream& cmd_input) const;
     bool EditBook(std::istream& cmd_input) const;
-    bool ShowAuthors() const;
-    bool ShowBooks() const;
+    bool ShowAuthors(std::istream& cmd_input) const;
+    bool ShowBooks(std::istream& cmd_input) const;
     bool ShowBook(std::istream& cmd_input) const;
-    bool ShowAuthorBooks() const;
+    bool ShowAuthorBooks(std::istream& cmd_input) const;
+    bool ShowBooksByYears(std::istream& cmd_input) const;
+    bool ShowStats(std::istream& cmd_input) const;
+    bool CheckStats(std::istream& cmd_input) const;
 
     std::vector<std::string> ParseTags(const std::string & tags_raw) const;
     std::vector<std::string> GetTags() const;
     std::optional<detail::AddBookParams> GetBookParams(std::istream& cmd_input) const;
     std::optional<std::string> SelectAuthor() const;
+    std::optional<detail::AuthorInfo> SelectAuthorInfo() const;
     std::optional<detail::BookInfo> SelectBook() const;
     std::optional<detail::BookInfo> SelectBookOneOf(const std::vector<detail::BookInfo> & books) const;
     std::vector<detail::AuthorInfo> GetAuthors() const;
@@ -0,0 +1,419 @@
+#include "catalog_cache.h"
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+
+#include "../metrics/metrics.h"
+
+namespace app {
+
+namespace {
+
+size_t StringBytes(const std::string& value) noexcept {
+    return sizeof(std::string) + (value.capacity() > 15 ? value.capacity() + 1 : 0);
+}
+
+}  // namespace
+
+std::shared_ptr<const CatalogSnapshot> CatalogSnapshot::Load(UnitOfWork& unit) {
+    static auto& latency = metrics::Latency(metrics::Scope::USE_CASE, "catalog_cache.load");
+    metrics::ScopedTimer timer{latency};
+
+    auto snapshot = std::make_shared<CatalogSnapshot>();
+    auto& self = *snapshot;
+    unit.Authors().ForEach([&](const domain::Author& author) {
+        self.author_by_name_.emplace(author.GetName(), self.authors_.size());
+        self.approx_bytes_ += sizeof(domain::Author) + 2 * StringBytes(author.GetName());
+        self.authors_.push_back(author);
+    });
+    unit.Books().ForEach([&](const domain::Book& book) {
+        const auto index = self.books_.size();
+        self.books_by_title_[book.GetTitle()].push_back(index);
+        self.books_by_author_[*book.GetAuthorId()].push_back(index);
+        self.books_by_year_.push_back(index);
+        self.approx_bytes_ += sizeof(domain::Book) + 2 * StringBytes(book.GetTitle())
+                              + StringBytes(book.GetAuthorName()) + 3 * sizeof(size_t);
+        self.books_.push_back(book);
+    });
+    std::sort(self.books_by_year_.begin(), self.books_by_year_.end(), [&books = self.books_](size_t lhs, size_t rhs) {
+        return domain::BookKeyLess(books[lhs], books[rhs]);
+    });
+    for (auto& [author_id, indexes] : self.books_by_author_) {
+        std::sort(indexes.begin(), indexes.end(), [&books = self.books_](size_t lhs, size_t rhs) {
+            return std::make_tuple(books[lhs].GetYear(), std::cref(books[lhs].GetTitle()))
+                 < std::make_tuple(books[rhs].GetYear(), std::cref(books[rhs].GetTitle()));
+        });
+    }
+    unit.Tags().ForEach([&](const domain::Tag& tag) {
+        self.tags_[*tag.GetBookId()].push_back(tag.GetTag());
+        self.approx_bytes_ += StringBytes(tag.GetTag());
+    });
+    for (auto& [book_id, tags] : self.tags_) {
+        std::sort(tags.begin(), tags.end());
+    }
+    self.approx_bytes_ += sizeof(CatalogSnapshot);
+    return snapshot;
+}
+
+std::optional<domain::Author> CatalogSnapshot::FindAuthorByName(const std::string& name) const {
+    const auto it = author_by_name_.find(name);
+    if (it == author_by_name_.end()) {
+        return std::nullopt;
+    }
+    return authors_[it->second];
+}
+
+CatalogSnapshot::list_books_t CatalogSnapshot::GetBooksByAuthor(const domain::AuthorId& author_id) const {
+    list_books_t books;
+    if (const auto it = books_by_author_.find(*author_id); it != books_by_author_.end()) {
+        books.reserve(it->second.size());
+        for (const auto index : it->second) {
+            books.push_back(books_[index]);
+        }
+    }
+    return books;
+}
+
+CatalogSnapshot::list_books_t CatalogSnapshot::GetBooksByTitle(const std::string& title) const {
+    list_books_t books;
+    if (const auto it = books_by_title_.find(title); it != books_by_title_.end()) {
+        books.reserve(it->second.size());
+        for (const auto index : it->second) {
+            books.push_back(books_[index]);
+        }
+    }
+    return books;
+}
+
+CatalogSnapshot::list_books_t CatalogSnapshot::GetBooksByYearRange(const domain::YearRangeQuery& query) const {
+    // Страница начинается с первой книги года from_year или, если он дальше, после ключа after
+    auto first = std::lower_bound(books_by_year_.begin(), books_by_year_.end(), query.from_year,
+                                  [this](size_t index, int year) {
+                                      return books_[index].GetYear() < year;
+                                  });
+    if (query.after) {
+        first = std::max(first, std::upper_bound(books_by_year_.begin(), books_by_year_.end(), *query.after,
+                                                 [this](const domain::BookKey& key, size_t index) {
+                                                     return domain::BookKeyLess(key, books_[index]);
+                                                 }));
+    }
+    list_books_t books;
+    for (auto it = first; it != books_by_year_.end() && books.size() < query.limit; ++it) {
+        const auto& book = books_[*it];
+        if (book.GetYear() > query.to_year) {
+            break;
+        }
+        if (query.Matches(book)) {
+            books.push_back(book);
+        }
+    }
+    return books;
+}
+
+CatalogSnapshot::list_tags_t CatalogSnapshot::GetTags(const domain::BookId& book_id) const {
+    list_tags_t tags;
+    if (const auto it = tags_.find(*book_id); it != tags_.end()) {
+        tags.reserve(it->second.size());
+        for (const auto& tag : it->second) {
+            tags.emplace_back(book_id, tag);
+        }
+    }
+    return tags;
+}
+
+void CatalogSnapshot::ForEachTag(const std::function<void(const domain::Tag&)>& visitor) const {
+    for (const auto& [book_id, tags] : tags_) {
+        for (const auto& tag : tags) {
+            visitor(domain::Tag(domain::BookId{book_id}, tag));
+        }
+    }
+}
+
+bool CatalogCache::IsUsable(const Entry& entry) const noexcept {
+    if (entry.generation != generation_.load()) {
+        return false;
+    }
+    return config_.max_age.count() == 0 || std::chrono::steady_clock::now() - entry.loaded_at < config_.max_age;
+}
+
+std::shared_ptr<const CatalogSnapshot> CatalogCache::Current() const {
+    const auto entry = entry_.load();
+    if (!entry || !IsUsable(*entry)) {
+        return nullptr;
+    }
+    return entry->snapshot;
+}
+
+bool CatalogCache::IsOversized() const {
+    const auto entry = entry_.load();
+    return entry && !entry->snapshot && IsUsable(*entry);
+}
+
+bool CatalogCache::Publish(std::shared_ptr<const CatalogSnapshot> snapshot, uint64_t generation) {
+    static auto& oversized = metrics::GetCounter("catalog_cache_oversized");
+    if (snapshot && snapshot->ApproxBytes() > config_.max_bytes) {
+        oversized.Increment();
+        snapshot.reset();
+    }
+    auto entry = std::make_shared<const Entry>(Entry{std::move(snapshot), generation, std::chrono::steady_clock::now()});
+    auto current = entry_.load();
+    // Не затираем копию более новой версии, если её успели опубликовать раньше
+    do {
+        if (generation != generation_.load() || (current && current->generation > generation)) {
+            return false;
+        }
+    } while (!entry_.compare_exchange_weak(current, entry));
+    return true;
+}
+
+void CatalogCache::Invalidate() {
+    static auto& invalidations = metrics::GetCounter("catalog_cache_invalidations");
+    invalidations.Increment();
+    ++generation_;
+    entry_.store(nullptr);
+
+    std::lock_guard lock{listeners_mutex_};
+    for (const auto& listener : listeners_) {
+        listener();
+    }
+}
+
+void CatalogCache::AddInvalidationListener(listener_t listener) {
+    std::lock_guard lock{listeners_mutex_};
+    listeners_.push_back(std::move(listener));
+}
+
+std::shared_ptr<const CatalogSnapshot> CachedUnitOfWorkFactory::GetSnapshot(const std::function<UnitOfWork&()>& storage) {
+    static auto& hits = metrics::GetCounter("catalog_cache_hits");
+    static auto& misses = metrics::GetCounter("catalog_cache_misses");
+    if (auto snapshot = cache_.Current()) {
+        hits.Increment();
+        return snapshot;
+    }
+    misses.Increment();
+    if (cache_.IsOversized() || loading_.exchange(true)) {
+        return nullptr;
+    }
+    std::shared_ptr<const CatalogSnapshot> snapshot;
+    try {
+        const auto generation = cache_.Generation();
+        snapshot = CatalogSnapshot::Load(storage());
+        cache_.Publish(snapshot, generation);
+    } catch (...) {
+        loading_ = false;
+        throw;
+    }
+    loading_ = false;
+    // Копия согласована с транзакцией unit, даже если опубликовать её не вышло
+    return snapshot->ApproxBytes() > cache_.GetConfig().max_bytes ? nullptr : snapshot;
+}
+
+void CachedUnitOfWorkFactory::Rebuild() {
+    static auto& rebuilds = metrics::GetCounter("catalog_cache_rebuilds");
+    if (loading_.exchange(true)) {
+        return;
+    }
+    try {
+        const auto generation = cache_.Generation();
+        auto unit = storage_->CreateUnitOfWork();
+        cache_.Publish(CatalogSnapshot::Load(*unit), generation);
+        unit->Commit();
+        rebuilds.Increment();
+    } catch (...) {
+        // Копию построит первое чтение
+    }
+    loading_ = false;
+}
+
+UnitOfWork& CachedUnitOfWork::Inner() {
+    if (!inner_) {
+        inner_ = factory_.GetStorage().CreateUnitOfWork();
+        if (deadline_) {
+            inner_->SetDeadline(*deadline_);
+        }
+    }
+    return *inner_;
+}
+
+std::shared_ptr<const CatalogSnapshot> CachedUnitOfWork::Snapshot() {
+    return factory_.GetSnapshot([this]() -> UnitOfWork& {
+        return Inner();
+    });
+}
+
+void CachedUnitOfWork::Commit() {
+    if (!inner_) {
+        return;
+    }
+    inner_->Commit();
+    inner_.reset();
+    if (wrote_) {
+        wrote_ = false;
+        auto& cache = factory_.GetCache();
+        cache.Invalidate();
+        if (cache.GetConfig().rebuild_on_commit) {
+            factory_.Rebuild();
+        }
+    }
+}
+
+void CachedUnitOfWork::BeginSavepoint() {
+    Inner().BeginSavepoint();
+}
+
+void CachedUnitOfWork::RollbackToSavepoint() {
+    Inner().RollbackToSavepoint();
+}
+
+void CachedUnitOfWork::ReleaseSavepoint() {
+    Inner().ReleaseSavepoint();
+}
+
+void CachedUnitOfWork::SetDeadline(std::chrono::steady_clock::time_point deadline) {
+    deadline_ = deadline;
+    if (inner_) {
+        inner_->SetDeadline(deadline);
+    }
+}
+
+void CachedUnitOfWork::ClearDeadline() noexcept {
+    deadline_.reset();
+    if (inner_) {
+        inner_->ClearDeadline();
+    }
+}
+
+void CachedAuthorRepository::DeleteAuthorAndDependencies(const domain::Author& author) {
+    unit_.Write().Authors().DeleteAuthorAndDependencies(author);
+}
+
+void CachedAuthorRepository::Save(const domain::Author& author) {
+    unit_.Write().Authors().Save(author);
+}
+
+CachedAuthorRepository::list_authors_t CachedAuthorRepository::GetList() {
+    return unit_.ReadThrough(
+        [](const CatalogSnapshot& snapshot) {
+            return snapshot.GetAuthors();
+        },
+        [](UnitOfWork& storage) {
+            return storage.Authors().GetList();
+        });
+}
+
+std::optional<domain::Author> CachedAuthorRepository::FindAuthorByName(const std::string& name) {
+    return unit_.ReadThrough(
+        [&name](const CatalogSnapshot& snapshot) {
+            return snapshot.FindAuthorByName(name);
+        },
+        [&name](UnitOfWork& storage) {
+            return storage.Authors().FindAuthorByName(name);
+        });
+}
+
+void CachedAuthorRepository::ForEach(const std::function<void(const domain::Author&)>& visitor) {
+    unit_.ReadThrough(
+        [&visitor](const CatalogSnapshot& snapshot) {
+            std::for_each(snapshot.GetAuthors().begin(), snapshot.GetAuthors().end(), visitor);
+        },
+        [&visitor](UnitOfWork& storage) {
+            storage.Authors().ForEach(visitor);
+        });
+}
+
+void CachedBookRepository::Delete(const domain::BookId& book_id) {
+    unit_.Write().Books().Delete(book_id);
+}
+
+void CachedBookRepository::Edit(const domain::Book& book) {
+    unit_.Write().Books().Edit(book);
+}
+
+void CachedBookRepository::Save(const domain::Book& book) {
+    unit_.Write().Books().Save(book);
+}
+
+CachedBookRepository::list_books_t CachedBookRepository::GetList() {
+    return unit_.ReadThrough(
+        [](const CatalogSnapshot& snapshot) {
+            return snapshot.GetBooks();
+        },
+        [](UnitOfWork& storage) {
+            return storage.Books().GetList();
+        });
+}
+
+CachedBookRepository::list_books_t CachedBookRepository::GetBookByAuthorId(const domain::AuthorId& author_id) {
+    return unit_.ReadThrough(
+        [&author_id](const CatalogSnapshot& snapshot) {
+            return snapshot.GetBooksByAuthor(author_id);
+        },
+        [&author_id](UnitOfWork& storage) {
+            return storage.Books().GetBookByAuthorId(author_id);
+        });
+}
+
+CachedBookRepository::list_books_t CachedBookRepository::GetBooksByTitle(const std::string& title) {
+    return unit_.ReadThrough(
+        [&title](const CatalogSnapshot& snapshot) {
+            return snapshot.GetBooksByTitle(title);
+        },
+        [&title](UnitOfWork& storage) {
+            return storage.Books().GetBooksByTitle(title);
+        });
+}
+
+CachedBookRepository::list_books_t CachedBookRepository::GetBooksByYearRange(const domain::YearRangeQuery& query) {
+    return unit_.ReadThrough(
+        [&query](const CatalogSnapshot& snapshot) {
+            return snapshot.GetBooksByYearRange(query);
+        },
+        [&query](UnitOfWork& storage) {
+            return storage.Books().GetBooksByYearRange(query);
+        });
+}
+
+void CachedBookRepository::ForEach(const std::function<void(const domain::Book&)>& visitor) {
+    unit_.ReadThrough(
+        [&visitor](const CatalogSnapshot& snapshot) {
+            std::for_each(snapshot.GetBooks().begin(), snapshot.GetBooks().end(), visitor);
+        },
+        [&visitor](UnitOfWork& storage) {
+            storage.Books().ForEach(visitor);
+        });
+}
+
+void CachedTagRepository::ClearTagsByBookId(const domain::BookId& book_id) {
+    unit_.Write().Tags().ClearTagsByBookId(book_id);
+}
+
+void CachedTagRepository::Save(const domain::Tag& tag) {
+    unit_.Write().Tags().Save(tag);
+}
+
+CachedTagRepository::list_tags_t CachedTagRepository::GetTagsByBookId(const domain::BookId& book_id) {
+    return unit_.ReadThrough(
+        [&book_id](const CatalogSnapshot& snapshot) {
+            return snapshot.GetTags(book_id);
+        },
+        [&book_id](UnitOfWork& storage) {
+            return storage.Tags().GetTagsByBookId(book_id);
+        });
+}
+
+bool CachedTagRepository::SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) {
+    return unit_.Write().Tags().SyncBookTags(book, tags);
+}
+
+void CachedTagRepository::ForEach(const std::function<void(const domain::Tag&)>& visitor) {
+    unit_.ReadThrough(
+        [&visitor](const CatalogSnapshot& snapshot) {
+            snapshot.ForEachTag(visitor);
+        },
+        [&visitor](UnitOfWork& storage) {
+            storage.Tags().ForEach(visitor);
+        });
+}
+
+}  // namespace app
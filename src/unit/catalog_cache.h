@@ -0,0 +1,276 @@
+#pragma once
+#include <atomic>
+#include <boost/uuid/uuid.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "unit_of_work.h"
+#include "unit_of_work_factory.h"
+
+namespace app {
+
+/**
+ * Неизменяемая копия каталога. Списки отдаются в том же порядке, что и репозитории хранилища.
+ * После публикации объект только читается, поэтому его можно разделять между потоками без блокировок.
+ */
+class CatalogSnapshot {
+public:
+    using list_authors_t = domain::AuthorRepository::list_authors_t;
+    using list_books_t = domain::BookRepository::list_books_t;
+    using list_tags_t = domain::TagRepository::list_tags_t;
+
+    // Читает каталог потоковыми ForEach репозиториев unit
+    static std::shared_ptr<const CatalogSnapshot> Load(UnitOfWork& unit);
+
+    const list_authors_t& GetAuthors() const noexcept {
+        return authors_;
+    }
+    const list_books_t& GetBooks() const noexcept {
+        return books_;
+    }
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) const;
+    list_books_t GetBooksByAuthor(const domain::AuthorId& author_id) const;
+    list_books_t GetBooksByTitle(const std::string& title) const;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) const;
+    list_tags_t GetTags(const domain::BookId& book_id) const;
+    void ForEachTag(const std::function<void(const domain::Tag&)>& visitor) const;
+
+    // Оценка занимаемой памяти, для CatalogCacheConfig::max_bytes
+    size_t ApproxBytes() const noexcept {
+        return approx_bytes_;
+    }
+
+private:
+    struct UuidHash {
+        size_t operator()(const boost::uuids::uuid& uuid) const noexcept {
+            return boost::uuids::hash_value(uuid);
+        }
+    };
+    using index_t = std::unordered_map<boost::uuids::uuid, std::vector<size_t>, UuidHash>;
+
+    list_authors_t authors_;
+    list_books_t books_;
+    std::unordered_map<std::string, size_t> author_by_name_;
+    std::unordered_map<std::string, std::vector<size_t>> books_by_title_;
+    // Книги автора по году и названию, как BookRepository::GetBookByAuthorId
+    index_t books_by_author_;
+    // Все книги по BookKey, для страниц выборки по годам
+    std::vector<size_t> books_by_year_;
+    std::unordered_map<boost::uuids::uuid, std::vector<std::string>, UuidHash> tags_;
+    size_t approx_bytes_ = 0;
+};
+
+/**
+ * Общая для всех сеансов процесса копия каталога. Текущая версия публикуется атомарной
+ * заменой shared_ptr: читатель берёт указатель и дальше работает с неизменяемым объектом,
+ * не блокируя ни писателей, ни других читателей. Старая версия освобождается,
+ * когда её отпустит последний читатель.
+ *
+ * Инвалидируют копию только коммиты этого процесса. Записи других процессов, будь то второй
+ * экземпляр приложения или лента изменений, обновляющая реплику, кэш не видит: они появятся,
+ * лишь когда копия устареет по max_age, а при max_age = 0 не появятся вовсе.
+ */
+class CatalogCache {
+public:
+    using listener_t = std::function<void()>;
+
+    explicit CatalogCache(CatalogCacheConfig config)
+        : config_{config} {
+    }
+
+    const CatalogCacheConfig& GetConfig() const noexcept {
+        return config_;
+    }
+
+    // nullptr, если копии нет, она устарела по max_age или каталог не помещается в max_bytes
+    std::shared_ptr<const CatalogSnapshot> Current() const;
+    // Актуальная версия каталога известна и не помещается в max_bytes
+    bool IsOversized() const;
+    // Номер версии каталога; меняется при каждой инвалидации
+    uint64_t Generation() const noexcept {
+        return generation_.load();
+    }
+    // Публикует копию, прочитанную, когда номер версии был generation.
+    // Если с тех пор каталог менялся, копия уже устарела и отбрасывается
+    bool Publish(std::shared_ptr<const CatalogSnapshot> snapshot, uint64_t generation);
+    // Каталог изменился: текущая копия больше не выдаётся
+    void Invalidate();
+    // Вызывается при каждой инвалидации, например, чтобы сбросить производные кэши
+    void AddInvalidationListener(listener_t listener);
+
+private:
+    struct Entry {
+        std::shared_ptr<const CatalogSnapshot> snapshot;  // nullptr - каталог больше max_bytes
+        uint64_t generation = 0;
+        std::chrono::steady_clock::time_point loaded_at;
+    };
+
+    bool IsUsable(const Entry& entry) const noexcept;
+
+    const CatalogCacheConfig config_;
+    std::atomic<std::shared_ptr<const Entry>> entry_;
+    std::atomic<uint64_t> generation_{0};
+
+    std::mutex listeners_mutex_;
+    std::vector<listener_t> listeners_;
+};
+
+class CachedUnitOfWork;
+
+class CachedAuthorRepository : public domain::AuthorRepository {
+public:
+    explicit CachedAuthorRepository(CachedUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void DeleteAuthorAndDependencies(const domain::Author& author) override;
+    void Save(const domain::Author& author) override;
+    list_authors_t GetList() override;
+    std::optional<domain::Author> FindAuthorByName(const std::string& name) override;
+    void ForEach(const std::function<void(const domain::Author&)>& visitor) override;
+
+private:
+    CachedUnitOfWork& unit_;
+};
+
+class CachedBookRepository : public domain::BookRepository {
+public:
+    explicit CachedBookRepository(CachedUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void Delete(const domain::BookId& book_id) override;
+    void Edit(const domain::Book& book) override;
+    void Save(const domain::Book& book) override;
+    list_books_t GetList() override;
+    list_books_t GetBookByAuthorId(const domain::AuthorId& author_id) override;
+    list_books_t GetBooksByTitle(const std::string& title) override;
+    list_books_t GetBooksByYearRange(const domain::YearRangeQuery& query) override;
+    void ForEach(const std::function<void(const domain::Book&)>& visitor) override;
+
+private:
+    CachedUnitOfWork& unit_;
+};
+
+class CachedTagRepository : public domain::TagRepository {
+public:
+    explicit CachedTagRepository(CachedUnitOfWork& unit)
+        : unit_{unit} {
+    }
+
+    void ClearTagsByBookId(const domain::BookId& book_id) override;
+    void Save(const domain::Tag& tag) override;
+    list_tags_t GetTagsByBookId(const domain::BookId& book_id) override;
+    bool SyncBookTags(const domain::Book& book, const std::vector<std::string>& tags) override;
+    void ForEach(const std::function<void(const domain::Tag&)>& visitor) override;
+
+private:
+    CachedUnitOfWork& unit_;
+};
+
+class CachedUnitOfWorkFactory;
+
+/**
+ * Единица работы, которая читает из CatalogCache, пока сама ничего не записала.
+ * Единица работы хранилища создаётся только при записи, промахе кэша или точке сохранения.
+ * Записи идут в хранилище, после их коммита кэш инвалидируется.
+ */
+class CachedUnitOfWork : public UnitOfWork {
+public:
+    explicit CachedUnitOfWork(CachedUnitOfWorkFactory& factory)
+        : factory_{factory} {
+    }
+
+    void Commit() override;
+    void BeginSavepoint() override;
+    void RollbackToSavepoint() override;
+    void ReleaseSavepoint() override;
+    // Срок передаётся единице работы хранилища, в том числе открытой позже
+    void SetDeadline(std::chrono::steady_clock::time_point deadline) override;
+    void ClearDeadline() noexcept override;
+
+    CachedAuthorRepository& Authors() override {
+        return authors_;
+    }
+    CachedBookRepository& Books() override {
+        return books_;
+    }
+    CachedTagRepository& Tags() override {
+        return tags_;
+    }
+    // Счётчики хранилище и так читает за O(1)
+    domain::StatsRepository& Stats() override {
+        return Inner().Stats();
+    }
+
+    UnitOfWork& Inner();
+    UnitOfWork& Write() {
+        wrote_ = true;
+        return Inner();
+    }
+
+    // Чтение из копии каталога или, если её нет или эта единица работы уже писала, из хранилища
+    template <typename Local, typename Remote>
+    auto ReadThrough(const Local& local, const Remote& remote) -> std::invoke_result_t<const Remote&, UnitOfWork&> {
+        if (!wrote_) {
+            if (auto snapshot = Snapshot()) {
+                return local(*snapshot);
+            }
+        }
+        return remote(Inner());
+    }
+
+private:
+    std::shared_ptr<const CatalogSnapshot> Snapshot();
+
+    CachedUnitOfWorkFactory& factory_;
+    std::shared_ptr<UnitOfWork> inner_;
+    bool wrote_ = false;
+    std::optional<std::chrono::steady_clock::time_point> deadline_;
+
+    CachedAuthorRepository authors_{*this};
+    CachedBookRepository books_{*this};
+    CachedTagRepository tags_{*this};
+};
+
+// Ставит CatalogCache перед любым хранилищем
+class CachedUnitOfWorkFactory : public UnitOfWorkFactory {
+public:
+    CachedUnitOfWorkFactory(std::unique_ptr<UnitOfWorkFactory> storage, CatalogCacheConfig config)
+        : storage_{std::move(storage)}
+        , cache_{config} {
+    }
+
+    UnitOfWorkFactory& GetStorage() noexcept {
+        return *storage_;
+    }
+    CatalogCache& GetCache() noexcept {
+        return cache_;
+    }
+
+    std::shared_ptr<UnitOfWork> CreateUnitOfWork() override {
+        return std::make_shared<CachedUnitOfWork>(*this);
+    }
+
+    // Копия каталога; при промахе читает её в единице работы storage() и публикует.
+    // nullptr - каталог не помещается в кэш или копию сейчас строит другой поток
+    std::shared_ptr<const CatalogSnapshot> GetSnapshot(const std::function<UnitOfWork&()>& storage);
+    // Строит копию в отдельной единице работы хранилища, после коммита записи
+    void Rebuild();
+
+private:
+    std::unique_ptr<UnitOfWorkFactory> storage_;
+    CatalogCache cache_;
+    // Копию строит один поток, остальные промахнувшиеся читают из хранилища
+    std::atomic<bool> loading_{false};
+};
+
+}  // namespace app
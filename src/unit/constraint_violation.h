@@ -0,0 +1,13 @@
+#pragma once
+#include <stdexcept>
+
+namespace app {
+
+// Хранилище отказало в записи из-за ограничения схемы (уникальность, внешний ключ, CHECK).
+// Повтор той же записи получит тот же отказ
+class ConstraintViolation : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+}  // namespace app
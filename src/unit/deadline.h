@@ -0,0 +1,13 @@
+#pragma once
+#include <stdexcept>
+
+namespace app {
+
+// Вызов сценария не уложился в срок: хранилище прервало запрос по таймауту или отменило его.
+// Транзакция после этого непригодна, единицу работы нужно откатить
+class DeadlineExceeded : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+}  // namespace app
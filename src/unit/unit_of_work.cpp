@@ -1 +1,15 @@
-#include "unit_of_work.h"
\ No newline at end of file
+#include "unit_of_work.h"
+
+#include <stdexcept>
+
+namespace app {
+
+uint64_t UnitOfWork::GetJournalPosition(const std::string &) {
+    throw std::logic_error("Storage doesn't support the write-behind journal");
+}
+
+void UnitOfWork::SetJournalPosition(const std::string &, uint64_t) {
+    throw std::logic_error("Storage doesn't support the write-behind journal");
+}
+
+}
@@ -1,17 +1,37 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <string>
+
 #include "../domain/author.h"
 #include "../domain/book.h"
+#include "../domain/stats.h"
 #include "../domain/tag.h"
+#include "deadline.h"
 
 namespace app {
 
 class UnitOfWork {
     public:
         virtual void Commit() = 0;
+        // Точка сохранения внутри текущей транзакции, используется пакетным режимом
+        virtual void BeginSavepoint() = 0;
+        virtual void RollbackToSavepoint() = 0;
+        virtual void ReleaseSavepoint() = 0;
+        // Запросы до ClearDeadline должны завершиться к deadline, иначе хранилище прерывает их
+        // и они бросают DeadlineExceeded. Хранилища без сетевых запросов срок не учитывают
+        virtual void SetDeadline(std::chrono::steady_clock::time_point /*deadline*/) {}
+        virtual void ClearDeadline() noexcept {}
+        // Позиция журнала отложенной записи (journal/) journal_id, уже применённая к хранилищу; 0 - ничего.
+        // Журнал пишет её в той же транзакции, что и свои операции, поэтому повтор после сбоя их не удвоит.
+        // Хранилища без поддержки журнала бросают std::logic_error
+        virtual uint64_t GetJournalPosition(const std::string & journal_id);
+        virtual void SetJournalPosition(const std::string & journal_id, uint64_t position);
         virtual domain::AuthorRepository & Authors() = 0; 
         virtual domain::BookRepository & Books() = 0;
         virtual domain::TagRepository & Tags() = 0;
+        virtual domain::StatsRepository & Stats() = 0;
 };
 
 }
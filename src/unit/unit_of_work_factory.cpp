@@ -1,13 +1,67 @@
 #include "unit_of_work_factory.h"
 
+#include <stdexcept>
+
+#include "catalog_cache.h"
+#include "../journal/unit_of_work_impl.h"
+#include "../postgres/replica.h"
+#include "../postgres/sharding.h"
 #include "../postgres/unit_of_work_impl.h"
+#include "../snapshot/unit_of_work_impl.h"
+#include "../sqlite/unit_of_work_impl.h"
 
 namespace app {
 
-UnitOfWorkFactory::UnitOfWorkFactory(pqxx::connection& conn) : conn_(conn) {}
+namespace {
+
+// read_only - единицы работы фабрики только читают; сейчас это учитывает только SQLite
+std::unique_ptr<UnitOfWorkFactory> MakeStorageFactory(const StorageConfig & config, bool read_only = false) {
+    if(config.urls.empty())
+        throw std::invalid_argument("No database url configured");
+    if(snapshot::IsSnapshotUrl(config.urls.front())) {
+        if(config.urls.size() > 1)
+            throw std::invalid_argument("Sharding is supported only for Postgres");
+        return std::make_unique<snapshot::UnitOfWorkFactoryImpl>(snapshot::ParseUrl(config.urls.front()));
+    }
+    if(sqlite::IsSqliteUrl(config.urls.front())) {
+        if(config.urls.size() > 1)
+            throw std::invalid_argument("Sharding is supported only for Postgres");
+        return std::make_unique<sqlite::UnitOfWorkFactoryImpl>(sqlite::PathFromUrl(config.urls.front()), read_only);
+    }
+    if(config.replica) {
+        if(config.urls.size() > 1 || config.previous_shard_count > 1)
+            throw std::invalid_argument("Replica is supported only for a single Postgres database");
+        return std::make_unique<postgres::ReplicatedUnitOfWorkFactory>(config.urls.front(), *config.replica);
+    }
+    if(config.urls.size() == 1 && config.previous_shard_count <= 1) {
+        return std::make_unique<postgres::UnitOfWorkFactoryImpl>(postgres::Connect(config.urls.front()));
+    }
+    return std::make_unique<postgres::ShardedUnitOfWorkFactory>(config.urls, config.previous_shard_count);
+}
+
+std::unique_ptr<UnitOfWorkFactory> MakeJournaledFactory(const StorageConfig & config) {
+    if(config.urls.size() != 1 || config.previous_shard_count > 1 || snapshot::IsSnapshotUrl(config.urls.front()))
+        throw std::invalid_argument("Write-behind journal is supported only for a single Postgres or SQLite database");
+    // Реплика отстаёт от базы, а кэш перечитывается после коммита: оба не увидели бы ещё не применённый журнал
+    if(config.replica || config.cache)
+        throw std::invalid_argument("Write-behind journal can't be combined with a replica or the catalog cache");
+    auto apply = config;
+    apply.journal.reset();
+    // Сеансы через своё хранилище только читают, пишет лишь поток сброса
+    return std::make_unique<journal::UnitOfWorkFactoryImpl>(MakeStorageFactory(config, true), [apply] {
+        return MakeStorageFactory(apply);
+    }, *config.journal);
+}
+
+}  // namespace
 
-std::shared_ptr<UnitOfWork> UnitOfWorkFactory::CreateUnitOfWork() {
-    return std::make_shared<postgres::UnitOfWorkImpl>(conn_);
+std::unique_ptr<UnitOfWorkFactory> MakeUnitOfWorkFactory(const StorageConfig & config) {
+    if(config.journal)
+        return MakeJournaledFactory(config);
+    auto factory = MakeStorageFactory(config);
+    if(config.cache)
+        return std::make_unique<CachedUnitOfWorkFactory>(std::move(factory), *config.cache);
+    return factory;
 }
 
 }  // namespace app
@@ -1,18 +1,55 @@
 #pragma once
 
-#include "../postgres/unit_of_work_impl.h"
+#include "unit_of_work.h"
+#include "../journal/journal.h"
+#include "../postgres/change_feed.h"
+#include <chrono>
+#include <cstddef>
 #include <memory>
-#include <pqxx/pqxx>
+#include <optional>
+#include <string>
+#include <vector>
 
 namespace app {
 
 class UnitOfWorkFactory {
 public:
-    UnitOfWorkFactory(pqxx::connection & conn);
+    virtual std::shared_ptr<UnitOfWork> CreateUnitOfWork() = 0;
+    // Записи, о коммите которых сеансу уже ответили, но которые хранилище отвергло при отложенном
+    // применении. Каждая отдаётся один раз. Хранилища, пишущие при коммите, ничего не откладывают
+    virtual std::vector<std::string> TakeRejectedWrites() {
+        return {};
+    }
 
-    std::shared_ptr<UnitOfWork> CreateUnitOfWork();
-private:
-    pqxx::connection & conn_;
+    virtual ~UnitOfWorkFactory() = default;
 };
 
+struct CatalogCacheConfig {
+    // Каталог, копия которого больше, не кэшируется: чтения идут в хранилище
+    size_t max_bytes = 64 * 1024 * 1024;
+    // Записи другого процесса кэш не видит; через max_age копия перечитывается. 0 - без ограничения
+    std::chrono::milliseconds max_age{5000};
+    // Пишущая единица работы после коммита сразу строит и публикует новую копию,
+    // иначе её построит первое чтение
+    bool rebuild_on_commit = true;
+};
+
+struct StorageConfig {
+    // Один адрес - обычная база (sqlite:path - файл SQLite, snapshot://path - снимок только для чтения),
+    // несколько - каталог Postgres шардирован по author_id
+    std::vector<std::string> urls;
+    // Идёт перешардирование: авторы ещё могут лежать по раскладке на столько шардов
+    size_t previous_shard_count = 0;
+    // Если задан, чтения одной базы Postgres обслуживает локальная реплика, которую обновляет лента изменений
+    std::optional<postgres::ReplicaConfig> replica;
+    // Если задан, чтения обслуживает общая для сеансов процесса копия каталога
+    std::optional<CatalogCacheConfig> cache;
+    // Если задан, записи коммитятся в локальный журнал и применяются к базе в фоне.
+    // Только для одной базы Postgres или SQLite, без реплики и кэша каталога
+    std::optional<journal::JournalConfig> journal;
+};
+
+// Выбирает хранилище по конфигурации; фабрика владеет соединениями
+std::unique_ptr<UnitOfWorkFactory> MakeUnitOfWorkFactory(const StorageConfig & config);
+
 }
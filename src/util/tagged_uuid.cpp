@@ -15,6 +15,18 @@ std::string UUIDToString(const UUIDType& uuid) {
     return to_string(uuid);
 }
 
+void UUIDToChars(const UUIDType& uuid, char* out) noexcept {
+    constexpr char digits[] = "0123456789abcdef";
+    size_t pos = 0;
+    for (size_t i = 0; i < uuid.size(); ++i) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            out[pos++] = '-';
+        }
+        out[pos++] = digits[uuid.data[i] >> 4];
+        out[pos++] = digits[uuid.data[i] & 0x0f];
+    }
+}
+
 UUIDType UUIDFromString(std::string_view str) {
     boost::uuids::string_generator gen;
     return gen(str.begin(), str.end());
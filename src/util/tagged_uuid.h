@@ -1,7 +1,9 @@
 #pragma once
 #include <boost/uuid/nil_generator.hpp>
 #include <boost/uuid/uuid.hpp>
+#include <cstddef>
 #include <string>
+#include <string_view>
 
 #include "tagged.h"
 
@@ -14,7 +16,12 @@ using UUIDType = boost::uuids::uuid;
 UUIDType NewUUID();
 constexpr UUIDType ZeroUUID{{0}};
 
+// Длина текстового вида UUID без завершающего нуля
+inline constexpr size_t UUID_TEXT_SIZE = 36;
+
 std::string UUIDToString(const UUIDType& uuid);
+// Пишет UUID_TEXT_SIZE символов в out, без выделения памяти
+void UUIDToChars(const UUIDType& uuid, char* out) noexcept;
 UUIDType UUIDFromString(std::string_view str);
 
 }  // namespace detail
@@ -33,7 +40,7 @@ public:
         return TaggedUUID{detail::NewUUID()};
     }
 
-    static TaggedUUID FromString(const std::string& uuid_as_text) {
+    static TaggedUUID FromString(std::string_view uuid_as_text) {
         return TaggedUUID{detail::UUIDFromString(uuid_as_text)};
     }
 
@@ -0,0 +1,176 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/sqlite/unit_of_work_impl.h"
+#include "../src/unit/catalog_cache.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct Fixture {
+    explicit Fixture(app::CatalogCacheConfig config = {})
+        : factory{std::make_unique<sqlite::UnitOfWorkFactoryImpl>(":memory:"s), config} {
+    }
+
+    app::CachedUnitOfWorkFactory factory;
+    app::UseCasesImpl use_cases{factory};
+};
+
+// Единица работы SQLite, которая записывает, когда ей ставят и снимают срок
+class DeadlineRecorder : public sqlite::UnitOfWorkImpl {
+public:
+    DeadlineRecorder(sqlite::Connection& connection, std::vector<std::string>& calls)
+        : UnitOfWorkImpl{connection}
+        , calls_{calls} {
+    }
+
+    void SetDeadline(std::chrono::steady_clock::time_point) override {
+        calls_.push_back("set"s);
+    }
+    void ClearDeadline() noexcept override {
+        calls_.push_back("clear"s);
+    }
+
+private:
+    std::vector<std::string>& calls_;
+};
+
+struct DeadlineRecorderFactory : app::UnitOfWorkFactory {
+    std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+        return std::make_shared<DeadlineRecorder>(db.GetConnection(), calls);
+    }
+
+    sqlite::Database db{":memory:"s};
+    std::vector<std::string> calls;
+};
+
+}  // namespace
+
+TEST_CASE_METHOD(Fixture, "Catalog cache serves reads and follows commits") {
+    auto& cache = factory.GetCache();
+    const auto pushkin = use_cases.AddAuthor("Pushkin");
+    const auto onegin = use_cases.AddBook(1833, pushkin, "Eugene Onegin");
+    use_cases.AddBook(1831, pushkin, "Boris Godunov");
+    use_cases.AddTags(onegin, {"poetry", "novel"});
+    use_cases.Commit();
+
+    // Копию опубликовал коммит
+    const auto snapshot = cache.Current();
+    REQUIRE(snapshot);
+    CHECK(snapshot->GetBooks().size() == 2);
+
+    const auto books = use_cases.GetBooksAuthors(pushkin);
+    REQUIRE(books.size() == 2);
+    CHECK(books[0].title == "Boris Godunov");
+    CHECK(use_cases.GetTagsByBookId(onegin) == std::vector{"novel"s, "poetry"s});
+    CHECK(use_cases.FindAuthorByName("Pushkin").has_value());
+    CHECK(use_cases.FindBooksByTitle("Eugene Onegin").size() == 1);
+    use_cases.FinishRead();
+    CHECK(cache.Current() == snapshot);
+
+    const auto generation = cache.Generation();
+    use_cases.AddAuthor("Gogol");
+    // Своя незакоммиченная запись видна, копия каталога её не содержит
+    CHECK(use_cases.GetAuthors().size() == 2);
+    CHECK(cache.Current() == snapshot);
+    use_cases.Commit();
+    CHECK(cache.Generation() > generation);
+    REQUIRE(cache.Current());
+    CHECK(cache.Current()->GetAuthors().size() == 2);
+
+    use_cases.AddAuthor("Chekhov");
+    use_cases.Rollback();
+    CHECK(use_cases.GetAuthors().size() == 2);
+}
+
+TEST_CASE("Catalog cache rejects stale and oversized copies") {
+    app::CatalogCacheConfig config;
+    config.rebuild_on_commit = false;
+    Fixture small{[] {
+        app::CatalogCacheConfig config;
+        config.max_bytes = 1;
+        return config;
+    }()};
+    small.use_cases.AddAuthor("Tolstoy");
+    small.use_cases.Commit();
+    CHECK(small.use_cases.GetAuthors().size() == 1);
+    CHECK(small.factory.GetCache().IsOversized());
+    CHECK_FALSE(small.factory.GetCache().Current());
+
+    Fixture lazy{config};
+    auto& cache = lazy.factory.GetCache();
+    lazy.use_cases.AddAuthor("Tolstoy");
+    lazy.use_cases.Commit();
+    CHECK_FALSE(cache.Current());
+    CHECK(lazy.use_cases.GetAuthors().size() == 1);
+    lazy.use_cases.FinishRead();
+    const auto snapshot = cache.Current();
+    REQUIRE(snapshot);
+
+    // Копия, прочитанная до инвалидации, не публикуется
+    const auto generation = cache.Generation();
+    cache.Invalidate();
+    CHECK_FALSE(cache.Publish(snapshot, generation));
+    CHECK_FALSE(cache.Current());
+    CHECK(cache.Publish(snapshot, cache.Generation()));
+}
+
+TEST_CASE_METHOD(Fixture, "Catalog cache pages books by year like the storage") {
+    const auto pushkin = use_cases.AddAuthor("Pushkin");
+    const auto gogol = use_cases.AddAuthor("Gogol");
+    for (int year = 1820; year < 1850; ++year) {
+        use_cases.AddBook(year, year % 2 ? pushkin : gogol, "Book "s + std::to_string(year % 3));
+    }
+    use_cases.Commit();
+    REQUIRE(factory.GetCache().Current());
+
+    for (const auto& author : {std::string{}, gogol}) {
+        domain::YearRangeQuery query{1825, 1844, std::nullopt, std::nullopt, 4};
+        if (!author.empty()) {
+            query.author_id = domain::AuthorId::FromString(author);
+        }
+        auto storage = factory.GetStorage().CreateUnitOfWork();
+        const auto snapshot = factory.GetCache().Current();
+        while (true) {
+            const auto expected = storage->Books().GetBooksByYearRange(query);
+            const auto cached = snapshot->GetBooksByYearRange(query);
+            REQUIRE(cached.size() == expected.size());
+            for (size_t i = 0; i < cached.size(); ++i) {
+                CHECK(cached[i].GetId() == expected[i].GetId());
+            }
+            if (expected.size() < query.limit) {
+                break;
+            }
+            query.after = domain::KeyOf(expected.back());
+        }
+    }
+}
+
+TEST_CASE("Catalog cache passes call deadlines to the storage unit of work") {
+    auto storage = std::make_unique<DeadlineRecorderFactory>();
+    auto& calls = storage->calls;
+    app::CachedUnitOfWorkFactory factory{std::move(storage), {}};
+    app::UseCasesImpl use_cases{factory};
+    use_cases.SetCallTimeout(std::chrono::seconds(10));
+
+    // Запись открывает единицу работы хранилища посреди вызова, срок достаётся и ей
+    use_cases.AddAuthor("Pushkin");
+    CHECK(calls == std::vector{"set"s, "clear"s});
+    use_cases.Commit();
+
+    // Чтение из копии каталога до хранилища не доходит
+    calls.clear();
+    CHECK(use_cases.GetAuthors().size() == 1);
+    CHECK(calls.empty());
+
+    use_cases.SetCallTimeout(std::chrono::milliseconds(0));
+    use_cases.AddAuthor("Gogol");
+    CHECK(calls.empty());
+    use_cases.Rollback();
+}
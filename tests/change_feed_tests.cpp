@@ -0,0 +1,87 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "../src/postgres/change_feed.h"
+#include "../src/postgres/replica.h"
+
+using namespace std::literals;
+using postgres::ChangeSequence;
+
+TEST_CASE("Change event payload") {
+    const auto id = domain::BookId::New().ToString();
+    auto event = postgres::ParseChangeEvent("42:book_tags:D:"s + id);
+    REQUIRE(event.has_value());
+    CHECK(event->seq == 42);
+    CHECK(event->table == postgres::ChangeTable::BOOK_TAGS);
+    CHECK(event->op == postgres::ChangeOp::DELETE);
+    CHECK(event->id == id);
+
+    CHECK(postgres::ParseChangeEvent("7:authors:U:"s + id)->op == postgres::ChangeOp::UPDATE);
+    CHECK_FALSE(postgres::ParseChangeEvent("7:authors:U:"sv).has_value());
+    CHECK_FALSE(postgres::ParseChangeEvent("x:authors:I:"s + id).has_value());
+    CHECK_FALSE(postgres::ParseChangeEvent("7:readers:I:"s + id).has_value());
+    CHECK_FALSE(postgres::ParseChangeEvent("7:books:T:"s + id).has_value());
+    CHECK_FALSE(postgres::ParseChangeEvent("7:books"sv).has_value());
+}
+
+TEST_CASE("Change sequence detects lost notifications") {
+    ChangeSequence sequence;
+    sequence.Reset(10);
+    // Уже в снимке
+    CHECK(sequence.Accept(9) == ChangeSequence::Position::APPLIED);
+    CHECK(sequence.Accept(10) == ChangeSequence::Position::APPLIED);
+    // Несколько строк одной транзакции несут один номер
+    CHECK(sequence.Accept(11) == ChangeSequence::Position::NEXT);
+    CHECK(sequence.Accept(11) == ChangeSequence::Position::NEXT);
+    CHECK(sequence.Accept(12) == ChangeSequence::Position::NEXT);
+    CHECK(sequence.Seq() == 12);
+    CHECK(sequence.Accept(14) == ChangeSequence::Position::GAP);
+    CHECK(sequence.Seq() == 12);
+
+    sequence.Reset(20);
+    CHECK(sequence.Accept(12) == ChangeSequence::Position::APPLIED);
+    CHECK(sequence.Accept(21) == ChangeSequence::Position::NEXT);
+}
+
+TEST_CASE("Replica state keeps repository order and cascades") {
+    postgres::CatalogState state;
+    const domain::Author tolstoy{domain::AuthorId::New(), "Tolstoy", 1};
+    const domain::Author chekhov{domain::AuthorId::New(), "Chekhov", 1};
+    const domain::Book war{domain::BookId::New(), {tolstoy.GetId(), ""}, "War and Peace", 1869, 1};
+    const domain::Book anna{domain::BookId::New(), {tolstoy.GetId(), ""}, "Anna Karenina", 1877, 1};
+    const domain::Book stories{domain::BookId::New(), {chekhov.GetId(), ""}, "Stories", 1890, 1};
+    state.PutAuthor(tolstoy);
+    state.PutAuthor(chekhov);
+    for (const auto& book : {war, anna, stories}) {
+        state.PutBook(book);
+    }
+    state.SetTags(war.GetId().ToString(), {"novel"s, "history"s});
+
+    const auto authors = state.GetAuthors();
+    REQUIRE(authors.size() == 2);
+    CHECK(authors[0].GetName() == "Chekhov");
+
+    const auto books = state.GetBooks();
+    REQUIRE(books.size() == 3);
+    CHECK(books[0].GetTitle() == "Anna Karenina");
+    CHECK(books[0].GetAuthorName() == "Tolstoy");
+    CHECK(state.GetBooksByAuthor(tolstoy.GetId().ToString())[0].GetTitle() == "War and Peace");
+    CHECK(state.GetTags(war.GetId())[0].GetTag() == "history");
+
+    // Переименование: старое имя больше не находится, книги видят новое
+    state.PutAuthor({tolstoy.GetId(), "Lev Tolstoy", 2});
+    CHECK_FALSE(state.FindAuthorByName("Tolstoy").has_value());
+    CHECK(state.FindAuthorByName("Lev Tolstoy")->GetVersion() == 2);
+    CHECK(state.GetBooksByTitle("Anna Karenina")[0].GetAuthorName() == "Lev Tolstoy");
+
+    // Правка названия переносит книгу в индексе
+    state.PutBook({anna.GetId(), {tolstoy.GetId(), ""}, "Anna", 1877, 2});
+    CHECK(state.GetBooksByTitle("Anna Karenina").empty());
+    CHECK(state.GetBooksByTitle("Anna").size() == 1);
+
+    state.EraseAuthor(tolstoy.GetId().ToString());
+    CHECK(state.BookCount() == 1);
+    CHECK(state.GetTags(war.GetId()).empty());
+    CHECK(state.GetBooksByAuthor(tolstoy.GetId().ToString()).empty());
+}
@@ -0,0 +1,135 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <set>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/app/executor.h"
+#include "../src/app/use_cases_impl.h"
+#include "../src/domain/errors.h"
+#include "../src/sqlite/unit_of_work_impl.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct TempDatabase {
+    TempDatabase()
+        : path{std::filesystem::temp_directory_path() / ("bookypedia-executor-"s + std::to_string(::getpid()) + ".db"s)} {
+        Remove();
+    }
+    ~TempDatabase() {
+        Remove();
+    }
+    void Remove() {
+        for (const auto* suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(path.string() + suffix);
+        }
+    }
+
+    std::filesystem::path path;
+};
+
+}  // namespace
+
+TEST_CASE("Executor runs each task in its own unit of work") {
+    TempDatabase db;
+    app::ExecutorConfig config;
+    config.threads = 4;
+    app::UseCaseExecutor executor{[&db] {
+        return std::make_unique<sqlite::UnitOfWorkFactoryImpl>(db.path.string());
+    }, config};
+    CHECK(executor.ThreadCount() == 4);
+
+    std::vector<std::string> names;
+    for (int i = 0; i < 40; ++i) {
+        names.push_back("Author "s + std::to_string(i));
+    }
+    auto added = executor.SubmitBatch(names.begin(), names.end(), [](app::UseCases& use_cases, const std::string& name) {
+        return use_cases.AddAuthor(name);
+    });
+    std::set<std::string> ids;
+    for (auto& future : added) {
+        ids.insert(future.get());
+    }
+    CHECK(ids.size() == names.size());
+
+    // Исключение откатывает единицу работы задачи и приходит в future
+    auto failed = executor.Submit([](app::UseCases& use_cases) {
+        use_cases.AddAuthor("Rolled back");
+        throw domain::VersionConflict("conflict");
+    });
+    CHECK_THROWS_AS(failed.get(), domain::VersionConflict);
+
+    auto authors = executor.Submit([](app::UseCases& use_cases) {
+        return use_cases.GetAuthors().size();
+    });
+    CHECK(authors.get() == names.size());
+}
+
+TEST_CASE("Idle executor threads steal tasks queued on a busy one") {
+    TempDatabase db;
+    app::ExecutorConfig config;
+    config.threads = 4;
+    app::UseCaseExecutor executor{[&db] {
+        return std::make_unique<sqlite::UnitOfWorkFactoryImpl>(db.path.string());
+    }, config};
+
+    // Задачи, поставленные из задачи, попадают в очередь её потока; остальные потоки простаивают
+    auto queued = executor.Submit([&executor](app::UseCases&) {
+        std::vector<std::future<std::thread::id>> ids;
+        for (int i = 0; i < 32; ++i) {
+            ids.push_back(executor.Submit([](app::UseCases&) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{2});
+                return std::this_thread::get_id();
+            }));
+        }
+        return ids;
+    });
+    std::set<std::thread::id> threads;
+    for (auto& id : queued.get()) {
+        threads.insert(id.get());
+    }
+    CHECK(threads.size() > 1);
+}
+
+TEST_CASE("Executor splits a batch into one run of items per queue") {
+    using app::UseCaseExecutor;
+    // Поровну
+    CHECK(UseCaseExecutor::BatchQueue(0, 8, 4) == 0);
+    CHECK(UseCaseExecutor::BatchQueue(1, 8, 4) == 0);
+    CHECK(UseCaseExecutor::BatchQueue(2, 8, 4) == 1);
+    CHECK(UseCaseExecutor::BatchQueue(7, 8, 4) == 3);
+    // Кусок округляется вверх, последней очереди достаётся меньше или ничего
+    CHECK(UseCaseExecutor::BatchQueue(3, 5, 4) == 1);
+    CHECK(UseCaseExecutor::BatchQueue(4, 5, 4) == 2);
+    CHECK(UseCaseExecutor::BatchQueue(8, 9, 4) == 2);
+    // Элементов меньше, чем очередей: по одному
+    CHECK(UseCaseExecutor::BatchQueue(0, 1, 4) == 0);
+    CHECK(UseCaseExecutor::BatchQueue(2, 3, 4) == 2);
+
+    TempDatabase db;
+    app::ExecutorConfig config;
+    config.threads = 4;
+    app::UseCaseExecutor executor{[&db] {
+        return std::make_unique<sqlite::UnitOfWorkFactoryImpl>(db.path.string());
+    }, config};
+    for (const int count : {0, 1, 3, 4, 5, 9}) {
+        std::vector<int> items(static_cast<size_t>(count));
+        for (int i = 0; i < count; ++i) {
+            items[static_cast<size_t>(i)] = i;
+        }
+        auto results = executor.SubmitBatch(items.begin(), items.end(), [](app::UseCases&, int item) {
+            return item * 10;
+        });
+        REQUIRE(results.size() == items.size());
+        for (int i = 0; i < count; ++i) {
+            CHECK(results[static_cast<size_t>(i)].get() == i * 10);
+        }
+    }
+}
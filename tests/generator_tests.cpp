@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../src/gen/generator.h"
+
+namespace {
+
+struct RecordingSink : gen::CatalogSink {
+    std::vector<std::string> authors;
+    std::vector<std::string> names;
+    std::vector<std::string> books;
+    std::vector<std::string> titles;
+    std::vector<std::string> tags;
+    bool finished = false;
+
+    std::vector<std::string> vocabulary;
+
+    void AddTagVocabulary(const std::vector<std::string>& tags) override {
+        vocabulary = tags;
+    }
+    void AddAuthor(std::string_view id, std::string_view name) override {
+        authors.emplace_back(id);
+        names.emplace_back(name);
+    }
+    void AddBook(std::string_view id, std::string_view, std::string_view title, int) override {
+        CHECK(tags.empty());
+        books.emplace_back(id);
+        titles.emplace_back(title);
+    }
+    void AddTag(std::string_view, size_t tag_index) override {
+        tags.push_back(vocabulary.at(tag_index));
+    }
+    void Finish() override {
+        finished = true;
+    }
+};
+
+gen::GeneratorConfig SmallConfig() {
+    gen::GeneratorConfig config;
+    config.authors = 200;
+    config.max_books_per_author = 50;
+    config.tag_vocabulary = 100;
+    config.seed = 7;
+    return config;
+}
+
+}  // namespace
+
+TEST_CASE("Generator is deterministic for a fixed seed") {
+    RecordingSink first, second;
+    gen::CatalogGenerator{SmallConfig()}.Generate(first);
+    gen::CatalogGenerator{SmallConfig()}.Generate(second);
+
+    CHECK(first.finished);
+    CHECK(first.authors == second.authors);
+    CHECK(first.books == second.books);
+    CHECK(first.tags == second.tags);
+}
+
+TEST_CASE("Generated rows fit the schema") {
+    RecordingSink sink;
+    gen::CatalogGenerator{SmallConfig()}.Generate(sink);
+
+    REQUIRE(sink.authors.size() == 200);
+    CHECK(std::set(sink.names.begin(), sink.names.end()).size() == sink.names.size());
+    CHECK(std::set(sink.books.begin(), sink.books.end()).size() == sink.books.size());
+    for (const auto& title : sink.titles) {
+        CHECK(!title.empty());
+        CHECK(title.size() <= 100);
+    }
+    for (const auto& tag : sink.tags) {
+        CHECK(tag.size() <= 30);
+    }
+}
+
+TEST_CASE("Zipf distribution prefers low ranks") {
+    gen::ZipfDistribution zipf{100, 1.1};
+    std::mt19937_64 engine{1};
+    std::map<size_t, int> hits;
+    for (int i = 0; i < 10000; ++i) {
+        auto rank = zipf(engine);
+        REQUIRE(rank >= 1);
+        REQUIRE(rank <= 100);
+        ++hits[rank];
+    }
+    CHECK(hits[1] > hits[2]);
+    CHECK(hits[2] > hits[10]);
+    CHECK(hits[1] > 10 * hits[50]);
+}
@@ -0,0 +1,272 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/journal/format.h"
+#include "../src/journal/unit_of_work_impl.h"
+#include "../src/sqlite/unit_of_work_impl.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct TempDir {
+    TempDir()
+        : path{std::filesystem::temp_directory_path() / ("bookypedia-journal-"s + std::to_string(::getpid()))} {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~TempDir() {
+        std::filesystem::remove_all(path);
+    }
+
+    std::filesystem::path path;
+};
+
+journal::JournalConfig MakeConfig(const TempDir& dir) {
+    journal::JournalConfig config;
+    config.path = dir.path / "journal";
+    config.retry_delay = std::chrono::milliseconds{10};
+    return config;
+}
+
+journal::Flusher::factory_maker_t SqliteStorage(const TempDir& dir) {
+    return [path = (dir.path / "db").string()] {
+        return std::make_unique<sqlite::UnitOfWorkFactoryImpl>(path);
+    };
+}
+
+// Хранилище чтений сеансов: пишет только поток сброса
+std::unique_ptr<app::UnitOfWorkFactory> SqliteReads(const TempDir& dir) {
+    return std::make_unique<sqlite::UnitOfWorkFactoryImpl>((dir.path / "db").string(), true);
+}
+
+// Первые failures записей автора падают, как при взаимоблокировке
+class FlakyAuthors : public sqlite::AuthorRepositoryImpl {
+public:
+    FlakyAuthors(sqlite::Connection& connection, int& failures)
+        : AuthorRepositoryImpl{connection}
+        , failures_{failures} {
+    }
+
+    void Save(const domain::Author& author) override {
+        if (failures_ > 0) {
+            --failures_;
+            throw std::runtime_error("deadlock detected");
+        }
+        AuthorRepositoryImpl::Save(author);
+    }
+
+private:
+    int& failures_;
+};
+
+class FlakyUnitOfWork : public sqlite::UnitOfWorkImpl {
+public:
+    FlakyUnitOfWork(sqlite::Connection& connection, int& failures)
+        : UnitOfWorkImpl{connection}
+        , authors_{connection, failures} {
+    }
+
+    FlakyAuthors& Authors() override {
+        return authors_;
+    }
+
+private:
+    FlakyAuthors authors_;
+};
+
+struct FlakyFactory : app::UnitOfWorkFactory {
+    FlakyFactory(const std::string& path, int& failures)
+        : db{path}
+        , failures{failures} {
+    }
+
+    std::shared_ptr<app::UnitOfWork> CreateUnitOfWork() override {
+        return std::make_shared<FlakyUnitOfWork>(db.GetConnection(), failures);
+    }
+
+    sqlite::Database db;
+    int& failures;
+};
+
+std::vector<std::string> AuthorNames(app::UnitOfWorkFactory& factory) {
+    std::vector<std::string> names;
+    for (const auto& author : factory.CreateUnitOfWork()->Authors().GetList()) {
+        names.push_back(author.GetName());
+    }
+    return names;
+}
+
+}  // namespace
+
+TEST_CASE("Journal operations survive encoding") {
+    const auto author_id = domain::AuthorId::New();
+    const auto book_id = domain::BookId::New();
+    const journal::operations_t operations{
+        journal::SaveAuthor{{author_id, "Author"s, 3}},
+        journal::SaveBook{{book_id, {author_id, ""s}, "Title"s, 1999}},
+        journal::SyncTags{{book_id, {{}, ""s}, "New title"s, 2000, 2}, {"a"s, "b"s}},
+        journal::DeleteBook{book_id},
+    };
+    const auto decoded = journal::DecodeOperations(journal::EncodeOperations(operations));
+    REQUIRE(decoded.size() == operations.size());
+    const auto& author = std::get<journal::SaveAuthor>(decoded[0]).author;
+    CHECK(author.GetId() == author_id);
+    CHECK(author.GetName() == "Author"s);
+    CHECK(author.GetVersion() == 3);
+    const auto& book = std::get<journal::SaveBook>(decoded[1]).book;
+    CHECK(book.GetAuthorId() == author_id);
+    CHECK(book.GetTitle() == "Title"s);
+    const auto& sync = std::get<journal::SyncTags>(decoded[2]);
+    CHECK(sync.book.GetVersion() == 2);
+    CHECK(sync.tags == std::vector<std::string>{"a"s, "b"s});
+    CHECK(std::get<journal::DeleteBook>(decoded[3]).book_id == book_id);
+
+    const auto encoded = journal::EncodeOperations(operations);
+    CHECK_THROWS_AS(journal::DecodeOperations(std::string_view{encoded}.substr(0, encoded.size() - 1)),
+                    journal::FormatError);
+}
+
+TEST_CASE("Journal file drops a torn tail and keeps numbering after compaction") {
+    TempDir dir;
+    const auto path = dir.path / "journal";
+    journal::JournalId id;
+    {
+        journal::JournalFile file{path};
+        id = file.GetId();
+        CHECK(file.Append("first"sv) == 1);
+        CHECK(file.Append("second"sv) == 2);
+    }
+    // Сбой посреди записи: заголовок третьей записи есть, байт операций нет
+    {
+        std::ofstream out{path, std::ios::binary | std::ios::app};
+        journal::RecordHeader torn{100, 0, 3};
+        out.write(reinterpret_cast<const char*>(&torn), sizeof(torn));
+    }
+    {
+        journal::JournalFile file{path};
+        CHECK(file.GetId() == id);
+        CHECK(file.LastPosition() == 2);
+        const auto records = file.Read(1);
+        REQUIRE(records.size() == 1);
+        CHECK(records.front().position == 2);
+        CHECK(records.front().payload == "second"s);
+        CHECK(file.Append("third"sv) == 3);
+        file.Compact();
+        CHECK(file.Read(0).empty());
+    }
+    journal::JournalFile file{path};
+    CHECK(file.LastPosition() == 3);
+    CHECK(file.Append("fourth"sv) == 4);
+}
+
+TEST_CASE("Write-behind commits reach the storage and are visible to later reads") {
+    TempDir dir;
+    const auto make_storage = SqliteStorage(dir);
+    journal::UnitOfWorkFactoryImpl factory{SqliteReads(dir), make_storage, MakeConfig(dir)};
+    app::UseCasesImpl use_cases{factory};
+
+    const auto author_id = use_cases.AddAuthor("Author");
+    const auto book_id = use_cases.AddBook(1990, author_id, "Book");
+    use_cases.AddTags(book_id, {"tag"});
+    use_cases.Commit();
+
+    // Чтение дожидается применения журнала
+    const auto books = use_cases.GetBooksAuthors(author_id);
+    REQUIRE(books.size() == 1);
+    CHECK(books.front().title == "Book"s);
+    CHECK(use_cases.GetTagsByBookId(book_id) == std::vector<std::string>{"tag"s});
+    CHECK(factory.GetFlusher().PendingCount() == 0);
+    auto storage = make_storage();
+    CHECK(storage->CreateUnitOfWork()->GetJournalPosition(factory.GetFlusher().GetId().ToString()) == 1);
+}
+
+TEST_CASE("Journal replays records the storage has not applied, exactly once") {
+    TempDir dir;
+    const auto config = MakeConfig(dir);
+    const auto make_storage = SqliteStorage(dir);
+    {
+        // Процесс упал, не успев применить ни одной записи
+        journal::JournalFile file{config.path};
+        file.Append(journal::EncodeOperations({journal::SaveAuthor{{domain::AuthorId::New(), "First"s}}}));
+        file.Append(journal::EncodeOperations({journal::SaveAuthor{{domain::AuthorId::New(), "Second"s}}}));
+    }
+    {
+        journal::UnitOfWorkFactoryImpl factory{SqliteReads(dir), make_storage, config};
+        factory.GetFlusher().WaitApplied();
+        CHECK(AuthorNames(factory) == std::vector<std::string>{"First"s, "Second"s});
+    }
+    // Применённые записи при следующем открытии не повторяются: повтор вставил бы авторов заново
+    journal::UnitOfWorkFactoryImpl factory{SqliteReads(dir), make_storage, config};
+    CHECK(factory.GetFlusher().PendingCount() == 0);
+    CHECK(AuthorNames(factory) == std::vector<std::string>{"First"s, "Second"s});
+    CHECK_FALSE(std::filesystem::exists(config.path.string() + ".rejected"s));
+}
+
+TEST_CASE("Journal skips a record the storage refuses and applies the rest") {
+    TempDir dir;
+    const auto config = MakeConfig(dir);
+    const auto make_storage = SqliteStorage(dir);
+    journal::UnitOfWorkFactoryImpl factory{SqliteReads(dir), make_storage, config};
+    app::UseCasesImpl use_cases{factory};
+
+    const auto author_id = use_cases.AddAuthor("Author");
+    use_cases.Commit();
+    // Устаревшая версия: хранилище откажет, хотя коммит сеанса уже прошёл
+    use_cases.EditAuthorName(author_id, 5, "Renamed");
+    use_cases.Commit();
+    use_cases.AddAuthor("Other");
+    use_cases.Commit();
+
+    factory.GetFlusher().WaitApplied();
+    CHECK(AuthorNames(factory) == std::vector<std::string>{"Author"s, "Other"s});
+    std::ifstream rejected{config.path.string() + ".rejected"s};
+    std::string line;
+    REQUIRE(std::getline(rejected, line));
+    CHECK(line.substr(0, 2) == "2\t"s);
+    // Сеанс узнаёт об отказе один раз
+    const auto reported = use_cases.TakeRejectedWrites();
+    REQUIRE(reported.size() == 1);
+    CHECK(reported.front().starts_with("change #2: "s));
+    CHECK(use_cases.TakeRejectedWrites().empty());
+}
+
+TEST_CASE("Journal retries a batch after a transient error instead of rejecting the record") {
+    TempDir dir;
+    const auto config = MakeConfig(dir);
+    const auto path = (dir.path / "db").string();
+    int failures = 2;
+    journal::UnitOfWorkFactoryImpl factory{SqliteReads(dir), [&] {
+        return std::make_unique<FlakyFactory>(path, failures);
+    }, config};
+    app::UseCasesImpl use_cases{factory};
+
+    use_cases.AddAuthor("Author");
+    use_cases.Commit();
+    // Повторяющееся имя - отказ хранилища, который не пройдёт и при повторе
+    use_cases.AddAuthor("Author");
+    use_cases.Commit();
+
+    // Пока попытка применения не удалась, ожидание бросает её ошибку
+    while (true) {
+        try {
+            factory.GetFlusher().WaitApplied();
+            break;
+        } catch (const std::runtime_error&) {
+        }
+    }
+    CHECK(failures == 0);
+    CHECK(AuthorNames(factory) == std::vector<std::string>{"Author"s});
+    std::ifstream rejected{config.path.string() + ".rejected"s};
+    std::string line;
+    REQUIRE(std::getline(rejected, line));
+    CHECK(line.substr(0, 2) == "2\t"s);
+    CHECK_FALSE(std::getline(rejected, line));
+}
@@ -0,0 +1,208 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+#include <thread>
+
+#include "../src/metrics/metrics.h"
+#include "../src/metrics/startup.h"
+#include "../src/metrics/trace.h"
+
+using metrics::Histogram;
+
+TEST_CASE("Histogram buckets keep relative error bounded") {
+    for (uint64_t value : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456ull, 99999999ull}) {
+        const auto index = Histogram::BucketIndex(value);
+        const auto upper = Histogram::BucketUpperBound(index);
+        CHECK(upper >= value);
+        CHECK(upper - value <= value / Histogram::SUB_BUCKETS + 1);
+        if (index > 0) {
+            CHECK(Histogram::BucketUpperBound(index - 1) < value);
+        }
+    }
+    CHECK(Histogram::BucketIndex(UINT64_MAX) == Histogram::BUCKETS - 1);
+}
+
+TEST_CASE("Histogram quantiles") {
+    Histogram histogram;
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        histogram.Record(i);
+    }
+    CHECK(histogram.Count() == 1000);
+    CHECK(histogram.Max() == 1000);
+    const auto p50 = histogram.Quantile(0.5);
+    CHECK(p50 >= 500);
+    CHECK(p50 <= 500 + 500 / 16);
+    CHECK(histogram.Quantile(1.0) == 1000);
+    CHECK(histogram.CountAtMost(15) == 15);
+}
+
+TEST_CASE("Latencies recorded on several threads are merged") {
+    auto& latency = metrics::Latency(metrics::Scope::STATEMENT, "test.merge");
+    auto& counter = metrics::GetCounter("test_merge");
+    auto work = [&] {
+        for (int i = 0; i < 100; ++i) {
+            latency.Record(std::chrono::milliseconds(1));
+            counter.Increment();
+        }
+    };
+    std::thread first{work}, second{work};
+    first.join();
+    second.join();
+
+    bool found = false;
+    for (const auto& snapshot : metrics::CollectLatencies()) {
+        if (snapshot.name == "test.merge") {
+            found = true;
+            CHECK(snapshot.histogram.Count() == 200);
+        }
+    }
+    CHECK(found);
+    for (const auto& snapshot : metrics::CollectCounters()) {
+        if (snapshot.name == "test_merge") {
+            CHECK(snapshot.value == 200);
+        }
+    }
+
+    std::ostringstream out;
+    metrics::WritePrometheus(out);
+    CHECK(out.str().find("bookypedia_latency_seconds_count{scope=\"statement\",name=\"test.merge\"} 200") != std::string::npos);
+}
+
+TEST_CASE("Startup timeline keeps parallel phases in start order") {
+    using namespace std::chrono;
+    auto& timeline = metrics::StartupTimeline::Instance();
+    timeline.Clear();
+    const auto origin = steady_clock::now();
+    timeline.Record("test.schema", origin + milliseconds(5), origin + milliseconds(25));
+    timeline.Record("test.connect", origin, origin + milliseconds(5));
+    {
+        std::thread worker{[] {
+            metrics::StartupTimer timer{"test.preload"};
+        }};
+        worker.join();
+    }
+
+    const auto phases = timeline.GetPhases();
+    REQUIRE(phases.size() == 3);
+    CHECK(phases[2].name == "test.preload");
+    CHECK(phases[2].end >= phases[2].start);
+
+    std::ostringstream out;
+    timeline.Write(out, origin, origin + milliseconds(30));
+    const auto report = out.str();
+    const auto connect = report.find("test.connect");
+    const auto schema = report.find("test.schema");
+    REQUIRE(connect != std::string::npos);
+    REQUIRE(schema != std::string::npos);
+    CHECK(connect < schema);
+    CHECK(report.find("20.000") != std::string::npos);
+    CHECK(report.find("30.000") != std::string::npos);
+    timeline.Clear();
+}
+
+TEST_CASE("Trace records nested spans of sampled commands") {
+    using namespace std::chrono;
+    auto& command = metrics::Latency(metrics::Scope::COMMAND, "TestCommand");
+    auto& use_case = metrics::Latency(metrics::Scope::USE_CASE, "TestUseCase");
+    auto& statement = metrics::Latency(metrics::Scope::STATEMENT, "test.statement");
+    metrics::ClearSpans();
+
+    // Выборка решается для корня: вложенные интервалы не попадают в трассу без него
+    metrics::ConfigureTracing({"unused.json", 0.0});
+    {
+        metrics::ScopedTimer command_timer{command};
+        metrics::ScopedTimer use_case_timer{use_case};
+        metrics::RecordSpan(statement, steady_clock::now(), steady_clock::now());
+    }
+    CHECK(metrics::CollectSpans().empty());
+
+    metrics::ConfigureTracing({"unused.json", 1.0});
+    {
+        metrics::ScopedTimer command_timer{command};
+        metrics::ScopedTimer use_case_timer{use_case};
+        const auto start = steady_clock::now();
+        metrics::RecordSpan(statement, start, start + microseconds(10));
+    }
+    metrics::DisableTracing();
+    {
+        metrics::ScopedTimer untraced{command};
+    }
+
+    const auto spans = metrics::CollectSpans();
+    REQUIRE(spans.size() == 3);
+    CHECK(spans[0].name == "TestCommand");
+    CHECK(spans[1].name == "TestUseCase");
+    CHECK(spans[2].scope == metrics::Scope::STATEMENT);
+    CHECK(spans[0].start <= spans[1].start);
+    CHECK(spans[1].end <= spans[0].end);
+    CHECK(spans[0].thread == spans[2].thread);
+
+    std::ostringstream out;
+    metrics::WriteChromeTrace(out);
+    const auto trace = out.str();
+    CHECK(trace.find("{\"name\":\"TestCommand\",\"cat\":\"command\",\"ph\":\"X\"") != std::string::npos);
+    CHECK(trace.find("\"dur\":10.000") != std::string::npos);
+    metrics::ClearSpans();
+}
+
+TEST_CASE("Trace ring buffer keeps the latest spans of a thread") {
+    using namespace std::chrono;
+    auto& statement = metrics::Latency(metrics::Scope::STATEMENT, "test.ring");
+    metrics::ClearSpans();
+    metrics::ConfigureTracing({"unused.json", 1.0, 4});
+    std::thread worker{[&statement] {
+        const auto origin = steady_clock::now();
+        for (int i = 0; i < 10; ++i) {
+            metrics::RecordSpan(statement, origin + milliseconds(i), origin + milliseconds(i + 1));
+        }
+    }};
+    worker.join();
+    metrics::DisableTracing();
+
+    const auto spans = metrics::CollectSpans();
+    REQUIRE(spans.size() == 4);
+    CHECK(spans.back().start - spans.front().start == milliseconds(3));
+    metrics::ClearSpans();
+}
+
+TEST_CASE("Trace carries the sampling decision and parent span into worker threads") {
+    using namespace std::chrono;
+    auto& command = metrics::Latency(metrics::Scope::COMMAND, "TestFanOut");
+    auto& statement = metrics::Latency(metrics::Scope::STATEMENT, "test.fan_out");
+    auto run_on_worker = [&statement](const metrics::TraceContext& context) {
+        std::thread worker{[&statement, context] {
+            metrics::ScopedTraceContext scope{context};
+            metrics::RecordSpan(statement, steady_clock::now(), steady_clock::now());
+        }};
+        worker.join();
+    };
+    metrics::ClearSpans();
+
+    // Корень не попал в выборку - интервалы рабочего потока тоже не пишутся
+    metrics::ConfigureTracing({"unused.json", 0.0});
+    {
+        metrics::ScopedTimer timer{command};
+        metrics::ConfigureTracing({"unused.json", 1.0});
+        run_on_worker(metrics::TraceContext::Current());
+    }
+    CHECK(metrics::CollectSpans().empty());
+
+    {
+        metrics::ScopedTimer timer{command};
+        run_on_worker(metrics::TraceContext::Current());
+        run_on_worker(metrics::TraceContext::Current());
+    }
+    metrics::DisableTracing();
+
+    const auto spans = metrics::CollectSpans();
+    REQUIRE(spans.size() == 3);
+    CHECK(spans[0].name == "TestFanOut");
+    CHECK(spans[0].parent == 0);
+    for (size_t i = 1; i < spans.size(); ++i) {
+        CHECK(spans[i].parent == spans[0].id);
+        CHECK(spans[i].thread != spans[0].thread);
+    }
+    // Второй рабочий поток получил буфер первого, уже завершившегося
+    CHECK(spans[1].thread == spans[2].thread);
+    metrics::ClearSpans();
+}
@@ -0,0 +1,41 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+
+#include "../src/ui/output.h"
+
+using namespace std::literals;
+
+TEST_CASE("Rows are rendered in every output format") {
+    const app::detail::BookInfo book{"Tab\there \"quoted\"", 1999, "Author", "id-1"};
+    std::ostringstream human, tsv, jsonl;
+    {
+        ui::BufferedOutput out{human};
+        ui::RowWriter{out, ui::OutputFormat::HUMAN}.WriteBook(book);
+    }
+    {
+        ui::BufferedOutput out{tsv};
+        ui::RowWriter{out, ui::OutputFormat::TSV}.WriteBook(book);
+    }
+    {
+        ui::BufferedOutput out{jsonl};
+        ui::RowWriter{out, ui::OutputFormat::JSONL}.WriteBook(book);
+    }
+    CHECK(human.str() == "1 Tab\there \"quoted\" by Author, 1999\n");
+    CHECK(tsv.str() == "id-1\tTab\\there \"quoted\"\tAuthor\t1999\n");
+    CHECK(jsonl.str() == R"({"id":"id-1","title":"Tab\there \"quoted\"","author":"Author","year":1999})"s + "\n");
+}
+
+TEST_CASE("Buffered output writes only on flush or when full") {
+    std::ostringstream stream;
+    ui::BufferedOutput out{stream, 8};
+    out << "abc"sv;
+    CHECK(stream.str().empty());
+    out << "defghij"sv;
+    CHECK(stream.str() == "abcdefghij");
+    out << 42;
+    out.Flush();
+    CHECK(stream.str() == "abcdefghij42");
+    CHECK(ui::ParseOutputFormat("tsv") == ui::OutputFormat::TSV);
+    CHECK(!ui::ParseOutputFormat("xml"));
+}
@@ -0,0 +1,235 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <pqxx/pqxx>
+
+#include "../src/gen/generator.h"
+#include "../src/gen/sinks.h"
+#include "../src/postgres/postgres.h"
+
+using namespace std::literals;
+using pqxx::operator"" _zv;
+
+namespace {
+
+// База целиком перезаписывается тестом - только отдельная, тестовая
+constexpr const char PLAN_DB_URL_ENV_NAME[]{"BOOKYPEDIA_PLAN_TEST_DB_URL"};
+
+// Таблицы, полный просмотр которых на рабочем каталоге недопустим
+const std::set<std::string> LARGE_TABLES{"books"s, "book_tags"s};
+
+/**
+ * Ожидания от плана подготовленного запроса репозитория. В args - SQL-литералы аргументов EXECUTE;
+ * {author}, {author_name}, {book}, {title} и {tag} заменяются значениями из загруженного каталога
+ */
+struct PlanExpectation {
+    std::string args;
+    // Индексы (родительские, для секций books), которые должны встретиться в плане
+    std::vector<std::string> indexes;
+    // Оценка строк корневого узла; 0 - без ограничения
+    double max_rows = 0;
+    // Разрешён полный просмотр больших таблиц: выгрузки и сверки
+    bool full_scan = false;
+    // Сколько секций books может прочитать план; 0 - без ограничения
+    size_t max_partitions = 0;
+};
+
+const std::string ZERO_ID = "'00000000-0000-0000-0000-000000000000'"s;
+
+const std::map<std::string, PlanExpectation> EXPECTATIONS{
+    {"authors.delete_by_name"s, {"'{author_name}'"s, {"authors_name_key"s}}},
+    {"authors.delete"s, {"'{author}'"s, {"authors_pkey"s}}},
+    {"authors.save"s, {"'{new_id}', 'Plan Test'"s, {}}},
+    {"authors.update_versioned"s, {"'{author}', 'Plan Test', 1"s, {"authors_pkey"s}, 1}},
+    {"authors.list"s, {""s, {}, 0, true}},
+    {"authors.by_name"s, {"'{author_name}'"s, {"authors_name_key"s}, 1}},
+    {"authors.exists"s, {"'{author}'"s, {"authors_pkey"s}, 1}},
+    {"tags.by_name"s, {"'{tag}'"s, {"tags_name_key"s}, 1}},
+    {"tags.insert"s, {"'plan test'"s, {}}},
+    {"book_tags.clear"s, {"'{book}'"s, {"book_tags_pkey"s}}},
+    {"book_tags.save"s, {"'{book}', 1"s, {}}},
+    {"book_tags.by_book"s, {"'{book}'"s, {"book_tags_pkey"s}, 50}},
+    {"book_tags.names_by_book"s, {"'{book}'"s, {"book_tags_pkey"s}, 50}},
+    {"book_tags.sync"s, {"'{book}', 'Plan Test', 1990, ARRAY['a', 'b']::varchar[], 0"s,
+                         {"book_id_constraint"s, "book_tags_pkey"s}}},
+    {"books.delete"s, {"'{book}'"s, {"book_years_pkey"s, "book_id_constraint"s}}},
+    {"books.edit"s, {"'{book}', 'Plan Test', 1990, 0"s, {"book_years_pkey"s, "book_id_constraint"s}}},
+    {"books.save"s, {"'{new_id}', '{author}', 'Plan Test', 1990"s, {}}},
+    {"books.list"s, {""s, {}, 0, true}},
+    {"books.by_author"s, {"'{author}'"s, {"books_by_author_year"s}, 1000}},
+    {"books.by_title"s, {"'{title}'"s, {"books_by_title"s}, 100}},
+    {"books.by_years"s, {"1990, 1999, 1989, '', "s + ZERO_ID + ", 100"s, {"books_by_year"s}, 100, false, 1}},
+    {"books.by_author_years"s, {"'{author}', 1990, 1999, 1989, '', "s + ZERO_ID + ", 100"s,
+                                {"books_by_author_year"s}, 100, false, 1}},
+    {"books.exists"s, {"'{book}'"s, {"book_years_pkey"s}, 1}},
+    {"stats.books"s, {""s, {}, 1}},
+    {"stats.author_books"s, {"'{author}'"s, {"author_stats_pkey"s}, 1}},
+    {"stats.top_authors"s, {"10"s, {}, 10}},
+    {"stats.top_tags"s, {"10"s, {}, 10}},
+    {"stats.years"s, {""s, {}}},
+    {"stats.verify"s, {""s, {}, 0, true}},
+};
+
+struct PlanSummary {
+    double root_rows = 0;
+    // Просмотренные таблицы и индексы, секции books - под именем родителя
+    std::set<std::string> indexes;
+    std::set<std::string> seq_scanned;
+    std::set<std::string> partitions;
+};
+
+class PlanReader {
+public:
+    explicit PlanReader(pqxx::work& work) {
+        // Секции таблиц и индексов наследуют от родительских
+        for (auto [child, parent] : work.stream<std::string, std::string>(R"(
+SELECT child.relname, parent.relname FROM pg_inherits
+INNER JOIN pg_class AS child ON child.oid = pg_inherits.inhrelid
+INNER JOIN pg_class AS parent ON parent.oid = pg_inherits.inhparent;
+)")) {
+            parents_.emplace(std::move(child), std::move(parent));
+        }
+    }
+
+    PlanSummary Read(const std::string& json) const {
+        boost::property_tree::ptree tree;
+        std::istringstream input{json};
+        boost::property_tree::read_json(input, tree);
+        PlanSummary summary;
+        const auto& root = tree.front().second.get_child("Plan");
+        summary.root_rows = root.get<double>("Plan Rows");
+        Visit(root, summary);
+        return summary;
+    }
+
+private:
+    std::string Parent(const std::string& name) const {
+        const auto it = parents_.find(name);
+        return it == parents_.end() ? name : it->second;
+    }
+
+    void Visit(const boost::property_tree::ptree& node, PlanSummary& summary) const {
+        const auto type = node.get<std::string>("Node Type", {});
+        if (const auto relation = node.get_optional<std::string>("Relation Name")) {
+            const auto table = Parent(*relation);
+            if (type == "Seq Scan"s) {
+                summary.seq_scanned.insert(table);
+            }
+            if (table == "books"s && *relation != table) {
+                summary.partitions.insert(*relation);
+            }
+        }
+        if (const auto index = node.get_optional<std::string>("Index Name")) {
+            summary.indexes.insert(Parent(*index));
+        }
+        if (const auto children = node.get_child_optional("Plans")) {
+            for (const auto& [key, child] : *children) {
+                Visit(child, summary);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> parents_;
+};
+
+std::string Substitute(std::string text, const std::map<std::string, std::string>& values) {
+    for (const auto& [key, value] : values) {
+        for (auto pos = text.find(key); pos != std::string::npos; pos = text.find(key, pos + value.size())) {
+            text.replace(pos, key.size(), value);
+        }
+    }
+    return text;
+}
+
+std::string Quote(const std::string& name) {
+    return "\""s + name + "\""s;
+}
+
+}  // namespace
+
+TEST_CASE("Repository statements keep their query plans") {
+    const auto* url = std::getenv(PLAN_DB_URL_ENV_NAME);
+    if (!url) {
+        WARN(PLAN_DB_URL_ENV_NAME + " is not set, query plans are not checked"s);
+        return;
+    }
+
+    postgres::Database db{postgres::Connect(url)};
+    auto& connection = db.GetConnection();
+    {
+        pqxx::work work{connection};
+        work.exec("TRUNCATE book_tags, books, book_years, authors, tags, author_stats, tag_stats, year_stats RESTART IDENTITY;"_zv);
+        gen::GeneratorConfig config;
+        config.authors = 3000;
+        config.max_books_per_author = 50;
+        gen::PostgresCopySink sink{work};
+        gen::CatalogGenerator{config}.Generate(sink);
+        work.commit();
+    }
+    pqxx::nontransaction{connection}.exec("ANALYZE;"_zv);
+
+    pqxx::work work{connection};
+    std::map<std::string, std::string> values;
+    {
+        // Самый плодовитый автор: оценки строк по нему - худший случай
+        const auto author_row = work.exec1(R"(
+SELECT authors.id::text, name FROM authors
+INNER JOIN author_stats ON author_stats.author_id = authors.id
+ORDER BY book_count DESC, name LIMIT 1;
+)");
+        const auto author = author_row[0].as<std::string>();
+        const auto book_row = work.exec_params1(
+            "SELECT id::text, title FROM books WHERE author_id = $1 ORDER BY title LIMIT 1;"_zv, author);
+        values = {{"{author}"s, author},
+                  {"{author_name}"s, work.esc(author_row[1].as<std::string>())},
+                  {"{book}"s, book_row[0].as<std::string>()},
+                  {"{title}"s, work.esc(book_row[1].as<std::string>())},
+                  {"{tag}"s, work.esc(work.query_value<std::string>("SELECT name FROM tags ORDER BY id LIMIT 1;"))},
+                  {"{new_id}"s, "11111111-1111-1111-1111-111111111111"s}};
+    }
+
+    const PlanReader reader{work};
+    std::set<std::string> prepared;
+    for (auto [name] : work.stream<std::string>("SELECT name FROM pg_prepared_statements;"_zv)) {
+        prepared.insert(name);
+    }
+    for (const auto& name : prepared) {
+        INFO("statement " << name);
+        const auto it = EXPECTATIONS.find(name);
+        // Новый запрос репозитория должен получить ожидания от плана
+        REQUIRE(it != EXPECTATIONS.end());
+        const auto& expected = it->second;
+
+        const auto args = Substitute(expected.args, values);
+        const auto plan = reader.Read(work.query_value<std::string>(
+            "EXPLAIN (FORMAT JSON) EXECUTE "s + Quote(name) + (args.empty() ? ""s : "("s + args + ")"s)));
+        for (const auto& index : expected.indexes) {
+            INFO("index " << index);
+            CHECK(plan.indexes.count(index) == 1);
+        }
+        if (!expected.full_scan) {
+            for (const auto& table : plan.seq_scanned) {
+                INFO("sequential scan on " << table);
+                CHECK(LARGE_TABLES.count(table) == 0);
+            }
+        }
+        if (expected.max_rows > 0) {
+            CHECK(plan.root_rows <= expected.max_rows);
+        }
+        if (expected.max_partitions > 0) {
+            CHECK(plan.partitions.size() <= expected.max_partitions);
+        }
+    }
+    for (const auto& [name, expected] : EXPECTATIONS) {
+        INFO("expectation without a statement: " << name);
+        CHECK(prepared.count(name) == 1);
+    }
+}
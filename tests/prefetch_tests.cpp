@@ -0,0 +1,82 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "../src/app/prefetch.h"
+#include "../src/app/use_cases_impl.h"
+#include "../src/sqlite/unit_of_work_impl.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct TempDatabase {
+    TempDatabase()
+        : path{std::filesystem::temp_directory_path() / ("bookypedia-prefetch-"s + std::to_string(::getpid()) + ".db"s)} {
+        Remove();
+    }
+    ~TempDatabase() {
+        Remove();
+    }
+    void Remove() {
+        for (const auto* suffix : {"", "-wal", "-shm"}) {
+            std::filesystem::remove(path.string() + suffix);
+        }
+    }
+
+    std::filesystem::path path;
+};
+
+}  // namespace
+
+TEST_CASE("Prefetcher loads book tags on its own connection until the session writes") {
+    TempDatabase db;
+    sqlite::UnitOfWorkFactoryImpl factory{db.path.string()};
+    app::UseCasesImpl use_cases{factory};
+    const auto author_id = use_cases.AddAuthor("Author");
+    const auto book_id = use_cases.AddBook(1990, author_id, "Book");
+    use_cases.AddTags(book_id, {"first", "second"});
+    use_cases.Commit();
+
+    app::BookDetailPrefetcher prefetcher{[&db] {
+        return std::make_unique<sqlite::UnitOfWorkFactoryImpl>(db.path.string());
+    }};
+    use_cases.SetPrefetcher(&prefetcher);
+    use_cases.PrefetchBookDetails(use_cases.GetBooks());
+    use_cases.FinishRead();
+    prefetcher.WaitIdle();
+    const auto prefetched = prefetcher.FindTags(book_id);
+    REQUIRE(prefetched);
+    CHECK(*prefetched == std::vector<std::string>{"first", "second"});
+    CHECK(use_cases.GetTagsByBookId(book_id) == *prefetched);
+
+    // После коммита сеанса загруженное могло устареть
+    use_cases.AddTags(book_id, {"third"});
+    use_cases.Commit();
+    CHECK_FALSE(prefetcher.FindTags(book_id));
+    CHECK(use_cases.GetTagsByBookId(book_id).size() == 3);
+    use_cases.Commit();
+}
+
+TEST_CASE("Prefetched tags expire after max_age") {
+    TempDatabase db;
+    sqlite::UnitOfWorkFactoryImpl factory{db.path.string()};
+    app::UseCasesImpl use_cases{factory};
+    const auto book_id = use_cases.AddBook(1990, use_cases.AddAuthor("Author"), "Book");
+    use_cases.Commit();
+
+    app::PrefetchConfig config;
+    config.max_age = std::chrono::milliseconds{0};
+    app::BookDetailPrefetcher prefetcher{[&db] {
+        return std::make_unique<sqlite::UnitOfWorkFactoryImpl>(db.path.string());
+    }, config};
+    prefetcher.Prefetch({book_id});
+    prefetcher.WaitIdle();
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    CHECK_FALSE(prefetcher.FindTags(book_id));
+}
@@ -0,0 +1,43 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+
+#include "../src/domain/author.h"
+#include "../src/postgres/query.h"
+
+using namespace std::literals;
+using postgres::detail::ColumnTraits;
+using postgres::detail::CountPlaceholders;
+using postgres::detail::CountSelectColumns;
+
+static_assert(CountPlaceholders("SELECT 1;") == 0);
+static_assert(CountPlaceholders("UPDATE books SET title = $2 WHERE id = $1 AND ($4 = 0 OR version = $4);") == 4);
+static_assert(CountPlaceholders("SELECT '$3' FROM books WHERE id = $1;") == 1);
+
+static_assert(CountSelectColumns("SELECT id, name, version FROM authors;") == 3);
+static_assert(CountSelectColumns("\nSELECT COALESCE(sum(book_count), 0)::int FROM year_stats;") == 1);
+static_assert(CountSelectColumns("SELECT EXISTS (SELECT 1 FROM books WHERE id = $1);") == 1);
+static_assert(CountSelectColumns("SELECT 'a,b', id FROM tags;") == 2);
+static_assert(CountSelectColumns("SELECT * FROM tags;") == 0);
+static_assert(CountSelectColumns("WITH t AS (SELECT 1) SELECT * FROM t;") == 0);
+static_assert(CountSelectColumns("DELETE FROM books WHERE id = $1;") == 0);
+
+using AuthorsByName = postgres::Query<"authors.by_name", "SELECT id, name, version FROM authors WHERE name = $1;",
+                                      postgres::Params<std::string>, postgres::Columns<domain::AuthorId, std::string, int>>;
+static_assert(AuthorsByName::NAME == "authors.by_name");
+
+TEST_CASE("Query columns are decoded from text") {
+    CHECK(ColumnTraits<int>::Decode("-42"sv) == -42);
+    CHECK(ColumnTraits<int64_t>::Decode("9000000000"sv) == 9'000'000'000);
+    CHECK_THROWS(ColumnTraits<int>::Decode("12a"sv));
+    CHECK_THROWS(ColumnTraits<int>::Decode(""sv));
+    CHECK(ColumnTraits<bool>::Decode("t"sv));
+    CHECK_FALSE(ColumnTraits<bool>::Decode("f"sv));
+    CHECK_THROWS(ColumnTraits<bool>::Decode("true"sv));
+
+    const auto id = domain::AuthorId::New();
+    CHECK(ColumnTraits<domain::AuthorId>::Decode(id.ToString()) == id);
+
+    const auto param = postgres::detail::ParamTraits<domain::AuthorId>::Encode(id);
+    CHECK(std::string_view(param.View()) == id.ToString());
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include "../src/domain/author.h"
+#include "../src/postgres/shard_routing.h"
+
+using postgres::JumpConsistentHash;
+using postgres::MergeSorted;
+
+TEST_CASE("Jump hash stays in range and spreads keys evenly") {
+    constexpr int32_t buckets = 8;
+    constexpr int keys = 80000;
+    std::vector<int> counts(buckets);
+    for (uint64_t key = 0; key < keys; ++key) {
+        const auto bucket = JumpConsistentHash(key * 0x9E3779B97F4A7C15ULL, buckets);
+        REQUIRE(bucket >= 0);
+        REQUIRE(bucket < buckets);
+        ++counts[bucket];
+    }
+    for (auto count : counts) {
+        CHECK(count > keys / buckets * 9 / 10);
+        CHECK(count < keys / buckets * 11 / 10);
+    }
+    CHECK(JumpConsistentHash(12345, 1) == 0);
+}
+
+TEST_CASE("Adding a shard moves keys only to the new shard") {
+    for (int32_t buckets = 1; buckets < 16; ++buckets) {
+        for (uint64_t key = 0; key < 1000; ++key) {
+            const auto hashed = key * 0x9E3779B97F4A7C15ULL;
+            const auto before = JumpConsistentHash(hashed, buckets);
+            const auto after = JumpConsistentHash(hashed, buckets + 1);
+            CHECK((after == before || after == buckets));
+        }
+    }
+}
+
+TEST_CASE("Author id picks a stable shard") {
+    const auto id = domain::AuthorId::FromString("6f1c2a3b-4d5e-4f60-8a7b-9c0d1e2f3a4b");
+    CHECK(postgres::ShardIndex(id, 4) == postgres::ShardIndex(domain::AuthorId::FromString(id.ToString()), 4));
+    CHECK(postgres::ShardKey(id) == 0x6f1c2a3b4d5e4f60ULL);
+}
+
+TEST_CASE("K-way merge keeps order and prefers earlier lists on ties") {
+    using Item = std::pair<int, std::string>;
+    std::vector<std::vector<Item>> lists{
+        {{1, "a"}, {4, "a"}, {7, "a"}},
+        {},
+        {{2, "c"}, {4, "c"}, {9, "c"}},
+        {{0, "d"}, {4, "d"}},
+    };
+    auto merged = MergeSorted(std::move(lists), [](const Item& lhs, const Item& rhs) {
+        return lhs.first < rhs.first;
+    });
+    const std::vector<Item> expected{{0, "d"}, {1, "a"}, {2, "c"}, {4, "a"}, {4, "c"}, {4, "d"}, {7, "a"}, {9, "c"}};
+    CHECK(merged == expected);
+    CHECK(MergeSorted(std::vector<std::vector<int>>{}, std::less<int>{}).empty());
+}
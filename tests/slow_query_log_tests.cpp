@@ -0,0 +1,35 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+
+#include "../src/postgres/slow_query_log.h"
+
+using postgres::NormalizeSql;
+
+TEST_CASE("SQL normalization keeps the statement shape") {
+    CHECK(NormalizeSql("SELECT id, name\n   FROM authors WHERE name = $1;") ==
+          "SELECT id, name FROM authors WHERE name = $1");
+    CHECK(NormalizeSql("SELECT * FROM books WHERE title = 'It''s' AND publication_year > 1999;") ==
+          "SELECT * FROM books WHERE title = ? AND publication_year > ?");
+    CHECK(NormalizeSql("SELECT col1, t2.x FROM t2") == "SELECT col1, t2.x FROM t2");
+}
+
+TEST_CASE("Rotating file keeps a bounded number of files") {
+    const auto dir = std::filesystem::temp_directory_path() / "bookypedia_rotating_file_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "slow.log";
+    {
+        postgres::RotatingFile file{path, 10, 2};
+        for (int i = 0; i < 5; ++i) {
+            file.Write("123456789\n");
+        }
+    }
+    CHECK(std::filesystem::exists(path));
+    CHECK(std::filesystem::exists(dir / "slow.log.1"));
+    CHECK(std::filesystem::exists(dir / "slow.log.2"));
+    CHECK(!std::filesystem::exists(dir / "slow.log.3"));
+    CHECK(std::filesystem::file_size(path) == 10);
+    std::filesystem::remove_all(dir);
+}
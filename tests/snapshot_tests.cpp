@@ -0,0 +1,126 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/snapshot/format.h"
+#include "../src/snapshot/unit_of_work_impl.h"
+#include "../src/snapshot/writer.h"
+
+using namespace std::literals;
+
+namespace {
+
+domain::Author MakeAuthor(const std::string& name) {
+    return {domain::AuthorId::New(), name, 1};
+}
+
+domain::Book MakeBook(const domain::Author& author, const std::string& title, int year) {
+    return {domain::BookId::New(), author, title, year, 1};
+}
+
+struct TempFile {
+    std::string path = (std::filesystem::temp_directory_path() / ("snapshot_test_"s + domain::BookId::New().ToString())).string();
+    ~TempFile() {
+        std::remove(path.c_str());
+    }
+};
+
+}  // namespace
+
+TEST_CASE("Snapshot URL") {
+    CHECK(snapshot::IsSnapshotUrl("snapshot:///var/lib/catalog.snap"sv));
+    CHECK_FALSE(snapshot::IsSnapshotUrl("sqlite:catalog.db"sv));
+    auto url = snapshot::ParseUrl("snapshot:///var/lib/catalog.snap?verify=0"sv);
+    CHECK(url.path == "/var/lib/catalog.snap");
+    CHECK_FALSE(url.verify_checksum);
+    CHECK(snapshot::ParseUrl("snapshot:catalog.snap"sv).verify_checksum);
+}
+
+TEST_CASE("Snapshot serves the catalog from the mapped file") {
+    const auto tolstoy = MakeAuthor("Tolstoy");
+    const auto chekhov = MakeAuthor("Chekhov");
+    const auto war = MakeBook(tolstoy, "War and Peace", 1869);
+    const auto anna = MakeBook(tolstoy, "Anna Karenina", 1877);
+    const auto stories = MakeBook(chekhov, "Stories", 1890);
+    const auto tolstoy_stories = MakeBook(tolstoy, "Stories", 1886);
+
+    snapshot::Writer writer;
+    writer.AddAuthor(tolstoy);
+    writer.AddAuthor(chekhov);
+    for (const auto& book : {war, anna, stories, tolstoy_stories}) {
+        writer.AddBook(book);
+    }
+    writer.AddTag({war.GetId(), "novel"});
+    writer.AddTag({war.GetId(), "history"});
+    writer.AddTag({anna.GetId(), "novel"});
+
+    TempFile file;
+    writer.Write(file.path);
+
+    snapshot::UnitOfWorkFactoryImpl factory{{file.path, true}};
+    app::UseCasesImpl use_cases{factory};
+
+    const auto authors = use_cases.GetAuthors();
+    REQUIRE(authors.size() == 2);
+    CHECK(authors[0].name == "Chekhov");
+    CHECK(authors[1].id == tolstoy.GetId().ToString());
+
+    const auto books = use_cases.GetBooks();
+    REQUIRE(books.size() == 4);
+    CHECK(books[0].title == "Anna Karenina");
+    CHECK(books[1].title == "Stories");
+    CHECK(books[1].author_name == "Chekhov");
+    CHECK(books[2].author_name == "Tolstoy");
+
+    const auto by_title = use_cases.FindBooksByTitle("Stories");
+    REQUIRE(by_title.size() == 2);
+    CHECK(by_title[0].author_name == "Chekhov");
+    CHECK(use_cases.FindBooksByTitle("Resurrection").empty());
+
+    const auto tolstoy_books = use_cases.GetBooksAuthors(tolstoy.GetId().ToString());
+    REQUIRE(tolstoy_books.size() == 3);
+    CHECK(tolstoy_books[0].title == "War and Peace");
+    CHECK(tolstoy_books[1].title == "Anna Karenina");
+
+    CHECK(use_cases.FindAuthorByName("Chekhov")->id == chekhov.GetId().ToString());
+    CHECK_FALSE(use_cases.FindAuthorByName("Gogol").has_value());
+    CHECK(use_cases.GetTagsByBookId(war.GetId().ToString()) == std::vector{"history"s, "novel"s});
+    CHECK(use_cases.GetTagsByBookId(stories.GetId().ToString()).empty());
+
+    CHECK_THROWS_AS(use_cases.AddAuthor("Gogol"), snapshot::ReadOnlyError);
+}
+
+TEST_CASE("Corrupted snapshot is rejected") {
+    snapshot::Writer writer;
+    writer.AddAuthor(MakeAuthor("Gogol"));
+    TempFile file;
+    writer.Write(file.path);
+    {
+        std::fstream stream{file.path, std::ios::in | std::ios::out | std::ios::binary};
+        stream.seekp(-1, std::ios::end);
+        stream.put('\x7f');
+    }
+    CHECK_THROWS_AS(snapshot::Catalog(file.path), snapshot::FormatError);
+    CHECK_NOTHROW(snapshot::Catalog(file.path, false));
+}
+
+TEST_CASE("Snapshot index out of bounds is rejected without checksum") {
+    snapshot::Writer writer;
+    writer.AddAuthor(MakeAuthor("Gogol"));
+    TempFile file;
+    writer.Write(file.path);
+    {
+        std::fstream stream{file.path, std::ios::in | std::ios::out | std::ios::binary};
+        snapshot::Header header{};
+        stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+        const uint32_t index = 7;
+        stream.seekp(static_cast<std::streamoff>(header.authors_by_id.offset));
+        stream.write(reinterpret_cast<const char*>(&index), sizeof(index));
+    }
+    CHECK_THROWS_AS(snapshot::Catalog(file.path, false), snapshot::FormatError);
+}
@@ -0,0 +1,214 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+#include "../src/app/use_cases_impl.h"
+#include "../src/domain/errors.h"
+#include "../src/sqlite/unit_of_work_impl.h"
+
+using namespace std::literals;
+
+namespace {
+
+struct Fixture {
+    sqlite::UnitOfWorkFactoryImpl factory{":memory:"s};
+    app::UseCasesImpl use_cases{factory};
+};
+
+}  // namespace
+
+TEST_CASE("SQLite URL scheme") {
+    CHECK(sqlite::IsSqliteUrl("sqlite:///var/lib/bookypedia.db"sv));
+    CHECK(sqlite::IsSqliteUrl("sqlite::memory:"sv));
+    CHECK_FALSE(sqlite::IsSqliteUrl("postgres://localhost/db"sv));
+    CHECK(sqlite::PathFromUrl("sqlite:///var/lib/bookypedia.db"sv) == "/var/lib/bookypedia.db");
+    CHECK(sqlite::PathFromUrl("sqlite:catalog.db"sv) == "catalog.db");
+    CHECK(sqlite::PathFromUrl("sqlite::memory:"sv) == ":memory:");
+}
+
+TEST_CASE_METHOD(Fixture, "SQLite backend stores authors, books and tags") {
+    const auto pushkin = use_cases.AddAuthor("Pushkin");
+    const auto gogol = use_cases.AddAuthor("Gogol");
+    const auto onegin = use_cases.AddBook(1833, pushkin, "Eugene Onegin");
+    use_cases.AddBook(1842, gogol, "Dead Souls");
+    use_cases.AddTags(onegin, {"novel", "poetry", "novel"});
+    use_cases.Commit();
+
+    const auto authors = use_cases.GetAuthors();
+    REQUIRE(authors.size() == 2);
+    CHECK(authors[0].name == "Gogol");
+    CHECK(authors[1].name == "Pushkin");
+    CHECK(authors[1].version == 1);
+
+    const auto books = use_cases.GetBooks();
+    REQUIRE(books.size() == 2);
+    CHECK(books[0].title == "Dead Souls");
+    CHECK(books[1].author_name == "Pushkin");
+    CHECK(use_cases.GetTagsByBookId(onegin) == std::vector{"novel"s, "poetry"s});
+
+    use_cases.DeleteAuthorAndDependencies(pushkin);
+    use_cases.Commit();
+    CHECK(use_cases.GetBooks().size() == 1);
+    CHECK(use_cases.GetTagsByBookId(onegin).empty());
+}
+
+TEST_CASE_METHOD(Fixture, "SQLite backend syncs tags and checks versions") {
+    const auto author = use_cases.AddAuthor("Tolstoy");
+    const auto book_id = use_cases.AddBook(1869, author, "War and Peace");
+    use_cases.AddTags(book_id, {"novel", "history"});
+    use_cases.Commit();
+
+    auto book = use_cases.FindBooksByTitle("War and Peace").at(0);
+    CHECK_FALSE(use_cases.EditBook(book_id, book.version, book.title, book.publication_year, {"history", "novel"}));
+    CHECK(use_cases.EditBook(book_id, book.version, book.title, book.publication_year, {"novel", "epic"}));
+    use_cases.Commit();
+    CHECK(use_cases.GetTagsByBookId(book_id) == std::vector{"epic"s, "novel"s});
+
+    // Версия, прочитанная до правки, устарела
+    CHECK_THROWS_AS(use_cases.EditBook(book_id, book.version, "Peace", 1869, {}), domain::VersionConflict);
+    use_cases.Rollback();
+
+    auto tolstoy = use_cases.FindAuthorByName("Tolstoy").value();
+    use_cases.EditAuthorName(author, tolstoy.version, "Leo Tolstoy");
+    use_cases.Commit();
+    CHECK_THROWS_AS(use_cases.EditAuthorName(author, tolstoy.version, "L. Tolstoy"), domain::VersionConflict);
+    use_cases.Rollback();
+    CHECK(use_cases.FindAuthorByName("Leo Tolstoy").has_value());
+}
+
+TEST_CASE_METHOD(Fixture, "SQLite backend rolls back uncommitted work") {
+    use_cases.AddAuthor("Chekhov");
+    use_cases.Rollback();
+    CHECK(use_cases.GetAuthors().empty());
+}
+
+TEST_CASE_METHOD(Fixture, "SQLite triggers keep catalog statistics") {
+    const auto pushkin = use_cases.AddAuthor("Pushkin");
+    const auto gogol = use_cases.AddAuthor("Gogol");
+    const auto onegin = use_cases.AddBook(1833, pushkin, "Eugene Onegin");
+    auto dubrovsky = use_cases.AddBook(1833, pushkin, "Dubrovsky");
+    const auto souls = use_cases.AddBook(1842, gogol, "Dead Souls");
+    use_cases.AddTags(onegin, {"novel", "poetry"});
+    use_cases.AddTags(souls, {"novel"});
+    use_cases.Commit();
+
+    auto stats = use_cases.GetCatalogStats(10);
+    CHECK(stats.books == 3);
+    REQUIRE(stats.top_authors.size() == 2);
+    CHECK(stats.top_authors[0].name == "Pushkin");
+    CHECK(stats.top_authors[0].books == 2);
+    REQUIRE(stats.top_tags.size() == 2);
+    CHECK(stats.top_tags[0].name == "novel");
+    CHECK(stats.top_tags[0].books == 2);
+    CHECK(stats.books_per_year == std::vector<std::pair<int, int>>{{1833, 2}, {1842, 1}});
+    CHECK(use_cases.GetCatalogStats(1).top_authors.size() == 1);
+
+    // Правка года переносит книгу между счётчиками, удаление автора снимает его книги и теги
+    const auto book = use_cases.FindBooksByTitle("Eugene Onegin").at(0);
+    CHECK(use_cases.EditBook(onegin, book.version, book.title, 1837, {"poetry"}));
+    use_cases.DeleteBookAndDependencies(dubrovsky);
+    use_cases.Commit();
+    CHECK(use_cases.CountAuthorBooks(pushkin) == 1);
+    CHECK(use_cases.GetCatalogStats(10).books_per_year == std::vector<std::pair<int, int>>{{1837, 1}, {1842, 1}});
+
+    use_cases.DeleteAuthorAndDependencies(gogol);
+    use_cases.Commit();
+    stats = use_cases.GetCatalogStats(10);
+    CHECK(stats.books == 1);
+    REQUIRE(stats.top_tags.size() == 1);
+    CHECK(stats.top_tags[0].name == "poetry");
+    CHECK(use_cases.CheckStats().empty());
+}
+
+TEST_CASE_METHOD(Fixture, "SQLite pages books by publication year") {
+    const auto pushkin = use_cases.AddAuthor("Pushkin");
+    const auto gogol = use_cases.AddAuthor("Gogol");
+    use_cases.AddBook(1820, pushkin, "Ruslan and Ludmila");
+    use_cases.AddBook(1833, pushkin, "Eugene Onegin");
+    use_cases.AddBook(1833, pushkin, "Bronze Horseman");
+    use_cases.AddBook(1836, pushkin, "The Captain's Daughter");
+    use_cases.AddBook(1835, gogol, "Taras Bulba");
+    use_cases.AddBook(1842, gogol, "Dead Souls");
+    use_cases.Commit();
+
+    std::vector<std::string> titles;
+    std::string page;
+    size_t pages = 0;
+    do {
+        auto result = use_cases.GetBooksByYearRange(1830, 1839, {}, page, 2);
+        CHECK(result.books.size() <= 2);
+        for (const auto& book : result.books) {
+            titles.push_back(book.title);
+        }
+        page = std::move(result.next_page);
+        ++pages;
+    } while (!page.empty());
+    CHECK(titles == std::vector{"Bronze Horseman"s, "Eugene Onegin"s, "Taras Bulba"s, "The Captain's Daughter"s});
+    // Четыре книги по две: третья страница пустая
+    CHECK(pages == 3);
+
+    const auto by_author = use_cases.GetBooksByYearRange(1800, 1899, gogol, {}, 10);
+    REQUIRE(by_author.books.size() == 2);
+    CHECK(by_author.books[0].title == "Taras Bulba");
+    CHECK(by_author.books[1].author_name == "Gogol");
+    CHECK(by_author.next_page.empty());
+    CHECK_THROWS_AS(use_cases.GetBooksByYearRange(1800, 1899, {}, "1833:broken"s, 10), std::invalid_argument);
+}
+
+TEST_CASE("SQLite book lookups by title and by author and year use indexes") {
+    sqlite::Database db{":memory:"s};
+    const auto plan = [&db](std::string_view sql) {
+        std::string details;
+        auto stmt = db.GetConnection().Prepare("EXPLAIN QUERY PLAN "s + std::string(sql));
+        while (stmt.Step()) {
+            details += stmt.ColumnText(3) + "\n"s;
+        }
+        return details;
+    };
+    CHECK(plan("SELECT id FROM books WHERE title = ?;"sv).find("books_by_title"s) != std::string::npos);
+    CHECK(plan(R"(
+SELECT id FROM books WHERE author_id = ? AND publication_year BETWEEN ? AND ?
+ORDER BY publication_year, title, id;
+)"sv).find("books_by_author_year"s) != std::string::npos);
+}
+
+TEST_CASE("SQLite write units of two connections wait for each other instead of failing") {
+    const auto path = std::filesystem::temp_directory_path() / ("bookypedia-sqlite-"s + std::to_string(::getpid()));
+    std::filesystem::remove(path);
+    {
+        sqlite::UnitOfWorkFactoryImpl first{path.string()};
+        sqlite::UnitOfWorkFactoryImpl second{path.string()};
+
+        // Единица работы, которая ещё ничего не читала, не мешает другому соединению писать
+        auto idle = first.CreateUnitOfWork();
+        auto unit = second.CreateUnitOfWork();
+        unit->Authors().Save({domain::AuthorId::New(), "Pushkin"s});
+        unit->Commit();
+        idle.reset();
+
+        // Чтение, затем запись, а между ними коммит другого соединения: при BEGIN DEFERRED запись
+        // получила бы SQLITE_BUSY_SNAPSHOT, теперь другое соединение ждёт конца транзакции
+        auto reader = first.CreateUnitOfWork();
+        CHECK(reader->Authors().GetList().size() == 1);
+        std::thread writer{[&] {
+            auto other = second.CreateUnitOfWork();
+            other->Authors().Save({domain::AuthorId::New(), "Gogol"s});
+            other->Commit();
+        }};
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        reader->Authors().Save({domain::AuthorId::New(), "Chekhov"s});
+        reader->Commit();
+        writer.join();
+
+        CHECK(first.CreateUnitOfWork()->Authors().GetList().size() == 3);
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(path.string() + "-wal"s);
+    std::filesystem::remove(path.string() + "-shm"s);
+}
@@ -0,0 +1,17 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "../src/ui/tag_tokenizer.h"
+
+using ui::TokenizeTags;
+using Tags = std::vector<std::string>;
+
+TEST_CASE("Tags are trimmed, sorted and deduplicated") {
+    CHECK(TokenizeTags("  sci-fi ,  adventure,sci-fi, , ") == Tags{"adventure", "sci-fi"});
+    CHECK(TokenizeTags("").empty());
+    CHECK(TokenizeTags(",,,").empty());
+}
+
+TEST_CASE("Whitespace runs inside a tag collapse to one space") {
+    CHECK(TokenizeTags("space    opera,hard\t\tscience") == Tags{"hard science", "space opera"});
+    CHECK(TokenizeTags("single\ttab") == Tags{"single\ttab"});
+}
@@ -13,4 +13,10 @@ TEST_CASE("UUID-String conversion") {
     auto uuid = TestUUID::New();
     auto s = uuid.ToString();
     CHECK(TestUUID::FromString(s) == uuid);
-}
\ No newline at end of file
+}
+TEST_CASE("UUID is written to a buffer as text") {
+    auto uuid = TestUUID::New();
+    char text[util::detail::UUID_TEXT_SIZE];
+    util::detail::UUIDToChars(*uuid, text);
+    CHECK(std::string_view(text, sizeof(text)) == uuid.ToString());
+}